@@ -0,0 +1,1369 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../parse_data/DataManager.h"
+#include "../routing/AllPairsTable.h"
+#include "../routing/ArcFlags.h"
+#include "../routing/BatchEngine.h"
+#include "../routing/ContractedGraph.h"
+#include "../routing/DeltaStepping.h"
+#include "../routing/GraphSnapshot.h"
+#include "../routing/LiveTraffic.h"
+#include "../routing/ParallelDijkstra.h"
+#include "../routing/ParkingIndex.h"
+#include "../routing/Preprocessing.h"
+#include "../routing/RouteCache.h"
+#include "../routing/Routing.h"
+#include "../routing/RouteRestrictions.h"
+#include "../routing/SearchKernels.h"
+#include "../routing/SearchTreeCache.h"
+#include "../routing/TravelTimeProfiles.h"
+#include "../routing/WorkStealing.h"
+
+bool Benchmark::loadGraph(
+    const std::string &locationsFilePath,
+    const std::string &distancesFilePath,
+    Graph<LocationInfo> &graph) {
+    if (!DataManager::getInstance()->loadData(locationsFilePath, distancesFilePath)) {
+        return false;
+    }
+    graph = GraphBuilder::buildGraphFromDataManager();
+    return true;
+}
+
+Graph<LocationInfo> Benchmark::buildGridCity(int side) {
+    Graph<LocationInfo> city;
+    for (int i = 0; i < side * side; i++) {
+        city.addVertex(LocationInfo("Block " + std::to_string(i), i, "G" + std::to_string(i), i % 7 == 0));
+    }
+
+    const auto &vertices = city.getVertexSet();
+    unsigned long long state = 88172645463325252ULL;
+    auto connect = [&](int a, int b) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        double driving = 1 + static_cast<double>(state % 9);
+        double walking = 3 * driving + static_cast<double>((state >> 32) % 4);
+        for (int direction = 0; direction < 2; direction++) {
+            Vertex<LocationInfo> *from = vertices[direction ? b : a];
+            Vertex<LocationInfo> *to = vertices[direction ? a : b];
+            from->addEdge(to, driving)->setType(Edge<LocationInfo>::EdgeType::DRIVING);
+            from->addEdge(to, walking)->setType(Edge<LocationInfo>::EdgeType::WALKING);
+        }
+    };
+    for (int row = 0; row < side; row++) {
+        for (int col = 0; col < side; col++) {
+            int v = row * side + col;
+            if (col + 1 < side)
+                connect(v, v + 1);
+            if (row + 1 < side)
+                connect(v, v + side);
+        }
+    }
+    return city;
+}
+
+double Benchmark::timeMillis(const std::function<void()> &work) {
+    auto start = std::chrono::steady_clock::now();
+    work();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+long Benchmark::mismatchCount = 0;
+
+long Benchmark::getMismatchCount() {
+    return mismatchCount;
+}
+
+std::string Benchmark::mismatchNote(long mismatches, const std::string &what) {
+    mismatchCount += mismatches;
+    return mismatches == 0 ? "" : "  (" + std::to_string(mismatches) + " " + what + "!)";
+}
+
+void Benchmark::report(const std::string &name, double millis, long queries, double baselineMillis) {
+    std::printf("  %-34s %10.2f ms %10.2f us/query", name.c_str(), millis, millis * 1000.0 / queries);
+    if (baselineMillis > 0) {
+        std::printf("   x%.2f", baselineMillis / millis);
+    }
+    std::printf("\n");
+}
+
+void Benchmark::searchKernels(const Graph<LocationInfo> &graph, int rounds) {
+    using EdgeType = Edge<LocationInfo>::EdgeType;
+    const auto &vertices = graph.getVertexSet();
+    long queries = static_cast<long>(vertices.size()) * rounds;
+
+    // Avoid every 37th location and one segment out of every 53rd location, like a busy restricted query
+    std::vector<int> avoidNodes;
+    std::vector<std::pair<int, int> > avoidSegments;
+    for (size_t i = 0; i < vertices.size(); i++) {
+        if (i % 37 == 36) {
+            avoidNodes.push_back(vertices[i]->getInfo().id);
+        } else if (i % 53 == 52 && !vertices[i]->getAdj().empty()) {
+            avoidSegments.emplace_back(vertices[i]->getInfo().id, vertices[i]->getAdj()[0]->getDest()->getInfo().id);
+        }
+    }
+    RouteRestrictions restrictions = RouteRestrictions::compile(graph, avoidNodes, avoidSegments, EdgeType::DRIVING);
+
+    // Checksums make sure every variant computed the same trees and keep the work from being optimised away
+    auto checksum = [](const Routing::SearchTree &tree) {
+        double sum = 0;
+        for (double d: tree.dist) {
+            if (d != INF)
+                sum += d;
+        }
+        return sum;
+    };
+
+    auto runErased = [&](const Routing::EdgeFilter &filter, double &sum) {
+        Routing::SearchTree tree;
+        for (int r = 0; r < rounds; r++) {
+            for (auto v: vertices) {
+                SearchKernels::grow<false>(graph, v, SearchKernels::ErasedEdge{&filter}, nullptr, 0, tree);
+                sum += checksum(tree);
+            }
+        }
+    };
+
+    auto runSpecialised = [&](const std::function<void(const Vertex<LocationInfo> *, Routing::SearchTree &)> &search,
+                              double &sum) {
+        Routing::SearchTree tree;
+        for (int r = 0; r < rounds; r++) {
+            for (auto v: vertices) {
+                search(v, tree);
+                sum += checksum(tree);
+            }
+        }
+    };
+
+    struct Variant {
+        std::string name;
+        Routing::EdgeFilter erased;
+        std::function<void(const Vertex<LocationInfo> *, Routing::SearchTree &)> specialised;
+    };
+
+    std::vector<Variant> variants = {
+        {
+            "unrestricted",
+            [](Edge<LocationInfo> *) { return true; },
+            [&](const Vertex<LocationInfo> *v, Routing::SearchTree &tree) {
+                SearchKernels::grow<false>(graph, v, SearchKernels::AnyEdge(), nullptr, 0, tree);
+            }
+        },
+        {
+            "driving-only",
+            [](Edge<LocationInfo> *e) { return e->getType() == EdgeType::DRIVING; },
+            [&](const Vertex<LocationInfo> *v, Routing::SearchTree &tree) {
+                SearchKernels::grow<false>(graph, v, SearchKernels::DrivingEdge(), nullptr, 0, tree);
+            }
+        },
+        {
+            "walking-only",
+            [](Edge<LocationInfo> *e) { return e->getType() == EdgeType::WALKING; },
+            [&](const Vertex<LocationInfo> *v, Routing::SearchTree &tree) {
+                SearchKernels::grow<false>(graph, v, SearchKernels::WalkingEdge(), nullptr, 0, tree);
+            }
+        },
+        {
+            "restricted (driving)",
+            [&restrictions](Edge<LocationInfo> *e) { return restrictions.allows(e); },
+            [&](const Vertex<LocationInfo> *v, Routing::SearchTree &tree) {
+                SearchKernels::grow<false>(graph, v, SearchKernels::RestrictedEdge<EdgeType::DRIVING>{&restrictions},
+                                           nullptr, 0, tree);
+            }
+        }
+    };
+
+    std::cout << "Search kernels: " << vertices.size() << " vertices, " << rounds << " round(s), "
+              << queries << " full trees per variant" << std::endl;
+
+    for (const auto &variant: variants) {
+        double erasedSum = 0;
+        double specialisedSum = 0;
+        double erasedMillis = timeMillis([&]() { runErased(variant.erased, erasedSum); });
+        double specialisedMillis = timeMillis([&]() { runSpecialised(variant.specialised, specialisedSum); });
+
+        std::cout << variant.name << mismatchNote(erasedSum != specialisedSum, "checksum mismatch") << std::endl;
+        report("type-erased std::function", erasedMillis, queries, 0);
+        report("compile-time kernel", specialisedMillis, queries, erasedMillis);
+    }
+}
+
+void Benchmark::allPairs(const Graph<LocationInfo> &graph) {
+    using EdgeType = Edge<LocationInfo>::EdgeType;
+    const auto &vertices = graph.getVertexSet();
+    long pairs = static_cast<long>(vertices.size()) * vertices.size();
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "All-pairs table: " << vertices.size() << " vertices, " << threads << " thread(s)" << std::endl;
+
+    for (EdgeType mode: {EdgeType::DRIVING, EdgeType::WALKING}) {
+        AllPairsTable serial;
+        AllPairsTable parallel;
+        double serialMillis = timeMillis([&]() { serial = AllPairsTable::compute(graph, mode, 1); });
+        double parallelMillis = timeMillis([&]() { parallel = AllPairsTable::compute(graph, mode, threads); });
+
+        long mismatches = 0;
+        Routing::SearchTree tree;
+        double searchMillis = timeMillis([&]() {
+            for (auto v: vertices) {
+                SearchKernels::growForMode<false>(graph, v, mode, nullptr, 0, tree);
+                for (auto w: vertices) {
+                    if (tree.dist[w->getIndex()] != parallel.getTime(v->getIndex(), w->getIndex()) ||
+                        serial.getTime(v->getIndex(), w->getIndex()) != parallel.getTime(v->getIndex(), w->getIndex()))
+                        mismatches++;
+                }
+            }
+        });
+
+        // Routes read from the table must be the ones the search trees hold, ties included
+        long routes = 0;
+        double routeMillis = 0;
+        for (size_t i = 0; i < vertices.size(); i += 7) {
+            SearchKernels::growForMode<false>(graph, vertices[i], mode, nullptr, 0, tree);
+            routeMillis += timeMillis([&]() {
+                for (size_t j = i % 11; j < vertices.size(); j += 11) {
+                    Routing::Route route = parallel.getRoute(vertices[i], vertices[j]);
+                    mismatches += route.edges != Routing::getTreeRoute(tree, vertices[j]).edges;
+                    routes++;
+                }
+            });
+        }
+
+        double sum = 0;
+        double lookupMillis = timeMillis([&]() {
+            for (auto v: vertices) {
+                for (auto w: vertices) {
+                    double time = parallel.getTime(v->getIndex(), w->getIndex());
+                    if (time != INF)
+                        sum += time;
+                }
+            }
+        });
+
+        std::string filename = "apsp_benchmark.bin";
+        AllPairsTable loaded;
+        double saveMillis = timeMillis([&]() { parallel.save(filename); });
+        bool ok = false;
+        double loadMillis = timeMillis([&]() { ok = AllPairsTable::load(filename, graph, mode, loaded); });
+        std::remove(filename.c_str());
+
+        std::cout << (mode == EdgeType::DRIVING ? "driving" : "walking")
+                  << mismatchNote(mismatches)
+                  << (ok ? "" : "  (load failed!)") << std::endl;
+        report("Floyd-Warshall, 1 thread", serialMillis, pairs, 0);
+        report("Floyd-Warshall, all threads", parallelMillis, pairs, serialMillis);
+        report("one search per source", searchMillis, pairs, 0);
+        report("table lookups", lookupMillis, pairs, 0);
+        report("routes read from the table", routeMillis, routes, 0);
+        report("save", saveMillis, pairs, 0);
+        report("load", loadMillis, pairs, 0);
+    }
+}
+
+void Benchmark::contraction(const Graph<LocationInfo> &graph, int rounds) {
+    using EdgeType = Edge<LocationInfo>::EdgeType;
+    const auto &vertices = graph.getVertexSet();
+    long queries = static_cast<long>(vertices.size()) * rounds * 2;
+
+    std::vector<int> avoidNodes;
+    for (size_t i = 0; i < vertices.size(); i++) {
+        if (i % 41 == 40)
+            avoidNodes.push_back(vertices[i]->getInfo().id);
+    }
+
+    std::cout << "Chain contraction: " << vertices.size() << " vertices, " << rounds << " round(s), "
+              << queries << " forward and backward trees per variant" << std::endl;
+
+    for (EdgeType mode: {EdgeType::DRIVING, EdgeType::WALKING}) {
+        std::shared_ptr<const ContractedGraph> contracted;
+        double buildMillis = timeMillis([&]() { contracted = ContractedGraph::build(graph, mode); });
+
+        for (bool restricted: {false, true}) {
+            RouteRestrictions restrictions = restricted
+                                                 ? RouteRestrictions::compile(graph, avoidNodes, {}, mode)
+                                                 : RouteRestrictions(mode);
+
+            std::vector<Routing::SearchTree> expected(vertices.size() * 2);
+            double fullMillis = timeMillis([&]() {
+                for (int r = 0; r < rounds; r++) {
+                    for (auto v: vertices) {
+                        SearchKernels::growRestricted<false>(graph, v, restrictions, nullptr, 0,
+                                                             expected[v->getIndex() * 2]);
+                        SearchKernels::growRestricted<true>(graph, v, restrictions, nullptr, 0,
+                                                            expected[v->getIndex() * 2 + 1]);
+                    }
+                }
+            });
+
+            long mismatches = 0;
+            Routing::SearchTree forward;
+            Routing::SearchTree backward;
+            double coreMillis = timeMillis([&]() {
+                for (int r = 0; r < rounds; r++) {
+                    for (auto v: vertices) {
+                        contracted->buildSearchTree(v, restrictions, false, forward);
+                        contracted->buildSearchTree(v, restrictions, true, backward);
+                        if (r == 0) {
+                            mismatches += forward.dist != expected[v->getIndex() * 2].dist ||
+                                          forward.parent != expected[v->getIndex() * 2].parent;
+                            mismatches += backward.dist != expected[v->getIndex() * 2 + 1].dist ||
+                                          backward.parent != expected[v->getIndex() * 2 + 1].parent;
+                        }
+                    }
+                }
+            });
+
+            std::cout << (mode == EdgeType::DRIVING ? "driving" : "walking")
+                      << (restricted ? " with avoided locations" : "") << ": core of "
+                      << contracted->getCore().getNumVertex() << " vertices and " << contracted->getCoreEdgeCount()
+                      << " edges, " << contracted->getChainCount() << " chains, built in " << buildMillis << " ms"
+                      << mismatchNote(mismatches) << std::endl;
+            report("full graph", fullMillis, queries, 0);
+            report("contracted core", coreMillis, queries, fullMillis);
+        }
+    }
+}
+
+void Benchmark::arcFlags(const Graph<LocationInfo> &graph, int queries) {
+    using EdgeType = Edge<LocationInfo>::EdgeType;
+    const auto &vertices = graph.getVertexSet();
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "Arc flags: " << vertices.size() << " vertices, " << queries << " queries per mode, "
+              << threads << " thread(s)" << std::endl;
+
+    for (EdgeType mode: {EdgeType::DRIVING, EdgeType::WALKING}) {
+        std::shared_ptr<const ArcFlags> index;
+        double serialMillis = timeMillis([&]() { index = ArcFlags::compute(graph, mode, 32, 1); });
+        double parallelMillis = timeMillis([&]() { index = ArcFlags::compute(graph, mode, 32, threads); });
+
+        // Deterministic pseudo-random pairs
+        std::vector<std::pair<int, int> > pairs;
+        unsigned long long state = 88172645463325252ULL;
+        for (int q = 0; q < queries; q++) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            pairs.emplace_back(static_cast<int>(state % vertices.size()),
+                               static_cast<int>((state >> 32) % vertices.size()));
+        }
+
+        std::vector<double> expected(pairs.size());
+        Routing::SearchTree tree;
+        std::vector<bool> isTarget(vertices.size(), false);
+        double plainMillis = timeMillis([&]() {
+            for (size_t q = 0; q < pairs.size(); q++) {
+                isTarget[pairs[q].second] = true;
+                SearchKernels::growForMode<false>(graph, vertices[pairs[q].first], mode, &isTarget, 1, tree);
+                isTarget[pairs[q].second] = false;
+                expected[q] = tree.dist[pairs[q].second];
+            }
+        });
+
+        long mismatches = 0;
+        long prunedSettled = 0;
+        double prunedMillis = timeMillis([&]() {
+            for (size_t q = 0; q < pairs.size(); q++) {
+                prunedSettled += index->search(graph, vertices[pairs[q].first], vertices[pairs[q].second], tree);
+                mismatches += tree.dist[pairs[q].second] != expected[q];
+            }
+        });
+
+        // Equal-cost ties must be broken the same way, so the routes match edge for edge
+        auto route = [](const Routing::SearchTree &searched, int target) {
+            std::vector<const Edge<LocationInfo> *> edges;
+            for (auto e = searched.parent[target]; e != nullptr; e = searched.parent[e->getOrig()->getIndex()]) {
+                edges.push_back(e);
+            }
+            return edges;
+        };
+        Routing::SearchTree full;
+        for (size_t q = 0; q < pairs.size(); q++) {
+            SearchKernels::growForMode<false>(graph, vertices[pairs[q].first], mode, nullptr, 0, full);
+            index->search(graph, vertices[pairs[q].first], vertices[pairs[q].second], tree);
+            mismatches += route(tree, pairs[q].second) != route(full, pairs[q].second);
+        }
+
+        std::cout << (mode == EdgeType::DRIVING ? "driving" : "walking") << ": " << index->getRegionCount()
+                  << " regions, " << index->getBoundaryCount() << " boundary vertices, "
+                  << prunedSettled / std::max(1, queries) << " vertices settled per pruned query"
+                  << mismatchNote(mismatches) << std::endl;
+        report("preprocessing, 1 thread", serialMillis, 1, 0);
+        report("preprocessing, all threads", parallelMillis, 1, serialMillis);
+        report("Dijkstra to target", plainMillis, queries, 0);
+        report("arc-flag Dijkstra", prunedMillis, queries, plainMillis);
+    }
+}
+
+void Benchmark::batch(const Graph<LocationInfo> &graph, int requests) {
+    using EdgeType = Edge<LocationInfo>::EdgeType;
+    const auto &vertices = graph.getVertexSet();
+    unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    ContractedGraph::prepare(graph);
+    ArcFlags::prepare(graph);
+    ParkingIndex::prepare(graph);
+
+    // Deterministic pseudo-random mix: half independent, a quarter restricted, a quarter eco
+    std::vector<BatchEngine::Request> batch;
+    unsigned long long state = 88172645463325252ULL;
+    for (int r = 0; r < requests; r++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        BatchEngine::Request request;
+        request.sourceId = vertices[state % vertices.size()]->getInfo().id;
+        request.destId = vertices[(state >> 32) % vertices.size()]->getInfo().id;
+        if (r % 4 == 2) {
+            request.kind = BatchEngine::RequestKind::RESTRICTED;
+            request.avoidNodes.push_back(vertices[(state >> 16) % vertices.size()]->getInfo().id);
+        } else if (r % 4 == 3) {
+            request.kind = BatchEngine::RequestKind::ECO;
+            request.maxWalkingTime = 5.0 * (1 + (state >> 48) % 6);
+        }
+        request.transportMode = EdgeType::DRIVING;
+        batch.push_back(request);
+    }
+
+    std::cout << "Batch engine: " << requests << " requests, " << hardwareThreads << " hardware thread(s)" << std::endl;
+
+    // Routing reports unreachable destinations on stdout; keep the table readable
+    std::streambuf *console = std::cout.rdbuf(nullptr);
+    std::vector<std::string> expected;
+    double serialMillis = 0;
+    std::vector<std::pair<unsigned int, double> > timings;
+    long mismatches = 0;
+    std::vector<unsigned int> poolSizes = {1, 2, 4};
+    for (unsigned int threads = 8; threads <= hardwareThreads; threads *= 2) {
+        poolSizes.push_back(threads);
+    }
+    if (hardwareThreads > poolSizes.back()) {
+        poolSizes.push_back(hardwareThreads);
+    }
+
+    for (unsigned int threads: poolSizes) {
+        BatchEngine engine(graph, threads);
+        std::vector<BatchEngine::Result> results;
+        double millis = timeMillis([&]() { results = engine.run(batch); });
+
+        for (size_t r = 0; r < batch.size(); r++) {
+            std::string formatted = BatchEngine::formatResult(batch[r], results[r]);
+            if (threads == 1)
+                expected.push_back(formatted);
+            else
+                mismatches += formatted != expected[r];
+        }
+        if (threads == 1)
+            serialMillis = millis;
+        timings.emplace_back(threads, millis);
+    }
+    std::cout.rdbuf(console);
+
+    if (mismatches != 0) {
+        std::cout << mismatchNote(mismatches) << std::endl;
+    }
+    for (const auto &timing: timings) {
+        report(std::to_string(timing.first) + " worker(s)", timing.second, requests,
+               timing.first == 1 ? 0 : serialMillis);
+    }
+}
+
+void Benchmark::routeCache(const Graph<LocationInfo> &graph, int requests) {
+    using EdgeType = Edge<LocationInfo>::EdgeType;
+    const auto &vertices = graph.getVertexSet();
+    unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    RouteCache *cache = RouteCache::getInstance();
+    ContractedGraph::prepare(graph);
+    ArcFlags::prepare(graph);
+    ParkingIndex::prepare(graph);
+
+    // A pool of distinct queries: half independent, a quarter restricted, a quarter eco
+    struct Query {
+        int kind;
+        std::string source;
+        std::string dest;
+        std::vector<int> avoidNodes;
+        double maxWalkingTime;
+    };
+    std::vector<Query> pool;
+    unsigned long long state = 88172645463325252ULL;
+    auto next = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    };
+    for (int q = 0; q < 200; q++) {
+        unsigned long long r = next();
+        Query query{q % 4, vertices[r % vertices.size()]->getInfo().code,
+                    vertices[(r >> 32) % vertices.size()]->getInfo().code, {}, 5.0 * (1 + (r >> 48) % 6)};
+        if (query.kind == 2) {
+            for (int a = 0; a < 3; a++) {
+                query.avoidNodes.push_back(vertices[next() % vertices.size()]->getInfo().id);
+            }
+        }
+        pool.push_back(query);
+    }
+
+    // Squaring a uniform draw favours the front of the pool; avoid lists come in a new order every time
+    std::vector<Query> stream;
+    for (int r = 0; r < requests; r++) {
+        double uniform = static_cast<double>(next() % 1000000) / 1000000;
+        Query query = pool[static_cast<size_t>(uniform * uniform * pool.size())];
+        std::reverse(query.avoidNodes.begin(), query.avoidNodes.begin() + next() % (query.avoidNodes.size() + 1));
+        stream.push_back(query);
+    }
+
+    auto answer = [&graph](const Query &query) {
+        switch (query.kind) {
+            case 2:
+                return Routing::formatRouteForOutput(Routing::findRouteWithRestrictions(
+                    graph, query.source, query.dest,
+                    RouteRestrictions::compile(graph, query.avoidNodes, {}, EdgeType::DRIVING)));
+            case 3:
+                return Routing::formatEcoRouteForOutput(Routing::findEnvironmentallyFriendlyRoute(
+                    graph, query.source, query.dest, query.maxWalkingTime));
+            default:
+                return Routing::formatRouteForOutput(Routing::findFastestRoute(
+                    graph, query.source, query.dest, EdgeType::DRIVING));
+        }
+    };
+    auto run = [&](unsigned int threads, std::vector<std::string> &answers) {
+        answers.assign(stream.size(), "");
+        std::atomic<size_t> claimed(0);
+        auto worker = [&]() {
+            for (size_t r = claimed++; r < stream.size(); r = claimed++) {
+                answers[r] = answer(stream[r]);
+            }
+        };
+        return timeMillis([&]() {
+            std::vector<std::thread> workers;
+            for (unsigned int t = 1; t < threads; t++) {
+                workers.emplace_back(worker);
+            }
+            worker();
+            for (auto &th: workers) {
+                th.join();
+            }
+        });
+    };
+
+    std::cout << "Route cache: " << requests << " queries drawn from " << pool.size() << ", "
+              << hardwareThreads << " hardware thread(s)" << std::endl;
+
+    // Routing reports unreachable destinations on stdout; keep the table readable
+    std::streambuf *console = std::cout.rdbuf(nullptr);
+    std::vector<std::string> expected;
+    std::vector<std::string> answers;
+    cache->setBudget(0);
+    double uncachedMillis = run(1, expected);
+
+    struct Variant {
+        std::string name;
+        size_t budget;
+        unsigned int threads;
+    };
+    std::vector<Variant> variants = {
+        {"cache, 1 thread", 64 << 20, 1},
+        {"cache, " + std::to_string(hardwareThreads) + " thread(s)", 64 << 20, hardwareThreads},
+        {"cache, 256 KiB budget", 256 << 10, hardwareThreads}
+    };
+    std::vector<std::pair<double, RouteCache::Stats> > results;
+    long mismatches = 0;
+    for (const auto &variant: variants) {
+        cache->setBudget(variant.budget);
+        RouteCache::Stats before = cache->getStats();
+        double millis = run(variant.threads, answers);
+        RouteCache::Stats stats = cache->getStats();
+        stats.hits -= before.hits;
+        stats.misses -= before.misses;
+        stats.evictions -= before.evictions;
+        results.emplace_back(millis, stats);
+        for (size_t r = 0; r < answers.size(); r++) {
+            mismatches += answers[r] != expected[r];
+        }
+    }
+    std::cout.rdbuf(console);
+
+    if (mismatches != 0) {
+        std::cout << mismatchNote(mismatches) << std::endl;
+    }
+    report("no cache", uncachedMillis, requests, 0);
+    for (size_t v = 0; v < variants.size(); v++) {
+        const RouteCache::Stats &stats = results[v].second;
+        report(variants[v].name, results[v].first, requests, uncachedMillis);
+        std::printf("    hit rate %.1f%%, %zu entries, %.1f KiB, %lu evictions\n", 100 * stats.hitRate(),
+                    stats.entries, stats.memoryBytes / 1024.0, stats.evictions);
+    }
+
+    cache->setBudget(0);
+}
+
+void Benchmark::hotReload(const std::string &locationsFilePath, const std::string &distancesFilePath, int reloads) {
+    using EdgeType = Edge<LocationInfo>::EdgeType;
+
+    // Routing and the loader report on stdout; keep the table readable
+    std::streambuf *console = std::cout.rdbuf(nullptr);
+    GraphSnapshot::Handle first;
+    double firstMillis = timeMillis([&]() { first = GraphSnapshot::load(locationsFilePath, distancesFilePath); });
+    std::cout.rdbuf(console);
+    if (first == nullptr) {
+        std::cout << "Hot reload: could not load the dataset" << std::endl;
+        return;
+    }
+    GraphSnapshot::publish(first);
+
+    // Deterministic pseudo-random driving queries, answered once before any reload
+    const auto &vertices = first->getGraph().getVertexSet();
+    size_t locationCount = vertices.size();
+    std::vector<std::pair<std::string, std::string> > queries;
+    unsigned long long state = 88172645463325252ULL;
+    for (int q = 0; q < 64; q++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        queries.emplace_back(vertices[state % vertices.size()]->getInfo().code,
+                             vertices[(state >> 32) % vertices.size()]->getInfo().code);
+    }
+    std::cout.rdbuf(nullptr);
+    std::vector<double> expected;
+    double idleMillis = timeMillis([&]() {
+        for (const auto &query: queries) {
+            expected.push_back(Routing::calculateRouteTime(Routing::findFastestRoute(
+                first->getGraph(), query.first, query.second, EdgeType::DRIVING)));
+        }
+    });
+    std::weak_ptr<const GraphSnapshot> firstAlive = first;
+    first.reset();
+
+    // One reader answers queries on the published snapshot until every reload is done
+    std::atomic<bool> done(false);
+    std::atomic<long> answered(0);
+    std::atomic<long> mismatches(0);
+    std::atomic<long> versions(0);
+    double slowestMillis = 0;
+    std::thread reader([&]() {
+        unsigned long lastVersion = 0;
+        for (size_t q = 0; !done.load(); q = (q + 1) % queries.size()) {
+            double millis = timeMillis([&]() {
+                GraphSnapshot::Handle snapshot = GraphSnapshot::current();
+                if (snapshot->getVersion() != lastVersion) {
+                    lastVersion = snapshot->getVersion();
+                    versions++;
+                }
+                double time = Routing::calculateRouteTime(Routing::findFastestRoute(
+                    snapshot->getGraph(), queries[q].first, queries[q].second, EdgeType::DRIVING));
+                mismatches += time != expected[q];
+            });
+            slowestMillis = std::max(slowestMillis, millis);
+            answered++;
+        }
+    });
+
+    double reloadMillis = timeMillis([&]() {
+        for (int r = 0; r < reloads; r++) {
+            GraphSnapshot::publish(GraphSnapshot::load(locationsFilePath, distancesFilePath));
+        }
+    });
+    done = true;
+    reader.join();
+    std::cout.rdbuf(console);
+
+    std::cout << "Hot reload: " << reloads << " reload(s) of " << locationCount << " locations while "
+              << answered.load() << " queries ran on " << versions.load() << " snapshot(s)" << std::endl;
+    report("first load", firstMillis, 1, 0);
+    report("queries, no reload", idleMillis, static_cast<long>(queries.size()), 0);
+    report("reload and publish", reloadMillis, reloads, firstMillis);
+    std::printf("  %-34s %10.2f ms\n", "slowest query during reloads", slowestMillis);
+    std::cout << "  answers that changed: " << mismatches.load() << ", first snapshot "
+              << (firstAlive.expired() ? "freed" : "still alive") << mismatchNote(mismatches.load())
+              << mismatchNote(!firstAlive.expired(), "leaked snapshot") << std::endl;
+
+    // Later benchmarks use their own graph and structures
+    GraphSnapshot::publish(nullptr);
+    ContractedGraph::clear();
+    ArcFlags::clear();
+    ParkingIndex::clear();
+    AllPairsTable::clear();
+}
+
+void Benchmark::preprocessing(const Graph<LocationInfo> &graph) {
+    using EdgeType = Edge<LocationInfo>::EdgeType;
+    unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> threadCounts = {1, 2, 4};
+    while (threadCounts.back() < hardwareThreads) {
+        threadCounts.push_back(threadCounts.back() * 2);
+    }
+
+    // Arc flags grow with the boundary, so a smaller city keeps the sweep short
+    Graph<LocationInfo> city = buildGridCity(50);
+
+    // Checksums of everything registered for a graph, in a fixed order
+    auto registered = [](const Graph<LocationInfo> &g) {
+        std::vector<unsigned long long> sums;
+        for (EdgeType mode: {EdgeType::DEFAULT, EdgeType::DRIVING, EdgeType::WALKING}) {
+            sums.push_back(ContractedGraph::find(g, mode)->getChecksum());
+        }
+        for (EdgeType mode: {EdgeType::DRIVING, EdgeType::WALKING}) {
+            sums.push_back(ArcFlags::find(g, mode)->getChecksum());
+        }
+        sums.push_back(ParkingIndex::find(g)->getChecksum());
+        for (EdgeType mode: {EdgeType::DRIVING, EdgeType::WALKING}) {
+            auto table = AllPairsTable::find(g, mode);
+            sums.push_back(table ? table->getChecksum() : 0);
+        }
+        return sums;
+    };
+
+    auto measure = [&](const std::string &name, const Graph<LocationInfo> &g) {
+        double sequentialMillis = timeMillis([&]() {
+            ContractedGraph::prepare(g);
+            ArcFlags::prepare(g);
+            ParkingIndex::prepare(g);
+            for (EdgeType mode: {EdgeType::DRIVING, EdgeType::WALKING}) {
+                if (g.getNumVertex() <= AllPairsTable::MAX_PREPARED_VERTICES)
+                    AllPairsTable::install(std::make_shared<const AllPairsTable>(AllPairsTable::compute(g, mode)));
+            }
+        });
+        std::vector<unsigned long long> expected = registered(g);
+
+        std::cout << "Preprocessing pipeline, " << name << ": " << g.getNumVertex() << " vertices, "
+                  << hardwareThreads << " hardware thread(s)" << std::endl;
+        report("prepare one after another", sequentialMillis, 1, 0);
+        for (unsigned int threads: threadCounts) {
+            Preprocessing::Report run = Preprocessing::prepare(g, threads);
+            bool same = registered(g) == expected;
+            report("pipeline, " + std::to_string(threads) + " thread(s)" + (same ? "" : "  (checksums differ!)"),
+                   run.millis, 1, sequentialMillis);
+            if (threads == threadCounts.back()) {
+                Preprocessing::printReport(run, std::cout);
+            }
+        }
+    };
+
+    measure("dataset", graph);
+    measure("50x50 grid city", city);
+
+    // Later benchmarks expect the dataset's structures, not the city's
+    ContractedGraph::clear();
+    ArcFlags::clear();
+    ParkingIndex::clear();
+    AllPairsTable::clear();
+}
+
+void Benchmark::parkingIndex(const Graph<LocationInfo> &graph, int queries) {
+    const auto &vertices = graph.getVertexSet();
+    SearchTreeCache *cache = SearchTreeCache::getInstance();
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::shared_ptr<const ParkingIndex> index;
+    double serialMillis = timeMillis([&]() { index = ParkingIndex::compute(graph, 16, 60, 1); });
+    double parallelMillis = timeMillis([&]() { index = ParkingIndex::compute(graph, 16, 60, threads); });
+
+    // Deterministic pseudo-random queries with walking limits between 5 and 30 minutes
+    struct EcoQuery {
+        std::string source;
+        std::string dest;
+        double maxWalkingTime;
+    };
+    std::vector<EcoQuery> ecoQueries;
+    unsigned long long state = 88172645463325252ULL;
+    for (int q = 0; q < queries; q++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        ecoQueries.push_back({
+            vertices[state % vertices.size()]->getInfo().code,
+            vertices[(state >> 32) % vertices.size()]->getInfo().code,
+            5.0 * (1 + (state >> 48) % 6)
+        });
+    }
+
+    auto run = [&](std::vector<double> &totals) {
+        totals.clear();
+        for (const auto &q: ecoQueries) {
+            cache->clear();
+            Routing::EcoRoute route = Routing::findEnvironmentallyFriendlyRoute(
+                graph, q.source, q.dest, q.maxWalkingTime, {}, {});
+            totals.push_back(route.isValid ? route.totalTime : -1);
+        }
+    };
+
+    std::vector<double> expected, indexed;
+    ParkingIndex::clear();
+    double scanMillis = timeMillis([&]() { run(expected); });
+    ParkingIndex::prepare(graph, 16, 60);
+    double indexedMillis = timeMillis([&]() { run(indexed); });
+    ParkingIndex::clear();
+    cache->clear();
+
+    long answered = 0;
+    for (const auto &q: ecoQueries) {
+        answered += index->isComplete(graph.findVertex(LocationInfo("", 0, q.dest, false))->getIndex(),
+                                      q.maxWalkingTime);
+    }
+    long mismatches = 0;
+    for (size_t q = 0; q < expected.size(); q++) {
+        mismatches += expected[q] != indexed[q];
+    }
+
+    std::cout << "Parking index: " << vertices.size() << " vertices, k = " << index->getK() << ", radius "
+              << index->getRadius() << " min, " << answered << " of " << queries << " queries answered from it"
+              << mismatchNote(mismatches) << std::endl;
+    report("preprocessing, 1 thread", serialMillis, 1, 0);
+    report("preprocessing, all threads", parallelMillis, 1, serialMillis);
+    report("eco, walking search per parking", scanMillis, queries, 0);
+    report("eco, parking index", indexedMillis, queries, scanMillis);
+}
+
+void Benchmark::multiQueue(const Graph<LocationInfo> &graph, int roots) {
+    using EdgeType = Edge<LocationInfo>::EdgeType;
+    unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> threadCounts = {1, 2, 4};
+    while (threadCounts.back() < hardwareThreads) {
+        threadCounts.push_back(threadCounts.back() * 2);
+    }
+    RouteRestrictions driving(EdgeType::DRIVING);
+    RouteRestrictions walking(EdgeType::WALKING);
+
+    Graph<LocationInfo> city = buildGridCity(100);
+
+    // One job is a list of seeds and the restrictions to search with
+    using Job = std::pair<std::vector<SearchKernels::Seed>, const RouteRestrictions *>;
+
+    auto measure = [&](const std::string &name, const Graph<LocationInfo> &g, const std::vector<Job> &jobs) {
+        std::vector<Routing::SearchTree> expected(jobs.size());
+        double sequentialMillis = timeMillis([&]() {
+            for (size_t j = 0; j < jobs.size(); j++) {
+                const RouteRestrictions &r = *jobs[j].second;
+                if (r.getTransportMode() == EdgeType::WALKING) {
+                    SearchKernels::growFrom<false>(g, jobs[j].first.data(), static_cast<int>(jobs[j].first.size()),
+                                                   SearchKernels::WalkingEdge(), nullptr, 0, expected[j]);
+                } else {
+                    SearchKernels::growFrom<false>(g, jobs[j].first.data(), static_cast<int>(jobs[j].first.size()),
+                                                   SearchKernels::DrivingEdge(), nullptr, 0, expected[j]);
+                }
+            }
+        });
+
+        std::cout << "MultiQueue Dijkstra, " << name << ": " << g.getNumVertex() << " vertices, " << jobs.size()
+                  << " searches, " << hardwareThreads << " hardware thread(s)" << std::endl;
+        report("sequential Dijkstra", sequentialMillis, static_cast<long>(jobs.size()), 0);
+
+        for (unsigned int threads: threadCounts) {
+            long mismatches = 0;
+            ParallelDijkstra::Stats total;
+            Routing::SearchTree tree;
+            double millis = timeMillis([&]() {
+                for (size_t j = 0; j < jobs.size(); j++) {
+                    ParallelDijkstra::Stats stats;
+                    ParallelDijkstra::searchFrom(g, jobs[j].first, *jobs[j].second, tree, threads, &stats);
+                    total.expansions += stats.expansions;
+                    total.stalePops += stats.stalePops;
+                    total.settled += stats.settled;
+                    for (size_t v = 0; v < tree.dist.size(); v++) {
+                        mismatches += std::memcmp(&tree.dist[v], &expected[j].dist[v], sizeof(double)) != 0 ||
+                                      tree.parent[v] != expected[j].parent[v];
+                    }
+                }
+            });
+
+            char waste[64];
+            std::snprintf(waste, sizeof(waste), ", waste %.3f, %.0f vertices/ms",
+                          total.settled == 0 ? 0.0 : static_cast<double>(total.expansions) / total.settled,
+                          millis > 0 ? total.expansions / millis : 0.0);
+            report("multiqueue, " + std::to_string(threads) + " thread(s)" + waste +
+                   mismatchNote(mismatches),
+                   millis, static_cast<long>(jobs.size()), sequentialMillis);
+        }
+    };
+
+    auto rootJobs = [&](const Graph<LocationInfo> &g) {
+        std::vector<Job> jobs;
+        const auto &vertices = g.getVertexSet();
+        for (int r = 0; r < roots; r++) {
+            jobs.push_back({{SearchKernels::Seed(vertices[(static_cast<size_t>(r) * 7919) % vertices.size()], 0)},
+                            &driving});
+        }
+        return jobs;
+    };
+
+    // Drive to every parking location, then walk on: one walking search seeded with the driving times
+    auto ecoJobs = [&](const Graph<LocationInfo> &g) {
+        std::vector<Job> jobs;
+        const auto &vertices = g.getVertexSet();
+        Routing::SearchTree drivingTree;
+        for (int r = 0; r < roots; r++) {
+            SearchKernels::growForMode<false>(g, vertices[(static_cast<size_t>(r) * 7919) % vertices.size()],
+                                              EdgeType::DRIVING, nullptr, 0, drivingTree);
+            std::vector<SearchKernels::Seed> seeds;
+            for (auto v: vertices) {
+                if (v->getInfo().hasParking && drivingTree.dist[v->getIndex()] != INF)
+                    seeds.emplace_back(v, drivingTree.dist[v->getIndex()]);
+            }
+            jobs.push_back({seeds, &walking});
+        }
+        return jobs;
+    };
+
+    measure("dataset", graph, rootJobs(graph));
+    measure("100x100 grid city", city, rootJobs(city));
+    measure("grid city, walking from every parking", city, ecoJobs(city));
+}
+
+void Benchmark::parallelEco(const Graph<LocationInfo> &graph, int queries) {
+    using EdgeType = Edge<LocationInfo>::EdgeType;
+    const auto &vertices = graph.getVertexSet();
+    SearchTreeCache *cache = SearchTreeCache::getInstance();
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    RouteRestrictions driving(EdgeType::DRIVING);
+    RouteRestrictions walking(EdgeType::WALKING);
+    ParkingIndex::clear();
+
+    std::vector<const Vertex<LocationInfo> *> parkings;
+    for (auto v: vertices) {
+        if (v->getInfo().hasParking)
+            parkings.push_back(v);
+    }
+
+    struct EcoQuery {
+        const Vertex<LocationInfo> *source;
+        const Vertex<LocationInfo> *dest;
+        double maxWalkingTime;
+    };
+    std::vector<EcoQuery> ecoQueries;
+    unsigned long long state = 88172645463325252ULL;
+    for (int q = 0; q < queries; q++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        ecoQueries.push_back({
+            vertices[state % vertices.size()],
+            vertices[(state >> 32) % vertices.size()],
+            5.0 * (1 + (state >> 48) % 6)
+        });
+    }
+
+    // Winning (parking, total) of every query, parking -1 when no route exists
+    using Answer = std::pair<int, double>;
+    std::vector<Answer> expected, serial, parallel;
+
+    double referenceMillis = timeMillis([&]() {
+        for (const auto &q: ecoQueries) {
+            Routing::SearchTree drivingTree = Routing::buildSearchTree(graph, q.source, driving);
+            Answer best(-1, INF);
+            for (auto parking: parkings) {
+                double drivingTime = drivingTree.dist[parking->getIndex()];
+                if (drivingTime == INF)
+                    continue;
+                Routing::SearchTree walkingTree = Routing::buildSearchTree(graph, parking, walking);
+                double walkingTime = walkingTree.dist[q.dest->getIndex()];
+                if (walkingTime <= q.maxWalkingTime && drivingTime + walkingTime < best.second) {
+                    best = {parking->getInfo().id, drivingTime + walkingTime};
+                }
+            }
+            expected.push_back(best);
+        }
+    });
+
+    auto run = [&](std::vector<Answer> &answers) {
+        for (const auto &q: ecoQueries) {
+            cache->clear();
+            Routing::EcoRoute route = Routing::findEnvironmentallyFriendlyRoute(
+                graph, q.source->getInfo().code, q.dest->getInfo().code, q.maxWalkingTime, {}, {});
+            answers.push_back(route.isValid ? Answer(route.parkingNode.id, route.totalTime) : Answer(-1, INF));
+        }
+    };
+
+    double serialMillis = timeMillis([&]() {
+        WorkStealing::SerialScope scope;
+        run(serial);
+    });
+    double parallelMillis = timeMillis([&]() { run(parallel); });
+    cache->clear();
+
+    long mismatches = 0;
+    for (size_t q = 0; q < expected.size(); q++) {
+        mismatches += (serial[q] != expected[q]) + (parallel[q] != expected[q]);
+    }
+
+    std::cout << "Parallel eco evaluation: " << parkings.size() << " parking locations, " << queries << " queries, "
+              << threads << " hardware thread(s)"
+              << mismatchNote(mismatches) << std::endl;
+    report("full walking tree per parking", referenceMillis, queries, 0);
+    report("pruned walks, 1 thread", serialMillis, queries, referenceMillis);
+    report("pruned walks, all threads", parallelMillis, queries, referenceMillis);
+}
+
+void Benchmark::deltaStepping(const Graph<LocationInfo> &graph, int roots) {
+    using EdgeType = Edge<LocationInfo>::EdgeType;
+    unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> threadCounts = {1, 2, 4};
+    while (threadCounts.back() < hardwareThreads) {
+        threadCounts.push_back(threadCounts.back() * 2);
+    }
+
+    Graph<LocationInfo> city = buildGridCity(100);
+
+    auto measure = [&](const std::string &name, const Graph<LocationInfo> &g) {
+        const auto &vertices = g.getVertexSet();
+        std::vector<const Vertex<LocationInfo> *> rootVertices;
+        for (int r = 0; r < roots; r++) {
+            rootVertices.push_back(vertices[(static_cast<size_t>(r) * 7919) % vertices.size()]);
+        }
+
+        std::vector<Routing::SearchTree> expected(rootVertices.size());
+        double sequentialMillis = timeMillis([&]() {
+            for (size_t r = 0; r < rootVertices.size(); r++) {
+                SearchKernels::growForMode<false>(g, rootVertices[r], EdgeType::DRIVING, nullptr, 0, expected[r]);
+            }
+        });
+
+        // Bit-identical distances, and the parents the sequential kernel picks among equal-cost paths
+        long mismatches = 0;
+        auto check = [&](size_t r, const Routing::SearchTree &tree) {
+            for (size_t v = 0; v < tree.dist.size(); v++) {
+                mismatches += std::memcmp(&tree.dist[v], &expected[r].dist[v], sizeof(double)) != 0 ||
+                              tree.parent[v] != expected[r].parent[v];
+            }
+        };
+
+        auto run = [&](const DeltaStepping &search, unsigned int threads) {
+            Routing::SearchTree tree;
+            return timeMillis([&]() {
+                for (size_t r = 0; r < rootVertices.size(); r++) {
+                    search.search(rootVertices[r], tree, threads);
+                    check(r, tree);
+                }
+            });
+        };
+
+        auto search = DeltaStepping::compile(g, EdgeType::DRIVING);
+        std::vector<double> millis;
+        for (unsigned int threads: threadCounts) {
+            millis.push_back(run(*search, threads));
+        }
+        std::vector<double> deltas = {search->getDelta() / 4, search->getDelta() * 4};
+        std::vector<double> deltaMillis;
+        for (double delta: deltas) {
+            deltaMillis.push_back(run(*DeltaStepping::compile(g, EdgeType::DRIVING, delta), hardwareThreads));
+        }
+
+        // Large graphs get the search from Preprocessing, and Routing grows their trees with it
+        double routingMillis = -1;
+        double limitedMillis = -1;
+        if (g.getNumVertex() >= DeltaStepping::MIN_PREPARED_VERTICES) {
+            DeltaStepping::install(search);
+            RouteRestrictions driving(EdgeType::DRIVING);
+            routingMillis = timeMillis([&]() {
+                for (size_t r = 0; r < rootVertices.size(); r++) {
+                    check(r, Routing::buildSearchTree(g, rootVertices[r], driving, false));
+                }
+            });
+
+            // Isochrones stop at their largest budget: distances up to it are final, the rest lie beyond it
+            Routing::SearchTree tree;
+            double limit = 30;
+            limitedMillis = timeMillis([&]() {
+                for (size_t r = 0; r < rootVertices.size(); r++) {
+                    search->search(rootVertices[r], tree, 0, limit);
+                    for (size_t v = 0; v < tree.dist.size(); v++) {
+                        double exact = expected[r].dist[v];
+                        mismatches += exact <= limit ? tree.dist[v] != exact : tree.dist[v] <= limit;
+                    }
+                }
+            });
+            DeltaStepping::clear();
+        }
+
+        std::cout << "Delta-stepping, " << name << ": " << vertices.size() << " vertices, delta " << search->getDelta()
+                  << ", " << search->getLightEdgeCount() << " light and " << search->getHeavyEdgeCount()
+                  << " heavy driving edges, " << hardwareThreads << " hardware thread(s)"
+                  << mismatchNote(mismatches) << std::endl;
+        report("sequential Dijkstra", sequentialMillis, roots, 0);
+        for (size_t t = 0; t < threadCounts.size(); t++) {
+            report("delta-stepping, " + std::to_string(threadCounts[t]) + " thread(s)", millis[t], roots,
+                   sequentialMillis);
+        }
+        for (size_t d = 0; d < deltas.size(); d++) {
+            report("delta " + std::to_string(deltas[d]).substr(0, 5) + ", all threads", deltaMillis[d], roots,
+                   sequentialMillis);
+        }
+        if (routingMillis >= 0) {
+            report("Routing::buildSearchTree", routingMillis, roots, sequentialMillis);
+            report("up to 30 min, all threads", limitedMillis, roots, sequentialMillis);
+        }
+    };
+
+    measure("dataset", graph);
+    measure("100x100 grid city", city);
+}
+
+void Benchmark::timeDependent(const Graph<LocationInfo> &graph, int queries) {
+    using EdgeType = Edge<LocationInfo>::EdgeType;
+    const auto &vertices = graph.getVertexSet();
+    RouteRestrictions driving(EdgeType::DRIVING);
+
+    std::vector<ProfileData> constant;
+    std::vector<ProfileData> rushHour;
+    for (const auto &row: DataManager::getInstance()->getDistanceData()) {
+        if (row.driving <= 0)
+            continue;
+        double w = row.driving;
+        constant.push_back({row.location1, row.location2, "Driving", {{0, w}}});
+        rushHour.push_back({
+            row.location1, row.location2, "Driving",
+            {{6 * 60 + 30, w}, {8 * 60, 2 * w}, {9 * 60 + 30, w}, {16 * 60 + 30, w}, {18 * 60, 2 * w}, {19 * 60 + 30, w}}
+        });
+    }
+
+    std::shared_ptr<const TravelTimeProfiles> flat = TravelTimeProfiles::compile(graph, constant);
+    std::shared_ptr<const TravelTimeProfiles> profiles;
+    std::vector<std::string> errors;
+    double compileMillis = timeMillis([&]() { profiles = TravelTimeProfiles::compile(graph, rushHour, &errors); });
+
+    std::cout << "Time-dependent routing: " << rushHour.size() << " driving segments, "
+              << profiles->getProfiledEdgeCount() << " profiled edges, " << profiles->getProfileCount()
+              << " distinct profiles, " << profiles->getBreakpointCount() << " breakpoints, "
+              << errors.size() << " rejected" << std::endl;
+
+    // Deterministic pseudo-random pairs
+    std::vector<std::pair<int, int> > pairs;
+    unsigned long long state = 88172645463325252ULL;
+    for (int q = 0; q < queries; q++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        pairs.emplace_back(static_cast<int>(state % vertices.size()),
+                           static_cast<int>((state >> 32) % vertices.size()));
+    }
+
+    std::vector<double> expected(pairs.size());
+    Routing::SearchTree tree;
+    std::vector<bool> isTarget(vertices.size(), false);
+    double staticMillis = timeMillis([&]() {
+        for (size_t q = 0; q < pairs.size(); q++) {
+            isTarget[pairs[q].second] = true;
+            SearchKernels::growForMode<false>(graph, vertices[pairs[q].first], EdgeType::DRIVING, &isTarget, 1, tree);
+            isTarget[pairs[q].second] = false;
+            expected[q] = tree.dist[pairs[q].second];
+        }
+    });
+
+    long mismatches = 0;
+    for (size_t q = 0; q < pairs.size(); q++) {
+        flat->search(graph, vertices[pairs[q].first], vertices[pairs[q].second], driving, 8 * 60, tree);
+        mismatches += tree.dist[pairs[q].second] != expected[q];
+    }
+
+    double peakTime = 0, staticTime = 0;
+    double peakMillis = timeMillis([&]() {
+        for (size_t q = 0; q < pairs.size(); q++) {
+            profiles->search(graph, vertices[pairs[q].first], vertices[pairs[q].second], driving, 8 * 60, tree);
+            if (expected[q] != INF) {
+                peakTime += tree.dist[pairs[q].second];
+                staticTime += expected[q];
+            }
+        }
+    });
+
+    // Arrival must not decrease as the departure moves through the morning peak
+    long fifoViolations = 0;
+    for (size_t q = 0; q < pairs.size() && q < 200; q++) {
+        double previousArrival = -INF;
+        for (int departure = 6 * 60; departure <= 11 * 60; departure += 5) {
+            profiles->search(graph, vertices[pairs[q].first], vertices[pairs[q].second], driving, departure, tree);
+            if (tree.dist[pairs[q].second] == INF)
+                break;
+            double arrival = departure + tree.dist[pairs[q].second];
+            fifoViolations += arrival < previousArrival - 1e-6;
+            previousArrival = arrival;
+        }
+    }
+
+    std::cout << "08:00 departures take " << (staticTime > 0 ? peakTime / staticTime : 1)
+              << "x the static time"
+              << mismatchNote(mismatches)
+              << mismatchNote(fifoViolations, "FIFO violations")
+              << std::endl;
+    report("profile compilation", compileMillis, 1, 0);
+    report("static Dijkstra to target", staticMillis, queries, 0);
+    report("time-dependent Dijkstra", peakMillis, queries, staticMillis);
+}
+
+void Benchmark::liveUpdates(const std::string &locationsFilePath, const std::string &distancesFilePath, int rounds) {
+    using EdgeType = Edge<LocationInfo>::EdgeType;
+    SearchTreeCache *cache = SearchTreeCache::getInstance();
+
+    std::streambuf *console = std::cout.rdbuf(nullptr);
+    GraphSnapshot::publish(GraphSnapshot::load(locationsFilePath, distancesFilePath));
+    std::cout.rdbuf(console);
+    GraphSnapshot::Handle snapshot = GraphSnapshot::current();
+    if (snapshot == nullptr) {
+        std::cout << "Live updates: could not load the dataset" << std::endl;
+        return;
+    }
+
+    // 64 roots, both directions and both modes: 256 trees, the default cache capacity
+    std::vector<int> roots;
+    int n = snapshot->getGraph().getNumVertex();
+    for (int i = 0; i < n && roots.size() < 64; i += std::max(1, n / 64)) {
+        roots.push_back(i);
+    }
+
+    auto fillCache = [&]() {
+        const Graph<LocationInfo> &graph = snapshot->getGraph();
+        cache->clear();
+        for (EdgeType mode: {EdgeType::DRIVING, EdgeType::WALKING}) {
+            for (int root: roots) {
+                for (bool backward: {false, true}) {
+                    const Vertex<LocationInfo> *v = graph.getVertexSet()[root];
+                    RouteRestrictions modeOnly(mode);
+                    cache->insert(graph, v, modeOnly, Routing::buildSearchTree(graph, v, modeOnly, backward));
+                }
+            }
+        }
+    };
+
+    std::cout << "Live updates: " << n << " vertices, " << roots.size() * 4 << " cached trees, "
+              << rounds << " update(s)" << std::endl;
+
+    double rebuildMillis = timeMillis(fillCache);
+
+    unsigned long long state = 2463534242ULL;
+    double updateMillis = 0;
+    long settled = 0;
+    long searches = 0;
+    long rows = 0;
+    double tableRepairMillis = 0;
+    long mismatches = 0;
+    for (int r = 0; r < rounds; r++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        const auto &vertices = snapshot->getGraph().getVertexSet();
+        Vertex<LocationInfo> *v = vertices[state % vertices.size()];
+        if (v->getAdj().empty())
+            continue;
+        Edge<LocationInfo> *e = v->getAdj()[(state >> 20) % v->getAdj().size()];
+        if (e->getType() != EdgeType::DRIVING && e->getType() != EdgeType::WALKING)
+            continue;
+
+        // Slower or faster by up to a factor of two, kept integral like the dataset
+        double factor = 0.5 + static_cast<double>((state >> 40) % 16) / 10;
+        LiveTraffic::TravelTimeUpdate update = {
+            v->getInfo().code, e->getDest()->getInfo().code, e->getType(), std::max(1.0, std::round(e->getWeight() * factor))
+        };
+
+        GraphSnapshot::Handle before = snapshot;
+        LiveTraffic::UpdateReport result;
+        updateMillis += timeMillis([&]() { result = LiveTraffic::publish({update}); });
+        settled += result.verticesSettled;
+        searches += result.arcFlagSearches;
+        rows += result.allPairsRows;
+        mismatches += !result.errors.empty();
+
+        // The old snapshot stays valid for anyone holding it; checks run on the published one
+        snapshot = GraphSnapshot::current();
+        const Graph<LocationInfo> &graph = snapshot->getGraph();
+        for (EdgeType mode: {EdgeType::DRIVING, EdgeType::WALKING}) {
+            for (int root: roots) {
+                for (bool backward: {false, true}) {
+                    const Vertex<LocationInfo> *rootVertex = graph.getVertexSet()[root];
+                    auto repaired = cache->find(graph, rootVertex, RouteRestrictions(mode), backward);
+                    Routing::SearchTree fresh;
+                    if (backward) {
+                        SearchKernels::growForMode<true>(graph, rootVertex, mode, nullptr, 0, fresh);
+                    } else {
+                        SearchKernels::growForMode<false>(graph, rootVertex, mode, nullptr, 0, fresh);
+                    }
+                    mismatches += !repaired || repaired->dist != fresh.dist || repaired->parent != fresh.parent;
+                }
+            }
+        }
+
+        // The table repair on its own, from the edges whose weight this update changed
+        std::vector<SearchKernels::WeightChange> changes;
+        const auto &oldVertices = before->getGraph().getVertexSet();
+        for (auto w: graph.getVertexSet()) {
+            const auto &adj = w->getAdj();
+            const auto &oldAdj = oldVertices[w->getIndex()]->getAdj();
+            for (size_t k = 0; k < adj.size(); k++) {
+                if (adj[k]->getWeight() != oldAdj[k]->getWeight())
+                    changes.emplace_back(adj[k], oldAdj[k]->getWeight());
+            }
+        }
+        for (EdgeType mode: {EdgeType::DRIVING, EdgeType::WALKING}) {
+            auto table = before->getIndexes().allPairs[static_cast<int>(mode)];
+            auto published = snapshot->getIndexes().allPairs[static_cast<int>(mode)];
+            if (table == nullptr || published == nullptr || changes.empty() || changes[0].first->getType() != mode)
+                continue;
+            std::shared_ptr<const AllPairsTable> repairedTable;
+            tableRepairMillis += timeMillis([&]() { repairedTable = table->repair(graph, changes); });
+            mismatches += repairedTable->getChecksum() != published->getChecksum();
+        }
+    }
+
+    // Repaired arc flags must be exactly what a full computation on the final weights gives
+    double computeMillis = 0;
+    for (EdgeType mode: {EdgeType::DRIVING, EdgeType::WALKING}) {
+        auto repaired = snapshot->getIndexes().arcFlags[static_cast<int>(mode)];
+        if (repaired == nullptr)
+            continue;
+        std::shared_ptr<const ArcFlags> computed;
+        computeMillis += timeMillis([&]() {
+            computed = ArcFlags::compute(snapshot->getGraph(), mode, repaired->getRegionCount());
+        });
+        mismatches += computed->getChecksum() != repaired->getChecksum();
+    }
+
+    // Cores carried over must be exactly what contracting the final graph gives
+    double contractMillis = 0;
+    for (EdgeType mode: {EdgeType::DEFAULT, EdgeType::DRIVING, EdgeType::WALKING}) {
+        auto carried = snapshot->getIndexes().contracted[static_cast<int>(mode)];
+        if (carried == nullptr)
+            continue;
+        std::shared_ptr<const ContractedGraph> built;
+        contractMillis += timeMillis([&]() { built = ContractedGraph::build(snapshot->getGraph(), mode); });
+        mismatches += built->getChecksum() != carried->getChecksum();
+    }
+
+    // So must the repaired all-pairs tables
+    double tableMillis = 0;
+    for (EdgeType mode: {EdgeType::DRIVING, EdgeType::WALKING}) {
+        auto repaired = snapshot->getIndexes().allPairs[static_cast<int>(mode)];
+        if (repaired == nullptr)
+            continue;
+        AllPairsTable computed;
+        tableMillis += timeMillis([&]() { computed = AllPairsTable::compute(snapshot->getGraph(), mode); });
+        mismatches += computed.getChecksum() != repaired->getChecksum();
+    }
+
+    std::cout << "per update: " << settled / std::max(1, rounds) << " vertices settled, "
+              << searches / std::max(1, rounds) << " boundary searches, "
+              << rows / std::max(1, rounds) << " table rows"
+              << mismatchNote(mismatches) << std::endl;
+    report("rebuild every cached tree", rebuildMillis, 1, 0);
+    report("recompute both arc flags", computeMillis, 1, 0);
+    report("recompute both all-pairs tables", tableMillis, 1, 0);
+    report("repair the changed all-pairs table", tableRepairMillis, rounds, tableMillis / 2 * rounds);
+    report("contract every core", contractMillis, 1, 0);
+    report("copy, repair and publish", updateMillis, rounds,
+           (rebuildMillis + computeMillis + tableMillis + contractMillis) * rounds);
+
+    snapshot.reset();
+    GraphSnapshot::publish(nullptr);
+    cache->clear();
+}
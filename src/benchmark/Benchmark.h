@@ -0,0 +1,259 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <functional>
+#include <string>
+#include "../graph_structure/Graph.h"
+#include "../graph_builder/GraphBuilder.h"
+
+/**
+ * @class Benchmark
+ * @brief Micro-benchmarks for the routing engine
+ *
+ * Each benchmark runs its variants over the same deterministic set of queries, checks that
+ * the variants agree and prints the time per query. It is built as a separate executable so
+ * that the interactive application stays free of timing code.
+ */
+class Benchmark {
+public:
+    /**
+     * @brief Loads a dataset and builds its graph
+     * @param locationsFilePath Path to the locations data file
+     * @param distancesFilePath Path to the distances data file
+     * @param graph The graph to fill
+     * @return True if the dataset was loaded
+     * @details O(L + D) where L is the number of locations and D is the number of distances
+     */
+    static bool loadGraph(
+        const std::string &locationsFilePath,
+        const std::string &distancesFilePath,
+        Graph<LocationInfo> &graph);
+
+    /**
+     * @brief Compares the compile-time specialised Dijkstra kernels with the type-erased path
+     *
+     * Every variant builds one full tree per source, for unrestricted, driving-only,
+     * walking-only and restricted searches.
+     *
+     * @param graph The graph to search
+     * @param rounds Number of times every vertex is used as a source
+     * @details O(R * V * E log V) where R is the number of rounds
+     */
+    static void searchKernels(const Graph<LocationInfo> &graph, int rounds);
+
+    /**
+     * @brief Times the all-pairs table per mode against one search per source
+     *
+     * Checks every entry of the table against a full search tree, then compares single-thread
+     * and multi-thread precomputation, lookups and a save/load round trip.
+     *
+     * @param graph The graph to search
+     * @details O(V^3 + V * E log V)
+     */
+    static void allPairs(const Graph<LocationInfo> &graph);
+
+    /**
+     * @brief Compares full trees built on the contracted core with trees built on the full graph
+     *
+     * Every vertex roots one forward and one backward tree per mode, with and without an
+     * avoid list, and every tree is checked against the full-graph search.
+     *
+     * @param graph The graph to search
+     * @param rounds Number of times every vertex is used as a root
+     * @details O(R * V * E log V) where R is the number of rounds
+     */
+    static void contraction(const Graph<LocationInfo> &graph, int rounds);
+
+    /**
+     * @brief Compares point-to-point searches pruned by arc flags with plain searches stopped at the target
+     *
+     * Times the preprocessing with one thread and with every thread, then runs pseudo-random
+     * driving and walking queries and checks that both searches find the same distance.
+     *
+     * @param graph The graph to search
+     * @param queries Number of queries per mode
+     * @details O(B * E log V + Q * E log V) where B is the number of boundary vertices and Q the queries
+     */
+    static void arcFlags(const Graph<LocationInfo> &graph, int queries);
+
+    /**
+     * @brief Times the batch engine on a mixed batch with growing worker pools
+     *
+     * The batch holds independent, restricted and eco requests between pseudo-random
+     * locations; every pool size must produce the same results as a single worker.
+     *
+     * @param graph The graph to search
+     * @param requests Number of requests in the batch
+     * @details O(T * R * Q) where T is the number of pool sizes tried
+     */
+    static void batch(const Graph<LocationInfo> &graph, int requests);
+
+    /**
+     * @brief Times a skewed stream of repeated queries with and without the RouteCache
+     *
+     * The stream draws independent, restricted and eco queries from a small pool, favouring
+     * some of them, and lists the avoid locations of a restricted query in a different order
+     * each time. The cache runs serially, on every thread and with a budget small enough to
+     * evict; every answer must match the uncached one.
+     *
+     * @param graph The graph to search
+     * @param requests Number of queries in the stream
+     * @details O(D * Q + R) where D is the number of distinct queries, Q the cost of one and R the stream length
+     */
+    static void routeCache(const Graph<LocationInfo> &graph, int requests);
+
+    /**
+     * @brief Times the preprocessing pipeline from 1 to every hardware thread
+     *
+     * Prints the per-task report of every run on the dataset and on a synthetic grid city,
+     * and checks that every run registers structures with the same checksums as calling the
+     * prepare functions one after another.
+     *
+     * @param graph The graph to preprocess
+     * @details O(T * P) where T is the number of thread counts and P the cost of preprocessing
+     */
+    static void preprocessing(const Graph<LocationInfo> &graph);
+
+    /**
+     * @brief Times eco queries answered from the parking index against the per-parking walking searches
+     *
+     * Times the index with one thread and with every thread, then runs pseudo-random eco
+     * queries with a cold SearchTreeCache, with and without the index, and checks that both
+     * pick the same total time.
+     *
+     * @param graph The graph to search
+     * @param queries Number of eco queries
+     * @details O(P * E log V + Q * P * E log V) where P is the number of parking locations and Q the queries
+     */
+    static void parkingIndex(const Graph<LocationInfo> &graph, int queries);
+
+    /**
+     * @brief Times the MultiQueue parallel Dijkstra from 1 to every hardware thread
+     *
+     * Reports throughput and the wasted-work ratio, expansions per vertex reached, on the
+     * dataset and on a synthetic grid city, plus a multi-source walking search seeded with the
+     * driving time to every parking location. Distances must match SearchKernels bit for bit.
+     *
+     * @param graph The graph to search
+     * @param roots Number of search roots per variant
+     * @details O(T * R * E log V) where T is the number of variants and R the roots
+     */
+    static void multiQueue(const Graph<LocationInfo> &graph, int roots);
+
+    /**
+     * @brief Times eco queries that search a walk per parking location, serially and on every thread
+     *
+     * Without the parking index every parking location needs a walking search. The reference
+     * searches a full walking tree per parking location, as eco queries used to; the parallel
+     * evaluation runs once inside a WorkStealing::SerialScope and once on every thread, and both
+     * must pick the same parking location and total time as the reference.
+     *
+     * @param graph The graph to search
+     * @param queries Number of eco queries
+     * @details O(Q * P * E log V) where Q is the number of queries and P the number of parking locations
+     */
+    static void parallelEco(const Graph<LocationInfo> &graph, int queries);
+
+    /**
+     * @brief Times delta-stepping one-to-all searches from 1 to every hardware thread
+     *
+     * Runs on the dataset and on a synthetic grid city, checks every distance bit for bit
+     * against the sequential kernel, then sweeps delta around the mean edge weight.
+     *
+     * @param graph The graph to search
+     * @param roots Number of search roots per variant
+     * @details O(T * R * (V + E) log V) where T is the number of variants and R the roots
+     */
+    static void deltaStepping(const Graph<LocationInfo> &graph, int roots);
+
+    /**
+     * @brief Times time-dependent Dijkstra over rush-hour profiles against static Dijkstra
+     *
+     * Gives every driving segment a profile that doubles its travel time in the morning and
+     * evening peaks, then checks that constant profiles reproduce the static distances and that
+     * a later departure never arrives earlier.
+     *
+     * @param graph The graph to search
+     * @param queries Number of queries
+     * @details O(R * B log B + Q * E (log V + B)) for R profiled segments of B breakpoints and Q queries
+     */
+    static void timeDependent(const Graph<LocationInfo> &graph, int queries);
+
+    /**
+     * @brief Times dataset reloads while queries keep running on the published snapshot
+     *
+     * A query thread answers driving queries on whatever GraphSnapshot is published while the
+     * dataset is loaded and published again several times; every answer must match the one
+     * given before the first reload, and every replaced snapshot must be freed.
+     *
+     * @param locationsFilePath Path to the locations data file
+     * @param distancesFilePath Path to the distances data file
+     * @param reloads Number of reloads
+     * @details O(R * (L + D + P)) where R is the number of reloads and P the cost of preprocessing
+     */
+    static void hotReload(const std::string &locationsFilePath, const std::string &distancesFilePath, int reloads);
+
+    /**
+     * @brief Times live travel-time updates against rebuilding what they change
+     *
+     * Loads and publishes a snapshot, fills the SearchTreeCache with forward and backward trees
+     * and publishes single-segment updates with LiveTraffic. Every repaired tree is checked
+     * against a fresh search on the new snapshot, and the repaired arc flags, all-pairs tables
+     * and carried-over cores against a full computation on the final weights. The all-pairs
+     * table repair is also timed on its own against a full recomputation of one table.
+     *
+     * @param locationsFilePath Path to the locations data file
+     * @param distancesFilePath Path to the distances data file
+     * @param rounds Number of updates
+     * @details O(R * (V + E + T * (V + A log A) + F)) where T is the number of cached trees and F the cost of ArcFlags::repair
+     */
+    static void liveUpdates(const std::string &locationsFilePath, const std::string &distancesFilePath, int rounds);
+
+    /**
+     * @brief Gets the number of results, over every benchmark run so far, that disagreed with their reference
+     * @return The number of mismatches, 0 if every variant agreed
+     * @details O(1)
+     */
+    static long getMismatchCount();
+
+private:
+    /** @brief Mismatches found by the benchmarks run so far */
+    static long mismatchCount;
+
+    /**
+     * @brief Records the mismatches a benchmark found and formats them for its summary line
+     * @param mismatches Number of mismatches
+     * @param what What they are, in the plural
+     * @return "  (N what!)", or an empty string if there are none
+     * @details O(1)
+     */
+    static std::string mismatchNote(long mismatches, const std::string &what = "mismatches");
+
+    /**
+     * @brief Builds a square grid city with pseudo-random driving and slower walking times
+     * @param side Number of locations along each side
+     * @return The graph; every seventh location has parking
+     * @details O(S^4) for S = side, dominated by Graph::addVertex
+     */
+    static Graph<LocationInfo> buildGridCity(int side);
+
+    /**
+     * @brief Runs a piece of work and measures it
+     * @param work The work to run
+     * @return Elapsed wall-clock time in milliseconds
+     * @details O(W) where W is the cost of the work
+     */
+    static double timeMillis(const std::function<void()> &work);
+
+    /**
+     * @brief Prints one result line
+     * @param name Name of the variant
+     * @param millis Total time of the variant
+     * @param queries Number of queries it ran
+     * @param baselineMillis Total time of the variant it is compared against, 0 for none
+     * @details O(1)
+     */
+    static void report(const std::string &name, double millis, long queries, double baselineMillis);
+};
+
+#endif // BENCHMARK_H
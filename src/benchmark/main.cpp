@@ -0,0 +1,83 @@
+/**
+ * @file main.cpp
+ * @brief Entry point for the routing benchmarks
+ *
+ * Usage: routing-benchmark [locations.csv distances.csv] [rounds] [kernels|apsp|contraction|arcflags|delta|multiqueue|preprocess|parking|eco|batch|routecache|reload|profiles|updates]
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "Benchmark.h"
+#include "../routing/RouteCache.h"
+
+/**
+ * @brief Benchmark entry point
+ * @param argc Number of arguments
+ * @param argv Optional dataset paths, number of rounds and a single benchmark to run
+ * @return 0 on success, 1 if the dataset could not be loaded, 2 if a variant disagreed with its reference
+ */
+int main(int argc, char *argv[]) {
+    std::string locationsFilePath = argc > 2 ? argv[1] : "../data/Locations.csv";
+    std::string distancesFilePath = argc > 2 ? argv[2] : "../data/Distances.csv";
+    int rounds = argc > 3 ? std::atoi(argv[3]) : 5;
+    std::string only = argc > 4 ? argv[4] : "";
+
+    // Suites compare search variants; answering repeats from the RouteCache would hide them
+    RouteCache::getInstance()->setBudget(0);
+
+    Graph<LocationInfo> graph;
+    if (!Benchmark::loadGraph(locationsFilePath, distancesFilePath, graph)) {
+        std::cerr << "Failed to load data from " << locationsFilePath << " and " << distancesFilePath << std::endl;
+        return 1;
+    }
+
+    if (only.empty() || only == "kernels") {
+        Benchmark::searchKernels(graph, rounds > 0 ? rounds : 1);
+    }
+    if (only.empty() || only == "apsp") {
+        Benchmark::allPairs(graph);
+    }
+    if (only.empty() || only == "contraction") {
+        Benchmark::contraction(graph, rounds > 0 ? rounds : 1);
+    }
+    if (only.empty() || only == "arcflags") {
+        Benchmark::arcFlags(graph, 1000 * (rounds > 0 ? rounds : 1));
+    }
+    if (only.empty() || only == "delta") {
+        Benchmark::deltaStepping(graph, 20 * (rounds > 0 ? rounds : 1));
+    }
+    if (only.empty() || only == "multiqueue") {
+        Benchmark::multiQueue(graph, 20 * (rounds > 0 ? rounds : 1));
+    }
+    if (only.empty() || only == "preprocess") {
+        Benchmark::preprocessing(graph);
+    }
+    if (only.empty() || only == "parking") {
+        Benchmark::parkingIndex(graph, 100 * (rounds > 0 ? rounds : 1));
+    }
+    if (only.empty() || only == "eco") {
+        Benchmark::parallelEco(graph, 20 * (rounds > 0 ? rounds : 1));
+    }
+    if (only.empty() || only == "batch") {
+        Benchmark::batch(graph, 400 * (rounds > 0 ? rounds : 1));
+    }
+    if (only.empty() || only == "routecache") {
+        Benchmark::routeCache(graph, 2000 * (rounds > 0 ? rounds : 1));
+    }
+    if (only.empty() || only == "reload") {
+        Benchmark::hotReload(locationsFilePath, distancesFilePath, rounds > 0 ? rounds : 1);
+    }
+    if (only.empty() || only == "profiles") {
+        Benchmark::timeDependent(graph, 1000 * (rounds > 0 ? rounds : 1));
+    }
+    if (only.empty() || only == "updates") {
+        Benchmark::liveUpdates(locationsFilePath, distancesFilePath, 20 * (rounds > 0 ? rounds : 1));
+    }
+
+    if (Benchmark::getMismatchCount() != 0) {
+        std::cerr << Benchmark::getMismatchCount() << " result(s) disagreed with their reference" << std::endl;
+        return 2;
+    }
+    return 0;
+}
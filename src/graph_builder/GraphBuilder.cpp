@@ -1,6 +1,9 @@
 #include "GraphBuilder.h"
+#include <algorithm>
 #include <iostream>
+#include <stack>
 #include <unordered_map>
+#include <utility>
 
 Graph<LocationInfo> GraphBuilder::buildIntegratedGraph(
     const std::vector<LocationData> &locationData,
@@ -81,9 +84,127 @@ Graph<LocationInfo> GraphBuilder::buildIntegratedGraph(
         std::cout << "Failed to add " << failedEdges << " edges." << std::endl;
     }
 
+    labelComponents(graph);
+
     return graph;
 }
 
+/**
+ * @brief Runs Tarjan's strongly connected components algorithm over the edges of one mode
+ * @param graph The graph to label
+ * @param transportMode The mode, DEFAULT for edges of every mode
+ * @param labels Component label of each vertex, indexed by vertex index
+ * @details O(V + E); iterative, so long chains cannot overflow the call stack
+ */
+static void tarjanComponents(
+    Graph<LocationInfo> &graph,
+    Edge<LocationInfo>::EdgeType transportMode,
+    std::vector<int> &labels) {
+    const auto &vertices = graph.getVertexSet();
+    labels.assign(vertices.size(), -1);
+
+    for (auto v: vertices) {
+        v->setNum(-1);
+        v->setLow(-1);
+    }
+
+    auto accepts = [transportMode](const Edge<LocationInfo> *e) {
+        return transportMode == Edge<LocationInfo>::EdgeType::DEFAULT || e->getType() == transportMode;
+    };
+
+    int counter = 0;
+    int components = 0;
+    std::vector<bool> onStack(vertices.size(), false);
+    std::stack<Vertex<LocationInfo> *> stack;
+    std::vector<std::pair<Vertex<LocationInfo> *, size_t> > dfs; // vertex and next adjacency position
+
+    for (auto root: vertices) {
+        if (root->getNum() != -1)
+            continue;
+
+        root->setNum(counter);
+        root->setLow(counter++);
+        stack.push(root);
+        onStack[root->getIndex()] = true;
+        dfs.emplace_back(root, 0);
+
+        while (!dfs.empty()) {
+            Vertex<LocationInfo> *v = dfs.back().first;
+            const auto &adj = v->getAdj();
+
+            if (dfs.back().second < adj.size()) {
+                Edge<LocationInfo> *e = adj[dfs.back().second++];
+                if (!accepts(e))
+                    continue;
+
+                Vertex<LocationInfo> *w = e->getDest();
+                if (w->getNum() == -1) {
+                    w->setNum(counter);
+                    w->setLow(counter++);
+                    stack.push(w);
+                    onStack[w->getIndex()] = true;
+                    dfs.emplace_back(w, 0);
+                } else if (onStack[w->getIndex()]) {
+                    v->setLow(std::min(v->getLow(), w->getNum()));
+                }
+                continue;
+            }
+
+            if (v->getLow() == v->getNum()) {
+                Vertex<LocationInfo> *w;
+                do {
+                    w = stack.top();
+                    stack.pop();
+                    onStack[w->getIndex()] = false;
+                    labels[w->getIndex()] = components;
+                } while (w != v);
+                components++;
+            }
+
+            dfs.pop_back();
+            if (!dfs.empty()) {
+                Vertex<LocationInfo> *parent = dfs.back().first;
+                parent->setLow(std::min(parent->getLow(), v->getLow()));
+            }
+        }
+    }
+}
+
+void GraphBuilder::labelComponents(Graph<LocationInfo> &graph) {
+    std::vector<int> driving, walking, any;
+    tarjanComponents(graph, Edge<LocationInfo>::EdgeType::DRIVING, driving);
+    tarjanComponents(graph, Edge<LocationInfo>::EdgeType::WALKING, walking);
+    tarjanComponents(graph, Edge<LocationInfo>::EdgeType::DEFAULT, any);
+
+    for (auto v: graph.getVertexSet()) {
+        LocationInfo info = v->getInfo();
+        info.drivingComponent = driving[v->getIndex()];
+        info.walkingComponent = walking[v->getIndex()];
+        info.anyComponent = any[v->getIndex()];
+        v->setInfo(info);
+    }
+}
+
+int GraphBuilder::getComponent(const LocationInfo &info, Edge<LocationInfo>::EdgeType transportMode) {
+    switch (transportMode) {
+        case Edge<LocationInfo>::EdgeType::DRIVING:
+            return info.drivingComponent;
+        case Edge<LocationInfo>::EdgeType::WALKING:
+            return info.walkingComponent;
+        default:
+            return info.anyComponent;
+    }
+}
+
+bool GraphBuilder::isUnreachable(
+    const LocationInfo &from,
+    const LocationInfo &to,
+    Edge<LocationInfo>::EdgeType transportMode) {
+    int fromComponent = getComponent(from, transportMode);
+    int toComponent = getComponent(to, transportMode);
+    return fromComponent != -1 && toComponent != -1 && fromComponent != toComponent;
+}
+
 Graph<LocationInfo> GraphBuilder::buildGraphFromDataManager() {
     DataManager *dataManager = DataManager::getInstance();
 
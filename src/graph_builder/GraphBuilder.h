@@ -18,6 +18,9 @@ struct LocationInfo {
     int id; /**< Unique numeric identifier */
     std::string code; /**< Location code (used as primary identifier) */
     bool hasParking; /**< Whether parking is available at this location */
+    int drivingComponent = -1; /**< Strongly connected component over driving edges, -1 if not labelled */
+    int walkingComponent = -1; /**< Strongly connected component over walking edges, -1 if not labelled */
+    int anyComponent = -1; /**< Strongly connected component over edges of every mode, -1 if not labelled */
 
     /**
      * @brief Full constructor with all fields
@@ -88,6 +91,39 @@ public:
      */
     static Graph<LocationInfo> buildGraphFromDataManager();
 
+    /**
+     * @brief Labels every location with its strongly connected component for each mode
+     *
+     * Uses Tarjan's algorithm over the vertices' num and low fields, once per mode, and
+     * stores the labels in LocationInfo. Called by buildIntegratedGraph.
+     *
+     * @param graph The graph to label
+     * @details O(V + E) per mode
+     */
+    static void labelComponents(Graph<LocationInfo> &graph);
+
+    /**
+     * @brief Gets the component label of a location for a transport mode
+     * @param info The location
+     * @param transportMode The mode, DEFAULT for edges of every mode
+     * @return The label, -1 if the location was not labelled
+     * @details O(1)
+     */
+    static int getComponent(const LocationInfo &info, Edge<LocationInfo>::EdgeType transportMode);
+
+    /**
+     * @brief Checks whether the component labels rule out any route between two locations
+     * @param from The origin location
+     * @param to The destination location
+     * @param transportMode The mode, DEFAULT for edges of every mode
+     * @return True if both are labelled and lie in different components; false means a route may exist
+     * @details O(1)
+     */
+    static bool isUnreachable(
+        const LocationInfo &from,
+        const LocationInfo &to,
+        Edge<LocationInfo>::EdgeType transportMode);
+
     /**
      * @brief Prints detailed information about the graph for debugging purposes
      * @param graph The graph to print
@@ -45,17 +45,31 @@ public:
 
     /**
      * @brief Gets the information stored in the vertex
-     * @return The vertex information
+     * @return Reference to the vertex information
      * @details O(1)
      */
-    T getInfo() const;
+    const T &getInfo() const;
+
+    /**
+     * @brief Gets the position of this vertex in the graph's vertex set
+     * @return The vertex index, or -1 if the vertex does not belong to a graph
+     * @details O(1)
+     */
+    int getIndex() const;
+
+    /**
+     * @brief Sets the position of this vertex in the graph's vertex set
+     * @param index The new vertex index
+     * @details O(1)
+     */
+    void setIndex(int index);
 
     /**
      * @brief Gets all outgoing edges from this vertex
-     * @return Vector of pointers to outgoing edges
+     * @return Reference to the vector of pointers to outgoing edges
      * @details O(1)
      */
-    std::vector<Edge<T> *> getAdj() const;
+    const std::vector<Edge<T> *> &getAdj() const;
 
     /**
      * @brief Checks if the vertex has been visited in a traversal
@@ -94,10 +108,10 @@ public:
 
     /**
      * @brief Gets all incoming edges to this vertex
-     * @return Vector of pointers to incoming edges
+     * @return Reference to the vector of pointers to incoming edges
      * @details O(1)
      */
-    std::vector<Edge<T> *> getIncoming() const;
+    const std::vector<Edge<T> *> &getIncoming() const;
 
     /**
      * @brief Sets the information stored in the vertex
@@ -178,6 +192,14 @@ public:
      */
     Edge<T> *addEdge(Vertex<T> *dest, double w);
 
+    /**
+     * @brief Adds an already constructed outgoing edge, so that subclasses of Edge can be stored
+     * @param edge The edge, whose origin must be this vertex
+     * @return The edge
+     * @details O(1)
+     */
+    Edge<T> *addEdge(Edge<T> *edge);
+
     /**
      * @brief Removes an outgoing edge to a vertex with the given information
      * @param in The information of the destination vertex
@@ -197,6 +219,7 @@ public:
 protected:
     T info; // info node
     std::vector<Edge<T> *> adj; // outgoing edges
+    int index = -1; // position in the graph's vertex set, used by array-based searches
 
     // auxiliary fields
     bool visited = false; // used by DFS, BFS, Prim ...
@@ -267,6 +290,13 @@ public:
      */
     double getWeight() const;
 
+    /**
+     * @brief Sets the edge weight
+     * @param weight The new weight
+     * @details O(1)
+     */
+    void setWeight(double weight);
+
     /**
      * @brief Checks if the edge is selected
      * @return True if the edge is selected
@@ -386,6 +416,14 @@ public:
      */
     bool addVertex(const T &in);
 
+    /**
+     * @brief Adds a vertex the caller knows is not in the graph yet, without looking for duplicates
+     * @param in The information for the new vertex
+     * @return Pointer to the new vertex
+     * @details O(1) amortized
+     */
+    Vertex<T> *appendVertex(const T &in);
+
     /**
      * @brief Removes a vertex with the given information
      * @param in The information of the vertex to remove
@@ -432,10 +470,10 @@ public:
 
     /**
      * @brief Gets all vertices in the graph
-     * @return Vector of pointers to all vertices
+     * @return Reference to the vector of pointers to all vertices
      * @details O(1)
      */
-    std::vector<Vertex<T> *> getVertexSet() const;
+    const std::vector<Vertex<T> *> &getVertexSet() const;
 
 protected:
     std::vector<Vertex<T> *> vertexSet; // vertex set
@@ -486,6 +524,13 @@ Edge<T> *Vertex<T>::addEdge(Vertex<T> *d, double w) {
     return newEdge;
 }
 
+template<class T>
+Edge<T> *Vertex<T>::addEdge(Edge<T> *edge) {
+    adj.push_back(edge);
+    edge->getDest()->incoming.push_back(edge);
+    return edge;
+}
+
 /*
  * Auxiliary function to remove an outgoing edge (with a given destination (d))
  * from a vertex (this).
@@ -528,7 +573,7 @@ bool Vertex<T>::operator<(Vertex<T> &vertex) const {
 }
 
 template<class T>
-T Vertex<T>::getInfo() const {
+const T &Vertex<T>::getInfo() const {
     return this->info;
 }
 
@@ -553,7 +598,17 @@ void Vertex<T>::setNum(int value) {
 }
 
 template<class T>
-std::vector<Edge<T> *> Vertex<T>::getAdj() const {
+int Vertex<T>::getIndex() const {
+    return this->index;
+}
+
+template<class T>
+void Vertex<T>::setIndex(int index) {
+    this->index = index;
+}
+
+template<class T>
+const std::vector<Edge<T> *> &Vertex<T>::getAdj() const {
     return this->adj;
 }
 
@@ -583,7 +638,7 @@ Edge<T> *Vertex<T>::getPath() const {
 }
 
 template<class T>
-std::vector<Edge<T> *> Vertex<T>::getIncoming() const {
+const std::vector<Edge<T> *> &Vertex<T>::getIncoming() const {
     return this->incoming;
 }
 
@@ -648,6 +703,11 @@ double Edge<T>::getWeight() const {
     return this->weight;
 }
 
+template<class T>
+void Edge<T>::setWeight(double weight) {
+    this->weight = weight;
+}
+
 template<class T>
 Vertex<T> *Edge<T>::getOrig() const {
     return this->orig;
@@ -713,7 +773,7 @@ int Graph<T>::getNumVertex() const {
 }
 
 template<class T>
-std::vector<Vertex<T> *> Graph<T>::getVertexSet() const {
+const std::vector<Vertex<T> *> &Graph<T>::getVertexSet() const {
     return vertexSet;
 }
 
@@ -747,10 +807,24 @@ template<class T>
 bool Graph<T>::addVertex(const T &in) {
     if (findVertex(in) != nullptr)
         return false;
-    vertexSet.push_back(new Vertex<T>(in));
+    auto v = new Vertex<T>(in);
+    v->setIndex(vertexSet.size());
+    vertexSet.push_back(v);
     return true;
 }
 
+/*
+ *  Adds a vertex with a given content (in) to a graph (this) that is known not to have it yet.
+ *  Returns the new vertex.
+ */
+template<class T>
+Vertex<T> *Graph<T>::appendVertex(const T &in) {
+    auto v = new Vertex<T>(in);
+    v->setIndex(vertexSet.size());
+    vertexSet.push_back(v);
+    return v;
+}
+
 /*
  *  Removes a vertex with a given content (in) from a graph (this), and
  *  all outgoing and incoming edges.
@@ -765,8 +839,11 @@ bool Graph<T>::removeVertex(const T &in) {
             for (auto u: vertexSet) {
                 u->removeEdge(v->getInfo());
             }
-            vertexSet.erase(it);
+            it = vertexSet.erase(it);
             delete v;
+            for (; it != vertexSet.end(); it++) {
+                (*it)->setIndex((*it)->getIndex() - 1);
+            }
             return true;
         }
     }
@@ -0,0 +1,175 @@
+/*
+ * MultiQueue.h
+ * A relaxed concurrent priority queue made of several sequential heaps, for parallel searches.
+ */
+
+#ifndef DA_TP_CLASSES_MULTIQUEUE
+#define DA_TP_CLASSES_MULTIQUEUE
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * @class MultiQueue
+ * @brief A relaxed priority queue that many threads can use at once
+ *
+ * The queue holds c * p binary heaps for p threads, each behind its own lock. A push goes to a
+ * random heap; a pop looks at the tops of two random heaps and takes from the smaller one. No
+ * thread waits for a busy heap, it picks others instead. Pops are not exact: they return one
+ * of the smallest elements with high probability, so searches built on it must tolerate
+ * elements that come out of order.
+ *
+ * Every thread passes its own random state, which keeps the choices independent of the others.
+ *
+ * @tparam T The type of values stored with their keys
+ */
+template<class T>
+class MultiQueue {
+public:
+    /**
+     * @brief Creates an empty queue
+     * @param threads Number of threads that will use it
+     * @param factor Number of heaps per thread
+     * @details O(c * p)
+     */
+    explicit MultiQueue(unsigned int threads, unsigned int factor = 2);
+
+    /**
+     * @brief Inserts a value into a random heap
+     * @param key The priority, smaller comes first
+     * @param value The value
+     * @param random The calling thread's random state
+     * @details O(log n) where n is the size of the heap
+     */
+    void push(double key, const T &value, unsigned long long &random);
+
+    /**
+     * @brief Removes one of the smallest values, chosen between the tops of two random heaps
+     * @param key Receives the key of the value
+     * @param value Receives the value
+     * @param random The calling thread's random state
+     * @return False if every heap looked empty
+     * @details O(log n) expected, O(c * p) when most heaps are empty
+     */
+    bool tryPop(double &key, T &value, unsigned long long &random);
+
+    /**
+     * @brief Gets the number of heaps
+     * @return c * p
+     * @details O(1)
+     */
+    size_t getHeapCount() const {
+        return heaps.size();
+    }
+
+private:
+    /** @brief Key and value of an element */
+    using Entry = std::pair<double, T>;
+
+    /**
+     * @brief One sequential heap, alone on its cache line
+     */
+    struct alignas(64) Heap {
+        std::mutex lock; /**< Held while the heap changes */
+        std::vector<Entry> items; /**< Binary min-heap on the keys */
+        std::atomic<double> top; /**< Key of the smallest item, infinity if empty, read without the lock */
+
+        Heap() : top(std::numeric_limits<double>::infinity()) {
+        }
+    };
+
+    /** @brief The heaps */
+    std::vector<Heap> heaps;
+
+    /**
+     * @brief Draws a random heap
+     * @param random The calling thread's random state
+     * @return Index of the heap
+     * @details O(1)
+     */
+    size_t pick(unsigned long long &random) const;
+
+    /**
+     * @brief Pops the top of a locked heap and refreshes its cached key
+     * @details O(log n)
+     */
+    static void popLocked(Heap &heap, double &key, T &value);
+};
+
+template<class T>
+MultiQueue<T>::MultiQueue(unsigned int threads, unsigned int factor)
+    : heaps(std::max(1u, threads) * std::max(1u, factor)) {
+}
+
+template<class T>
+size_t MultiQueue<T>::pick(unsigned long long &random) const {
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    return static_cast<size_t>(random % heaps.size());
+}
+
+template<class T>
+void MultiQueue<T>::push(double key, const T &value, unsigned long long &random) {
+    while (true) {
+        Heap &heap = heaps[pick(random)];
+        if (!heap.lock.try_lock())
+            continue; // another thread holds it, any other heap will do
+        heap.items.emplace_back(key, value);
+        std::push_heap(heap.items.begin(), heap.items.end(), std::greater<Entry>());
+        heap.top.store(heap.items.front().first, std::memory_order_relaxed);
+        heap.lock.unlock();
+        return;
+    }
+}
+
+template<class T>
+void MultiQueue<T>::popLocked(Heap &heap, double &key, T &value) {
+    std::pop_heap(heap.items.begin(), heap.items.end(), std::greater<Entry>());
+    key = heap.items.back().first;
+    value = heap.items.back().second;
+    heap.items.pop_back();
+    heap.top.store(heap.items.empty() ? std::numeric_limits<double>::infinity() : heap.items.front().first,
+                   std::memory_order_relaxed);
+}
+
+template<class T>
+bool MultiQueue<T>::tryPop(double &key, T &value, unsigned long long &random) {
+    const double none = std::numeric_limits<double>::infinity();
+
+    for (size_t attempt = 0; attempt < 2 * heaps.size(); attempt++) {
+        size_t first = pick(random);
+        size_t second = pick(random);
+        double firstTop = heaps[first].top.load(std::memory_order_relaxed);
+        double secondTop = heaps[second].top.load(std::memory_order_relaxed);
+        Heap &heap = heaps[secondTop < firstTop ? second : first];
+        if (std::min(firstTop, secondTop) == none || !heap.lock.try_lock())
+            continue;
+        if (heap.items.empty()) {
+            heap.lock.unlock();
+            continue;
+        }
+        popLocked(heap, key, value);
+        heap.lock.unlock();
+        return true;
+    }
+
+    // Random picks keep missing; look at every heap before reporting the queue empty
+    for (auto &heap: heaps) {
+        if (heap.top.load(std::memory_order_relaxed) == none)
+            continue;
+        std::lock_guard<std::mutex> guard(heap.lock);
+        if (!heap.items.empty()) {
+            popLocked(heap, key, value);
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif /* DA_TP_CLASSES_MULTIQUEUE */
@@ -3,16 +3,144 @@
  * @brief Entry point for the project application
  * 
  * This file contains the main function which initializes the application
- * and displays the main menu to the user.
+ * and displays the main menu to the user, answers a batch file of requests, or keeps
+ * answering requests, one per line, until its input ends or it is stopped:
+ *
+ * project1-da-leic --batch locations.csv distances.csv requests.txt [results.txt] [threads]
+ * project1-da-leic --serve locations.csv distances.csv [socket|-] [threads]
  */
 
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
 #include "menu/Menu.h"
+#include "parse_data/DataManager.h"
+#include "routing/BatchEngine.h"
+#include "routing/GraphSnapshot.h"
+#include "routing/Preprocessing.h"
+#include "server/QueryServer.h"
+
+/**
+ * @brief Loads a dataset, builds the graph and answers every request of a batch file
+ * @param argc Number of arguments
+ * @param argv Arguments, starting with --batch
+ * @return 0 on success, 1 on failure
+ * @details O(V + E + R * Q / T) where R is the number of requests and T the number of threads
+ */
+int runBatch(int argc, char *argv[]) {
+    if (argc < 5) {
+        std::cerr << "Usage: " << argv[0]
+                << " --batch locations.csv distances.csv requests.txt [results.txt] [threads]" << std::endl;
+        return 1;
+    }
+    std::string resultsFilePath = argc > 5 ? argv[5] : "output.txt";
+    unsigned int threads = argc > 6 ? static_cast<unsigned int>(std::atoi(argv[6])) : 0;
+
+    if (!DataManager::getInstance()->loadData(argv[2], argv[3])) {
+        std::cerr << "Failed to load data from " << argv[2] << " and " << argv[3] << std::endl;
+        return 1;
+    }
+
+    std::vector<BatchEngine::Request> requests;
+    if (!BatchEngine::readRequests(argv[4], requests)) {
+        return 1;
+    }
+
+    Graph<LocationInfo> graph = GraphBuilder::buildGraphFromDataManager();
+    Preprocessing::printReport(Preprocessing::prepare(graph), std::cout);
+
+    BatchEngine engine(graph, threads);
+    std::vector<BatchEngine::Result> results = engine.run(requests);
+    if (!BatchEngine::writeResults(resultsFilePath, requests, results)) {
+        return 1;
+    }
+
+    std::cout << requests.size() << " request(s) answered by " << engine.getThreadCount() << " thread(s), written to "
+            << resultsFilePath << std::endl;
+    return 0;
+}
+
+/** @brief Server stopped by SIGINT and SIGTERM, nullptr when none is serving a socket */
+static QueryServer *activeServer = nullptr;
+
+/**
+ * @brief Stops the active server; stop only stores a flag and shuts a socket down, both safe in a handler
+ * @param signal The signal
+ */
+static void stopServer(int signal) {
+    (void) signal;
+    if (activeServer != nullptr) {
+        activeServer->stop();
+    }
+}
+
+/**
+ * @brief Loads a dataset once and answers requests, one per line, on standard input or a Unix-domain socket
+ * @param argc Number of arguments
+ * @param argv Arguments, starting with --serve
+ * @return 0 on success, 1 on failure
+ * @details O(V + E + P) to load, then O(Q / T) per request where T is the number of threads
+ */
+int runServer(int argc, char *argv[]) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " --serve locations.csv distances.csv [socket|-] [threads]" << std::endl;
+        return 1;
+    }
+    std::string socketPath = argc > 4 ? argv[4] : "-";
+    unsigned int threads = argc > 5 ? static_cast<unsigned int>(std::atoi(argv[5])) : 0;
+
+    // Standard output only carries responses; what the library prints goes to standard error
+    std::ostream responses(std::cout.rdbuf());
+    std::streambuf *standardOutput = std::cout.rdbuf(std::cerr.rdbuf());
+
+    GraphSnapshot::Handle snapshot = GraphSnapshot::load(argv[2], argv[3]);
+    if (!snapshot) {
+        std::cerr << "Failed to load data from " << argv[2] << " and " << argv[3] << std::endl;
+        std::cout.rdbuf(standardOutput);
+        return 1;
+    }
+    Preprocessing::printReport(snapshot->getReport(), std::cerr);
+    GraphSnapshot::publish(snapshot);
+    snapshot.reset();
+
+    bool served = true;
+    {
+        QueryServer server(threads);
+        if (socketPath == "-") {
+            std::cerr << "Serving on standard input with " << server.getThreadCount() << " thread(s)" << std::endl;
+            server.serveStream(std::cin, responses);
+        } else {
+            std::cerr << "Serving on " << socketPath << " with " << server.getThreadCount() << " thread(s)" << std::endl;
+            activeServer = &server;
+            std::signal(SIGINT, stopServer);
+            std::signal(SIGTERM, stopServer);
+            served = server.serveSocket(socketPath);
+            std::signal(SIGINT, SIG_DFL);
+            std::signal(SIGTERM, SIG_DFL);
+            activeServer = nullptr;
+        }
+    }
+
+    std::cout.rdbuf(standardOutput);
+    return served ? 0 : 1;
+}
 
 /**
  * @brief Application entry point
+ * @param argc Number of arguments
+ * @param argv Arguments; --batch answers a batch file and --serve starts a server instead of showing the menu
  * @return 0 on successful execution
  */
-int main() {
+int main(int argc, char *argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--batch") {
+        return runBatch(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--serve") {
+        return runServer(argc, argv);
+    }
+
     Menu menu;
     menu.credits();
     menu.mainMenu();
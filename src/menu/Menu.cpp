@@ -9,16 +9,24 @@
 #include <limits>
 #include <string>
 
-#include "../parse_data/DataManager.h"
 #include "../graph_builder/GraphBuilder.h"
 #include "../routing/Routing.h"
+#include "../routing/TravelTimeProfiles.h"
 
 Menu::Menu() {
-    dataManager = DataManager::getInstance();
-    graphBuilt = false;
+}
+
+Menu::~Menu() {
+    if (reloader.joinable()) {
+        reloader.join();
+    }
 }
 
 void Menu::mainMenu() {
+    // The last query is done with its snapshot; holding on to it would keep a replaced dataset alive
+    snapshot.reset();
+    printReloadReport();
+
     std::cout << "" << std::endl;
     std::cout << "  0. Load dataset." << std::endl;
     std::cout << "" << std::endl;
@@ -40,7 +48,6 @@ void Menu::optionPicker() {
 
     if (option == 0) {
         datasetMenu();
-        buildGraph();
         mainMenu();
     } else if (option == 1) {
         if (!checkDataLoaded()) {
@@ -61,6 +68,10 @@ void Menu::optionPicker() {
         }
         environmentallyFriendlyRoute();
     } else if (option == 4) {
+        if (reloader.joinable()) {
+            reloader.join();
+        }
+        printReloadReport();
         exit(0);
     } else {
         std::cout << "" << std::endl;
@@ -71,42 +82,69 @@ void Menu::optionPicker() {
     }
 }
 
-bool Menu::checkDataLoaded() const {
-    if (!dataManager->isDataLoaded()) {
+bool Menu::checkDataLoaded() {
+    snapshot = GraphSnapshot::current();
+    if (snapshot == nullptr) {
         std::cout << "" << std::endl;
         std::cout << "No data loaded. Select load dataset from the main menu." << std::endl;
         return false;
     }
-    if (!graphBuilt) {
-        std::cout << "" << std::endl;
-        std::cout << "Graph not built. Please try reloading the dataset." << std::endl;
-        return false;
-    }
     return true;
 }
 
-void Menu::buildGraph() {
-    if (!dataManager->isDataLoaded()) {
-        return;
+void Menu::printReloadReport() {
+    std::string report;
+    {
+        std::lock_guard<std::mutex> lock(reloadMutex);
+        report.swap(reloadReport);
     }
+    if (!report.empty()) {
+        std::cout << "" << std::endl;
+        std::cout << "Background dataset load:" << std::endl;
+        std::cout << report;
+    }
+}
 
-    std::cout << "" << std::endl;
-
+bool Menu::buildGraph(const std::string &locationsFilePath,
+                      const std::string &distancesFilePath,
+                      const std::string &profilesFilePath,
+                      std::ostream &out) {
+    GraphSnapshot::Handle built;
     try {
-        transportGraph = GraphBuilder::buildGraphFromDataManager();
-        graphBuilt = true;
+        built = GraphSnapshot::load(locationsFilePath, distancesFilePath, profilesFilePath);
+    } catch (const std::exception &e) {
+        out << "Error building graph: " << e.what() << std::endl;
+        return false;
+    }
+    if (built == nullptr) {
+        out << "Failed to load data. Please check the file paths and try again." << std::endl;
+        return false;
+    }
 
-        std::cout << "Graph built successfully!" << std::endl;
+    out << "" << std::endl;
+    out << "Data loaded successfully!" << std::endl;
+    out << "" << std::endl;
+    out << "Locations loaded: " << built->getLocations().size() << std::endl;
+    out << "Distances loaded: " << built->getDistanceCount() << std::endl;
+    out << "" << std::endl;
+    out << "Graph built successfully!" << std::endl;
 
-        // Print detailed graph information
-        // GraphBuilder::printGraph(transportGraph);
-    } catch (const std::exception &e) {
-        std::cerr << "Error building graph: " << e.what() << std::endl;
-        graphBuilt = false;
+    for (const auto &message: built->getMessages()) {
+        out << message << std::endl;
+    }
+    if (built->getIndexes().profiles) {
+        out << "Travel-time profiles loaded for " << built->getIndexes().profiles->getProfiledEdgeCount() <<
+                " edges." << std::endl;
     }
+
+    // Print detailed graph information
+    // GraphBuilder::printGraph(built->getGraph());
+
+    GraphSnapshot::publish(built);
+    return true;
 }
 
-void Menu::datasetMenu() const {
+void Menu::datasetMenu() {
     std::cout << "" << std::endl;
     std::cout << "You will need to load two csv files:" << std::endl;
     std::cout <<
@@ -123,25 +161,35 @@ void Menu::datasetMenu() const {
     std::cout << "Please enter the file path for the distances csv file: ";
     std::string distancesFilePath;
     std::getline(std::cin >> std::ws, distancesFilePath);
+    std::cout << "" << std::endl;
+    std::cout << "Please enter the file path for the travel-time profiles csv file (optional, leave empty to skip): ";
+    std::string profilesFilePath;
+    std::getline(std::cin, profilesFilePath);
+
+    if (GraphSnapshot::current() == nullptr) {
+        if (!buildGraph(locationsFilePath, distancesFilePath, profilesFilePath, std::cout)) {
+            std::cout << "" << std::endl;
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            datasetMenu();
+        }
+        return;
+    }
 
-    bool loaded = dataManager->loadData(locationsFilePath, distancesFilePath);
-
-    if (loaded) {
-        std::cout << "" << std::endl;
-        std::cout << "Data loaded successfully!" << std::endl;
-        std::cout << "" << std::endl;
-
-        auto distanceData = dataManager->getDistanceData();
-        auto locationData = dataManager->getLocationData();
-
-        std::cout << "Locations loaded: " << locationData.size() << std::endl;
-        std::cout << "Distances loaded: " << distanceData.size() << std::endl;
-    } else {
-        std::cerr << "Failed to load data. Please check the file paths and try again." << std::endl;
-        std::cout << "" << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        datasetMenu();
+    // Routes keep using the published dataset until the new one replaces it
+    if (reloader.joinable()) {
+        reloader.join();
     }
+    reloader = std::thread([this, locationsFilePath, distancesFilePath, profilesFilePath]() {
+        std::ostringstream report;
+        if (!buildGraph(locationsFilePath, distancesFilePath, profilesFilePath, report)) {
+            report << "The current dataset stays loaded." << std::endl;
+        }
+        std::lock_guard<std::mutex> lock(reloadMutex);
+        reloadReport += report.str();
+    });
+    std::cout << "" << std::endl;
+    std::cout << "Loading the new dataset in the background; routes use the current one until it is ready." <<
+            std::endl;
 }
 
 bool Menu::readInput(const std::string &filename,
@@ -150,8 +198,10 @@ bool Menu::readInput(const std::string &filename,
                      std::string &destCode,
                      std::vector<int> &avoidNodes,
                      std::vector<std::pair<int, int> > &avoidSegments,
-                     int &includeNode) {
+                     std::vector<int> &includeNodes,
+                     double &departureTime) {
     std::ifstream file(filename);
+    departureTime = -1;
 
     if (!file.is_open()) {
         std::cerr << "Could not open file " << filename << std::endl;
@@ -239,15 +289,31 @@ bool Menu::readInput(const std::string &filename,
                     }
                 }
             }
+        } else if (line.find("DepartureTime:") == 0) {
+            std::string time = line.substr(14);
+            time.erase(0, time.find_first_not_of(" \t"));
+            size_t colonPos = time.find(':');
+            try {
+                departureTime = colonPos == std::string::npos
+                                    ? std::stod(time)
+                                    : std::stoi(time.substr(0, colonPos)) * 60 + std::stod(time.substr(colonPos + 1));
+            } catch (const std::exception &e) {
+                std::cerr << "Error parsing departure time: " << e.what() << std::endl;
+                return false;
+            }
         } else if (line.find("IncludeNode:") == 0) {
-            std::string nodeStr = line.substr(12);
-            nodeStr.erase(0, nodeStr.find_first_not_of(" \t"));
-            if (!nodeStr.empty()) {
-                try {
-                    includeNode = std::stoi(nodeStr);
-                } catch (const std::exception &e) {
-                    std::cerr << "Error parsing include node ID: " << e.what() << std::endl;
-                    return false;
+            std::string nodes = line.substr(12);
+            nodes.erase(0, nodes.find_first_not_of(" \t"));
+            if (!nodes.empty()) {
+                std::stringstream ss(nodes);
+                std::string node;
+                while (std::getline(ss, node, ',')) {
+                    try {
+                        includeNodes.push_back(std::stoi(node));
+                    } catch (const std::exception &e) {
+                        std::cerr << "Error parsing include node ID: " << e.what() << std::endl;
+                        return false;
+                    }
                 }
             }
         }
@@ -271,7 +337,7 @@ bool Menu::readInput(const std::string &filename,
     bool foundSource = false;
     bool foundDest = false;
 
-    std::vector<LocationData> locations = dataManager->getLocationData();
+    const std::vector<LocationData> &locations = snapshot->getLocations();
 
     for (const auto &loc: locations) {
         if (loc.id == sourceId) {
@@ -311,6 +377,7 @@ void Menu::independentRoute() {
     std::string sourceCode, destCode;
     int sourceId = -1, destId = -1;
     Edge<LocationInfo>::EdgeType transportMode = Edge<LocationInfo>::EdgeType::DRIVING;
+    double departureTime = -1;
 
     if (choice == 2) {
         std::cout << "\nEnter the path to the input file (default: ./input.txt): ";
@@ -324,9 +391,9 @@ void Menu::independentRoute() {
 
         std::vector<int> dummyAvoidNodes;
         std::vector<std::pair<int, int> > dummyAvoidSegments;
-        int dummyIncludeNode = -1;
+        std::vector<int> dummyIncludeNodes;
         if (!readInput(filePath, transportMode, sourceCode, destCode, dummyAvoidNodes, dummyAvoidSegments,
-                       dummyIncludeNode)) {
+                       dummyIncludeNodes, departureTime)) {
             std::cerr << "Failed to read route data from file. Please check the format and try again." << std::endl;
             std::cout << "\nPress Enter to return to the main menu...";
             std::cin.get();
@@ -334,7 +401,7 @@ void Menu::independentRoute() {
             return;
         }
 
-        auto locations = dataManager->getLocationData();
+        const auto &locations = snapshot->getLocations();
         for (const auto &loc: locations) {
             if (loc.code == sourceCode) {
                 sourceId = loc.id;
@@ -376,7 +443,7 @@ void Menu::independentRoute() {
 
         if (isSourceId) {
             bool found = false;
-            for (const auto &loc: dataManager->getLocationData()) {
+            for (const auto &loc: snapshot->getLocations()) {
                 if (loc.id == sourceId) {
                     sourceCode = loc.code;
                     found = true;
@@ -394,7 +461,7 @@ void Menu::independentRoute() {
 
         if (isDestId) {
             bool found = false;
-            for (const auto &loc: dataManager->getLocationData()) {
+            for (const auto &loc: snapshot->getLocations()) {
                 if (loc.id == destId) {
                     destCode = loc.code;
                     found = true;
@@ -409,7 +476,7 @@ void Menu::independentRoute() {
                 return;
             }
         } else {
-            for (const auto &loc: dataManager->getLocationData()) {
+            for (const auto &loc: snapshot->getLocations()) {
                 if (loc.code == destCode) {
                     destId = loc.id;
                     break;
@@ -418,7 +485,7 @@ void Menu::independentRoute() {
         }
 
         if (!isSourceId) {
-            for (const auto &loc: dataManager->getLocationData()) {
+            for (const auto &loc: snapshot->getLocations()) {
                 if (loc.code == sourceCode) {
                     sourceId = loc.id;
                     break;
@@ -436,25 +503,28 @@ void Menu::independentRoute() {
         return;
     }
 
-    std::vector<LocationInfo> fastestRoute = Routing::findFastestRoute(
-        transportGraph, sourceCode, destCode, transportMode);
+    Routing::Route fastestRoute = Routing::findFastestRoute(
+        snapshot->getGraph(), sourceCode, destCode, transportMode, departureTime);
 
-    std::vector<LocationInfo> alternativeRoute;
+    Routing::Route alternativeRoute;
     if (!fastestRoute.empty()) {
         alternativeRoute = Routing::findAlternativeRoute(
-            transportGraph, fastestRoute, sourceCode, destCode, transportMode);
+            snapshot->getGraph(), fastestRoute, sourceCode, destCode, transportMode);
+    }
+    if (departureTime >= 0) {
+        alternativeRoute = Routing::timeRoute(snapshot->getGraph(), alternativeRoute, departureTime);
     }
 
-    double fastestTime = Routing::calculateRouteTime(fastestRoute, transportGraph, transportMode);
-    double alternativeTime = Routing::calculateRouteTime(alternativeRoute, transportGraph, transportMode);
+    double fastestTime = Routing::calculateRouteTime(fastestRoute);
+    double alternativeTime = Routing::calculateRouteTime(alternativeRoute);
 
     std::cout << "\nBest route: ";
     if (fastestRoute.empty()) {
         std::cout << "No route found." << std::endl;
     } else {
-        for (size_t i = 0; i < fastestRoute.size(); i++) {
-            std::cout << fastestRoute[i].id;
-            if (i < fastestRoute.size() - 1)
+        for (size_t i = 0; i < fastestRoute.locations.size(); i++) {
+            std::cout << fastestRoute.locations[i].id;
+            if (i < fastestRoute.locations.size() - 1)
                 std::cout << " → ";
         }
         std::cout << " (" << fastestTime << " minutes)" << std::endl;
@@ -464,16 +534,36 @@ void Menu::independentRoute() {
     if (alternativeRoute.empty()) {
         std::cout << "No alternative route found." << std::endl;
     } else {
-        for (size_t i = 0; i < alternativeRoute.size(); i++) {
-            std::cout << alternativeRoute[i].id;
-            if (i < alternativeRoute.size() - 1)
+        for (size_t i = 0; i < alternativeRoute.locations.size(); i++) {
+            std::cout << alternativeRoute.locations[i].id;
+            if (i < alternativeRoute.locations.size() - 1)
                 std::cout << " → ";
         }
         std::cout << " (" << alternativeTime << " minutes)" << std::endl;
     }
 
+    std::vector<Routing::Route> otherRoutes;
+    if (!fastestRoute.empty()) {
+        otherRoutes = Routing::findAlternativeRoutes(snapshot->getGraph(), sourceCode, destCode, transportMode);
+    }
+    if (departureTime >= 0) {
+        for (auto &route: otherRoutes) {
+            route = Routing::timeRoute(snapshot->getGraph(), route, departureTime);
+        }
+    }
+
+    for (size_t r = 0; r < otherRoutes.size(); r++) {
+        std::cout << "Other option " << r + 1 << ": ";
+        for (size_t i = 0; i < otherRoutes[r].locations.size(); i++) {
+            std::cout << otherRoutes[r].locations[i].id;
+            if (i < otherRoutes[r].locations.size() - 1)
+                std::cout << " → ";
+        }
+        std::cout << " (" << Routing::calculateRouteTime(otherRoutes[r]) << " minutes)" << std::endl;
+    }
+
     std::string outputFilename = "output.txt";
-    Routing::outputRoutesToFile(outputFilename, sourceId, destId, fastestRoute, alternativeRoute, transportGraph);
+    Routing::outputRoutesToFile(outputFilename, sourceId, destId, fastestRoute, alternativeRoute);
 
     std::cout << "\nPress Enter to return to the main menu...";
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
@@ -500,7 +590,9 @@ void Menu::restrictedRoute() {
 
     std::vector<int> avoidNodes;
     std::vector<std::pair<int, int> > avoidSegments;
-    int includeNode = -1;
+    std::vector<int> includeNodes;
+    bool keepIncludeOrder = true;
+    double departureTime = -1;
 
     if (choice == 2) {
         std::cout << "\nEnter the path to the input file (default: input.txt): ";
@@ -512,7 +604,8 @@ void Menu::restrictedRoute() {
             filePath = "input.txt";
         }
 
-        if (!readInput(filePath, transportMode, sourceCode, destCode, avoidNodes, avoidSegments, includeNode)) {
+        if (!readInput(filePath, transportMode, sourceCode, destCode, avoidNodes, avoidSegments, includeNodes,
+                       departureTime)) {
             std::cerr << "Failed to read route data from file. Please check the format and try again." << std::endl;
             std::cout << "\nPress Enter to return to the main menu...";
             std::cin.get();
@@ -520,7 +613,7 @@ void Menu::restrictedRoute() {
             return;
         }
 
-        auto locations = dataManager->getLocationData();
+        const auto &locations = snapshot->getLocations();
         for (const auto &loc: locations) {
             if (loc.code == sourceCode) {
                 sourceId = loc.id;
@@ -557,7 +650,7 @@ void Menu::restrictedRoute() {
 
         if (isSourceId) {
             bool found = false;
-            for (const auto &loc: dataManager->getLocationData()) {
+            for (const auto &loc: snapshot->getLocations()) {
                 if (loc.id == sourceId) {
                     sourceCode = loc.code;
                     found = true;
@@ -575,7 +668,7 @@ void Menu::restrictedRoute() {
 
         if (isDestId) {
             bool found = false;
-            for (const auto &loc: dataManager->getLocationData()) {
+            for (const auto &loc: snapshot->getLocations()) {
                 if (loc.id == destId) {
                     destCode = loc.code;
                     found = true;
@@ -590,7 +683,7 @@ void Menu::restrictedRoute() {
                 return;
             }
         } else {
-            for (const auto &loc: dataManager->getLocationData()) {
+            for (const auto &loc: snapshot->getLocations()) {
                 if (loc.code == destCode) {
                     destId = loc.id;
                     break;
@@ -599,7 +692,7 @@ void Menu::restrictedRoute() {
         }
 
         if (!isSourceId) {
-            for (const auto &loc: dataManager->getLocationData()) {
+            for (const auto &loc: snapshot->getLocations()) {
                 if (loc.code == sourceCode) {
                     sourceId = loc.id;
                     break;
@@ -662,13 +755,32 @@ void Menu::restrictedRoute() {
             }
         }
 
-        std::cout << "Do you want to include a specific intermediate node? (y/n): ";
+        std::cout << "Do you want to include specific intermediate nodes? (y/n): ";
         char includeNodeOption;
         std::cin >> includeNodeOption;
 
         if (includeNodeOption == 'y' || includeNodeOption == 'Y') {
-            std::cout << "Enter ID of node to include: ";
-            std::cin >> includeNode;
+            std::cout << "Enter IDs of nodes to include (comma-separated): ";
+            std::string includeNodesInput;
+            std::cin.ignore();
+            std::getline(std::cin, includeNodesInput);
+
+            std::stringstream ss(includeNodesInput);
+            std::string nodeId;
+            while (std::getline(ss, nodeId, ',')) {
+                try {
+                    includeNodes.push_back(std::stoi(nodeId));
+                } catch (const std::exception &e) {
+                    std::cerr << "Error parsing node ID: " << e.what() << std::endl;
+                }
+            }
+
+            if (includeNodes.size() > 1) {
+                std::cout << "Can they be visited in any order? (y/n): ";
+                char anyOrderOption;
+                std::cin >> anyOrderOption;
+                keepIncludeOrder = !(anyOrderOption == 'y' || anyOrderOption == 'Y');
+            }
         }
     } else {
         std::cout << "\nInvalid option. Returning to main menu." << std::endl;
@@ -681,7 +793,7 @@ void Menu::restrictedRoute() {
 
     std::vector<int> avoidNodeIds;
     for (int avoidNodeInputId: avoidNodes) {
-        for (const auto &loc: dataManager->getLocationData()) {
+        for (const auto &loc: snapshot->getLocations()) {
             if (loc.id == avoidNodeInputId) {
                 avoidNodeIds.push_back(loc.id);
                 break;
@@ -690,66 +802,34 @@ void Menu::restrictedRoute() {
     }
 
     std::unordered_map<int, std::string> idToCodeMap;
-    for (const auto &loc: dataManager->getLocationData()) {
+    for (const auto &loc: snapshot->getLocations()) {
         idToCodeMap[loc.id] = loc.code;
     }
 
-    Routing::EdgeFilter restrictionFilter = [&avoidNodeIds, &avoidSegments, &transportMode](Edge<LocationInfo> *edge) {
-        if (edge->getType() != transportMode) {
-            return false;
-        }
-
-        int destId = edge->getDest()->getInfo().id;
-        int origId = edge->getOrig()->getInfo().id;
+    RouteRestrictions restrictions = RouteRestrictions::compile(
+        snapshot->getGraph(), avoidNodeIds, avoidSegments, transportMode);
 
-        for (int avoidId: avoidNodeIds) {
-            if (destId == avoidId) {
-                return false;
-            }
-        }
+    Routing::Route restrictedRoute;
 
-        for (const auto &segment: avoidSegments) {
-            if ((segment.first == origId && segment.second == destId) ||
-                (segment.first == destId && segment.second == origId)) {
-                return false;
-            }
-        }
-
-        return true;
-    };
-
-    std::vector<LocationInfo> restrictedRoute;
-
-    if (includeNode == -1) {
-        restrictedRoute = Routing::findRouteWithFilter(
-            transportGraph, sourceCode, destCode, restrictionFilter);
+    if (includeNodes.empty()) {
+        restrictedRoute = Routing::findRouteWithRestrictions(
+            snapshot->getGraph(), sourceCode, destCode, restrictions, departureTime);
     } else {
-        std::string includeNodeCode;
-        for (const auto &loc: dataManager->getLocationData()) {
-            if (loc.id == includeNode) {
-                includeNodeCode = loc.code;
-                break;
+        std::vector<std::string> includeNodeCodes;
+        for (int includeNode: includeNodes) {
+            auto it = idToCodeMap.find(includeNode);
+            if (it != idToCodeMap.end()) {
+                includeNodeCodes.push_back(it->second);
             }
         }
 
-        if (!includeNodeCode.empty()) {
-            auto firstLeg = Routing::findRouteWithFilter(
-                transportGraph, sourceCode, includeNodeCode, restrictionFilter);
-
-            auto secondLeg = Routing::findRouteWithFilter(
-                transportGraph, includeNodeCode, destCode, restrictionFilter);
-
-            if (!firstLeg.empty() && !secondLeg.empty()) {
-                restrictedRoute = firstLeg;
-                restrictedRoute.insert(restrictedRoute.end(), secondLeg.begin() + 1, secondLeg.end());
-            }
+        if (includeNodeCodes.size() == includeNodes.size()) {
+            restrictedRoute = Routing::findRouteThroughStops(
+                snapshot->getGraph(), sourceCode, destCode, includeNodeCodes, restrictions, keepIncludeOrder);
         }
     }
 
-    double routeTime = 0;
-    if (!restrictedRoute.empty()) {
-        routeTime = Routing::calculateRouteTime(restrictedRoute, transportGraph, transportMode);
-    }
+    double routeTime = Routing::calculateRouteTime(restrictedRoute);
 
     std::ofstream outFile("output.txt");
     if (!outFile.is_open()) {
@@ -760,7 +840,7 @@ void Menu::restrictedRoute() {
         return;
     }
 
-    outFile << "RestrictedDrivingRoute:" << Routing::formatRouteForOutput(restrictedRoute, routeTime) << std::endl;
+    outFile << "RestrictedDrivingRoute:" << Routing::formatRouteForOutput(restrictedRoute) << std::endl;
 
     outFile.flush();
     outFile.close();
@@ -768,9 +848,9 @@ void Menu::restrictedRoute() {
     std::cout << "\nRestricted Route Result:" << std::endl;
     if (!restrictedRoute.empty()) {
         std::cout << "Path: ";
-        for (size_t i = 0; i < restrictedRoute.size(); i++) {
-            std::cout << restrictedRoute[i].id;
-            if (i < restrictedRoute.size() - 1)
+        for (size_t i = 0; i < restrictedRoute.locations.size(); i++) {
+            std::cout << restrictedRoute.locations[i].id;
+            if (i < restrictedRoute.locations.size() - 1)
                 std::cout << " → ";
         }
         std::cout << "\nTotal time: " << routeTime << " minutes" << std::endl;
@@ -810,7 +890,7 @@ void Menu::environmentallyFriendlyRoute() {
         std::cout << "\nProcessing input file..." << std::endl;
         std::string outputFilename = "output.txt";
 
-        bool success = Routing::processEcoRouteFromFile(filePath, outputFilename, transportGraph);
+        bool success = Routing::processEcoRouteFromFile(filePath, outputFilename, snapshot->getGraph());
 
         if (!success) {
             std::cout << "Failed to process route from input file." << std::endl;
@@ -849,7 +929,7 @@ void Menu::environmentallyFriendlyRoute() {
 
         if (isSourceId) {
             bool found = false;
-            for (const auto &loc: dataManager->getLocationData()) {
+            for (const auto &loc: snapshot->getLocations()) {
                 if (loc.id == sourceId) {
                     sourceCode = loc.code;
                     found = true;
@@ -867,7 +947,7 @@ void Menu::environmentallyFriendlyRoute() {
 
         if (isDestId) {
             bool found = false;
-            for (const auto &loc: dataManager->getLocationData()) {
+            for (const auto &loc: snapshot->getLocations()) {
                 if (loc.id == destId) {
                     destCode = loc.code;
                     found = true;
@@ -884,7 +964,7 @@ void Menu::environmentallyFriendlyRoute() {
         }
 
         if (!isSourceId) {
-            for (const auto &loc: dataManager->getLocationData()) {
+            for (const auto &loc: snapshot->getLocations()) {
                 if (loc.code == sourceCode) {
                     sourceId = loc.id;
                     break;
@@ -893,7 +973,7 @@ void Menu::environmentallyFriendlyRoute() {
         }
 
         if (!isDestId) {
-            for (const auto &loc: dataManager->getLocationData()) {
+            for (const auto &loc: snapshot->getLocations()) {
                 if (loc.code == destCode) {
                     destId = loc.id;
                     break;
@@ -959,7 +1039,7 @@ void Menu::environmentallyFriendlyRoute() {
         }
 
         Routing::EcoRoute ecoRoute = Routing::findEnvironmentallyFriendlyRoute(
-            transportGraph, sourceCode, destCode, maxWalkingTime, avoidNodes, avoidSegments);
+            snapshot->getGraph(), sourceCode, destCode, maxWalkingTime, avoidNodes, avoidSegments);
 
         std::string outputFilename = "output.txt";
 
@@ -975,7 +1055,7 @@ void Menu::environmentallyFriendlyRoute() {
                 std::cout << "Finding approximate solutions..." << std::endl;
 
                 std::vector<Routing::EcoRoute> approximateRoutes = Routing::findApproximateEcoRoutes(
-                    transportGraph, sourceCode, destCode, avoidNodes, avoidSegments);
+                    snapshot->getGraph(), sourceCode, destCode, avoidNodes, avoidSegments);
 
                 if (!approximateRoutes.empty()) {
                     displayMultipleEcoRouteResults(approximateRoutes, sourceCode, destCode);
@@ -1018,7 +1098,7 @@ void Menu::displayEcoRouteResults(const Routing::EcoRoute &route, const std::str
     std::cout << "--------------------------" << std::endl;
 
     std::string sourceName = "Unknown", destName = "Unknown";
-    for (const auto &location: dataManager->getLocationData()) {
+    for (const auto &location: snapshot->getLocations()) {
         if (location.code == sourceCode) {
             sourceName = location.location;
         }
@@ -1039,20 +1119,12 @@ void Menu::displayEcoRouteResults(const Routing::EcoRoute &route, const std::str
 
     std::cout << "Driving Route:" << std::endl;
     std::cout << "--------------" << std::endl;
-    for (size_t i = 0; i < route.drivingRoute.size(); i++) {
-        std::cout << i + 1 << ". " << route.drivingRoute[i].name
-                << " (" << route.drivingRoute[i].code << ")";
-
-        if (i < route.drivingRoute.size() - 1) {
-            Vertex<LocationInfo> *current = transportGraph.findVertex(route.drivingRoute[i]);
+    for (size_t i = 0; i < route.drivingRoute.locations.size(); i++) {
+        std::cout << i + 1 << ". " << route.drivingRoute.locations[i].name
+                << " (" << route.drivingRoute.locations[i].code << ")";
 
-            for (Edge<LocationInfo> *edge: current->getAdj()) {
-                if (edge->getDest()->getInfo().code == route.drivingRoute[i + 1].code &&
-                    edge->getType() == Edge<LocationInfo>::EdgeType::DRIVING) {
-                    std::cout << " -> " << edge->getWeight() << " minutes (driving)";
-                    break;
-                }
-            }
+        if (i < route.drivingRoute.edges.size()) {
+            std::cout << " -> " << route.drivingRoute.edges[i]->getWeight() << " minutes (driving)";
         }
 
         std::cout << std::endl;
@@ -1066,20 +1138,12 @@ void Menu::displayEcoRouteResults(const Routing::EcoRoute &route, const std::str
     std::cout << std::endl
             << "Walking Route:" << std::endl;
     std::cout << "--------------" << std::endl;
-    for (size_t i = 0; i < route.walkingRoute.size(); i++) {
-        std::cout << i + 1 << ". " << route.walkingRoute[i].name
-                << " (" << route.walkingRoute[i].code << ")";
-
-        if (i < route.walkingRoute.size() - 1) {
-            Vertex<LocationInfo> *current = transportGraph.findVertex(route.walkingRoute[i]);
+    for (size_t i = 0; i < route.walkingRoute.locations.size(); i++) {
+        std::cout << i + 1 << ". " << route.walkingRoute.locations[i].name
+                << " (" << route.walkingRoute.locations[i].code << ")";
 
-            for (Edge<LocationInfo> *edge: current->getAdj()) {
-                if (edge->getDest()->getInfo().code == route.walkingRoute[i + 1].code &&
-                    edge->getType() == Edge<LocationInfo>::EdgeType::WALKING) {
-                    std::cout << " -> " << edge->getWeight() << " minutes (walking)";
-                    break;
-                }
-            }
+        if (i < route.walkingRoute.edges.size()) {
+            std::cout << " -> " << route.walkingRoute.edges[i]->getWeight() << " minutes (walking)";
         }
 
         std::cout << std::endl;
@@ -1097,7 +1161,7 @@ void Menu::displayMultipleEcoRouteResults(const std::vector<Routing::EcoRoute> &
     std::cout << "------------------------------------------------" << std::endl;
 
     std::string sourceName = "Unknown", destName = "Unknown";
-    for (const auto &location: dataManager->getLocationData()) {
+    for (const auto &location: snapshot->getLocations()) {
         if (location.code == sourceCode) {
             sourceName = location.location;
         }
@@ -1123,20 +1187,12 @@ void Menu::displayMultipleEcoRouteResults(const std::vector<Routing::EcoRoute> &
 
         std::cout << "Driving Route:" << std::endl;
         std::cout << "--------------" << std::endl;
-        for (size_t i = 0; i < route.drivingRoute.size(); i++) {
-            std::cout << i + 1 << ". " << route.drivingRoute[i].name
-                    << " (" << route.drivingRoute[i].code << ")";
-
-            if (i < route.drivingRoute.size() - 1) {
-                Vertex<LocationInfo> *current = transportGraph.findVertex(route.drivingRoute[i]);
-
-                for (Edge<LocationInfo> *edge: current->getAdj()) {
-                    if (edge->getDest()->getInfo().code == route.drivingRoute[i + 1].code &&
-                        edge->getType() == Edge<LocationInfo>::EdgeType::DRIVING) {
-                        std::cout << " -> " << edge->getWeight() << " minutes (driving)";
-                        break;
-                    }
-                }
+        for (size_t i = 0; i < route.drivingRoute.locations.size(); i++) {
+            std::cout << i + 1 << ". " << route.drivingRoute.locations[i].name
+                    << " (" << route.drivingRoute.locations[i].code << ")";
+
+            if (i < route.drivingRoute.edges.size()) {
+                std::cout << " -> " << route.drivingRoute.edges[i]->getWeight() << " minutes (driving)";
             }
 
             std::cout << std::endl;
@@ -1150,20 +1206,12 @@ void Menu::displayMultipleEcoRouteResults(const std::vector<Routing::EcoRoute> &
         std::cout << std::endl
                 << "Walking Route:" << std::endl;
         std::cout << "--------------" << std::endl;
-        for (size_t i = 0; i < route.walkingRoute.size(); i++) {
-            std::cout << i + 1 << ". " << route.walkingRoute[i].name
-                    << " (" << route.walkingRoute[i].code << ")";
-
-            if (i < route.walkingRoute.size() - 1) {
-                Vertex<LocationInfo> *current = transportGraph.findVertex(route.walkingRoute[i]);
-
-                for (Edge<LocationInfo> *edge: current->getAdj()) {
-                    if (edge->getDest()->getInfo().code == route.walkingRoute[i + 1].code &&
-                        edge->getType() == Edge<LocationInfo>::EdgeType::WALKING) {
-                        std::cout << " -> " << edge->getWeight() << " minutes (walking)";
-                        break;
-                    }
-                }
+        for (size_t i = 0; i < route.walkingRoute.locations.size(); i++) {
+            std::cout << i + 1 << ". " << route.walkingRoute.locations[i].name
+                    << " (" << route.walkingRoute.locations[i].code << ")";
+
+            if (i < route.walkingRoute.edges.size()) {
+                std::cout << " -> " << route.walkingRoute.edges[i]->getWeight() << " minutes (walking)";
             }
 
             std::cout << std::endl;
@@ -1,10 +1,13 @@
 #ifndef MENU_H
 #define MENU_H
 
+#include <mutex>
+#include <ostream>
 #include <string>
-#include "../parse_data/DataManager.h"
+#include <thread>
 #include "../graph_structure/Graph.h"
 #include "../graph_builder/GraphBuilder.h"
+#include "../routing/GraphSnapshot.h"
 #include "../routing/Routing.h"
 
 /**
@@ -15,14 +18,23 @@
  * It presents various options for route planning, handles user input, and displays results.
  */
 class Menu {
-    /** @brief Singleton data manager instance */
-    DataManager *dataManager;
+    /** @brief Snapshot of the transportation network used by the query in progress */
+    GraphSnapshot::Handle snapshot;
 
-    /** @brief Graph representing the transportation network */
-    Graph<LocationInfo> transportGraph;
+    /** @brief Loads a replacement dataset while the menu keeps answering on the current one */
+    std::thread reloader;
 
-    /** @brief Flag indicating if the graph has been successfully built */
-    bool graphBuilt;
+    /** @brief What the reloader has to say, printed by the menu thread before the next menu */
+    std::string reloadReport;
+
+    /** @brief Guards reloadReport */
+    std::mutex reloadMutex;
+
+    /**
+     * @brief Prints what the reloader reported since the last call, if anything
+     * @details O(N) where N is the length of the report
+     */
+    void printReloadReport();
 
     /**
      * @brief Handles user option selection from the main menu
@@ -31,17 +43,25 @@ class Menu {
     void optionPicker();
 
     /**
-     * @brief Verifies if data is loaded and graph is built
-     * @return True if data is loaded and graph is built, false otherwise
+     * @brief Takes the published snapshot for the query about to run
+     * @return True if a dataset has been loaded, false otherwise
      * @details O(1)
      */
-    bool checkDataLoaded() const;
+    bool checkDataLoaded();
 
     /**
-     * @brief Builds the transportation graph from loaded data
-     * @details O(V + E) where V is the number of vertices and E is the number of edges
+     * @brief Loads a dataset, builds its graph and publishes it
+     * @param locationsFilePath Path to the locations csv file
+     * @param distancesFilePath Path to the distances csv file
+     * @param profilesFilePath Path to the travel-time profiles csv file, empty if none
+     * @param out Stream the outcome is written to
+     * @return True if the dataset was published, false otherwise
+     * @details O(V + E) where V is the number of vertices and E is the number of edges, plus preprocessing
      */
-    void buildGraph();
+    bool buildGraph(const std::string &locationsFilePath,
+                    const std::string &distancesFilePath,
+                    const std::string &profilesFilePath,
+                    std::ostream &out);
 
     /**
      * @brief Reads input parameters from a file
@@ -51,7 +71,8 @@ class Menu {
      * @param destCode Reference to store the destination location code
      * @param avoidNodes Reference to store nodes to avoid
      * @param avoidSegments Reference to store segments to avoid
-     * @param includeNode Reference to store a node to include
+     * @param includeNodes Reference to store the nodes to include, in visiting order
+     * @param departureTime Reference to store the departure time in minutes after midnight, -1 if none
      * @return True if input was successfully read, false otherwise
      * @details O(N) where N is the number of lines in the input file
      */
@@ -61,7 +82,8 @@ class Menu {
                    std::string &destCode,
                    std::vector<int> &avoidNodes,
                    std::vector<std::pair<int, int> > &avoidSegments,
-                   int &includeNode);
+                   std::vector<int> &includeNodes,
+                   double &departureTime);
 
     /**
      * @brief Displays the results of an environmentally-friendly route
@@ -92,6 +114,12 @@ public:
      */
     Menu();
 
+    /**
+     * @brief Waits for a dataset still loading in the background
+     * @details O(1), or the rest of the load
+     */
+    ~Menu();
+
     /**
      * @brief Displays the main menu options
      * @details O(1)
@@ -106,9 +134,13 @@ public:
 
     /**
      * @brief Menu for loading dataset files
+     *
+     * The first dataset is loaded before returning; later ones load in the background while
+     * routes keep using the current one.
+     *
      * @details O(N) where N is the size of the dataset
      */
-    void datasetMenu() const;
+    void datasetMenu();
 
     /**
      * @brief Handles the independent route planning functionality
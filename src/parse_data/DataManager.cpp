@@ -1,10 +1,11 @@
 #include "DataManager.h"
 #include "ParseData.h"
 #include <iostream>
+#include <utility>
 
 DataManager *DataManager::instance = nullptr;
 
-DataManager::DataManager() : dataLoaded(false) {
+DataManager::DataManager() : dataLoaded(false), dataVersion(0) {
 }
 
 DataManager *DataManager::getInstance() {
@@ -15,26 +16,35 @@ DataManager *DataManager::getInstance() {
 }
 
 bool DataManager::loadData(const std::string &locationsFilePath, const std::string &distancesFilePath) {
-    distanceData = readDistancesCSV(distancesFilePath);
-    locationData = readLocationsCSV(locationsFilePath);
+    std::vector<DistanceData> distances = readDistancesCSV(distancesFilePath);
+    std::vector<LocationData> locations = readLocationsCSV(locationsFilePath);
+    return setData(std::move(locations), std::move(distances));
+}
 
-    if (distanceData.empty() || locationData.empty()) {
-        dataLoaded = false;
-        return false;
-    }
+bool DataManager::setData(std::vector<LocationData> locations, std::vector<DistanceData> distances) {
+    std::lock_guard<std::mutex> lock(dataMutex);
+    distanceData = std::move(distances);
+    locationData = std::move(locations);
+    dataVersion++;
 
-    dataLoaded = true;
-    return true;
+    dataLoaded = !distanceData.empty() && !locationData.empty();
+    return dataLoaded;
 }
 
 bool DataManager::isDataLoaded() const {
     return dataLoaded;
 }
 
+unsigned long DataManager::getDataVersion() const {
+    return dataVersion;
+}
+
 std::vector<DistanceData> DataManager::getDistanceData() const {
+    std::lock_guard<std::mutex> lock(dataMutex);
     return distanceData;
 }
 
 std::vector<LocationData> DataManager::getLocationData() const {
+    std::lock_guard<std::mutex> lock(dataMutex);
     return locationData;
 }
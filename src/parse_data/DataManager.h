@@ -1,6 +1,8 @@
 #ifndef DATAMANAGER_H
 #define DATAMANAGER_H
 
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <vector>
 #include "../parse_data/ParseData.h"
@@ -24,7 +26,13 @@ class DataManager {
     std::vector<LocationData> locationData;
 
     /** @brief Flag indicating if data has been successfully loaded */
-    bool dataLoaded;
+    std::atomic<bool> dataLoaded;
+
+    /** @brief Incremented on every load, so derived structures can tell that they are stale */
+    std::atomic<unsigned long> dataVersion;
+
+    /** @brief Guards the data, which a background reload may replace while queries run */
+    mutable std::mutex dataMutex;
 
     /**
      * @brief Private constructor (singleton pattern)
@@ -49,6 +57,15 @@ public:
      */
     bool loadData(const std::string &locationsFilePath, const std::string &distancesFilePath);
 
+    /**
+     * @brief Replaces the data with data read elsewhere
+     * @param locations The location data
+     * @param distances The distance data
+     * @return True if neither collection is empty, false otherwise
+     * @details O(1)
+     */
+    bool setData(std::vector<LocationData> locations, std::vector<DistanceData> distances);
+
     /**
      * @brief Checks if data has been loaded
      * @return True if data is loaded, false otherwise
@@ -56,6 +73,13 @@ public:
      */
     bool isDataLoaded() const;
 
+    /**
+     * @brief Gets the version of the loaded data
+     * @return A number that changes every time loadData or setData is called
+     * @details O(1)
+     */
+    unsigned long getDataVersion() const;
+
     /**
      * @brief Gets the collection of distance data
      * @return Vector of distance data objects
@@ -108,3 +108,81 @@ std::vector<LocationData> readLocationsCSV(const std::string &filePath) {
     file.close();
     return data;
 }
+
+bool parseBreakpoint(const std::string &token, std::pair<int, double> &breakpoint) {
+    size_t colon = token.find(':');
+    size_t equals = token.find('=');
+    if (colon == std::string::npos || equals == std::string::npos || colon > equals) {
+        return false;
+    }
+
+    std::string hours = token.substr(0, colon);
+    std::string minutes = token.substr(colon + 1, equals - colon - 1);
+    if (!isInteger(hours) || !isInteger(minutes) || std::stoi(minutes) >= 60) {
+        return false;
+    }
+
+    try {
+        size_t used = 0;
+        std::string time = token.substr(equals + 1);
+        breakpoint.second = std::stod(time, &used);
+        if (used != time.size()) {
+            return false;
+        }
+    } catch (const std::exception &) {
+        return false;
+    }
+
+    breakpoint.first = std::stoi(hours) * 60 + std::stoi(minutes);
+    return breakpoint.first < 24 * 60;
+}
+
+std::vector<ProfileData> readProfilesCSV(const std::string &filePath) {
+    std::vector<ProfileData> data;
+    std::ifstream file(filePath);
+
+    if (!file.is_open()) {
+        return data;
+    }
+
+    std::string line;
+
+    std::getline(file, line);
+
+    while (std::getline(file, line)) {
+        line.erase(line.begin(), std::find_if(line.begin(), line.end(), [](unsigned char ch) {
+            return !std::isspace(ch);
+        }));
+        line.erase(std::find_if(line.rbegin(), line.rend(), [](unsigned char ch) {
+            return !std::isspace(ch);
+        }).base(), line.end());
+
+        if (line.empty()) {
+            continue;
+        }
+
+        std::stringstream lineStream(line);
+        ProfileData row;
+        std::getline(lineStream, row.location1, ',');
+        std::getline(lineStream, row.location2, ',');
+        std::getline(lineStream, row.mode, ',');
+
+        std::string token;
+        bool valid = true;
+        while (lineStream >> token) {
+            std::pair<int, double> breakpoint;
+            if (!parseBreakpoint(token, breakpoint)) {
+                valid = false;
+                break;
+            }
+            row.breakpoints.push_back(breakpoint);
+        }
+
+        if (valid && !row.breakpoints.empty()) {
+            data.push_back(row);
+        }
+    }
+
+    file.close();
+    return data;
+}
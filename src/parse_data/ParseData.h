@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <string>
+#include <utility>
 
 /**
  * @struct DistanceData
@@ -32,6 +33,20 @@ struct LocationData {
     int parking; /**< Parking availability (1 = available, 0 = unavailable) */
 };
 
+/**
+ * @struct ProfileData
+ * @brief Structure to store a time-of-day travel-time profile of a segment
+ *
+ * The profile is a piecewise-linear function of the departure time, given by its breakpoints
+ * and repeated every day.
+ */
+struct ProfileData {
+    std::string location1; /**< First location code */
+    std::string location2; /**< Second location code */
+    std::string mode; /**< Transport mode, "Driving" or "Walking" */
+    std::vector<std::pair<int, double> > breakpoints; /**< Minute of the day and travel time in minutes */
+};
+
 /**
  * @brief Reads distance data from a CSV file
  * @param filePath Path to the CSV file containing distance data
@@ -48,4 +63,16 @@ std::vector<DistanceData> readDistancesCSV(const std::string &filePath);
  */
 std::vector<LocationData> readLocationsCSV(const std::string &filePath);
 
+/**
+ * @brief Reads travel-time profiles from a CSV file
+ *
+ * Every row reads Location1,Location2,Mode,Profile where the profile is a space-separated
+ * list of HH:MM=minutes breakpoints, e.g. "00:00=4 07:30=8 09:30=4". Malformed rows are skipped.
+ *
+ * @param filePath Path to the CSV file containing the profiles
+ * @return Vector of ProfileData objects
+ * @details O(N) where N is the size of the CSV file
+ */
+std::vector<ProfileData> readProfilesCSV(const std::string &filePath);
+
 #endif // PARSEDATA_H
@@ -0,0 +1,476 @@
+#include "AllPairsTable.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+#include "../parse_data/DataManager.h"
+#include "SearchKernels.h"
+
+/** @brief Identifies table files, followed by a format version */
+static const char TABLE_MAGIC[8] = {'A', 'P', 'S', 'P', 0, 0, 0, 1};
+
+/**
+ * @brief Runs tasks 0 to count - 1 over a number of threads
+ * @param count Number of tasks
+ * @param threads Number of threads to use
+ * @param task The task, called with its number
+ * @details O(count / threads) per thread
+ */
+static void parallelFor(int count, unsigned int threads, const std::function<void(int)> &task) {
+    threads = std::min<unsigned int>(threads, std::max(1, count));
+
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        for (int t = next++; t < count; t = next++) {
+            task(t);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned int k = 1; k < threads; k++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &th: pool) {
+        th.join();
+    }
+}
+
+std::shared_ptr<const AllPairsTable> AllPairsTable::prepared[3];
+std::mutex AllPairsTable::preparedMutex;
+
+AllPairsTable::AllPairsTable()
+    : vertexCount(0), stride(0), transportMode(Edge<LocationInfo>::EdgeType::DEFAULT), graphFingerprint(0),
+      graphFirstVertex(nullptr), dataVersion(0), repairedRows(0) {
+}
+
+void AllPairsTable::bind(const Graph<LocationInfo> &graph) {
+    graphFirstVertex = graph.getVertexSet().empty() ? nullptr : graph.getVertexSet()[0];
+    dataVersion = DataManager::getInstance()->getDataVersion();
+}
+
+/**
+ * @brief Min-plus update of one block row: row[j] = min(row[j], toVia + viaRow[j])
+ * @param row The row being updated, must not overlap viaRow
+ * @param viaRow The row of the intermediate vertex
+ * @param toVia Time from the row's vertex to the intermediate vertex
+ * @details O(B) where B is the block size; the loop has a fixed length and no aliasing, so it is vectorised
+ */
+static inline void minPlusRow(double *__restrict__ row, const double *__restrict__ viaRow, double toVia) {
+    for (int j = 0; j < AllPairsTable::BLOCK_SIZE; j++) {
+        row[j] = std::min(row[j], toVia + viaRow[j]);
+    }
+}
+
+void AllPairsTable::relaxBlock(int rowBlock, int colBlock, int viaBlock) {
+    const int rowStart = rowBlock * BLOCK_SIZE;
+    const int colStart = colBlock * BLOCK_SIZE;
+    const int viaStart = viaBlock * BLOCK_SIZE;
+
+    // k stays outermost so that blocks sharing a row or column with the via block are updated in order
+    for (int k = viaStart; k < viaStart + BLOCK_SIZE; k++) {
+        const double *viaRow = &times[static_cast<size_t>(k) * stride + colStart];
+        for (int i = rowStart; i < rowStart + BLOCK_SIZE; i++) {
+            double toVia = times[static_cast<size_t>(i) * stride + k];
+            if (i == k || toVia == INF)
+                continue; // row k would only be relaxed through its own zero diagonal
+
+            minPlusRow(&times[static_cast<size_t>(i) * stride + colStart], viaRow, toVia);
+        }
+    }
+}
+
+AllPairsTable AllPairsTable::compute(
+    const Graph<LocationInfo> &graph,
+    Edge<LocationInfo>::EdgeType transportMode,
+    unsigned int threads) {
+    AllPairsTable table;
+    table.transportMode = transportMode;
+    table.vertexCount = graph.getNumVertex();
+    table.graphFingerprint = fingerprint(graph);
+    table.bind(graph);
+    table.stride = (table.vertexCount + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+    table.times.assign(static_cast<size_t>(table.stride) * table.stride, INF);
+
+    for (auto v: graph.getVertexSet()) {
+        int from = v->getIndex();
+        table.times[static_cast<size_t>(from) * table.stride + from] = 0;
+        for (auto e: v->getAdj()) {
+            if (transportMode != Edge<LocationInfo>::EdgeType::DEFAULT && e->getType() != transportMode)
+                continue;
+
+            double &time = table.times[static_cast<size_t>(from) * table.stride + e->getDest()->getIndex()];
+            time = std::min(time, e->getWeight());
+        }
+    }
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Blocked Floyd-Warshall: the via block itself, then its block row and column, then everything else
+    int blocks = table.stride / BLOCK_SIZE;
+    for (int k = 0; k < blocks; k++) {
+        table.relaxBlock(k, k, k);
+
+        parallelFor(2 * blocks, threads, [&](int t) {
+            if (t < blocks) {
+                if (t != k)
+                    table.relaxBlock(k, t, k);
+            } else if (t - blocks != k) {
+                table.relaxBlock(t - blocks, k, k);
+            }
+        });
+
+        parallelFor(blocks * blocks, threads, [&](int t) {
+            int i = t / blocks;
+            int j = t % blocks;
+            if (i != k && j != k)
+                table.relaxBlock(i, j, k);
+        });
+    }
+
+    return table;
+}
+
+/**
+ * @brief Incoming edges of one mode packed by head, with their weights before a change
+ */
+struct RowRepair {
+    std::vector<int> first; /**< Edges of head v are first[v] to first[v + 1] - 1 */
+    std::vector<int> tail; /**< Origin of every edge */
+    std::vector<Edge<LocationInfo> *> edge; /**< Every edge, in incoming-list order */
+    std::vector<double> weight; /**< Weight of every edge before the changes */
+};
+
+/**
+ * @brief Repairs one row of the table in place
+ *
+ * The old row implies a shortest-path tree of the old weights: every reached vertex takes a
+ * tight incoming edge from a strictly closer vertex. SearchKernels::repair then settles only the
+ * vertices the changes cut off or bring closer. A row where some vertex has no such edge, which
+ * needs zero-weight edges, is computed again with a full search.
+ *
+ * @tparam Filter Functor deciding whether an edge belongs to the table's mode
+ * @param graph The graph, with the new weights already set
+ * @param changes The changed edges with their previous weights
+ * @param filter The edge filter
+ * @param incoming Incoming edges of the mode with their previous weights
+ * @param source Index of the row's vertex
+ * @param row The row, old travel times on entry and new ones on return
+ * @details O(V + E) plus the search over the vertices whose distance changed
+ */
+template<class Filter>
+static void repairRow(
+    const Graph<LocationInfo> &graph,
+    const std::vector<std::pair<Edge<LocationInfo> *, double> > &changes,
+    const Filter &filter,
+    const RowRepair &incoming,
+    int source,
+    double *row) {
+    int n = graph.getNumVertex();
+    Routing::SearchTree tree;
+    tree.dist.assign(row, row + n);
+    tree.parent.assign(n, nullptr);
+
+    for (int v = 0; v < n; v++) {
+        double dist = tree.dist[v];
+        if (v == source || dist == INF)
+            continue;
+        for (int k = incoming.first[v]; k < incoming.first[v + 1]; k++) {
+            double toTail = tree.dist[incoming.tail[k]];
+            if (toTail < dist && toTail + incoming.weight[k] == dist) {
+                tree.parent[v] = incoming.edge[k];
+                break;
+            }
+        }
+        if (tree.parent[v] == nullptr) {
+            SearchKernels::grow<false>(graph, graph.getVertexSet()[source], filter, nullptr, 0, tree);
+            std::copy(tree.dist.begin(), tree.dist.end(), row);
+            return;
+        }
+    }
+
+    SearchKernels::repair<false>(graph, changes, filter, tree);
+    std::copy(tree.dist.begin(), tree.dist.end(), row);
+}
+
+std::shared_ptr<const AllPairsTable> AllPairsTable::repair(
+    const Graph<LocationInfo> &graph,
+    const std::vector<std::pair<Edge<LocationInfo> *, double> > &changes,
+    unsigned int threads) const {
+    std::shared_ptr<AllPairsTable> table(new AllPairsTable(*this));
+    table->graphFingerprint = fingerprint(graph);
+    table->bind(graph);
+
+    // A row changes only if a slower edge was on a shortest path from its source, or a faster one
+    // now reaches its destination sooner; otherwise every old route is still a fastest one
+    std::vector<int> rows;
+    for (int i = 0; i < vertexCount; i++) {
+        const double *row = &times[static_cast<size_t>(i) * stride];
+        for (const auto &change: changes) {
+            const Edge<LocationInfo> *e = change.first;
+            if (transportMode != Edge<LocationInfo>::EdgeType::DEFAULT && e->getType() != transportMode)
+                continue;
+
+            double toOrig = row[e->getOrig()->getIndex()];
+            double toDest = row[e->getDest()->getIndex()];
+            if (toOrig == INF)
+                continue;
+
+            bool slowerOnPath = e->getWeight() > change.second && toOrig + change.second == toDest;
+            if (slowerOnPath || toOrig + e->getWeight() < toDest) {
+                rows.push_back(i);
+                break;
+            }
+        }
+    }
+    table->repairedRows = static_cast<int>(rows.size());
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Incoming edges of the mode packed by head, with their weights before the changes
+    const auto &vertices = graph.getVertexSet();
+    std::unordered_map<const Edge<LocationInfo> *, double> previous(changes.begin(), changes.end());
+    RowRepair incoming;
+    incoming.first.assign(vertexCount + 1, 0);
+    for (auto v: vertices) {
+        for (auto e: v->getIncoming()) {
+            if (transportMode != Edge<LocationInfo>::EdgeType::DEFAULT && e->getType() != transportMode)
+                continue;
+            auto old = previous.find(e);
+            incoming.tail.push_back(e->getOrig()->getIndex());
+            incoming.edge.push_back(e);
+            incoming.weight.push_back(old == previous.end() ? e->getWeight() : old->second);
+        }
+        incoming.first[v->getIndex() + 1] = static_cast<int>(incoming.edge.size());
+    }
+
+    parallelFor(static_cast<int>(rows.size()), threads, [&](int r) {
+        double *row = &table->times[static_cast<size_t>(rows[r]) * stride];
+        switch (transportMode) {
+            case Edge<LocationInfo>::EdgeType::DRIVING:
+                repairRow(graph, changes, SearchKernels::DrivingEdge(), incoming, rows[r], row);
+                break;
+            case Edge<LocationInfo>::EdgeType::WALKING:
+                repairRow(graph, changes, SearchKernels::WalkingEdge(), incoming, rows[r], row);
+                break;
+            default:
+                repairRow(graph, changes, SearchKernels::AnyEdge(), incoming, rows[r], row);
+                break;
+        }
+    });
+
+    return table;
+}
+
+void AllPairsTable::install(const std::shared_ptr<const AllPairsTable> &table) {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    prepared[static_cast<int>(table->transportMode)] = table;
+}
+
+std::shared_ptr<const AllPairsTable> AllPairsTable::find(
+    const Graph<LocationInfo> &graph,
+    Edge<LocationInfo>::EdgeType transportMode) {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    const auto &table = prepared[static_cast<int>(transportMode)];
+    if (table && table->covers(graph)) {
+        return table;
+    }
+    return nullptr;
+}
+
+void AllPairsTable::clear() {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    for (auto &table: prepared) {
+        table.reset();
+    }
+}
+
+bool AllPairsTable::covers(const Graph<LocationInfo> &graph) const {
+    return graph.getNumVertex() == vertexCount &&
+           (vertexCount == 0 || graph.getVertexSet()[0] == graphFirstVertex) &&
+           DataManager::getInstance()->getDataVersion() == dataVersion;
+}
+
+unsigned long long AllPairsTable::getChecksum() const {
+    unsigned long long hash = 14695981039346656037ULL;
+    auto mix = [&hash](unsigned long long value) {
+        for (int i = 0; i < 8; i++) {
+            hash ^= (value >> (i * 8)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    mix(static_cast<unsigned long long>(vertexCount));
+    mix(static_cast<unsigned long long>(transportMode));
+    for (int i = 0; i < vertexCount; i++) {
+        for (int j = 0; j < vertexCount; j++) {
+            double time = getTime(i, j);
+            unsigned long long bits;
+            std::memcpy(&bits, &time, sizeof(bits));
+            mix(bits);
+        }
+    }
+    return hash;
+}
+
+Edge<LocationInfo> *AllPairsTable::lastEdge(int from, const Vertex<LocationInfo> *to) const {
+    Edge<LocationInfo> *best = nullptr;
+    double time = getTime(from, to->getIndex());
+
+    // Lowest origin index among the tight edges, as SearchKernels::breaksTie settles ties
+    for (auto e: to->getIncoming()) {
+        if (transportMode != Edge<LocationInfo>::EdgeType::DEFAULT && e->getType() != transportMode)
+            continue;
+        if (e->getOrig() == to || getTime(from, e->getOrig()->getIndex()) + e->getWeight() != time)
+            continue;
+
+        if (best == nullptr || e->getOrig()->getIndex() < best->getOrig()->getIndex()) {
+            best = e;
+        }
+    }
+
+    return best;
+}
+
+Routing::Route AllPairsTable::getRoute(
+    const Vertex<LocationInfo> *from,
+    const Vertex<LocationInfo> *to) const {
+    if (from == nullptr || to == nullptr || empty() || getTime(from->getIndex(), to->getIndex()) == INF) {
+        return Routing::Route();
+    }
+
+    std::vector<Edge<LocationInfo> *> edges;
+    const Vertex<LocationInfo> *current = to;
+    while (current != from) {
+        Edge<LocationInfo> *e = lastEdge(from->getIndex(), current);
+        if (e == nullptr || static_cast<int>(edges.size()) >= vertexCount) {
+            return Routing::Route(); // the table does not belong to this graph
+        }
+        edges.push_back(e);
+        current = e->getOrig();
+    }
+
+    std::reverse(edges.begin(), edges.end());
+    return Routing::makeRoute(from, edges);
+}
+
+unsigned long long AllPairsTable::fingerprint(const Graph<LocationInfo> &graph) {
+    unsigned long long hash = 14695981039346656037ULL;
+    auto mix = [&hash](unsigned long long value) {
+        for (int i = 0; i < 8; i++) {
+            hash ^= (value >> (i * 8)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    mix(graph.getNumVertex());
+    for (auto v: graph.getVertexSet()) {
+        mix(static_cast<unsigned long long>(v->getInfo().id));
+        for (auto e: v->getAdj()) {
+            double weight = e->getWeight();
+            unsigned long long bits;
+            std::memcpy(&bits, &weight, sizeof(bits));
+
+            mix(static_cast<unsigned long long>(e->getDest()->getIndex()));
+            mix(bits);
+            mix(static_cast<unsigned long long>(e->getType()));
+        }
+    }
+
+    return hash;
+}
+
+bool AllPairsTable::save(const std::string &filename) const {
+    std::ofstream out(filename, std::ios::binary);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    // Host byte order; the file is a cache next to the dataset, not an exchange format
+    std::uint32_t mode = static_cast<std::uint32_t>(transportMode);
+    std::int32_t count = vertexCount;
+    unsigned long long graphHash = graphFingerprint;
+
+    out.write(TABLE_MAGIC, sizeof(TABLE_MAGIC));
+    out.write(reinterpret_cast<const char *>(&mode), sizeof(mode));
+    out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char *>(&graphHash), sizeof(graphHash));
+    for (int i = 0; i < vertexCount; i++) {
+        out.write(reinterpret_cast<const char *>(&times[static_cast<size_t>(i) * stride]),
+                  sizeof(double) * vertexCount);
+    }
+
+    return static_cast<bool>(out);
+}
+
+bool AllPairsTable::load(
+    const std::string &filename,
+    const Graph<LocationInfo> &graph,
+    Edge<LocationInfo>::EdgeType transportMode,
+    AllPairsTable &table) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    char magic[sizeof(TABLE_MAGIC)];
+    std::uint32_t mode = 0;
+    std::int32_t count = 0;
+    unsigned long long graphHash = 0;
+
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char *>(&mode), sizeof(mode));
+    in.read(reinterpret_cast<char *>(&count), sizeof(count));
+    in.read(reinterpret_cast<char *>(&graphHash), sizeof(graphHash));
+
+    if (!in || std::memcmp(magic, TABLE_MAGIC, sizeof(magic)) != 0 ||
+        mode != static_cast<std::uint32_t>(transportMode) ||
+        count != graph.getNumVertex() ||
+        graphHash != fingerprint(graph)) {
+        return false;
+    }
+
+    AllPairsTable loaded;
+    loaded.transportMode = transportMode;
+    loaded.vertexCount = count;
+    loaded.stride = (count + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+    loaded.graphFingerprint = graphHash;
+    loaded.bind(graph);
+    loaded.times.assign(static_cast<size_t>(loaded.stride) * loaded.stride, INF);
+    for (int i = 0; i < count; i++) {
+        in.read(reinterpret_cast<char *>(&loaded.times[static_cast<size_t>(i) * loaded.stride]),
+                sizeof(double) * count);
+    }
+
+    if (!in) {
+        return false;
+    }
+
+    table = std::move(loaded);
+    return true;
+}
+
+AllPairsTable AllPairsTable::loadOrCompute(
+    const Graph<LocationInfo> &graph,
+    Edge<LocationInfo>::EdgeType transportMode,
+    const std::string &filename) {
+    AllPairsTable table;
+    if (load(filename, graph, transportMode, table)) {
+        return table;
+    }
+
+    table = compute(graph, transportMode);
+    if (!table.save(filename)) {
+        std::cerr << "Could not write all-pairs table to " << filename << std::endl;
+    }
+    return table;
+}
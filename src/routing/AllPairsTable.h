@@ -0,0 +1,266 @@
+#ifndef ALLPAIRSTABLE_H
+#define ALLPAIRSTABLE_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../graph_structure/Graph.h"
+#include "../graph_builder/GraphBuilder.h"
+#include "Routing.h"
+
+/**
+ * @class AllPairsTable
+ * @brief Precomputed travel times between every pair of locations for one transport mode
+ *
+ * The table is filled with a cache-blocked Floyd-Warshall whose min-plus inner loop runs over
+ * contiguous rows, so the compiler can vectorise it, and whose independent blocks are spread
+ * over threads. Times live in one row-major array indexed by Vertex::getIndex(), padded to
+ * whole blocks. No predecessor matrix is stored: the last hop of a shortest path is the
+ * tight incoming edge with the lowest origin index, the parent a search tree picks, so routes
+ * read from the table are the ones Routing's searches return.
+ *
+ * Preprocessing builds the driving and walking tables of graphs of up to MAX_PREPARED_VERTICES
+ * vertices, and Routing::findFastestRoute reads unrestricted routes from a table covering the
+ * graph in place of searching.
+ *
+ * Graph::distMatrix and Graph::pathMatrix are left alone on purpose: Graph copies share
+ * those raw rows and ~Graph frees them, so filling them would double free on the first copy.
+ */
+class AllPairsTable {
+public:
+    /** @brief Side of the square blocks the matrix is processed in */
+    static const int BLOCK_SIZE = 64;
+
+    /** @brief Largest graph Preprocessing builds tables for; a table takes O(V^2) memory and O(V^3) time */
+    static const int MAX_PREPARED_VERTICES = 2048;
+
+    /**
+     * @brief Creates an empty table
+     * @details O(1)
+     */
+    AllPairsTable();
+
+    /**
+     * @brief Computes the table for a graph and a transport mode
+     * @param graph The transportation graph
+     * @param transportMode The mode of transport, DEFAULT accepts every mode
+     * @param threads Number of worker threads, 0 to use every hardware thread
+     * @return The filled table
+     * @details O(V^3 / P) time and O(V^2) memory where P is the number of threads
+     */
+    static AllPairsTable compute(
+        const Graph<LocationInfo> &graph,
+        Edge<LocationInfo>::EdgeType transportMode,
+        unsigned int threads = 0);
+
+    /**
+     * @brief Loads the table from disk, computing and saving it if the file is missing or stale
+     * @param graph The transportation graph
+     * @param transportMode The mode of transport
+     * @param filename Path of the table file
+     * @return The table
+     * @details O(V^2) when the file is valid, O(V^3 / P) otherwise
+     */
+    static AllPairsTable loadOrCompute(
+        const Graph<LocationInfo> &graph,
+        Edge<LocationInfo>::EdgeType transportMode,
+        const std::string &filename);
+
+    /**
+     * @brief Gets the registered table for a graph and a transport mode
+     * @param graph The transportation graph
+     * @param transportMode The mode of transport
+     * @return The table, or nullptr if none was prepared for this graph and dataset
+     * @details O(1)
+     */
+    static std::shared_ptr<const AllPairsTable> find(
+        const Graph<LocationInfo> &graph,
+        Edge<LocationInfo>::EdgeType transportMode);
+
+    /**
+     * @brief Drops every registered table
+     * @details O(1)
+     */
+    static void clear();
+
+    /**
+     * @brief Registers a table computed earlier for its transport mode, replacing the current one
+     * @param table The table
+     * @details O(1)
+     */
+    static void install(const std::shared_ptr<const AllPairsTable> &table);
+
+    /**
+     * @brief Builds the table of a copy of the graph whose edge weights changed
+     *
+     * Only the rows of sources whose distances the changes can alter are repaired: those where a
+     * slower edge was on a shortest path, or a faster one now shortens the way to its destination.
+     * Each of them is repaired like a cached tree (SearchKernels::repair), from the tree its old
+     * times imply, so only the vertices whose time changes are settled again.
+     *
+     * @param graph The copy, with the same vertices in the same order as the original
+     * @param changes Changed edges of the copy with their previous weights, as SearchKernels::WeightChange
+     * @param threads Number of worker threads, 0 to use every hardware thread
+     * @return The repaired table
+     * @details O(V * C + V^2 + R * (V + E + A log A) / P) where C is the number of changes, R the rows repaired and A the vertices whose time changes
+     */
+    std::shared_ptr<const AllPairsTable> repair(
+        const Graph<LocationInfo> &graph,
+        const std::vector<std::pair<Edge<LocationInfo> *, double> > &changes,
+        unsigned int threads = 0) const;
+
+    /**
+     * @brief Gets the number of rows the repair that built this table had to repair
+     * @return Number of rows, 0 for a table that was not repaired
+     * @details O(1)
+     */
+    int getRepairedRowCount() const {
+        return repairedRows;
+    }
+
+    /**
+     * @brief Checks whether the table was built from a graph and the current dataset
+     * @param graph The graph
+     * @return True if the table can answer queries on the graph
+     * @details O(1)
+     */
+    bool covers(const Graph<LocationInfo> &graph) const;
+
+    /**
+     * @brief Hashes the travel times, to check that rebuilds and repairs are reproducible
+     * @return FNV-1a hash of the table
+     * @details O(V^2)
+     */
+    unsigned long long getChecksum() const;
+
+    /**
+     * @brief Writes the table to a binary file
+     * @param filename Path of the file
+     * @return True if the file was written
+     * @details O(V^2)
+     */
+    bool save(const std::string &filename) const;
+
+    /**
+     * @brief Reads a table written by save
+     * @param filename Path of the file
+     * @param graph The graph the table must belong to
+     * @param transportMode The transport mode the table must have been computed for
+     * @param table The table to fill
+     * @return False if the file is missing, corrupt or was computed for another graph or mode
+     * @details O(V^2)
+     */
+    static bool load(
+        const std::string &filename,
+        const Graph<LocationInfo> &graph,
+        Edge<LocationInfo>::EdgeType transportMode,
+        AllPairsTable &table);
+
+    /**
+     * @brief Checks whether the table has been computed
+     * @return True if the table holds no vertices
+     * @details O(1)
+     */
+    bool empty() const {
+        return vertexCount == 0;
+    }
+
+    /**
+     * @brief Gets the travel time between two vertices
+     * @param from Vertex index of the origin
+     * @param to Vertex index of the destination
+     * @return Travel time in minutes, INF if unreachable
+     * @details O(1)
+     */
+    double getTime(int from, int to) const {
+        return times[static_cast<size_t>(from) * stride + to];
+    }
+
+    /**
+     * @brief Rebuilds the fastest route between two vertices
+     * @param from The origin vertex
+     * @param to The destination vertex
+     * @return The route, empty if the destination is unreachable or the table does not belong to the graph
+     * @details O(N * D) where N is the length of the route and D the maximum in-degree
+     */
+    Routing::Route getRoute(
+        const Vertex<LocationInfo> *from,
+        const Vertex<LocationInfo> *to) const;
+
+    /**
+     * @brief Gets the transport mode the table was computed for
+     * @return The transport mode
+     * @details O(1)
+     */
+    Edge<LocationInfo>::EdgeType getTransportMode() const {
+        return transportMode;
+    }
+
+    /**
+     * @brief Hashes the vertices and edges of a graph, so a saved table can be matched to it
+     * @param graph The graph to hash
+     * @return The fingerprint
+     * @details O(V + E)
+     */
+    static unsigned long long fingerprint(const Graph<LocationInfo> &graph);
+
+private:
+    /** @brief Number of vertices covered */
+    int vertexCount;
+
+    /** @brief Row length, vertexCount rounded up to whole blocks */
+    int stride;
+
+    /** @brief Transport mode the table was computed for */
+    Edge<LocationInfo>::EdgeType transportMode;
+
+    /** @brief Fingerprint of the graph the table was computed for */
+    unsigned long long graphFingerprint;
+
+    /** @brief Row-major travel times, stride * stride entries */
+    std::vector<double> times;
+
+    /** @brief First vertex of the graph the table was built from, identifies it */
+    const Vertex<LocationInfo> *graphFirstVertex;
+
+    /** @brief DataManager data version the table was built from */
+    unsigned long dataVersion;
+
+    /** @brief Rows repaired by the repair that built this table */
+    int repairedRows;
+
+    /** @brief Registered tables, by transport mode */
+    static std::shared_ptr<const AllPairsTable> prepared[3];
+
+    /** @brief Guards the registered tables */
+    static std::mutex preparedMutex;
+
+    /**
+     * @brief Records the graph and dataset the table belongs to
+     * @param graph The graph
+     * @details O(1)
+     */
+    void bind(const Graph<LocationInfo> &graph);
+
+    /**
+     * @brief Relaxes one block of the matrix through one block of intermediate vertices
+     * @param rowBlock Block row of the block being updated
+     * @param colBlock Block column of the block being updated
+     * @param viaBlock Block of intermediate vertices
+     * @details O(B^3) where B is BLOCK_SIZE
+     */
+    void relaxBlock(int rowBlock, int colBlock, int viaBlock);
+
+    /**
+     * @brief Finds the edge that ends the shortest path from a source to a vertex
+     * @param from Vertex index of the source
+     * @param to The current vertex
+     * @return The tight incoming edge with the lowest origin index, or nullptr if there is none
+     * @details O(D) where D is the in-degree of the vertex
+     */
+    Edge<LocationInfo> *lastEdge(int from, const Vertex<LocationInfo> *to) const;
+};
+
+#endif // ALLPAIRSTABLE_H
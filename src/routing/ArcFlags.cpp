@@ -0,0 +1,374 @@
+#include "ArcFlags.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <thread>
+#include <utility>
+#include "../parse_data/DataManager.h"
+#include "SearchBudget.h"
+#include "SearchKernels.h"
+
+const int ArcFlags::MAX_REGIONS;
+
+std::shared_ptr<const ArcFlags> ArcFlags::prepared[3];
+std::mutex ArcFlags::preparedMutex;
+
+ArcFlags::ArcFlags()
+    : transportMode(Edge<LocationInfo>::EdgeType::DEFAULT), regionCount(0), repairedBoundaries(0),
+      graphFirstVertex(nullptr), graphVertexCount(0), dataVersion(0) {
+}
+
+void ArcFlags::partition(const Graph<LocationInfo> &graph, int regions) {
+    const auto &vertices = graph.getVertexSet();
+    int n = graph.getNumVertex();
+    int capacity = std::max(1, (n + regions - 1) / regions);
+
+    // Regions ignore edge direction, so that a region is a compact patch of the map
+    auto forEachNeighbour = [&](const Vertex<LocationInfo> *v, const std::function<void(int)> &visit) {
+        for (auto e: v->getAdj()) {
+            if (accepts(e))
+                visit(e->getDest()->getIndex());
+        }
+        for (auto e: v->getIncoming()) {
+            if (accepts(e))
+                visit(e->getOrig()->getIndex());
+        }
+    };
+
+    region.assign(n, -1);
+    regionCount = 0;
+    for (auto seed: vertices) {
+        if (region[seed->getIndex()] != -1)
+            continue;
+        if (regionCount == regions)
+            break;
+
+        int r = regionCount++;
+        int size = 1;
+        std::queue<int> q;
+        region[seed->getIndex()] = r;
+        q.push(seed->getIndex());
+        while (!q.empty() && size < capacity) {
+            int v = q.front();
+            q.pop();
+            forEachNeighbour(vertices[v], [&](int w) {
+                if (region[w] == -1 && size < capacity) {
+                    region[w] = r;
+                    size++;
+                    q.push(w);
+                }
+            });
+        }
+    }
+
+    // Vertices left over once every region has been grown join the region of a neighbour
+    std::queue<int> q;
+    for (int v = 0; v < n; v++) {
+        if (region[v] != -1)
+            q.push(v);
+    }
+    while (!q.empty()) {
+        int v = q.front();
+        q.pop();
+        forEachNeighbour(vertices[v], [&](int w) {
+            if (region[w] == -1) {
+                region[w] = region[v];
+                q.push(w);
+            }
+        });
+    }
+
+    for (int v = 0; v < n; v++) {
+        if (region[v] == -1)
+            region[v] = 0; // no edge of the mode reaches it, so its region never matters
+    }
+}
+
+std::shared_ptr<const ArcFlags> ArcFlags::compute(
+    const Graph<LocationInfo> &graph,
+    Edge<LocationInfo>::EdgeType transportMode,
+    int regionCount,
+    unsigned int threads) {
+    std::shared_ptr<ArcFlags> index(new ArcFlags());
+    const auto &vertices = graph.getVertexSet();
+    int n = graph.getNumVertex();
+
+    index->transportMode = transportMode;
+    index->graphFirstVertex = vertices.empty() ? nullptr : vertices[0];
+    index->graphVertexCount = n;
+    index->dataVersion = DataManager::getInstance()->getDataVersion();
+    index->partition(graph, std::max(1, std::min(regionCount, MAX_REGIONS)));
+
+    index->offset.assign(n + 1, 0);
+    for (int v = 0; v < n; v++) {
+        index->offset[v + 1] = index->offset[v] + static_cast<int>(vertices[v]->getAdj().size());
+    }
+    index->flags.assign(index->offset[n], 0);
+    index->flagInside(graph, ~std::uint64_t(0));
+
+    // A vertex entered from another region is a boundary vertex
+    for (int v = 0; v < n; v++) {
+        for (auto e: vertices[v]->getIncoming()) {
+            if (index->accepts(e) && index->region[e->getOrig()->getIndex()] != index->region[v]) {
+                index->boundary.push_back(v);
+                break;
+            }
+        }
+    }
+    index->boundaryDist.assign(index->boundary.size() * n, INF);
+
+    std::vector<int> targets(index->boundary.size());
+    for (size_t t = 0; t < targets.size(); t++) {
+        targets[t] = static_cast<int>(t);
+    }
+    index->flagPaths(graph, targets, std::vector<bool>(targets.size(), true), threads);
+    return index;
+}
+
+std::shared_ptr<const ArcFlags> ArcFlags::repair(
+    const Graph<LocationInfo> &graph,
+    const std::vector<std::pair<Edge<LocationInfo> *, double> > &changes,
+    unsigned int threads) const {
+    std::shared_ptr<ArcFlags> index(new ArcFlags(*this));
+    const auto &vertices = graph.getVertexSet();
+    int n = graph.getNumVertex();
+
+    index->graphFirstVertex = vertices.empty() ? nullptr : vertices[0];
+    index->dataVersion = DataManager::getInstance()->getDataVersion();
+
+    // A boundary vertex is searched again if a changed edge was or now is on a shortest path into it;
+    // otherwise its distances, and the edges they flag, stay exactly as they were
+    std::vector<bool> search(boundary.size(), false);
+    std::uint64_t regions = 0;
+    for (size_t t = 0; t < boundary.size(); t++) {
+        const double *dist = boundaryDist.data() + t * n;
+        for (const auto &change: changes) {
+            const Edge<LocationInfo> *e = change.first;
+            double rest = dist[e->getDest()->getIndex()];
+            if (!accepts(e) || rest == INF)
+                continue;
+
+            double toBoundary = dist[e->getOrig()->getIndex()];
+            double slack = 1e-9 * std::max(1.0, toBoundary);
+            if (rest + change.second <= toBoundary + slack || rest + e->getWeight() <= toBoundary + slack) {
+                search[t] = true;
+                regions |= std::uint64_t(1) << region[boundary[t]];
+                break;
+            }
+        }
+    }
+    if (regions == 0) {
+        return index;
+    }
+
+    // The bit of an affected region is rebuilt from every boundary vertex of the region
+    std::vector<int> targets;
+    for (size_t t = 0; t < boundary.size(); t++) {
+        if (regions >> region[boundary[t]] & 1)
+            targets.push_back(static_cast<int>(t));
+    }
+    for (auto &f: index->flags) {
+        f &= ~regions;
+    }
+    index->flagInside(graph, regions);
+    index->flagPaths(graph, targets, search, threads);
+    index->repairedBoundaries = static_cast<int>(std::count(search.begin(), search.end(), true));
+    return index;
+}
+
+bool ArcFlags::accepts(const Edge<LocationInfo> *edge) const {
+    return transportMode == Edge<LocationInfo>::EdgeType::DEFAULT || edge->getType() == transportMode;
+}
+
+void ArcFlags::flagInside(const Graph<LocationInfo> &graph, std::uint64_t regions) {
+    const auto &vertices = graph.getVertexSet();
+    for (int v = 0; v < graph.getNumVertex(); v++) {
+        if (!(regions >> region[v] & 1))
+            continue;
+
+        const auto &adj = vertices[v]->getAdj();
+        for (size_t k = 0; k < adj.size(); k++) {
+            if (accepts(adj[k]) && region[adj[k]->getDest()->getIndex()] == region[v])
+                flags[offset[v] + k] |= std::uint64_t(1) << region[v];
+        }
+    }
+}
+
+void ArcFlags::flagPaths(
+    const Graph<LocationInfo> &graph,
+    const std::vector<int> &targets,
+    const std::vector<bool> &search,
+    unsigned int threads) {
+    const auto &vertices = graph.getVertexSet();
+    int n = graph.getNumVertex();
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min<unsigned int>(threads, std::max<size_t>(1, targets.size()));
+
+    // Every edge on a shortest path to a boundary vertex gets the boundary vertex's region bit
+    std::atomic<size_t> next(0);
+    std::mutex mergeMutex;
+    auto worker = [&]() {
+        std::vector<std::uint64_t> local(flags.size(), 0);
+        Routing::SearchTree tree;
+
+        for (size_t i = next++; i < targets.size(); i = next++) {
+            int t = targets[i];
+            int b = boundary[t];
+            std::uint64_t bit = std::uint64_t(1) << region[b];
+            double *dist = boundaryDist.data() + static_cast<size_t>(t) * n;
+            if (search[t]) {
+                SearchKernels::growForMode<true>(graph, vertices[b], transportMode, nullptr, 0, tree);
+                std::copy(tree.dist.begin(), tree.dist.end(), dist);
+            }
+
+            for (int u = 0; u < n; u++) {
+                double toBoundary = dist[u];
+                if (toBoundary == INF)
+                    continue;
+
+                const auto &adj = vertices[u]->getAdj();
+                for (size_t k = 0; k < adj.size(); k++) {
+                    double rest = dist[adj[k]->getDest()->getIndex()];
+                    if (!accepts(adj[k]) || rest == INF)
+                        continue;
+
+                    // Ties count too, with some slack for rounding; an extra bit only costs pruning
+                    if (rest + adj[k]->getWeight() <= toBoundary + 1e-9 * std::max(1.0, toBoundary))
+                        local[offset[u] + k] |= bit;
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mergeMutex);
+        for (size_t i = 0; i < local.size(); i++) {
+            flags[i] |= local[i];
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned int k = 1; k < threads; k++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &th: pool) {
+        th.join();
+    }
+}
+
+void ArcFlags::prepare(const Graph<LocationInfo> &graph, int regionCount) {
+    install(compute(graph, Edge<LocationInfo>::EdgeType::DRIVING, regionCount));
+    install(compute(graph, Edge<LocationInfo>::EdgeType::WALKING, regionCount));
+}
+
+void ArcFlags::install(const std::shared_ptr<const ArcFlags> &index) {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    prepared[static_cast<int>(index->transportMode)] = index;
+}
+
+std::shared_ptr<const ArcFlags> ArcFlags::find(
+    const Graph<LocationInfo> &graph,
+    Edge<LocationInfo>::EdgeType transportMode) {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    const auto &index = prepared[static_cast<int>(transportMode)];
+    if (index && index->covers(graph)) {
+        return index;
+    }
+    return nullptr;
+}
+
+void ArcFlags::clear() {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    for (auto &index: prepared) {
+        index.reset();
+    }
+}
+
+bool ArcFlags::covers(const Graph<LocationInfo> &graph) const {
+    return graph.getNumVertex() == graphVertexCount &&
+           (graphVertexCount == 0 || graph.getVertexSet()[0] == graphFirstVertex) &&
+           DataManager::getInstance()->getDataVersion() == dataVersion;
+}
+
+unsigned long long ArcFlags::getChecksum() const {
+    unsigned long long hash = 14695981039346656037ULL;
+    auto mix = [&hash](unsigned long long value) {
+        for (int i = 0; i < 8; i++) {
+            hash ^= (value >> (i * 8)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    mix(static_cast<unsigned long long>(regionCount));
+    for (int r: region) {
+        mix(static_cast<unsigned long long>(r));
+    }
+    for (int o: offset) {
+        mix(static_cast<unsigned long long>(o));
+    }
+    for (std::uint64_t f: flags) {
+        mix(f);
+    }
+    return hash;
+}
+
+int ArcFlags::search(
+    const Graph<LocationInfo> &graph,
+    const Vertex<LocationInfo> *source,
+    const Vertex<LocationInfo> *target,
+    Routing::SearchTree &tree) const {
+    tree.backward = false;
+    tree.dist.assign(graph.getNumVertex(), INF);
+    tree.parent.assign(graph.getNumVertex(), nullptr);
+
+    if (source == nullptr || target == nullptr) {
+        return 0;
+    }
+
+    const std::uint64_t bit = std::uint64_t(1) << region[target->getIndex()];
+    const auto &vertices = graph.getVertexSet();
+    int settled = 0;
+
+    using QueueEntry = std::pair<double, int>;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > q;
+    tree.dist[source->getIndex()] = 0;
+    q.push({0, source->getIndex()});
+    SearchBudget::check();
+
+    while (!q.empty()) {
+        QueueEntry top = q.top();
+        q.pop();
+
+        int v = top.second;
+        if (top.first > tree.dist[v])
+            continue;
+
+        settled++;
+        SearchBudget::checkEvery(static_cast<unsigned int>(settled));
+        if (v == target->getIndex())
+            break;
+
+        const auto &adj = vertices[v]->getAdj();
+        const std::uint64_t *edgeFlags = flags.data() + offset[v];
+        for (size_t k = 0; k < adj.size(); k++) {
+            if (!(edgeFlags[k] & bit))
+                continue;
+
+            int w = adj[k]->getDest()->getIndex();
+            double newDist = tree.dist[v] + adj[k]->getWeight();
+            if (newDist < tree.dist[w]) {
+                tree.dist[w] = newDist;
+                tree.parent[w] = adj[k];
+                q.push({newDist, w});
+            } else if (newDist == tree.dist[w] && SearchKernels::breaksTie<false>(adj[k], tree.parent[w])) {
+                tree.parent[w] = adj[k];
+            }
+        }
+    }
+
+    return settled;
+}
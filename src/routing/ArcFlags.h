@@ -0,0 +1,264 @@
+#ifndef ARCFLAGS_H
+#define ARCFLAGS_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "../graph_structure/Graph.h"
+#include "../graph_builder/GraphBuilder.h"
+#include "Routing.h"
+
+/**
+ * @class ArcFlags
+ * @brief Arc-flag index that lets point-to-point searches of one transport mode skip useless edges
+ *
+ * The vertices are partitioned into at most MAX_REGIONS regions grown by breadth-first search.
+ * Every edge of the mode carries one bit per region, set if the edge lies on some shortest
+ * path into that region: edges inside a region always carry its bit, and the rest are found
+ * with one backward search per boundary vertex (a vertex entered by an edge from another
+ * region), spread over threads. A search towards a target then only relaxes edges flagged
+ * with the target's region. Edges of other modes carry no bits, so the mode filter comes for
+ * free.
+ *
+ * Flags sit next to the adjacency lists, indexed by vertex and position in Vertex::getAdj(),
+ * so the index is only valid while the graph's edges stay as they were. Avoid lists change the
+ * shortest paths, so restricted queries must not use it.
+ *
+ * The distances into every boundary vertex are kept, O(B * V) memory, so that new travel times
+ * can be absorbed by repair: only the boundary vertices whose shortest paths the changed edges
+ * touch are searched again, and only the bits of their regions are rebuilt.
+ */
+class ArcFlags {
+public:
+    /** @brief Largest number of regions, one bit each */
+    static const int MAX_REGIONS = 64;
+
+    /**
+     * @brief Computes the index for a graph and a transport mode
+     * @param graph The transportation graph
+     * @param transportMode The mode of transport, DEFAULT accepts every mode
+     * @param regionCount Number of regions, at most MAX_REGIONS
+     * @param threads Number of worker threads, 0 to use every hardware thread
+     * @return The index
+     * @details O(B * E log V / P) where B is the number of boundary vertices and P the number of threads
+     */
+    static std::shared_ptr<const ArcFlags> compute(
+        const Graph<LocationInfo> &graph,
+        Edge<LocationInfo>::EdgeType transportMode,
+        int regionCount = 32,
+        unsigned int threads = 0);
+
+    /**
+     * @brief Computes the driving and walking indexes and registers them for Routing
+     * @param graph The transportation graph
+     * @param regionCount Number of regions, at most MAX_REGIONS
+     * @details O(B * E log V / P)
+     */
+    static void prepare(const Graph<LocationInfo> &graph, int regionCount = 32);
+
+    /**
+     * @brief Gets the registered index for a graph and a transport mode
+     * @param graph The transportation graph
+     * @param transportMode The mode of transport
+     * @return The index, or nullptr if none was prepared for this graph and dataset
+     * @details O(1)
+     */
+    static std::shared_ptr<const ArcFlags> find(
+        const Graph<LocationInfo> &graph,
+        Edge<LocationInfo>::EdgeType transportMode);
+
+    /**
+     * @brief Drops every registered index
+     * @details O(1)
+     */
+    static void clear();
+
+    /**
+     * @brief Registers an index computed earlier for its transport mode, replacing the current one
+     * @param index The index
+     * @details O(1)
+     */
+    static void install(const std::shared_ptr<const ArcFlags> &index);
+
+    /**
+     * @brief Builds the index of a copy of the graph whose edge weights changed
+     *
+     * The result is the index compute would build for the copy, without searching from the
+     * boundary vertices the changes leave alone.
+     *
+     * @param graph The copy, with the same vertices and adjacency lists in the same order as the original
+     * @param changes Changed edges of the copy with their previous weights, as SearchKernels::WeightChange
+     * @param threads Number of worker threads, 0 to use every hardware thread
+     * @return The repaired index
+     * @details O(B * C + A * E log V / P + R * E) where C is the number of changes, A the boundary
+     * vertices searched again and R the boundary vertices of their regions
+     */
+    std::shared_ptr<const ArcFlags> repair(
+        const Graph<LocationInfo> &graph,
+        const std::vector<std::pair<Edge<LocationInfo> *, double> > &changes,
+        unsigned int threads = 0) const;
+
+    /**
+     * @brief Checks whether the index was built from a graph and the current dataset
+     * @param graph The graph
+     * @return True if the index can answer searches on the graph
+     * @details O(1)
+     */
+    bool covers(const Graph<LocationInfo> &graph) const;
+
+    /**
+     * @brief Hashes the regions and flags, to check that rebuilds are reproducible
+     * @return FNV-1a hash of the index
+     * @details O(V + E)
+     */
+    unsigned long long getChecksum() const;
+
+    /**
+     * @brief Runs Dijkstra from a source until a target is settled, skipping edges not flagged for the target's region
+     * @param graph The graph the index was computed for
+     * @param source The source vertex
+     * @param target The target vertex
+     * @param tree The tree to fill; only the path to the target is complete
+     * @return Number of vertices settled
+     * @details O(E log V) in the worst case, usually a small part of the graph
+     */
+    int search(
+        const Graph<LocationInfo> &graph,
+        const Vertex<LocationInfo> *source,
+        const Vertex<LocationInfo> *target,
+        Routing::SearchTree &tree) const;
+
+    /**
+     * @brief Gets the region of a vertex
+     * @param index Vertex index
+     * @return The region
+     * @details O(1)
+     */
+    int getRegion(int index) const {
+        return region[index];
+    }
+
+    /**
+     * @brief Gets the number of regions
+     * @return The number of regions
+     * @details O(1)
+     */
+    int getRegionCount() const {
+        return regionCount;
+    }
+
+    /**
+     * @brief Gets the number of boundary vertices the flags were computed from
+     * @return The number of boundary vertices
+     * @details O(1)
+     */
+    int getBoundaryCount() const {
+        return static_cast<int>(boundary.size());
+    }
+
+    /**
+     * @brief Gets the number of boundary vertices repair searched again to build this index
+     * @return The number of searches, 0 for an index built by compute
+     * @details O(1)
+     */
+    int getRepairedBoundaryCount() const {
+        return repairedBoundaries;
+    }
+
+    /**
+     * @brief Gets the transport mode the index was computed for
+     * @return The transport mode
+     * @details O(1)
+     */
+    Edge<LocationInfo>::EdgeType getTransportMode() const {
+        return transportMode;
+    }
+
+private:
+    /** @brief Transport mode the index was computed for */
+    Edge<LocationInfo>::EdgeType transportMode;
+
+    /** @brief Number of regions */
+    int regionCount;
+
+    /** @brief Boundary vertices, by vertex index */
+    std::vector<int> boundary;
+
+    /** @brief Distance of every vertex to every boundary vertex, one row of V per boundary vertex */
+    std::vector<double> boundaryDist;
+
+    /** @brief Boundary vertices searched again by the repair that built the index */
+    int repairedBoundaries;
+
+    /** @brief Region of every vertex */
+    std::vector<int> region;
+
+    /** @brief Position of every vertex's first edge in flags, plus the total at the end */
+    std::vector<int> offset;
+
+    /** @brief Region bits of every edge, by offset of its origin and position in its adjacency list */
+    std::vector<std::uint64_t> flags;
+
+    /** @brief First vertex, identifies the graph the index was computed for */
+    const Vertex<LocationInfo> *graphFirstVertex;
+
+    /** @brief Number of vertices */
+    int graphVertexCount;
+
+    /** @brief DataManager data version the index was computed from */
+    unsigned long dataVersion;
+
+    /** @brief Registered indexes, by transport mode */
+    static std::shared_ptr<const ArcFlags> prepared[3];
+
+    /** @brief Guards the registered indexes */
+    static std::mutex preparedMutex;
+
+    /**
+     * @brief Creates an empty index
+     * @details O(1)
+     */
+    ArcFlags();
+
+    /**
+     * @brief Partitions the vertices by growing regions breadth-first over edges of the mode
+     * @param graph The transportation graph
+     * @param regions Number of regions to grow
+     * @details O(V + E)
+     */
+    void partition(const Graph<LocationInfo> &graph, int regions);
+
+    /**
+     * @brief Checks whether an edge is of the index's mode
+     * @param edge The edge
+     * @return True if searches of the mode may use the edge
+     * @details O(1)
+     */
+    bool accepts(const Edge<LocationInfo> *edge) const;
+
+    /**
+     * @brief Sets the bit of every edge that stays inside its region, for some regions
+     * @param graph The transportation graph
+     * @param regions Mask of the regions
+     * @details O(V + E)
+     */
+    void flagInside(const Graph<LocationInfo> &graph, std::uint64_t regions);
+
+    /**
+     * @brief Sets the region bit of every edge on a shortest path into some boundary vertices
+     * @param graph The transportation graph
+     * @param targets Positions in boundary of the boundary vertices
+     * @param search By position in boundary, true if the distances into it must be searched first
+     * @param threads Number of worker threads, 0 to use every hardware thread
+     * @details O(T * E + S * E log V / P) for T targets of which S are searched
+     */
+    void flagPaths(
+        const Graph<LocationInfo> &graph,
+        const std::vector<int> &targets,
+        const std::vector<bool> &search,
+        unsigned int threads);
+};
+
+#endif // ARCFLAGS_H
@@ -0,0 +1,375 @@
+#include "BatchEngine.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include "RouteRestrictions.h"
+#include "SearchBudget.h"
+#include "SearchTreeCache.h"
+#include "WorkStealing.h"
+
+BatchEngine::BatchEngine(const Graph<LocationInfo> &graph, unsigned int threads)
+    : graph(graph), batch(nullptr), results(nullptr), next(0), busy(0), generation(0), stopping(false) {
+    for (auto v: graph.getVertexSet()) {
+        codeOf[v->getInfo().id] = v->getInfo().code;
+    }
+
+    // The shared cache is created here, before any worker could race to create it
+    SearchTreeCache::getInstance();
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned int k = 0; k < threads; k++) {
+        workers.emplace_back(&BatchEngine::work, this);
+    }
+}
+
+BatchEngine::~BatchEngine() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker: workers) {
+        worker.join();
+    }
+}
+
+std::vector<BatchEngine::Result> BatchEngine::run(const std::vector<Request> &requests) {
+    std::lock_guard<std::mutex> runLock(runMutex);
+    std::vector<Result> out(requests.size());
+    if (requests.empty()) {
+        return out;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    batch = &requests;
+    results = &out;
+    next = 0;
+    busy = static_cast<unsigned int>(workers.size());
+    generation++;
+    wake.notify_all();
+    finished.wait(lock, [this]() { return busy == 0; });
+
+    batch = nullptr;
+    results = nullptr;
+    return out;
+}
+
+void BatchEngine::work() {
+    SearchTreeCache::ThreadScope scope;
+    // The pool already keeps every core busy, so parallel loops inside a request stay on the worker
+    WorkStealing::SerialScope serial;
+    unsigned long seen = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+
+        // Trees from an earlier batch may predate live updates
+        SearchTreeCache::getInstance()->clear();
+
+        for (size_t i = next++; i < batch->size(); i = next++) {
+            const Request &request = (*batch)[i];
+            if (request.timeLimit > 0) {
+                SearchBudget::Scope budget(SearchBudget::Clock::now() + std::chrono::microseconds(
+                                               static_cast<long long>(request.timeLimit * 1000)));
+                (*results)[i] = evaluate(graph, codeOf, request);
+            } else {
+                (*results)[i] = evaluate(graph, codeOf, request);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busy == 0) {
+            finished.notify_one();
+        }
+    }
+}
+
+BatchEngine::Result BatchEngine::evaluate(const Graph<LocationInfo> &graph,
+                                          const std::unordered_map<int, std::string> &codeOf,
+                                          const Request &request) {
+    try {
+        return search(graph, codeOf, request);
+    } catch (const SearchBudget::Exhausted &e) {
+        Result result;
+        result.error = e.what();
+        return result;
+    }
+}
+
+BatchEngine::Result BatchEngine::search(const Graph<LocationInfo> &graph,
+                                        const std::unordered_map<int, std::string> &codeOf,
+                                        const Request &request) {
+    Result result;
+
+    auto source = codeOf.find(request.sourceId);
+    auto dest = codeOf.find(request.destId);
+    if (source == codeOf.end() || dest == codeOf.end()) {
+        result.error = "Could not find location codes for the provided IDs";
+        return result;
+    }
+
+    if (request.kind == RequestKind::ECO) {
+        result.ecoRoute = Routing::findEnvironmentallyFriendlyRoute(
+            graph, source->second, dest->second, request.maxWalkingTime, request.avoidNodes, request.avoidSegments);
+        if (!result.ecoRoute.isValid) {
+            result.ecoRoute.errorMessage = "No possible route with max. walking time of " +
+                                           std::to_string(static_cast<int>(request.maxWalkingTime)) + " minutes.";
+        }
+        return result;
+    }
+
+    if (request.kind == RequestKind::INDEPENDENT) {
+        result.route = Routing::findFastestRoute(
+            graph, source->second, dest->second, request.transportMode, request.departureTime);
+        if (!result.route.empty()) {
+            result.alternativeRoute = Routing::findAlternativeRoute(
+                graph, result.route, source->second, dest->second, request.transportMode);
+            if (request.departureTime >= 0) {
+                result.alternativeRoute = Routing::timeRoute(graph, result.alternativeRoute, request.departureTime);
+            }
+        }
+        return result;
+    }
+
+    RouteRestrictions restrictions = RouteRestrictions::compile(
+        graph, request.avoidNodes, request.avoidSegments, request.transportMode);
+    if (request.includeNodes.empty()) {
+        result.route = Routing::findRouteWithRestrictions(
+            graph, source->second, dest->second, restrictions, request.departureTime);
+        return result;
+    }
+
+    std::vector<std::string> stopCodes;
+    for (int id: request.includeNodes) {
+        auto stop = codeOf.find(id);
+        if (stop == codeOf.end()) {
+            result.error = "Could not find location code for include node " + std::to_string(id);
+            return result;
+        }
+        stopCodes.push_back(stop->second);
+    }
+    result.route = Routing::findRouteThroughStops(graph, source->second, dest->second, stopCodes, restrictions, true);
+    return result;
+}
+
+void BatchEngine::applyField(const std::string &key, const std::string &value, Request &request,
+                             std::string &mode, bool &restricted) {
+    auto parseIds = [](std::string list, std::vector<int> &ids) {
+        std::stringstream ss(list);
+        std::string id;
+        while (std::getline(ss, id, ',')) {
+            id.erase(0, id.find_first_not_of(" \t"));
+            if (!id.empty())
+                ids.push_back(std::stoi(id));
+        }
+    };
+
+    if (key == "Mode") {
+        mode = value;
+    } else if (key == "Source") {
+        request.sourceId = std::stoi(value);
+    } else if (key == "Destination") {
+        request.destId = std::stoi(value);
+    } else if (key == "MaxWalkTime") {
+        request.maxWalkingTime = std::stod(value);
+    } else if (key == "DepartureTime") {
+        size_t split = value.find(':');
+        request.departureTime = split == std::string::npos
+                                    ? std::stod(value)
+                                    : std::stoi(value.substr(0, split)) * 60 + std::stod(value.substr(split + 1));
+    } else if (key == "TimeLimit") {
+        request.timeLimit = std::stod(value);
+    } else if (key == "Priority") {
+        if (value == "interactive") {
+            request.priority = Priority::INTERACTIVE;
+        } else if (value == "bulk") {
+            request.priority = Priority::BULK;
+        } else {
+            throw std::invalid_argument("expected interactive or bulk");
+        }
+    } else if (key == "AvoidNodes") {
+        restricted = true;
+        parseIds(value, request.avoidNodes);
+    } else if (key == "IncludeNode") {
+        restricted = true;
+        parseIds(value, request.includeNodes);
+    } else if (key == "AvoidSegments") {
+        restricted = true;
+        size_t pos = 0;
+        while ((pos = value.find('(', pos)) != std::string::npos) {
+            size_t end = value.find(')', pos);
+            if (end == std::string::npos)
+                break;
+            std::vector<int> pair;
+            parseIds(value.substr(pos + 1, end - pos - 1), pair);
+            if (pair.size() == 2)
+                request.avoidSegments.emplace_back(pair[0], pair[1]);
+            pos = end + 1;
+        }
+    }
+}
+
+bool BatchEngine::completeRequest(const std::string &mode, bool restricted, Request &request) {
+    if (request.sourceId == -1 || request.destId == -1 || mode.empty()) {
+        return false;
+    }
+
+    if (mode == "driving-walking") {
+        request.kind = RequestKind::ECO;
+    } else {
+        request.kind = restricted ? RequestKind::RESTRICTED : RequestKind::INDEPENDENT;
+        request.transportMode = mode == "driving"
+                                    ? Edge<LocationInfo>::EdgeType::DRIVING
+                                    : mode == "walking"
+                                          ? Edge<LocationInfo>::EdgeType::WALKING
+                                          : Edge<LocationInfo>::EdgeType::DEFAULT;
+    }
+    return true;
+}
+
+bool BatchEngine::readRequests(const std::string &filename, std::vector<Request> &requests) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Could not open file " << filename << std::endl;
+        return false;
+    }
+
+    Request request;
+    std::string mode;
+    bool started = false;
+    bool restricted = false;
+    int lineNumber = 0;
+
+    // Completes the request being read; false if it lacks a required key
+    auto finish = [&]() {
+        if (!started) {
+            return true;
+        }
+        if (!completeRequest(mode, restricted, request)) {
+            std::cerr << "Missing required data in the request ending at line " << lineNumber << std::endl;
+            return false;
+        }
+        requests.push_back(request);
+
+        request = Request();
+        mode.clear();
+        started = false;
+        restricted = false;
+        return true;
+    };
+
+    std::string line;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line.erase(0, line.find_first_not_of(" \t\r"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+
+        if (line.empty()) {
+            if (!finish())
+                return false;
+            continue;
+        }
+
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            std::cerr << "Malformed line " << lineNumber << ": " << line << std::endl;
+            return false;
+        }
+        std::string key = line.substr(0, colon);
+        std::string value = line.substr(colon + 1);
+        value.erase(0, value.find_first_not_of(" \t"));
+        started = true;
+
+        try {
+            applyField(key, value, request, mode, restricted);
+        } catch (const std::exception &e) {
+            std::cerr << "Error parsing line " << lineNumber << ": " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    return finish();
+}
+
+bool BatchEngine::parseRequest(const std::string &line, Request &request, std::string &error) {
+    request = Request();
+    std::string mode;
+    bool restricted = false;
+
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, ';')) {
+        field.erase(0, field.find_first_not_of(" \t\r"));
+        field.erase(field.find_last_not_of(" \t\r") + 1);
+        if (field.empty())
+            continue;
+
+        size_t colon = field.find(':');
+        if (colon == std::string::npos) {
+            error = "Malformed field: " + field;
+            return false;
+        }
+        std::string value = field.substr(colon + 1);
+        value.erase(0, value.find_first_not_of(" \t"));
+        try {
+            applyField(field.substr(0, colon), value, request, mode, restricted);
+        } catch (const std::exception &e) {
+            error = "Error parsing field " + field + ": " + e.what();
+            return false;
+        }
+    }
+
+    if (!completeRequest(mode, restricted, request)) {
+        error = "Missing required data: Mode, Source and Destination are needed";
+        return false;
+    }
+    return true;
+}
+
+std::string BatchEngine::formatResult(const Request &request, const Result &result) {
+    std::stringstream out;
+    out << "Source:" << request.sourceId << std::endl;
+    out << "Destination:" << request.destId << std::endl;
+
+    if (!result.error.empty()) {
+        out << "Message:" << result.error << std::endl;
+    } else if (request.kind == RequestKind::ECO) {
+        out << Routing::formatEcoRouteForOutput(result.ecoRoute);
+    } else if (request.kind == RequestKind::INDEPENDENT) {
+        out << "BestDrivingRoute:" << Routing::formatRouteForOutput(result.route) << std::endl;
+        out << "AlternativeDrivingRoute:" << Routing::formatRouteForOutput(result.alternativeRoute) << std::endl;
+    } else {
+        out << "RestrictedDrivingRoute:" << Routing::formatRouteForOutput(result.route) << std::endl;
+    }
+    return out.str();
+}
+
+bool BatchEngine::writeResults(
+    const std::string &filename,
+    const std::vector<Request> &requests,
+    const std::vector<Result> &results) {
+    std::ofstream outFile(filename);
+    if (!outFile.is_open()) {
+        std::cerr << "Error opening file " << filename << " for writing." << std::endl;
+        return false;
+    }
+
+    for (size_t i = 0; i < requests.size() && i < results.size(); i++) {
+        if (i > 0)
+            outFile << std::endl;
+        outFile << formatResult(requests[i], results[i]);
+    }
+    return true;
+}
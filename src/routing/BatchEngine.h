@@ -0,0 +1,259 @@
+#ifndef BATCHENGINE_H
+#define BATCHENGINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../graph_structure/Graph.h"
+#include "../graph_builder/GraphBuilder.h"
+#include "Routing.h"
+
+/**
+ * @class BatchEngine
+ * @brief Runs batches of independent route requests on a fixed pool of worker threads
+ *
+ * The workers are started once and wait between batches. Every worker keeps its own search
+ * state, a private SearchTreeCache bound with SearchTreeCache::ThreadScope, so workers share
+ * nothing but the graph and the prepared indexes, which they only read. Results are stored
+ * by request position, so they come back in input order whatever order the workers finish in.
+ * Workers run inside a WorkStealing::SerialScope, so requests do not start threads of their own.
+ *
+ * The graph must not change while a batch runs, which holds for the graph of any GraphSnapshot.
+ * Private caches are cleared at the start of every batch, so batches may run on different
+ * snapshots, such as those LiveTraffic publishes.
+ */
+class BatchEngine {
+public:
+    /**
+     * @brief Kind of a request, matching the main menu's routing options
+     */
+    enum class RequestKind {
+        INDEPENDENT, /**< Fastest route and an alternative avoiding its segments */
+        RESTRICTED, /**< Fastest route with avoid lists and stops */
+        ECO /**< Driving to a parking location, then walking */
+    };
+
+    /**
+     * @brief Scheduling class of a request, used by QueryServer
+     */
+    enum class Priority {
+        AUTOMATIC, /**< Chosen from the kind of request */
+        INTERACTIVE, /**< Cheap requests someone is waiting for */
+        BULK /**< Expensive or background requests */
+    };
+
+    /**
+     * @brief One routing request, as read from an input file
+     */
+    struct Request {
+        RequestKind kind = RequestKind::INDEPENDENT; /**< Kind of request */
+        Edge<LocationInfo>::EdgeType transportMode = Edge<LocationInfo>::EdgeType::DRIVING; /**< Mode of transport */
+        int sourceId = -1; /**< Source location ID */
+        int destId = -1; /**< Destination location ID */
+        std::vector<int> avoidNodes; /**< IDs of locations to avoid */
+        std::vector<std::pair<int, int> > avoidSegments; /**< Pairs of location IDs whose segment must not be used */
+        std::vector<int> includeNodes; /**< IDs of locations to visit, in order */
+        double maxWalkingTime = 0; /**< Walking limit of eco requests, in minutes */
+        double departureTime = -1; /**< Departure time in minutes after midnight, negative for static times */
+        Priority priority = Priority::AUTOMATIC; /**< Scheduling class */
+        double timeLimit = 0; /**< Milliseconds the request may take, 0 for no limit of its own */
+    };
+
+    /**
+     * @brief Answer to one request
+     */
+    struct Result {
+        Routing::Route route; /**< Best or restricted route */
+        Routing::Route alternativeRoute; /**< Alternative route of independent requests */
+        Routing::EcoRoute ecoRoute; /**< Route of eco requests */
+        std::string error; /**< Why the request could not be answered, empty if it was */
+    };
+
+    /**
+     * @brief Starts the worker pool
+     * @param graph The transportation graph, shared by every worker
+     * @param threads Number of workers, 0 to use every hardware thread
+     * @details O(T) where T is the number of workers
+     */
+    explicit BatchEngine(const Graph<LocationInfo> &graph, unsigned int threads = 0);
+
+    /**
+     * @brief Stops and joins the workers
+     * @details O(T)
+     */
+    ~BatchEngine();
+
+    BatchEngine(const BatchEngine &) = delete;
+
+    BatchEngine &operator=(const BatchEngine &) = delete;
+
+    /**
+     * @brief Answers a batch of requests
+     * @param requests The requests
+     * @return One result per request, in the same order
+     * @details O(R * Q / T) where R is the number of requests and Q the cost of one query
+     */
+    std::vector<Result> run(const std::vector<Request> &requests);
+
+    /**
+     * @brief Gets the number of workers
+     * @return The number of workers
+     * @details O(1)
+     */
+    unsigned int getThreadCount() const {
+        return static_cast<unsigned int>(workers.size());
+    }
+
+    /**
+     * @brief Reads a batch file: input-file requests separated by blank lines
+     *
+     * Each request uses the keys of input.txt. Mode driving-walking makes an eco request, any
+     * of AvoidNodes, AvoidSegments or IncludeNode a restricted one, and anything else an
+     * independent one. TimeLimit bounds a request in milliseconds and Priority, interactive or
+     * bulk, sets its scheduling class.
+     *
+     * @param filename Path to the batch file
+     * @param requests Receives the requests
+     * @return True if the file was read and every request is well formed
+     * @details O(N) where N is the size of the file
+     */
+    static bool readRequests(const std::string &filename, std::vector<Request> &requests);
+
+    /**
+     * @brief Reads a request written on one line, its input-file keys separated by semicolons
+     *
+     * For example "Mode:driving;Source:5;Destination:700;AvoidSegments:(1,2),(3,4)".
+     *
+     * @param line The line
+     * @param request Receives the request
+     * @param error Receives why the line is not a request
+     * @return True if the line is a well formed request
+     * @details O(N) where N is the length of the line
+     */
+    static bool parseRequest(const std::string &line, Request &request, std::string &error);
+
+    /**
+     * @brief Answers one request
+     *
+     * Runs under the SearchBudget bound to the calling thread; a request whose budget runs out
+     * gets the reason as its error.
+     *
+     * @param graph The transportation graph
+     * @param codeOf Location code of every location ID of the graph
+     * @param request The request
+     * @return The result
+     * @details O(Q) where Q is the cost of the query
+     */
+    static Result evaluate(const Graph<LocationInfo> &graph,
+                           const std::unordered_map<int, std::string> &codeOf,
+                           const Request &request);
+
+    /**
+     * @brief Formats a result the way the single-request output.txt does, with Source and Destination first
+     * @param request The request
+     * @param result Its result
+     * @return The lines of the result
+     * @details O(N) where N is the length of the routes
+     */
+    static std::string formatResult(const Request &request, const Result &result);
+
+    /**
+     * @brief Writes the results of a batch, one block per request separated by blank lines
+     * @param filename Path to the output file
+     * @param requests The requests
+     * @param results Their results, in the same order
+     * @return True if the file was written
+     * @details O(N) where N is the size of the output
+     */
+    static bool writeResults(
+        const std::string &filename,
+        const std::vector<Request> &requests,
+        const std::vector<Result> &results);
+
+private:
+    /** @brief The transportation graph */
+    const Graph<LocationInfo> &graph;
+
+    /** @brief Location code of every location ID */
+    std::unordered_map<int, std::string> codeOf;
+
+    /** @brief The worker threads */
+    std::vector<std::thread> workers;
+
+    /** @brief Serialises calls to run */
+    std::mutex runMutex;
+
+    /** @brief Guards the batch hand-over below */
+    std::mutex mutex;
+
+    /** @brief Wakes the workers when a batch starts or the engine stops */
+    std::condition_variable wake;
+
+    /** @brief Wakes run when the last worker finishes a batch */
+    std::condition_variable finished;
+
+    /** @brief Requests of the running batch */
+    const std::vector<Request> *batch;
+
+    /** @brief Results of the running batch */
+    std::vector<Result> *results;
+
+    /** @brief Position of the next request to take */
+    std::atomic<size_t> next;
+
+    /** @brief Workers still busy with the running batch */
+    unsigned int busy;
+
+    /** @brief Number of batches started, tells workers a new batch is waiting */
+    unsigned long generation;
+
+    /** @brief Set when the engine is being destroyed */
+    bool stopping;
+
+    /**
+     * @brief Body of every worker: waits for batches and answers their requests
+     * @details O(R * Q / T) per batch
+     */
+    void work();
+
+    /**
+     * @brief Answers one request, letting SearchBudget::Exhausted through
+     * @param graph The transportation graph
+     * @param codeOf Location code of every location ID of the graph
+     * @param request The request
+     * @return The result
+     * @details O(Q) where Q is the cost of the query
+     */
+    static Result search(const Graph<LocationInfo> &graph,
+                         const std::unordered_map<int, std::string> &codeOf,
+                         const Request &request);
+
+    /**
+     * @brief Applies one key of an input-file request
+     * @param key The key, such as Mode or AvoidNodes
+     * @param value Its value
+     * @param request The request being read
+     * @param mode Receives the value of Mode
+     * @param restricted Set when the key makes the request a restricted one
+     * @details O(N) where N is the length of the value; throws if a number is malformed
+     */
+    static void applyField(const std::string &key, const std::string &value, Request &request,
+                           std::string &mode, bool &restricted);
+
+    /**
+     * @brief Sets the kind and transport mode of a request once all its keys are read
+     * @param mode Value of its Mode key
+     * @param restricted Whether a key made it a restricted request
+     * @param request The request
+     * @return False if Mode, Source or Destination is missing
+     * @details O(1)
+     */
+    static bool completeRequest(const std::string &mode, bool restricted, Request &request);
+};
+
+#endif // BATCHENGINE_H
@@ -0,0 +1,464 @@
+#include "ContractedGraph.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+#include "../parse_data/DataManager.h"
+#include "SearchKernels.h"
+
+std::shared_ptr<const ContractedGraph> ContractedGraph::prepared[3];
+std::mutex ContractedGraph::preparedMutex;
+
+ShortcutEdge::ShortcutEdge(
+    Vertex<LocationInfo> *orig,
+    Vertex<LocationInfo> *dest,
+    const std::vector<Edge<LocationInfo> *> &collapsed)
+    : Edge<LocationInfo>(orig, dest, 0), collapsed(collapsed) {
+    for (auto e: collapsed) {
+        weight += e->getWeight();
+    }
+}
+
+/**
+ * @brief Core edge filter that accepts a shortcut only if every edge it stands for is accepted
+ * @tparam Filter Functor deciding whether an original edge may be used
+ */
+template<class Filter>
+struct CollapsedEdge {
+    const Filter *filter;
+
+    bool operator()(const Edge<LocationInfo> *edge) const {
+        for (auto e: static_cast<const ShortcutEdge *>(edge)->getCollapsed()) {
+            if (!(*filter)(e))
+                return false;
+        }
+        return true;
+    }
+};
+
+ContractedGraph::ContractedGraph(EdgeType transportMode)
+    : transportMode(transportMode), coreEdgeCount(0), graphFirstVertex(nullptr), graphVertexCount(0),
+      dataVersion(0) {
+}
+
+ContractedGraph::~ContractedGraph() {
+    for (auto v: core.getVertexSet()) {
+        for (auto e: v->getAdj()) {
+            delete e;
+        }
+        delete v;
+    }
+}
+
+/**
+ * @brief Finds the edge of a mode from one vertex to another
+ * @param from The origin vertex
+ * @param to The destination vertex
+ * @param transportMode The mode, DEFAULT accepts every mode
+ * @return The edge, or nullptr if there is none
+ * @details O(D) where D is the degree of the origin
+ */
+static Edge<LocationInfo> *edgeBetween(
+    const Vertex<LocationInfo> *from,
+    const Vertex<LocationInfo> *to,
+    Edge<LocationInfo>::EdgeType transportMode) {
+    for (auto e: from->getAdj()) {
+        if (e->getDest() == to &&
+            (transportMode == Edge<LocationInfo>::EdgeType::DEFAULT || e->getType() == transportMode))
+            return e;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const ContractedGraph> ContractedGraph::build(
+    const Graph<LocationInfo> &graph,
+    EdgeType transportMode,
+    const std::vector<int> &keepIds) {
+    std::shared_ptr<ContractedGraph> contracted(new ContractedGraph(transportMode));
+    const auto &vertices = graph.getVertexSet();
+    int n = graph.getNumVertex();
+
+    contracted->graphFirstVertex = vertices.empty() ? nullptr : vertices[0];
+    contracted->graphVertexCount = n;
+    contracted->dataVersion = DataManager::getInstance()->getDataVersion();
+
+    auto accepts = [transportMode](const Edge<LocationInfo> *e) {
+        return transportMode == EdgeType::DEFAULT || e->getType() == transportMode;
+    };
+
+    std::unordered_set<int> keep(keepIds.begin(), keepIds.end());
+
+    // A location is collapsible if its edges of the mode reach exactly two other locations,
+    // with at most one edge each way to each of them, and nothing requires it to stay
+    std::vector<std::vector<Vertex<LocationInfo> *> > neighbours(n);
+    std::vector<bool> isCore(n, true);
+    for (auto v: vertices) {
+        int i = v->getIndex();
+        std::vector<Vertex<LocationInfo> *> outgoing;
+        std::vector<Vertex<LocationInfo> *> incoming;
+        int out = 0;
+        int in = 0;
+        bool selfLoop = false;
+
+        auto addUnique = [](std::vector<Vertex<LocationInfo> *> &list, Vertex<LocationInfo> *w) {
+            if (std::find(list.begin(), list.end(), w) == list.end())
+                list.push_back(w);
+        };
+
+        for (auto e: v->getAdj()) {
+            if (!accepts(e))
+                continue;
+            out++;
+            selfLoop |= e->getDest() == v;
+            addUnique(outgoing, e->getDest());
+            addUnique(neighbours[i], e->getDest());
+        }
+        for (auto e: v->getIncoming()) {
+            if (!accepts(e))
+                continue;
+            in++;
+            addUnique(incoming, e->getOrig());
+            addUnique(neighbours[i], e->getOrig());
+        }
+
+        isCore[i] = selfLoop || neighbours[i].size() != 2 ||
+                    out != static_cast<int>(outgoing.size()) || in != static_cast<int>(incoming.size()) ||
+                    v->getInfo().hasParking || keep.count(v->getInfo().id) > 0;
+    }
+
+    contracted->chainOf.assign(n, -1);
+
+    // Walks a chain from a core vertex through one of its collapsible neighbours
+    auto walk = [&](Vertex<LocationInfo> *start, Vertex<LocationInfo> *first) {
+        Chain chain;
+        chain.vertices.push_back(start);
+
+        Vertex<LocationInfo> *previous = start;
+        Vertex<LocationInfo> *current = first;
+        while (true) {
+            chain.vertices.push_back(current);
+            if (isCore[current->getIndex()])
+                break;
+
+            contracted->chainOf[current->getIndex()] = static_cast<int>(contracted->chains.size());
+
+            const auto &around = neighbours[current->getIndex()];
+            Vertex<LocationInfo> *next = around[0] == previous ? around[1] : around[0];
+            previous = current;
+            current = next;
+        }
+
+        for (size_t i = 0; i + 1 < chain.vertices.size(); i++) {
+            chain.forward.push_back(edgeBetween(chain.vertices[i], chain.vertices[i + 1], transportMode));
+            chain.backward.push_back(edgeBetween(chain.vertices[i + 1], chain.vertices[i], transportMode));
+        }
+        contracted->chains.push_back(chain);
+    };
+
+    auto walkFrom = [&](Vertex<LocationInfo> *v) {
+        for (auto next: neighbours[v->getIndex()]) {
+            if (!isCore[next->getIndex()] && contracted->chainOf[next->getIndex()] == -1)
+                walk(v, next);
+        }
+    };
+
+    for (auto v: vertices) {
+        if (isCore[v->getIndex()])
+            walkFrom(v);
+    }
+
+    // Whatever is left forms rings of collapsible locations; each ring keeps one of them
+    for (auto v: vertices) {
+        if (!isCore[v->getIndex()] && contracted->chainOf[v->getIndex()] == -1) {
+            isCore[v->getIndex()] = true;
+            walkFrom(v);
+        }
+    }
+
+    contracted->coreVertex.assign(n, nullptr);
+    for (auto v: vertices) {
+        if (!isCore[v->getIndex()])
+            continue;
+
+        Vertex<LocationInfo> *c = contracted->core.appendVertex(v->getInfo());
+        contracted->coreVertex[v->getIndex()] = c;
+        contracted->originalVertex.push_back(v);
+    }
+
+    auto addShortcut = [&](Vertex<LocationInfo> *from, Vertex<LocationInfo> *to,
+                           const std::vector<Edge<LocationInfo> *> &collapsed) {
+        Vertex<LocationInfo> *orig = contracted->coreVertex[from->getIndex()];
+        auto shortcut = new ShortcutEdge(orig, contracted->coreVertex[to->getIndex()], collapsed);
+        shortcut->setType(transportMode);
+        orig->addEdge(shortcut);
+        contracted->coreEdgeCount++;
+    };
+
+    for (auto v: vertices) {
+        if (!isCore[v->getIndex()])
+            continue;
+        for (auto e: v->getAdj()) {
+            if (accepts(e) && isCore[e->getDest()->getIndex()])
+                addShortcut(v, e->getDest(), {e});
+        }
+    }
+
+    for (const auto &chain: contracted->chains) {
+        Vertex<LocationInfo> *a = chain.vertices.front();
+        Vertex<LocationInfo> *b = chain.vertices.back();
+
+        if (std::find(chain.forward.begin(), chain.forward.end(), nullptr) == chain.forward.end())
+            addShortcut(a, b, chain.forward);
+
+        if (std::find(chain.backward.begin(), chain.backward.end(), nullptr) == chain.backward.end())
+            addShortcut(b, a, std::vector<Edge<LocationInfo> *>(chain.backward.rbegin(), chain.backward.rend()));
+    }
+
+    return contracted;
+}
+
+std::shared_ptr<const ContractedGraph> ContractedGraph::rebind(
+    const Graph<LocationInfo> &graph,
+    const std::unordered_map<const Edge<LocationInfo> *, Edge<LocationInfo> *> &copyOf) const {
+    std::shared_ptr<ContractedGraph> contracted(new ContractedGraph(transportMode));
+    const auto &vertices = graph.getVertexSet();
+
+    contracted->graphFirstVertex = vertices.empty() ? nullptr : vertices[0];
+    contracted->graphVertexCount = graph.getNumVertex();
+    contracted->dataVersion = DataManager::getInstance()->getDataVersion();
+    contracted->chainOf = chainOf;
+    contracted->coreEdgeCount = coreEdgeCount;
+
+    auto copied = [&copyOf](Edge<LocationInfo> *e) {
+        return e == nullptr ? nullptr : copyOf.at(e);
+    };
+
+    contracted->coreVertex.assign(vertices.size(), nullptr);
+    for (auto v: originalVertex) {
+        Vertex<LocationInfo> *c = contracted->core.appendVertex(v->getInfo());
+        contracted->coreVertex[v->getIndex()] = c;
+        contracted->originalVertex.push_back(vertices[v->getIndex()]);
+    }
+
+    const auto &cores = contracted->core.getVertexSet();
+    for (auto v: core.getVertexSet()) {
+        for (auto e: v->getAdj()) {
+            std::vector<Edge<LocationInfo> *> collapsed;
+            for (auto original: static_cast<const ShortcutEdge *>(e)->getCollapsed()) {
+                collapsed.push_back(copied(original));
+            }
+            auto shortcut = new ShortcutEdge(cores[v->getIndex()], cores[e->getDest()->getIndex()], collapsed);
+            shortcut->setType(transportMode);
+            cores[v->getIndex()]->addEdge(shortcut);
+        }
+    }
+
+    contracted->chains.reserve(chains.size());
+    for (const auto &chain: chains) {
+        Chain copy;
+        for (auto v: chain.vertices) {
+            copy.vertices.push_back(vertices[v->getIndex()]);
+        }
+        for (auto e: chain.forward) {
+            copy.forward.push_back(copied(e));
+        }
+        for (auto e: chain.backward) {
+            copy.backward.push_back(copied(e));
+        }
+        contracted->chains.push_back(std::move(copy));
+    }
+    return contracted;
+}
+
+void ContractedGraph::prepare(const Graph<LocationInfo> &graph, const std::vector<int> &keepIds) {
+    std::shared_ptr<const ContractedGraph> built[3];
+    for (EdgeType mode: {EdgeType::DEFAULT, EdgeType::DRIVING, EdgeType::WALKING}) {
+        built[static_cast<int>(mode)] = build(graph, mode, keepIds);
+    }
+
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    for (int i = 0; i < 3; i++) {
+        prepared[i] = built[i];
+    }
+}
+
+std::shared_ptr<const ContractedGraph> ContractedGraph::find(
+    const Graph<LocationInfo> &graph,
+    EdgeType transportMode) {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    const auto &contracted = prepared[static_cast<int>(transportMode)];
+    if (contracted && contracted->covers(graph)) {
+        return contracted;
+    }
+    return nullptr;
+}
+
+void ContractedGraph::clear() {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    for (auto &contracted: prepared) {
+        contracted.reset();
+    }
+}
+
+void ContractedGraph::install(const std::shared_ptr<const ContractedGraph> &contracted) {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    prepared[static_cast<int>(contracted->transportMode)] = contracted;
+}
+
+bool ContractedGraph::covers(const Graph<LocationInfo> &graph) const {
+    return graph.getNumVertex() == graphVertexCount &&
+           (graphVertexCount == 0 || graph.getVertexSet()[0] == graphFirstVertex) &&
+           DataManager::getInstance()->getDataVersion() == dataVersion;
+}
+
+unsigned long long ContractedGraph::getChecksum() const {
+    unsigned long long hash = 14695981039346656037ULL;
+    auto mix = [&hash](unsigned long long value) {
+        for (int i = 0; i < 8; i++) {
+            hash ^= (value >> (i * 8)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    for (auto v: core.getVertexSet()) {
+        mix(static_cast<unsigned long long>(originalVertex[v->getIndex()]->getIndex()));
+        for (auto e: v->getAdj()) {
+            double weight = e->getWeight();
+            unsigned long long bits;
+            std::memcpy(&bits, &weight, sizeof(bits));
+            mix(static_cast<unsigned long long>(e->getDest()->getIndex()));
+            mix(bits);
+            mix(static_cast<const ShortcutEdge *>(e)->getCollapsed().size());
+        }
+    }
+    for (int chain: chainOf) {
+        mix(static_cast<unsigned long long>(chain));
+    }
+    return hash;
+}
+
+template<bool Backward, class Filter>
+void ContractedGraph::sweepChain(const Chain &chain, const Filter &filter, Routing::SearchTree &tree) {
+    // On a path every shortest distance comes from the left or from the right, so one pass each way
+    // suffices. Moving right uses forward edges when growing from the root and backward edges when
+    // growing towards it, and the other way round when moving left.
+    const auto &rightward = Backward ? chain.backward : chain.forward;
+    const auto &leftward = Backward ? chain.forward : chain.backward;
+    int last = static_cast<int>(chain.vertices.size()) - 1;
+
+    auto relax = [&](int i, int from, Edge<LocationInfo> *e) {
+        double known = tree.dist[chain.vertices[from]->getIndex()];
+        if (e == nullptr || known == INF || !filter(e))
+            return;
+
+        int v = chain.vertices[i]->getIndex();
+        if (known + e->getWeight() < tree.dist[v] ||
+            (known + e->getWeight() == tree.dist[v] && SearchKernels::breaksTie<Backward>(e, tree.parent[v]))) {
+            tree.dist[v] = known + e->getWeight();
+            tree.parent[v] = e;
+        }
+    };
+
+    for (int i = 1; i <= last; i++) {
+        relax(i, i - 1, rightward[i - 1]);
+    }
+    for (int i = last - 1; i >= 0; i--) {
+        relax(i, i + 1, leftward[i]);
+    }
+}
+
+template<bool Backward, class Filter>
+void ContractedGraph::search(
+    const Vertex<LocationInfo> *root,
+    const Filter &filter,
+    bool anyShortcut,
+    Routing::SearchTree &tree) const {
+    tree.backward = Backward;
+    tree.dist.assign(graphVertexCount, INF);
+    tree.parent.assign(graphVertexCount, nullptr);
+
+    // A root inside a chain reaches the core through the ends of its chain
+    SearchKernels::Seed seeds[2];
+    int seedCount = 0;
+    tree.dist[root->getIndex()] = 0;
+    if (coreVertex[root->getIndex()] != nullptr) {
+        seeds[seedCount++] = {coreVertex[root->getIndex()], 0};
+    } else {
+        const Chain &chain = chains[chainOf[root->getIndex()]];
+        sweepChain<Backward>(chain, filter, tree);
+        for (auto end: {chain.vertices.front(), chain.vertices.back()}) {
+            if (tree.dist[end->getIndex()] != INF)
+                seeds[seedCount++] = {coreVertex[end->getIndex()], tree.dist[end->getIndex()]};
+        }
+    }
+
+    Routing::SearchTree coreTree;
+    if (anyShortcut) {
+        SearchKernels::growFrom<Backward>(core, seeds, seedCount, SearchKernels::AnyEdge(), nullptr, 0, coreTree);
+    } else {
+        SearchKernels::growFrom<Backward>(core, seeds, seedCount, CollapsedEdge<Filter>{&filter}, nullptr, 0,
+                                          coreTree);
+    }
+
+    // Core distances carry over; a core parent becomes the original edge next to the vertex
+    for (size_t c = 0; c < originalVertex.size(); c++) {
+        int v = originalVertex[c]->getIndex();
+        tree.dist[v] = coreTree.dist[c];
+
+        auto shortcut = static_cast<const ShortcutEdge *>(coreTree.parent[c]);
+        if (shortcut != nullptr) {
+            tree.parent[v] = Backward ? shortcut->getCollapsed().front() : shortcut->getCollapsed().back();
+        }
+    }
+
+    for (const auto &chain: chains) {
+        sweepChain<Backward>(chain, filter, tree);
+    }
+
+    // The core search breaks ties by the far end of a shortcut; core parents are compared again
+    // among the original edges, by the vertex next to them, as every other kernel does
+    for (auto original: originalVertex) {
+        int v = original->getIndex();
+        if (tree.parent[v] == nullptr)
+            continue;
+
+        for (auto e: Backward ? original->getAdj() : original->getIncoming()) {
+            int u = Backward ? e->getDest()->getIndex() : e->getOrig()->getIndex();
+            if (tree.dist[u] != INF && filter(e) && tree.dist[u] + e->getWeight() == tree.dist[v] &&
+                SearchKernels::breaksTie<Backward>(e, tree.parent[v]))
+                tree.parent[v] = e;
+        }
+    }
+}
+
+void ContractedGraph::buildSearchTree(
+    const Vertex<LocationInfo> *root,
+    const RouteRestrictions &restrictions,
+    bool backward,
+    Routing::SearchTree &tree) const {
+    using Kernels = SearchKernels;
+    bool modeOnly = restrictions.getFingerprint() == 0;
+
+    switch (transportMode) {
+        case EdgeType::DRIVING: {
+            Kernels::RestrictedEdge<EdgeType::DRIVING> filter{&restrictions};
+            backward
+                ? search<true>(root, filter, modeOnly, tree)
+                : search<false>(root, filter, modeOnly, tree);
+            break;
+        }
+        case EdgeType::WALKING: {
+            Kernels::RestrictedEdge<EdgeType::WALKING> filter{&restrictions};
+            backward
+                ? search<true>(root, filter, modeOnly, tree)
+                : search<false>(root, filter, modeOnly, tree);
+            break;
+        }
+        default: {
+            Kernels::RestrictedEdge<EdgeType::DEFAULT> filter{&restrictions};
+            backward
+                ? search<true>(root, filter, modeOnly, tree)
+                : search<false>(root, filter, modeOnly, tree);
+            break;
+        }
+    }
+}
@@ -0,0 +1,300 @@
+#ifndef CONTRACTEDGRAPH_H
+#define CONTRACTEDGRAPH_H
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "../graph_structure/Graph.h"
+#include "../graph_builder/GraphBuilder.h"
+#include "Routing.h"
+#include "RouteRestrictions.h"
+
+/**
+ * @class ShortcutEdge
+ * @brief Edge of a ContractedGraph core that stands for a sequence of edges of the original graph
+ *
+ * Every core edge is a ShortcutEdge: one between two adjacent core vertices collapses a single
+ * original edge, one across a chain collapses the whole chain, in travel order.
+ */
+class ShortcutEdge : public Edge<LocationInfo> {
+public:
+    /**
+     * @brief Creates a shortcut between two core vertices
+     * @param orig The core vertex the shortcut leaves
+     * @param dest The core vertex the shortcut enters
+     * @param collapsed The original edges, in travel order
+     * @details O(N) where N is the number of collapsed edges
+     */
+    ShortcutEdge(
+        Vertex<LocationInfo> *orig,
+        Vertex<LocationInfo> *dest,
+        const std::vector<Edge<LocationInfo> *> &collapsed);
+
+    /**
+     * @brief Gets the original edges the shortcut stands for
+     * @return The edges, in travel order
+     * @details O(1)
+     */
+    const std::vector<Edge<LocationInfo> *> &getCollapsed() const {
+        return collapsed;
+    }
+
+private:
+    /** @brief Original edges, in travel order */
+    std::vector<Edge<LocationInfo> *> collapsed;
+};
+
+/**
+ * @class ContractedGraph
+ * @brief Routing core of a transportation graph for one transport mode, with degree-2 chains collapsed
+ *
+ * A location whose edges of the mode lead to exactly two other locations, one edge each way at
+ * most, only ever passes traffic through. Maximal runs of such locations are removed and each
+ * run is replaced by at most one ShortcutEdge per direction between the core vertices at its
+ * ends. Parking nodes and caller-supplied locations (known endpoints, avoided locations) always
+ * stay in the core, and a ring with no core vertex keeps one of its locations.
+ *
+ * Searches run Dijkstra on the core only and then sweep every chain once to fill in its
+ * locations, so the result is a complete SearchTree over the original graph and the rest of
+ * Routing cannot tell it apart from a search over the full graph. A query rooted inside a
+ * chain seeds the core search at both ends of its chain. Restrictions on collapsed locations
+ * are honoured by checking the edges a shortcut stands for.
+ */
+class ContractedGraph {
+public:
+    /** @brief Shorthand for the transport mode enumeration */
+    using EdgeType = Edge<LocationInfo>::EdgeType;
+
+    /**
+     * @brief Contracts a graph for one transport mode
+     * @param graph The transportation graph
+     * @param transportMode Mode whose edges are kept, DEFAULT keeps every edge
+     * @param keepIds IDs of locations that must stay in the core
+     * @return The contracted graph
+     * @details O(V + E)
+     */
+    static std::shared_ptr<const ContractedGraph> build(
+        const Graph<LocationInfo> &graph,
+        EdgeType transportMode,
+        const std::vector<int> &keepIds = {});
+
+    /**
+     * @brief Carries the core over to a copy of its graph whose edges only differ in weight
+     *
+     * Weights do not decide which locations collapse, so the copy keeps the same core vertices,
+     * shortcuts and chains without contracting again; shortcuts sum the weights of the copied
+     * edges. The result is what build gives on the copy.
+     *
+     * @param graph The copy, with the same vertices in the same order
+     * @param copyOf Copy of every edge of the graph the core was built from
+     * @return The core for the copy
+     * @details O(V' + E' + C) where V' and E' are the size of the core and C the collapsed edges
+     */
+    std::shared_ptr<const ContractedGraph> rebind(
+        const Graph<LocationInfo> &graph,
+        const std::unordered_map<const Edge<LocationInfo> *, Edge<LocationInfo> *> &copyOf) const;
+
+    /**
+     * @brief Contracts a graph for every transport mode and registers the results for Routing
+     *
+     * Routing::buildSearchTree uses a registered core whenever it was built for the graph it is
+     * given and for the current dataset, and searches the full graph otherwise.
+     *
+     * @param graph The transportation graph
+     * @param keepIds IDs of locations that must stay in every core
+     * @details O(V + E)
+     */
+    static void prepare(const Graph<LocationInfo> &graph, const std::vector<int> &keepIds = {});
+
+    /**
+     * @brief Gets the registered core for a graph and a transport mode
+     * @param graph The transportation graph
+     * @param transportMode The transport mode
+     * @return The core, or nullptr if none was prepared for this graph and dataset
+     * @details O(1)
+     */
+    static std::shared_ptr<const ContractedGraph> find(const Graph<LocationInfo> &graph, EdgeType transportMode);
+
+    /**
+     * @brief Drops every registered core
+     * @details O(1)
+     */
+    static void clear();
+
+    /**
+     * @brief Registers a core built earlier for its transport mode, replacing the current one
+     * @param contracted The core
+     * @details O(1)
+     */
+    static void install(const std::shared_ptr<const ContractedGraph> &contracted);
+
+    /**
+     * @brief Frees the core vertices and shortcuts
+     * @details O(V + E) of the core
+     */
+    ~ContractedGraph();
+
+    ContractedGraph(const ContractedGraph &) = delete;
+
+    ContractedGraph &operator=(const ContractedGraph &) = delete;
+
+    /**
+     * @brief Checks whether the core was built from a graph and the current dataset
+     * @param graph The graph
+     * @return True if the core can answer searches on the graph
+     * @details O(1)
+     */
+    bool covers(const Graph<LocationInfo> &graph) const;
+
+    /**
+     * @brief Hashes the core vertices, shortcuts and chains, to check that rebuilds are reproducible
+     * @return FNV-1a hash of the core
+     * @details O(V + E)
+     */
+    unsigned long long getChecksum() const;
+
+    /**
+     * @brief Builds a complete shortest-path tree over the original graph using the core
+     * @param root The root vertex, from the original graph
+     * @param restrictions Restrictions compiled for the original graph, with this core's mode
+     * @param backward If true, the tree follows incoming edges towards the root
+     * @param tree The tree to fill, indexed like the original graph
+     * @details O(E' log V' + V + E) where V' and E' are the size of the core and E the original edges
+     */
+    void buildSearchTree(
+        const Vertex<LocationInfo> *root,
+        const RouteRestrictions &restrictions,
+        bool backward,
+        Routing::SearchTree &tree) const;
+
+    /**
+     * @brief Gets the core graph, whose edges are all ShortcutEdges
+     * @return The core
+     * @details O(1)
+     */
+    const Graph<LocationInfo> &getCore() const {
+        return core;
+    }
+
+    /**
+     * @brief Gets the core vertex of an original vertex
+     * @param original The vertex of the original graph
+     * @return The core vertex, or nullptr if the vertex was collapsed into a chain
+     * @details O(1)
+     */
+    const Vertex<LocationInfo> *toCore(const Vertex<LocationInfo> *original) const {
+        return coreVertex[original->getIndex()];
+    }
+
+    /**
+     * @brief Gets the number of edges in the core
+     * @return The number of ShortcutEdges
+     * @details O(1)
+     */
+    int getCoreEdgeCount() const {
+        return coreEdgeCount;
+    }
+
+    /**
+     * @brief Gets the number of collapsed chains
+     * @return The number of chains
+     * @details O(1)
+     */
+    int getChainCount() const {
+        return static_cast<int>(chains.size());
+    }
+
+    /**
+     * @brief Gets the transport mode the core was built for
+     * @return The transport mode
+     * @details O(1)
+     */
+    EdgeType getTransportMode() const {
+        return transportMode;
+    }
+
+private:
+    /**
+     * @brief A maximal run of collapsed locations between two core vertices
+     */
+    struct Chain {
+        std::vector<Vertex<LocationInfo> *> vertices; /**< Core vertex, collapsed locations, core vertex */
+        std::vector<Edge<LocationInfo> *> forward; /**< forward[i] leads vertices[i] -> vertices[i + 1], may be null */
+        std::vector<Edge<LocationInfo> *> backward; /**< backward[i] leads vertices[i + 1] -> vertices[i], may be null */
+    };
+
+    /** @brief Transport mode the core was built for */
+    EdgeType transportMode;
+
+    /** @brief The core graph */
+    Graph<LocationInfo> core;
+
+    /** @brief Number of ShortcutEdges in the core */
+    int coreEdgeCount;
+
+    /** @brief Core vertex of every original vertex, nullptr for collapsed ones */
+    std::vector<Vertex<LocationInfo> *> coreVertex;
+
+    /** @brief Original vertex of every core vertex */
+    std::vector<Vertex<LocationInfo> *> originalVertex;
+
+    /** @brief The collapsed chains */
+    std::vector<Chain> chains;
+
+    /** @brief Chain of every collapsed original vertex, -1 for core vertices */
+    std::vector<int> chainOf;
+
+    /** @brief First original vertex, identifies the graph the core was built from */
+    const Vertex<LocationInfo> *graphFirstVertex;
+
+    /** @brief Number of original vertices */
+    int graphVertexCount;
+
+    /** @brief DataManager data version the core was built from */
+    unsigned long dataVersion;
+
+    /** @brief Registered cores, by transport mode */
+    static std::shared_ptr<const ContractedGraph> prepared[3];
+
+    /** @brief Guards the registered cores */
+    static std::mutex preparedMutex;
+
+    /**
+     * @brief Creates an empty core
+     * @param transportMode The transport mode
+     * @details O(1)
+     */
+    explicit ContractedGraph(EdgeType transportMode);
+
+    /**
+     * @brief Runs the core search and the chain sweeps with a fixed edge filter
+     * @tparam Backward If true, the tree follows incoming edges towards the root
+     * @tparam Filter Functor deciding whether an original edge may be used
+     * @param root The root vertex, from the original graph
+     * @param filter The edge filter
+     * @param anyShortcut True if the filter accepts every edge of this core's mode
+     * @param tree The tree to fill
+     * @details O(E' log V' + V + E)
+     */
+    template<bool Backward, class Filter>
+    void search(
+        const Vertex<LocationInfo> *root,
+        const Filter &filter,
+        bool anyShortcut,
+        Routing::SearchTree &tree) const;
+
+    /**
+     * @brief Relaxes the locations of a chain from both of its ends and, optionally, from inside
+     * @tparam Backward If true, distances lead towards the root
+     * @tparam Filter Functor deciding whether an original edge may be used
+     * @param chain The chain
+     * @param filter The edge filter
+     * @param tree The tree being filled, indexed like the original graph
+     * @details O(L) where L is the length of the chain
+     */
+    template<bool Backward, class Filter>
+    static void sweepChain(const Chain &chain, const Filter &filter, Routing::SearchTree &tree);
+};
+
+#endif // CONTRACTEDGRAPH_H
@@ -0,0 +1,325 @@
+#include "DeltaStepping.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include "../parse_data/DataManager.h"
+#include "SearchBudget.h"
+
+/**
+ * @brief Lets a fixed group of threads wait for each other between rounds
+ */
+class RoundBarrier {
+public:
+    explicit RoundBarrier(unsigned int threads) : threads(threads), waiting(0), round(0) {
+    }
+
+    /**
+     * @brief Blocks until every thread of the group has called wait for this round
+     * @details O(T) wake-ups where T is the number of threads
+     */
+    void wait() {
+        if (threads == 1)
+            return;
+        std::unique_lock<std::mutex> lock(mutex);
+        unsigned long arrived = round;
+        if (++waiting == threads) {
+            waiting = 0;
+            round++;
+            released.notify_all();
+            return;
+        }
+        released.wait(lock, [&]() { return round != arrived; });
+    }
+
+private:
+    unsigned int threads;
+    unsigned int waiting;
+    unsigned long round;
+    std::mutex mutex;
+    std::condition_variable released;
+};
+
+/**
+ * @brief Lowers a shared distance to a candidate value
+ * @return True if the candidate was lower
+ * @details O(1) expected
+ */
+static bool lowerDistance(std::atomic<double> &dist, double candidate) {
+    double current = dist.load(std::memory_order_relaxed);
+    while (candidate < current) {
+        if (dist.compare_exchange_weak(current, candidate, std::memory_order_relaxed))
+            return true;
+    }
+    return false;
+}
+
+std::shared_ptr<const DeltaStepping> DeltaStepping::prepared[3];
+std::mutex DeltaStepping::preparedMutex;
+
+DeltaStepping::DeltaStepping()
+    : transportMode(Edge<LocationInfo>::EdgeType::DEFAULT), delta(1), vertexCount(0), graphFirstVertex(nullptr),
+      dataVersion(0) {
+}
+
+std::shared_ptr<const DeltaStepping> DeltaStepping::compile(
+    const Graph<LocationInfo> &graph,
+    Edge<LocationInfo>::EdgeType transportMode,
+    double delta) {
+    std::shared_ptr<DeltaStepping> search(new DeltaStepping());
+    const auto &vertices = graph.getVertexSet();
+    search->vertexCount = graph.getNumVertex();
+    search->transportMode = transportMode;
+    search->graphFirstVertex = vertices.empty() ? nullptr : vertices[0];
+    search->dataVersion = DataManager::getInstance()->getDataVersion();
+
+    auto ofMode = [transportMode](const Edge<LocationInfo> *e) {
+        return transportMode == Edge<LocationInfo>::EdgeType::DEFAULT || e->getType() == transportMode;
+    };
+
+    double total = 0;
+    long count = 0;
+    for (auto v: vertices) {
+        for (auto e: v->getAdj()) {
+            if (ofMode(e)) {
+                total += e->getWeight();
+                count++;
+            }
+        }
+    }
+    search->delta = delta > 0 ? delta : count == 0 ? 1 : total / count;
+
+    // Light arcs first, each group keeping the adjacency order
+    search->arcs.reserve(count);
+    search->start.assign(search->vertexCount + 1, 0);
+    search->heavyStart.assign(search->vertexCount, 0);
+    for (auto v: vertices) {
+        int index = v->getIndex();
+        search->start[index] = static_cast<int>(search->arcs.size());
+        for (int heavy = 0; heavy < 2; heavy++) {
+            if (heavy)
+                search->heavyStart[index] = static_cast<int>(search->arcs.size());
+            for (auto e: v->getAdj()) {
+                if (ofMode(e) && (e->getWeight() > search->delta) == (heavy == 1))
+                    search->arcs.push_back({e->getDest()->getIndex(), e->getWeight(), e});
+            }
+        }
+    }
+    search->start[search->vertexCount] = static_cast<int>(search->arcs.size());
+
+    return search;
+}
+
+void DeltaStepping::search(
+    const Vertex<LocationInfo> *root,
+    Routing::SearchTree &tree,
+    unsigned int threads,
+    double limit) const {
+    int n = vertexCount;
+    tree.dist.assign(n, INF);
+    tree.parent.assign(n, nullptr);
+    tree.backward = false;
+    if (root == nullptr || n == 0) {
+        return;
+    }
+    SearchBudget::check();
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<std::atomic<double> > dist(n);
+    for (auto &d: dist) {
+        d.store(INF, std::memory_order_relaxed);
+    }
+    dist[root->getIndex()].store(0, std::memory_order_relaxed);
+
+    auto bucketOf = [&](double d) {
+        return static_cast<size_t>(d / delta);
+    };
+
+    // Shared state, changed by thread 0 alone between the two barriers of a round
+    std::vector<std::vector<int> > buckets(1, std::vector<int>(1, root->getIndex()));
+    size_t current = 0;
+    std::vector<int> frontier;
+    std::vector<int> settled;
+    bool heavyRound = false;
+    bool done = false;
+    std::atomic<size_t> next(0);
+    std::vector<std::vector<int> > lowered(threads);
+
+    std::vector<unsigned int> inFrontier(n, 0);
+    unsigned int roundStamp = 0;
+    std::vector<size_t> settledIn(n, static_cast<size_t>(-1));
+
+    // Fills the frontier for the next round, moving on to the heavy round and later buckets
+    auto prepare = [&]() {
+        if (threads == 1)
+            SearchBudget::check(); // no other thread waits at the barrier
+        for (auto &local: lowered) {
+            for (int v: local) {
+                size_t b = bucketOf(dist[v].load(std::memory_order_relaxed));
+                if (b >= buckets.size())
+                    buckets.resize(b + 1);
+                buckets[b].push_back(v);
+            }
+            local.clear();
+        }
+        next.store(0);
+
+        while (true) {
+            if (heavyRound) {
+                heavyRound = false;
+                current++;
+            }
+            if (current >= buckets.size() || static_cast<double>(current) * delta > limit)
+                break;
+
+            frontier.clear();
+            roundStamp++;
+            std::vector<int> bucket;
+            bucket.swap(buckets[current]);
+            for (int v: bucket) {
+                // Entries whose vertex has since moved to a lower bucket are stale
+                if (bucketOf(dist[v].load(std::memory_order_relaxed)) != current || inFrontier[v] == roundStamp)
+                    continue;
+                inFrontier[v] = roundStamp;
+                frontier.push_back(v);
+                if (settledIn[v] != current) {
+                    settledIn[v] = current;
+                    settled.push_back(v);
+                }
+            }
+            if (!frontier.empty())
+                return;
+
+            // The light rounds of the bucket are over; its heavy arcs are relaxed once
+            frontier.swap(settled);
+            settled.clear();
+            heavyRound = true;
+            if (!frontier.empty())
+                return;
+        }
+        done = true;
+    };
+
+    RoundBarrier barrier(threads);
+    auto worker = [&](unsigned int id) {
+        const size_t chunk = 64;
+        while (true) {
+            if (id == 0)
+                prepare();
+            barrier.wait();
+            if (done)
+                return;
+
+            for (size_t first = next.fetch_add(chunk); first < frontier.size(); first = next.fetch_add(chunk)) {
+                size_t last = std::min(frontier.size(), first + chunk);
+                for (size_t k = first; k < last; k++) {
+                    int v = frontier[k];
+                    double d = dist[v].load(std::memory_order_relaxed);
+                    int from = heavyRound ? heavyStart[v] : start[v];
+                    int to = heavyRound ? start[v + 1] : heavyStart[v];
+                    for (int a = from; a < to; a++) {
+                        if (lowerDistance(dist[arcs[a].head], d + arcs[a].weight))
+                            lowered[id].push_back(arcs[a].head);
+                    }
+                }
+            }
+            barrier.wait();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned int id = 1; id < threads; id++) {
+        pool.emplace_back(worker, id);
+    }
+    worker(0);
+    for (auto &th: pool) {
+        th.join();
+    }
+
+    for (int v = 0; v < n; v++) {
+        tree.dist[v] = dist[v].load(std::memory_order_relaxed);
+    }
+
+    // Parents follow the first tight arc in vertex and adjacency order, as SearchKernels::breaksTie picks them
+    for (int u = 0; u < n; u++) {
+        if (tree.dist[u] == INF)
+            continue;
+        for (int a = start[u]; a < start[u + 1]; a++) {
+            int w = arcs[a].head;
+            if (w != root->getIndex() && tree.parent[w] == nullptr && tree.dist[u] + arcs[a].weight == tree.dist[w])
+                tree.parent[w] = arcs[a].edge;
+        }
+    }
+}
+
+int DeltaStepping::getLightEdgeCount() const {
+    int count = 0;
+    for (int v = 0; v < vertexCount; v++) {
+        count += heavyStart[v] - start[v];
+    }
+    return count;
+}
+
+int DeltaStepping::getHeavyEdgeCount() const {
+    return static_cast<int>(arcs.size()) - getLightEdgeCount();
+}
+
+void DeltaStepping::install(const std::shared_ptr<const DeltaStepping> &search) {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    prepared[static_cast<int>(search->transportMode)] = search;
+}
+
+std::shared_ptr<const DeltaStepping> DeltaStepping::find(
+    const Graph<LocationInfo> &graph,
+    Edge<LocationInfo>::EdgeType transportMode) {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    const auto &search = prepared[static_cast<int>(transportMode)];
+    if (search && search->covers(graph)) {
+        return search;
+    }
+    return nullptr;
+}
+
+void DeltaStepping::clear() {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    for (auto &search: prepared) {
+        search.reset();
+    }
+}
+
+bool DeltaStepping::covers(const Graph<LocationInfo> &graph) const {
+    return graph.getNumVertex() == vertexCount &&
+           (vertexCount == 0 || graph.getVertexSet()[0] == graphFirstVertex) &&
+           DataManager::getInstance()->getDataVersion() == dataVersion;
+}
+
+unsigned long long DeltaStepping::getChecksum() const {
+    unsigned long long hash = 14695981039346656037ULL;
+    auto mix = [&hash](unsigned long long value) {
+        for (int i = 0; i < 8; i++) {
+            hash ^= (value >> (i * 8)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    };
+    auto mixDouble = [&mix](double value) {
+        unsigned long long bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        mix(bits);
+    };
+
+    mixDouble(delta);
+    for (int v = 0; v < vertexCount; v++) {
+        mix(static_cast<unsigned long long>(start[v]));
+        mix(static_cast<unsigned long long>(heavyStart[v]));
+    }
+    for (const auto &arc: arcs) {
+        mix(static_cast<unsigned long long>(arc.head));
+        mixDouble(arc.weight);
+    }
+    return hash;
+}
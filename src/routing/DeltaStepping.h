@@ -0,0 +1,188 @@
+#ifndef DELTASTEPPING_H
+#define DELTASTEPPING_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "../graph_structure/Graph.h"
+#include "../graph_builder/GraphBuilder.h"
+#include "Routing.h"
+
+/**
+ * @class DeltaStepping
+ * @brief Parallel one-to-all shortest paths by delta-stepping, for one transport mode
+ *
+ * Tentative distances are kept in buckets of width delta. The lowest non-empty bucket is
+ * emptied in rounds: all threads relax the light edges (weight at most delta) of its vertices
+ * together, and vertices that land back in the bucket form the next round. Once the bucket
+ * stays empty, the heavy edges of everything it held are relaxed once, since they can only
+ * reach later buckets. Distances are lowered with compare-and-swap, so threads never lock.
+ *
+ * Every distance ends as the minimum of dist(u) + w(u, v) over the edges into v, the same
+ * sums Dijkstra computes, so distances are bit-identical to the sequential kernels for any
+ * delta and thread count. Parents are chosen afterwards from those distances, in vertex and
+ * edge order, so the tree does not depend on the thread count either.
+ *
+ * A small delta gives many buckets with little work each, a large one re-relaxes vertices
+ * more often; the default is the mean edge weight of the mode.
+ *
+ * Preprocessing compiles the searches of graphs of at least MIN_PREPARED_VERTICES vertices,
+ * and Routing::buildSearchTree then grows unrestricted forward trees with them, on one thread
+ * per VERTICES_PER_THREAD vertices. Threads in a WorkStealing::SerialScope, such as server
+ * and batch workers, search on their own thread.
+ */
+class DeltaStepping {
+public:
+    /** @brief Smallest graph Preprocessing compiles searches for; below it threads cost more than they save */
+    static const int MIN_PREPARED_VERTICES = 4096;
+
+    /** @brief Vertices worth one thread of a search started by Routing */
+    static const int VERTICES_PER_THREAD = 2048;
+
+    /**
+     * @brief Splits the edges of one mode into light and heavy ones
+     * @param graph The transportation graph; it must not change while the result is used
+     * @param transportMode The mode, DEFAULT for edges of every mode
+     * @param delta Bucket width, 0 or less for the mean edge weight of the mode
+     * @return The prepared search
+     * @details O(V + E) where V is the number of vertices and E the number of edges
+     */
+    static std::shared_ptr<const DeltaStepping> compile(
+        const Graph<LocationInfo> &graph,
+        Edge<LocationInfo>::EdgeType transportMode,
+        double delta = 0);
+
+    /**
+     * @brief Gets the registered search for a graph and a transport mode
+     * @param graph The transportation graph
+     * @param transportMode The mode of transport
+     * @return The search, or nullptr if none was prepared for this graph and dataset
+     * @details O(1)
+     */
+    static std::shared_ptr<const DeltaStepping> find(
+        const Graph<LocationInfo> &graph,
+        Edge<LocationInfo>::EdgeType transportMode);
+
+    /**
+     * @brief Drops every registered search
+     * @details O(1)
+     */
+    static void clear();
+
+    /**
+     * @brief Registers a search compiled earlier for its transport mode, replacing the current one
+     * @param search The search
+     * @details O(1)
+     */
+    static void install(const std::shared_ptr<const DeltaStepping> &search);
+
+    /**
+     * @brief Checks whether the search was compiled from a graph and the current dataset
+     * @param graph The graph
+     * @return True if the search can build trees of the graph
+     * @details O(1)
+     */
+    bool covers(const Graph<LocationInfo> &graph) const;
+
+    /**
+     * @brief Hashes the bucket width and arcs, to check that rebuilds are reproducible
+     * @return FNV-1a hash of the search
+     * @details O(V + E)
+     */
+    unsigned long long getChecksum() const;
+
+    /**
+     * @brief Builds the whole shortest path tree rooted at a vertex
+     *
+     * On one thread the SearchBudget of the calling thread is checked every round; bounded
+     * searches always run on one thread, since SearchBudget::Scope makes the thread serial.
+     *
+     * @param root The root vertex
+     * @param tree The tree to fill
+     * @param threads Number of threads, 0 to use every hardware thread
+     * @param limit Distance at which the search stops; only distances up to it are final
+     * @details O((V + E) / T + B * T) expected, where B is the number of rounds and T the
+     * number of threads
+     */
+    void search(
+        const Vertex<LocationInfo> *root,
+        Routing::SearchTree &tree,
+        unsigned int threads = 0,
+        double limit = INF) const;
+
+    /**
+     * @brief Gets the bucket width
+     * @return The width, in minutes
+     * @details O(1)
+     */
+    double getDelta() const {
+        return delta;
+    }
+
+    /**
+     * @brief Gets the transport mode the search was compiled for
+     * @return The transport mode
+     * @details O(1)
+     */
+    Edge<LocationInfo>::EdgeType getTransportMode() const {
+        return transportMode;
+    }
+
+    /**
+     * @brief Gets the number of light edges
+     * @return The number of edges of weight at most delta
+     * @details O(V)
+     */
+    int getLightEdgeCount() const;
+
+    /**
+     * @brief Gets the number of heavy edges
+     * @return The number of edges heavier than delta
+     * @details O(V)
+     */
+    int getHeavyEdgeCount() const;
+
+private:
+    /**
+     * @brief An edge of the mode, as stored by its tail
+     */
+    struct Arc {
+        int head; /**< Index of the vertex the edge enters */
+        double weight; /**< Weight of the edge */
+        Edge<LocationInfo> *edge; /**< The edge itself */
+    };
+
+    /** @brief Transport mode the search was compiled for */
+    Edge<LocationInfo>::EdgeType transportMode;
+
+    /** @brief Bucket width */
+    double delta;
+
+    /** @brief Number of vertices */
+    int vertexCount;
+
+    /** @brief Arcs of every vertex, light ones first, from start[v] to start[v + 1] */
+    std::vector<Arc> arcs;
+
+    /** @brief First arc of every vertex, plus the total at the end */
+    std::vector<int> start;
+
+    /** @brief First heavy arc of every vertex */
+    std::vector<int> heavyStart;
+
+    /** @brief First vertex of the graph the search was compiled from, identifies it */
+    const Vertex<LocationInfo> *graphFirstVertex;
+
+    /** @brief DataManager data version the search was compiled from */
+    unsigned long dataVersion;
+
+    /** @brief Registered searches, by transport mode */
+    static std::shared_ptr<const DeltaStepping> prepared[3];
+
+    /** @brief Guards the registered searches */
+    static std::mutex preparedMutex;
+
+    DeltaStepping();
+};
+
+#endif // DELTASTEPPING_H
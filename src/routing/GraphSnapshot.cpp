@@ -0,0 +1,171 @@
+#include "GraphSnapshot.h"
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include "../parse_data/DataManager.h"
+#include "RouteCache.h"
+#include "SearchTreeCache.h"
+#include "TravelTimeProfiles.h"
+
+std::vector<std::weak_ptr<const GraphSnapshot> > GraphSnapshot::live;
+std::mutex GraphSnapshot::liveMutex;
+std::atomic<unsigned long> GraphSnapshot::serials(0);
+std::atomic<unsigned long> GraphSnapshot::tracked(0);
+std::mutex GraphSnapshot::loadMutex;
+std::mutex GraphSnapshot::publishMutex;
+// Defined after live, so the snapshot still published at exit is freed while live exists
+GraphSnapshot::Handle GraphSnapshot::published;
+
+GraphSnapshot::GraphSnapshot(Graph<LocationInfo> graph, std::vector<LocationData> locations, size_t distanceCount)
+    : graph(graph), locations(std::move(locations)), distanceCount(distanceCount), version(0), serial(++serials),
+      dataPending(false) {
+}
+
+GraphSnapshot::~GraphSnapshot() {
+    {
+        std::lock_guard<std::mutex> lock(liveMutex);
+        live.erase(std::remove_if(live.begin(), live.end(), [](const std::weak_ptr<const GraphSnapshot> &s) {
+            return s.expired();
+        }), live.end());
+    }
+    SearchTreeCache::forget(graph);
+    RouteCache::getInstance()->forget(graph);
+
+    // Every edge is in the outgoing list of exactly one vertex
+    for (auto v: graph.getVertexSet()) {
+        for (auto e: v->getAdj()) {
+            delete e;
+        }
+    }
+    for (auto v: graph.getVertexSet()) {
+        delete v;
+    }
+}
+
+GraphSnapshot::Handle GraphSnapshot::load(const std::string &locationsFilePath,
+                                          const std::string &distancesFilePath,
+                                          const std::string &profilesFilePath,
+                                          unsigned int threads) {
+    std::vector<DistanceData> distances = readDistancesCSV(distancesFilePath);
+    std::vector<LocationData> locations = readLocationsCSV(locationsFilePath);
+    if (distances.empty() || locations.empty()) {
+        return nullptr;
+    }
+
+    // Built before anything shared changes, so a load that fails here leaves everything as it was
+    std::shared_ptr<GraphSnapshot> snapshot(new GraphSnapshot(
+        GraphBuilder::buildIntegratedGraph(locations, distances), locations, distances.size()));
+
+    std::lock_guard<std::mutex> lock(loadMutex);
+    snapshot->report = Preprocessing::build(snapshot->graph, snapshot->indexes, threads);
+    if (!profilesFilePath.empty()) {
+        snapshot->indexes.profiles = TravelTimeProfiles::load(snapshot->graph, profilesFilePath, &snapshot->messages);
+    }
+    // DataManager gets the data on publish: a new data version would clear the caches the published snapshot still uses
+    snapshot->distances = std::move(distances);
+    snapshot->dataPending = true;
+    return track(snapshot);
+}
+
+GraphSnapshot::Handle GraphSnapshot::track(const std::shared_ptr<GraphSnapshot> &snapshot) {
+    std::lock_guard<std::mutex> lock(liveMutex);
+    live.push_back(snapshot);
+    tracked++;
+    return snapshot;
+}
+
+void GraphSnapshot::publish(const Handle &snapshot) {
+    std::lock_guard<std::mutex> lock(publishMutex);
+    std::atomic_store(&published, snapshot);
+    if (snapshot && snapshot->dataPending) {
+        DataManager *dataManager = DataManager::getInstance();
+        dataManager->setData(snapshot->locations, std::move(snapshot->distances));
+        snapshot->distances.clear();
+        snapshot->version = dataManager->getDataVersion();
+        snapshot->dataPending = false;
+    }
+}
+
+bool GraphSnapshot::replace(const Handle &expected, const Handle &snapshot) {
+    Handle previous = expected;
+    return std::atomic_compare_exchange_strong(&published, &previous, snapshot);
+}
+
+GraphSnapshot::Handle GraphSnapshot::current() {
+    return std::atomic_load(&published);
+}
+
+GraphSnapshot::Handle GraphSnapshot::owning(const Graph<LocationInfo> &graph) {
+    // A query asks for the same graph many times in a row; the answer stays right while the
+    // snapshot lives, and no graph gains an owner without a new snapshot being tracked
+    thread_local const Graph<LocationInfo> *lastGraph = nullptr;
+    thread_local std::weak_ptr<const GraphSnapshot> lastOwner;
+    thread_local bool lastOwned = false;
+    thread_local unsigned long lastTracked = 0;
+    unsigned long generation = tracked.load();
+    if (&graph == lastGraph) {
+        if (lastOwned) {
+            Handle snapshot = lastOwner.lock();
+            if (snapshot) {
+                return snapshot;
+            }
+        } else if (lastTracked == generation) {
+            return nullptr;
+        }
+    }
+
+    Handle snapshot = lookup(graph);
+    lastGraph = &graph;
+    lastOwner = snapshot;
+    lastOwned = snapshot != nullptr;
+    lastTracked = generation;
+    return snapshot;
+}
+
+GraphSnapshot::Handle GraphSnapshot::lookup(const Graph<LocationInfo> &graph) {
+    Handle snapshot = current();
+    if (snapshot && &snapshot->graph == &graph) {
+        return snapshot;
+    }
+
+    std::lock_guard<std::mutex> lock(liveMutex);
+    for (const auto &entry: live) {
+        snapshot = entry.lock();
+        if (snapshot && &snapshot->graph == &graph) {
+            return snapshot;
+        }
+    }
+    return nullptr;
+}
+
+const Graph<LocationInfo> &GraphSnapshot::getGraph() const {
+    return graph;
+}
+
+const std::vector<LocationData> &GraphSnapshot::getLocations() const {
+    return locations;
+}
+
+size_t GraphSnapshot::getDistanceCount() const {
+    return distanceCount;
+}
+
+unsigned long GraphSnapshot::getVersion() const {
+    return version;
+}
+
+unsigned long GraphSnapshot::getSerial() const {
+    return serial;
+}
+
+const Preprocessing::Report &GraphSnapshot::getReport() const {
+    return report;
+}
+
+const Preprocessing::Indexes &GraphSnapshot::getIndexes() const {
+    return indexes;
+}
+
+const std::vector<std::string> &GraphSnapshot::getMessages() const {
+    return messages;
+}
@@ -0,0 +1,236 @@
+#ifndef GRAPHSNAPSHOT_H
+#define GRAPHSNAPSHOT_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../graph_structure/Graph.h"
+#include "../graph_builder/GraphBuilder.h"
+#include "../parse_data/ParseData.h"
+#include "Preprocessing.h"
+
+/**
+ * @class GraphSnapshot
+ * @brief An immutable dataset and its graph, published to queries through an atomically swapped pointer
+ *
+ * A query takes the current snapshot once and runs on it to the end, so publishing a new one
+ * never disturbs it. The snapshot owns its vertices and edges, its acceleration structures and
+ * its travel-time profiles, and frees them when the last query holding it lets go, which is
+ * what lets a dataset be rebuilt in the background while the old one keeps answering.
+ *
+ * Routing is handed a graph, not a snapshot, so it finds the structures of a graph through
+ * owning(); queries still on an old snapshot keep their structures and profiles until they
+ * finish.
+ */
+class GraphSnapshot {
+public:
+    /** @brief Shared handle to a snapshot, keeps it alive */
+    using Handle = std::shared_ptr<const GraphSnapshot>;
+
+    /**
+     * @brief Reads a dataset and builds its graph and acceleration structures
+     *
+     * Nothing changes if a file cannot be read. Otherwise the snapshot is built but neither
+     * published nor handed to DataManager, so the published one keeps its structures and cached
+     * routes: the caller decides when to switch. Loads run one at a time.
+     *
+     * @param locationsFilePath Path to the locations data file
+     * @param distancesFilePath Path to the distances data file
+     * @param profilesFilePath Path to a travel-time profiles file, empty for none; see getMessages
+     * @param threads Threads used to build the structures, 0 to use every hardware thread
+     * @return The snapshot, or nullptr if the data could not be read
+     * @details O(L + D + P) where L is the number of locations, D the number of distances and P
+     * the cost of Preprocessing::build
+     */
+    static Handle load(const std::string &locationsFilePath,
+                       const std::string &distancesFilePath,
+                       const std::string &profilesFilePath = "",
+                       unsigned int threads = 0);
+
+    /**
+     * @brief Makes a snapshot the one queries take
+     *
+     * The previous snapshot is freed once the last query holding it finishes. The first time a
+     * loaded snapshot is published, its data then replaces DataManager's, which moves the data
+     * version on.
+     *
+     * @param snapshot The snapshot
+     * @details O(1), O(L + D) the first time a loaded snapshot is published
+     */
+    static void publish(const Handle &snapshot);
+
+    /**
+     * @brief Publishes a snapshot only if the published one is still the one it was derived from
+     * @param expected The snapshot that must still be published
+     * @param snapshot The snapshot to publish
+     * @return False, publishing nothing, if another snapshot was published in the meantime
+     * @details O(1)
+     */
+    static bool replace(const Handle &expected, const Handle &snapshot);
+
+    /**
+     * @brief Gets the published snapshot
+     * @return The snapshot, or nullptr if none was published yet
+     * @details O(1)
+     */
+    static Handle current();
+
+    /**
+     * @brief Finds the live snapshot a graph belongs to
+     *
+     * Each thread remembers the last graph it asked about and its owner, so the many calls of
+     * one query take neither the published pointer nor the lock on the live snapshots again.
+     *
+     * @param graph The graph
+     * @return The snapshot, or nullptr if no snapshot owns the graph
+     * @details O(1) for the graph of the previous call or the published snapshot, O(S) otherwise for S live snapshots
+     */
+    static Handle owning(const Graph<LocationInfo> &graph);
+
+    /**
+     * @brief Frees the graph, first dropping the shared search trees and cached routes of it
+     * @details O(V + E + C + S) where C is the number of cached search trees and S the RouteCache slots
+     */
+    ~GraphSnapshot();
+
+    GraphSnapshot(const GraphSnapshot &) = delete;
+
+    GraphSnapshot &operator=(const GraphSnapshot &) = delete;
+
+    /**
+     * @brief Gets the graph
+     * @return The graph
+     * @details O(1)
+     */
+    const Graph<LocationInfo> &getGraph() const;
+
+    /**
+     * @brief Gets the locations the graph was built from
+     * @return The locations, in file order
+     * @details O(1)
+     */
+    const std::vector<LocationData> &getLocations() const;
+
+    /**
+     * @brief Gets the number of distances the graph was built from
+     * @return Number of distance rows
+     * @details O(1)
+     */
+    size_t getDistanceCount() const;
+
+    /**
+     * @brief Gets the DataManager data version of the snapshot
+     * @return The version, 0 until the snapshot is first published
+     * @details O(1)
+     */
+    unsigned long getVersion() const;
+
+    /**
+     * @brief Gets the number of the snapshot, which no other snapshot of the process shares
+     * @return The number, counting from 1
+     * @details O(1)
+     */
+    unsigned long getSerial() const;
+
+    /**
+     * @brief Gets the report of the preprocessing run
+     * @return The report
+     * @details O(1)
+     */
+    const Preprocessing::Report &getReport() const;
+
+    /**
+     * @brief Gets the acceleration structures and travel-time profiles of the graph
+     * @return The structures
+     * @details O(1)
+     */
+    const Preprocessing::Indexes &getIndexes() const;
+
+    /**
+     * @brief Gets what loading the travel-time profiles had to report, such as ignored rows
+     * @return The messages, in order
+     * @details O(1)
+     */
+    const std::vector<std::string> &getMessages() const;
+
+private:
+    /** @brief Derives snapshots with new travel times */
+    friend class LiveTraffic;
+
+    /** @brief The graph, owned by the snapshot */
+    Graph<LocationInfo> graph;
+
+    /** @brief Locations the graph was built from */
+    std::vector<LocationData> locations;
+
+    /** @brief Number of distances the graph was built from */
+    size_t distanceCount;
+
+    /** @brief DataManager data version of the snapshot, set when it is first published */
+    mutable std::atomic<unsigned long> version;
+
+    /** @brief Number of the snapshot */
+    unsigned long serial;
+
+    /** @brief True from load until the first publish hands the data to DataManager, guarded by publishMutex */
+    mutable bool dataPending;
+
+    /** @brief Distances read by load, kept until the first publish, guarded by publishMutex */
+    mutable std::vector<DistanceData> distances;
+
+    /** @brief Report of the preprocessing run */
+    Preprocessing::Report report;
+
+    /** @brief Acceleration structures and travel-time profiles of the graph */
+    Preprocessing::Indexes indexes;
+
+    /** @brief Messages of the travel-time profile loading */
+    std::vector<std::string> messages;
+
+    /** @brief The published snapshot, only read and written with the atomic shared_ptr functions */
+    static Handle published;
+
+    /** @brief Serialises loads */
+    static std::mutex loadMutex;
+
+    /** @brief Serialises publishes, which hand loaded data to DataManager */
+    static std::mutex publishMutex;
+
+    /** @brief Every snapshot loaded and not yet freed, for owning */
+    static std::vector<std::weak_ptr<const GraphSnapshot> > live;
+
+    /** @brief Guards live */
+    static std::mutex liveMutex;
+
+    /** @brief Number of snapshots created so far */
+    static std::atomic<unsigned long> serials;
+
+    /** @brief Number of snapshots tracked so far, tells owning when a graph may have gained an owner */
+    static std::atomic<unsigned long> tracked;
+
+    /**
+     * @brief Takes ownership of a graph
+     * @details O(1)
+     */
+    GraphSnapshot(Graph<LocationInfo> graph, std::vector<LocationData> locations, size_t distanceCount);
+
+    /**
+     * @brief Makes a finished snapshot known to owning
+     * @param snapshot The snapshot
+     * @return The snapshot
+     * @details O(1) amortised
+     */
+    static Handle track(const std::shared_ptr<GraphSnapshot> &snapshot);
+
+    /**
+     * @brief Finds the live snapshot a graph belongs to, without the per-thread memory of owning
+     * @param graph The graph
+     * @return The snapshot, or nullptr if no snapshot owns the graph
+     * @details O(1) for the published snapshot, O(S) otherwise for S live snapshots
+     */
+    static Handle lookup(const Graph<LocationInfo> &graph);
+};
+
+#endif // GRAPHSNAPSHOT_H
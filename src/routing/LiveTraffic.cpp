@@ -0,0 +1,320 @@
+#include "LiveTraffic.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include "AllPairsTable.h"
+#include "ArcFlags.h"
+#include "ContractedGraph.h"
+#include "DeltaStepping.h"
+#include "ParkingIndex.h"
+#include "SearchKernels.h"
+#include "SearchTreeCache.h"
+
+/**
+ * @brief Repairs a mode-only tree with the kernel for its mode
+ * @tparam Mode The transport mode the tree was built for
+ * @param graph The graph, with the new weights already set
+ * @param changes The changed edges with their previous weights
+ * @param tree The tree to repair
+ * @return Number of vertices settled again
+ * @details O(V + A log A)
+ */
+template<Edge<LocationInfo>::EdgeType Mode>
+static int repairTree(
+    const Graph<LocationInfo> &graph,
+    const std::vector<SearchKernels::WeightChange> &changes,
+    Routing::SearchTree &tree) {
+    return tree.backward
+               ? SearchKernels::repair<true>(graph, changes, SearchKernels::ModeEdge<Mode>(), tree)
+               : SearchKernels::repair<false>(graph, changes, SearchKernels::ModeEdge<Mode>(), tree);
+}
+
+/**
+ * @brief Copies a graph with some edges given new weights
+ *
+ * Vertices keep their indices, and edges are added in an order that keeps every adjacency
+ * list and every incoming list in its original order, so anything indexed by vertex and
+ * adjacency position, and any search, means the same on the copy.
+ *
+ * @param graph The graph
+ * @param weights New weight of some edges of the graph
+ * @param copyOf Receives the copy of every edge of the graph
+ * @return The copy
+ * @details O(V + E)
+ */
+static Graph<LocationInfo> copyGraph(
+    const Graph<LocationInfo> &graph,
+    const std::unordered_map<const Edge<LocationInfo> *, double> &weights,
+    std::unordered_map<const Edge<LocationInfo> *, Edge<LocationInfo> *> &copyOf) {
+    Graph<LocationInfo> copy;
+    const auto &vertices = graph.getVertexSet();
+    int n = graph.getNumVertex();
+    size_t edgeCount = 0;
+    for (auto v: vertices) {
+        copy.appendVertex(v->getInfo());
+        edgeCount += v->getAdj().size();
+    }
+    copyOf.reserve(edgeCount);
+    const auto &copies = copy.getVertexSet();
+
+    // An edge is added once it heads what is left of both its origin's list and its destination's
+    std::vector<size_t> nextOut(n, 0);
+    std::vector<size_t> nextIn(n, 0);
+    std::vector<Edge<LocationInfo> *> ready;
+    auto offer = [&](Edge<LocationInfo> *e) {
+        const auto &adj = e->getOrig()->getAdj();
+        const auto &incoming = e->getDest()->getIncoming();
+        size_t out = nextOut[e->getOrig()->getIndex()];
+        size_t in = nextIn[e->getDest()->getIndex()];
+        if (out < adj.size() && adj[out] == e && in < incoming.size() && incoming[in] == e)
+            ready.push_back(e);
+    };
+    auto add = [&](Edge<LocationInfo> *e) {
+        int from = e->getOrig()->getIndex();
+        int to = e->getDest()->getIndex();
+        auto weight = weights.find(e);
+        Edge<LocationInfo> *c = copies[from]->addEdge(copies[to], weight == weights.end() ? e->getWeight() : weight->second);
+        c->setType(e->getType());
+        copyOf[e] = c;
+    };
+    for (auto v: vertices) {
+        if (!v->getAdj().empty())
+            offer(v->getAdj()[0]);
+    }
+    while (!ready.empty()) {
+        Edge<LocationInfo> *e = ready.back();
+        ready.pop_back();
+        add(e);
+        int from = e->getOrig()->getIndex();
+        int to = e->getDest()->getIndex();
+        nextOut[from]++;
+        nextIn[to]++;
+
+        const auto &adj = vertices[from]->getAdj();
+        const auto &incoming = vertices[to]->getIncoming();
+        Edge<LocationInfo> *nextOfOrigin = nextOut[from] < adj.size() ? adj[nextOut[from]] : nullptr;
+        Edge<LocationInfo> *nextOfDest = nextIn[to] < incoming.size() ? incoming[nextIn[to]] : nullptr;
+        if (nextOfOrigin != nullptr)
+            offer(nextOfOrigin);
+        if (nextOfDest != nullptr && nextOfDest != nextOfOrigin)
+            offer(nextOfDest);
+    }
+
+    // Lists built in an order no sequence of insertions gives keep their adjacency order
+    for (auto v: vertices) {
+        for (auto e: v->getAdj()) {
+            if (copyOf.count(e) == 0)
+                add(e);
+        }
+    }
+
+    for (auto v: vertices) {
+        for (auto e: v->getAdj()) {
+            if (e->getReverse() != nullptr)
+                copyOf[e]->setReverse(copyOf[e->getReverse()]);
+        }
+    }
+    return copy;
+}
+
+GraphSnapshot::Handle LiveTraffic::apply(
+    const GraphSnapshot::Handle &base,
+    const std::vector<TravelTimeUpdate> &updates,
+    UpdateReport &report,
+    unsigned int threads) {
+    using EdgeType = Edge<LocationInfo>::EdgeType;
+    const Graph<LocationInfo> &graph = base->getGraph();
+    report = UpdateReport();
+
+    // New weight of every changed edge of the base graph, with later updates winning
+    std::unordered_map<const Edge<LocationInfo> *, double> weights;
+    std::vector<const Edge<LocationInfo> *> order;
+    for (const auto &update: updates) {
+        std::string segment = update.location1 + "-" + update.location2;
+        if (update.transportMode != EdgeType::DRIVING && update.transportMode != EdgeType::WALKING) {
+            report.errors.push_back(segment + ": mode must be driving or walking");
+            continue;
+        }
+        if (!std::isfinite(update.time) || update.time <= 0) {
+            report.errors.push_back(segment + ": travel time must be positive");
+            continue;
+        }
+
+        Vertex<LocationInfo> *a = graph.findVertex(LocationInfo("", 0, update.location1, false));
+        Vertex<LocationInfo> *b = graph.findVertex(LocationInfo("", 0, update.location2, false));
+        if (a == nullptr || b == nullptr) {
+            report.errors.push_back(segment + ": unknown location");
+            continue;
+        }
+
+        std::vector<const Edge<LocationInfo> *> edges;
+        for (auto e: a->getAdj()) {
+            if (e->getDest() == b && e->getType() == update.transportMode)
+                edges.push_back(e);
+        }
+        for (auto e: b->getAdj()) {
+            if (e->getDest() == a && e->getType() == update.transportMode)
+                edges.push_back(e);
+        }
+        if (edges.empty()) {
+            report.errors.push_back(segment + (update.transportMode == EdgeType::DRIVING
+                                                   ? ": no driving segment"
+                                                   : ": no walking segment"));
+            continue;
+        }
+
+        for (auto e: edges) {
+            if (weights.count(e) == 0)
+                order.push_back(e);
+            weights[e] = update.time;
+        }
+    }
+
+    std::unordered_map<const Edge<LocationInfo> *, Edge<LocationInfo> *> copyOf;
+    std::vector<SearchKernels::WeightChange> changes;
+    bool modeChanged[3] = {false, false, false};
+    for (auto e: order) {
+        if (weights[e] == e->getWeight()) {
+            weights.erase(e);
+        } else {
+            modeChanged[static_cast<int>(e->getType())] = true;
+        }
+    }
+    if (weights.empty()) {
+        return base;
+    }
+
+    std::shared_ptr<GraphSnapshot> snapshot(new GraphSnapshot(
+        copyGraph(graph, weights, copyOf), base->locations, base->distanceCount));
+    const Graph<LocationInfo> &copy = snapshot->graph;
+    for (auto e: order) {
+        if (weights.count(e))
+            changes.emplace_back(copyOf[e], e->getWeight());
+    }
+    report.edgesChanged = static_cast<int>(changes.size());
+
+    snapshot->version = base->version.load();
+    snapshot->report = base->report;
+    snapshot->messages = base->messages;
+
+    const Preprocessing::Indexes &indexes = base->indexes;
+    Preprocessing::Indexes &repaired = snapshot->indexes;
+    for (EdgeType mode: {EdgeType::DEFAULT, EdgeType::DRIVING, EdgeType::WALKING}) {
+        int m = static_cast<int>(mode);
+        if (indexes.contracted[m])
+            repaired.contracted[m] = indexes.contracted[m]->rebind(copy, copyOf);
+        if (indexes.deltaStepping[m])
+            repaired.deltaStepping[m] = DeltaStepping::compile(copy, mode, indexes.deltaStepping[m]->getDelta());
+
+        repaired.arcFlags[m] = indexes.arcFlags[m];
+        if (indexes.arcFlags[m] && modeChanged[m]) {
+            repaired.arcFlags[m] = indexes.arcFlags[m]->repair(copy, changes, threads);
+            report.arcFlagSearches += repaired.arcFlags[m]->getRepairedBoundaryCount();
+        }
+
+        repaired.allPairs[m] = indexes.allPairs[m];
+        if (indexes.allPairs[m] && modeChanged[m]) {
+            repaired.allPairs[m] = indexes.allPairs[m]->repair(copy, changes, threads);
+            report.allPairsRows += repaired.allPairs[m]->getRepairedRowCount();
+        }
+    }
+    repaired.parking = indexes.parking;
+    if (indexes.parking && modeChanged[static_cast<int>(EdgeType::WALKING)]) {
+        repaired.parking = ParkingIndex::compute(copy, indexes.parking->getK(), indexes.parking->getRadius(), threads);
+        report.parkingIndexRebuilt = true;
+    }
+    repaired.profiles = indexes.profiles;
+
+    // Trees of the base graph are copied onto the new one and repaired there; the base keeps its own.
+    // A private cache of the publishing thread is left alone: its owner clears it on the new snapshot.
+    const auto &copies = copy.getVertexSet();
+    std::vector<std::pair<const Vertex<LocationInfo> *, std::pair<EdgeType, SearchTreeCache::TreeHandle> > > trees;
+    SearchTreeCache *cache = SearchTreeCache::getShared();
+    cache->rewrite([&](const Graph<LocationInfo> *owner,
+                       const Vertex<LocationInfo> *root,
+                       EdgeType transportMode,
+                       bool restricted,
+                       const SearchTreeCache::TreeHandle &tree) {
+        if (owner == &graph && !restricted)
+            trees.emplace_back(copies[root->getIndex()], std::make_pair(transportMode, tree));
+        return tree;
+    });
+    for (const auto &entry: trees) {
+        EdgeType transportMode = entry.second.first;
+        Routing::SearchTree tree = *entry.second.second;
+        for (auto &parent: tree.parent) {
+            if (parent != nullptr)
+                parent = copyOf[parent];
+        }
+
+        switch (transportMode) {
+            case EdgeType::DRIVING:
+                report.verticesSettled += repairTree<EdgeType::DRIVING>(copy, changes, tree);
+                break;
+            case EdgeType::WALKING:
+                report.verticesSettled += repairTree<EdgeType::WALKING>(copy, changes, tree);
+                break;
+            default:
+                report.verticesSettled += repairTree<EdgeType::DEFAULT>(copy, changes, tree);
+                break;
+        }
+        cache->insert(copy, entry.first, RouteRestrictions(transportMode), std::move(tree));
+        report.treesRepaired++;
+    }
+
+    return GraphSnapshot::track(snapshot);
+}
+
+LiveTraffic::UpdateReport LiveTraffic::publish(const std::vector<TravelTimeUpdate> &updates, unsigned int threads) {
+    UpdateReport report;
+    while (true) {
+        GraphSnapshot::Handle base = GraphSnapshot::current();
+        if (!base) {
+            report = UpdateReport();
+            report.errors.push_back("No dataset loaded");
+            return report;
+        }
+
+        GraphSnapshot::Handle updated = apply(base, updates, report, threads);
+        if (updated == base || GraphSnapshot::replace(base, updated)) {
+            return report;
+        }
+    }
+}
+
+bool LiveTraffic::parseUpdate(const std::string &row, TravelTimeUpdate &update) {
+    std::vector<std::string> fields;
+    std::stringstream stream(row);
+    std::string field;
+    while (std::getline(stream, field, ',')) {
+        field.erase(0, field.find_first_not_of(" \t"));
+        field.erase(field.find_last_not_of(" \t\r") + 1);
+        fields.push_back(field);
+    }
+    if (fields.size() != 4) {
+        return false;
+    }
+
+    std::string mode = fields[2];
+    std::transform(mode.begin(), mode.end(), mode.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (mode == "driving") {
+        update.transportMode = Edge<LocationInfo>::EdgeType::DRIVING;
+    } else if (mode == "walking") {
+        update.transportMode = Edge<LocationInfo>::EdgeType::WALKING;
+    } else {
+        return false;
+    }
+
+    char *end = nullptr;
+    update.time = std::strtod(fields[3].c_str(), &end);
+    if (fields[3].empty() || *end != '\0') {
+        return false;
+    }
+    update.location1 = fields[0];
+    update.location2 = fields[1];
+    return true;
+}
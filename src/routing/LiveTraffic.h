@@ -0,0 +1,97 @@
+#ifndef LIVETRAFFIC_H
+#define LIVETRAFFIC_H
+
+#include <string>
+#include <vector>
+#include "../graph_structure/Graph.h"
+#include "../graph_builder/GraphBuilder.h"
+#include "GraphSnapshot.h"
+
+/**
+ * @class LiveTraffic
+ * @brief Changes travel times by deriving a new GraphSnapshot and repairs everything derived from them
+ *
+ * An update sets the time of a segment between two locations for one mode, in both
+ * directions, as a row of the distances file would. Snapshots are immutable, so updates are
+ * copy-on-write: the graph is copied with its vertices and edges in the same order and the new
+ * weights, and the copy gets its own structures, which queries on the old snapshot never see:
+ * - trees of the old graph in the shared SearchTreeCache are copied onto the new graph and
+ *   repaired in place of a rebuild (SearchKernels::repair); trees built with avoid lists stay
+ *   with the old graph, and private ThreadScope caches, even the publishing thread's, are left
+ *   to their owners, which clear them on the new snapshot;
+ * - the ContractedGraph cores are carried over without contracting again, since weights do not
+ *   change which locations collapse (ContractedGraph::rebind);
+ * - the DeltaStepping searches are compiled again, which only takes a linear pass;
+ * - the ArcFlags of every changed mode are repaired (ArcFlags::repair), the others are shared;
+ * - the AllPairsTable of every changed mode is repaired too: only the rows the changes can
+ *   alter, each like a cached tree (AllPairsTable::repair);
+ * - walking updates rebuild the ParkingIndex, other updates share it;
+ * - travel-time profiles are shared;
+ * - saved AllPairsTable files no longer match AllPairsTable::fingerprint and are recomputed
+ *   by the next loadOrCompute.
+ */
+class LiveTraffic {
+public:
+    /**
+     * @brief A new travel time for one segment and mode
+     */
+    struct TravelTimeUpdate {
+        std::string location1; /**< Code of one end of the segment */
+        std::string location2; /**< Code of the other end of the segment */
+        Edge<LocationInfo>::EdgeType transportMode; /**< DRIVING or WALKING */
+        double time; /**< New travel time in minutes, positive */
+    };
+
+    /**
+     * @brief What a batch of updates changed
+     */
+    struct UpdateReport {
+        int edgesChanged = 0; /**< Edges whose weight changed, two per segment */
+        int treesRepaired = 0; /**< Cached trees copied onto the new graph and repaired */
+        int verticesSettled = 0; /**< Vertices settled again while repairing the trees */
+        int arcFlagSearches = 0; /**< Boundary vertices searched again to repair the arc flags */
+        int allPairsRows = 0; /**< Rows of the all-pairs tables repaired */
+        bool parkingIndexRebuilt = false; /**< True if the parking index was rebuilt */
+        std::vector<std::string> errors; /**< Updates that were rejected and why */
+    };
+
+    /**
+     * @brief Derives a snapshot with new travel times from another one
+     * @param base The snapshot to start from, left untouched
+     * @param updates The updates, applied in order
+     * @param report Receives what changed; rejected updates are listed in errors and change nothing
+     * @param threads Threads used to repair the arc flags and tables and rebuild the parking index, 0 to use every hardware thread
+     * @return The new snapshot, not published yet; base itself if no weight changed
+     * @details O(V^2 + E + U * V + T * (V + A log A) + F) where U is the number of updates, T the number of
+     * cached trees, A the vertices whose distance changes and F the cost of ArcFlags::repair and AllPairsTable::repair
+     */
+    static GraphSnapshot::Handle apply(
+        const GraphSnapshot::Handle &base,
+        const std::vector<TravelTimeUpdate> &updates,
+        UpdateReport &report,
+        unsigned int threads = 0);
+
+    /**
+     * @brief Applies travel-time updates to the published snapshot and publishes the result
+     *
+     * If a dataset or another update is published while this one is being applied, it is
+     * applied again on top of that snapshot, so no update is lost.
+     *
+     * @param updates The updates, applied in order
+     * @param threads Threads used to repair the structures, 0 to use every hardware thread
+     * @return What changed; an error if no snapshot is published
+     * @details See apply
+     */
+    static UpdateReport publish(const std::vector<TravelTimeUpdate> &updates, unsigned int threads = 0);
+
+    /**
+     * @brief Reads an update written like a row of the distances file
+     * @param row Location1,Location2,Mode,Time, where Mode is Driving or Walking
+     * @param update Receives the update
+     * @return False if the row is malformed
+     * @details O(N) where N is the length of the row
+     */
+    static bool parseUpdate(const std::string &row, TravelTimeUpdate &update);
+};
+
+#endif // LIVETRAFFIC_H
@@ -0,0 +1,147 @@
+#include "ParallelDijkstra.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "../graph_structure/MultiQueue.h"
+
+/**
+ * @brief Lowers a shared distance to a candidate value
+ * @return True if the candidate was lower
+ * @details O(1) expected
+ */
+static bool lowerDistance(std::atomic<double> &dist, double candidate) {
+    double current = dist.load(std::memory_order_relaxed);
+    while (candidate < current) {
+        if (dist.compare_exchange_weak(current, candidate, std::memory_order_relaxed))
+            return true;
+    }
+    return false;
+}
+
+void ParallelDijkstra::search(
+    const Graph<LocationInfo> &graph,
+    const Vertex<LocationInfo> *root,
+    const RouteRestrictions &restrictions,
+    Routing::SearchTree &tree,
+    unsigned int threads,
+    Stats *stats) {
+    std::vector<SearchKernels::Seed> seeds;
+    if (root != nullptr) {
+        seeds.emplace_back(root, 0);
+    }
+    searchFrom(graph, seeds, restrictions, tree, threads, stats);
+}
+
+void ParallelDijkstra::searchFrom(
+    const Graph<LocationInfo> &graph,
+    const std::vector<SearchKernels::Seed> &seeds,
+    const RouteRestrictions &restrictions,
+    Routing::SearchTree &tree,
+    unsigned int threads,
+    Stats *stats) {
+    const auto &vertices = graph.getVertexSet();
+    int n = graph.getNumVertex();
+    tree.backward = false;
+    tree.dist.assign(n, INF);
+    tree.parent.assign(n, nullptr);
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<std::atomic<double> > dist(n);
+    for (auto &d: dist) {
+        d.store(INF, std::memory_order_relaxed);
+    }
+    std::vector<double> seedDist(n, INF);
+    for (const auto &seed: seeds) {
+        int v = seed.first->getIndex();
+        seedDist[v] = std::min(seedDist[v], seed.second);
+    }
+
+    MultiQueue<int> queue(threads);
+    unsigned long long random = 0x9E3779B97F4A7C15ULL;
+    std::atomic<long> pending(0);
+    long seedPushes = 0;
+    for (int v = 0; v < n; v++) {
+        if (seedDist[v] != INF) {
+            dist[v].store(seedDist[v], std::memory_order_relaxed);
+            pending++;
+            seedPushes++;
+            queue.push(seedDist[v], v, random);
+        }
+    }
+
+    // An entry stays pending until its vertex's edges are relaxed, so pending == 0 means done
+    std::vector<Stats> local(threads);
+    auto worker = [&](unsigned int id) {
+        unsigned long long state = 0x2545F4914F6CDD1DULL * (id + 1);
+        Stats &counters = local[id];
+        double key;
+        int v;
+        while (pending.load() > 0) {
+            if (!queue.tryPop(key, v, state)) {
+                std::this_thread::yield();
+                continue;
+            }
+            if (key > dist[v].load(std::memory_order_relaxed)) {
+                counters.stalePops++;
+                pending--;
+                continue;
+            }
+
+            counters.expansions++;
+            for (auto e: vertices[v]->getAdj()) {
+                if (!restrictions.allows(e))
+                    continue;
+                int w = e->getDest()->getIndex();
+                double candidate = key + e->getWeight();
+                if (lowerDistance(dist[w], candidate)) {
+                    pending++;
+                    counters.pushes++;
+                    queue.push(candidate, w, state);
+                }
+            }
+            pending--;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned int id = 1; id < threads; id++) {
+        pool.emplace_back(worker, id);
+    }
+    worker(0);
+    for (auto &th: pool) {
+        th.join();
+    }
+
+    for (int v = 0; v < n; v++) {
+        tree.dist[v] = dist[v].load(std::memory_order_relaxed);
+    }
+
+    // Parents follow the first tight edge in vertex and adjacency order, as SearchKernels::breaksTie picks them;
+    // seeds that kept their distance have none
+    for (int u = 0; u < n; u++) {
+        if (tree.dist[u] == INF)
+            continue;
+        for (auto e: vertices[u]->getAdj()) {
+            int w = e->getDest()->getIndex();
+            if (tree.parent[w] == nullptr && seedDist[w] != tree.dist[w] && restrictions.allows(e) &&
+                tree.dist[u] + e->getWeight() == tree.dist[w])
+                tree.parent[w] = e;
+        }
+    }
+
+    if (stats != nullptr) {
+        *stats = Stats();
+        stats->pushes = seedPushes;
+        for (const auto &counters: local) {
+            stats->pushes += counters.pushes;
+            stats->expansions += counters.expansions;
+            stats->stalePops += counters.stalePops;
+        }
+        for (int v = 0; v < n; v++) {
+            stats->settled += tree.dist[v] != INF;
+        }
+    }
+}
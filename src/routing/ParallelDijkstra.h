@@ -0,0 +1,77 @@
+#ifndef PARALLELDIJKSTRA_H
+#define PARALLELDIJKSTRA_H
+
+#include <vector>
+#include "../graph_structure/Graph.h"
+#include "../graph_builder/GraphBuilder.h"
+#include "Routing.h"
+#include "RouteRestrictions.h"
+#include "SearchKernels.h"
+
+/**
+ * @class ParallelDijkstra
+ * @brief Label-setting search run by several threads over a shared MultiQueue
+ *
+ * Threads pop vertices from a relaxed MultiQueue and relax their edges, lowering distances
+ * with compare-and-swap. Since pops are only nearly in order, a vertex may be expanded before
+ * its final distance is known and expanded again later; Stats counts that wasted work. Every
+ * distance still ends as the minimum of dist(u) + w(u, v) over allowed edges, so distances
+ * are bit-identical to SearchKernels for any thread count.
+ *
+ * Unlike DeltaStepping it takes compiled restrictions and several seeds, so it also serves
+ * multi-source searches such as walking onwards from every parking location at once, seeded
+ * with the driving time to each.
+ *
+ * Routing does not call it: relaxed pops only pay off with several cores, and the multiqueue
+ * benchmark suite is where it is measured against the sequential kernel.
+ */
+class ParallelDijkstra {
+public:
+    /**
+     * @brief Work done by one search
+     */
+    struct Stats {
+        long pushes = 0; /**< Entries pushed into the queue */
+        long expansions = 0; /**< Vertices whose edges were relaxed, counting repeats */
+        long stalePops = 0; /**< Entries popped after their vertex got a smaller distance */
+        long settled = 0; /**< Vertices reached */
+    };
+
+    /**
+     * @brief Builds the whole tree rooted at a vertex
+     * @param graph The graph to search
+     * @param root The root vertex
+     * @param restrictions Restrictions compiled for this graph
+     * @param tree The tree to fill
+     * @param threads Number of threads, 0 to use every hardware thread
+     * @param stats Optional counters to fill
+     * @details O(E log V / T) expected for T threads, plus the wasted expansions
+     */
+    static void search(
+        const Graph<LocationInfo> &graph,
+        const Vertex<LocationInfo> *root,
+        const RouteRestrictions &restrictions,
+        Routing::SearchTree &tree,
+        unsigned int threads = 0,
+        Stats *stats = nullptr);
+
+    /**
+     * @brief Builds the shortest-path forest of several seeds with their own initial distances
+     * @param graph The graph to search
+     * @param seeds The seeds; they keep a null parent unless another seed reaches them sooner
+     * @param restrictions Restrictions compiled for this graph
+     * @param tree The tree to fill
+     * @param threads Number of threads, 0 to use every hardware thread
+     * @param stats Optional counters to fill
+     * @details O(E log V / T) expected for T threads, plus the wasted expansions
+     */
+    static void searchFrom(
+        const Graph<LocationInfo> &graph,
+        const std::vector<SearchKernels::Seed> &seeds,
+        const RouteRestrictions &restrictions,
+        Routing::SearchTree &tree,
+        unsigned int threads = 0,
+        Stats *stats = nullptr);
+};
+
+#endif // PARALLELDIJKSTRA_H
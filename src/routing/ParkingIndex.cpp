@@ -0,0 +1,159 @@
+#include "ParkingIndex.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include "../parse_data/DataManager.h"
+#include "Routing.h"
+#include "SearchKernels.h"
+
+std::shared_ptr<const ParkingIndex> ParkingIndex::prepared;
+std::mutex ParkingIndex::preparedMutex;
+
+ParkingIndex::ParkingIndex()
+    : k(0), radius(0), graphFirstVertex(nullptr), graphVertexCount(0), dataVersion(0) {
+}
+
+std::shared_ptr<const ParkingIndex> ParkingIndex::compute(
+    const Graph<LocationInfo> &graph,
+    int k,
+    double radius,
+    unsigned int threads) {
+    std::shared_ptr<ParkingIndex> index(new ParkingIndex());
+    const auto &vertices = graph.getVertexSet();
+    int n = graph.getNumVertex();
+
+    index->k = std::max(1, k);
+    index->radius = radius;
+    index->graphFirstVertex = vertices.empty() ? nullptr : vertices[0];
+    index->graphVertexCount = n;
+    index->dataVersion = DataManager::getInstance()->getDataVersion();
+
+    std::vector<int> parkings;
+    for (auto v: vertices) {
+        if (v->getInfo().hasParking)
+            parkings.push_back(v->getIndex());
+    }
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min<unsigned int>(threads, std::max<size_t>(1, parkings.size()));
+
+    // Every search reports (location, entry) pairs; they are bucketed by location afterwards
+    using Reached = std::pair<int, Entry>;
+    std::vector<std::vector<Reached> > found(threads);
+    std::atomic<size_t> next(0);
+    auto worker = [&](unsigned int id) {
+        Routing::SearchTree tree;
+        for (size_t t = next++; t < parkings.size(); t = next++) {
+            SearchKernels::growForMode<false>(graph, vertices[parkings[t]], Edge<LocationInfo>::EdgeType::WALKING,
+                                              nullptr, 0, tree, radius);
+            for (int v = 0; v < n; v++) {
+                if (tree.dist[v] <= radius)
+                    found[id].push_back({v, {parkings[t], static_cast<float>(tree.dist[v])}});
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned int id = 1; id < threads; id++) {
+        pool.emplace_back(worker, id);
+    }
+    worker(0);
+    for (auto &th: pool) {
+        th.join();
+    }
+
+    std::vector<int> reachedCount(n + 1, 0);
+    for (const auto &local: found) {
+        for (const auto &r: local) {
+            reachedCount[r.first + 1]++;
+        }
+    }
+    for (int v = 0; v < n; v++) {
+        reachedCount[v + 1] += reachedCount[v];
+    }
+    std::vector<Entry> reached(reachedCount[n]);
+    std::vector<int> fill(reachedCount.begin(), reachedCount.end() - 1);
+    for (const auto &local: found) {
+        for (const auto &r: local) {
+            reached[fill[r.first]++] = r.second;
+        }
+    }
+
+    // Closest first, lower vertex index first among ties so that lists do not depend on threads
+    index->start.assign(n + 1, 0);
+    for (int v = 0; v < n; v++) {
+        auto first = reached.begin() + reachedCount[v];
+        auto last = reached.begin() + reachedCount[v + 1];
+        auto kept = first + std::min<long>(index->k, last - first);
+        std::partial_sort(first, kept, last, [](const Entry &a, const Entry &b) {
+            return a.walkingTime < b.walkingTime || (a.walkingTime == b.walkingTime && a.parking < b.parking);
+        });
+        index->entries.insert(index->entries.end(), first, kept);
+        index->start[v + 1] = static_cast<int>(index->entries.size());
+    }
+
+    return index;
+}
+
+void ParkingIndex::prepare(const Graph<LocationInfo> &graph, int k, double radius) {
+    install(compute(graph, k, radius));
+}
+
+void ParkingIndex::install(const std::shared_ptr<const ParkingIndex> &index) {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    prepared = index;
+}
+
+std::shared_ptr<const ParkingIndex> ParkingIndex::find(const Graph<LocationInfo> &graph) {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    if (prepared && prepared->covers(graph)) {
+        return prepared;
+    }
+    return nullptr;
+}
+
+bool ParkingIndex::clear() {
+    std::lock_guard<std::mutex> lock(preparedMutex);
+    bool dropped = prepared != nullptr;
+    prepared.reset();
+    return dropped;
+}
+
+bool ParkingIndex::covers(const Graph<LocationInfo> &graph) const {
+    return graph.getNumVertex() == graphVertexCount &&
+           (graphVertexCount == 0 || graph.getVertexSet()[0] == graphFirstVertex) &&
+           DataManager::getInstance()->getDataVersion() == dataVersion;
+}
+
+unsigned long long ParkingIndex::getChecksum() const {
+    unsigned long long hash = 14695981039346656037ULL;
+    auto mix = [&hash](unsigned long long value) {
+        for (int i = 0; i < 8; i++) {
+            hash ^= (value >> (i * 8)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    mix(static_cast<unsigned long long>(k));
+    for (int s: start) {
+        mix(static_cast<unsigned long long>(s));
+    }
+    for (const auto &entry: entries) {
+        unsigned int bits;
+        std::memcpy(&bits, &entry.walkingTime, sizeof(bits));
+        mix(static_cast<unsigned long long>(entry.parking));
+        mix(bits);
+    }
+    return hash;
+}
+
+bool ParkingIndex::isComplete(int index, double maxWalkingTime) const {
+    if (maxWalkingTime > radius) {
+        return false;
+    }
+    int count = getCount(index);
+    return count < k || getNearest(index)[count - 1].walkingTime > maxWalkingTime;
+}
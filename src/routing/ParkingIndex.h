@@ -0,0 +1,177 @@
+#ifndef PARKINGINDEX_H
+#define PARKINGINDEX_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "../graph_structure/Graph.h"
+#include "../graph_builder/GraphBuilder.h"
+
+/**
+ * @class ParkingIndex
+ * @brief The k parking locations closest to every location by walking time
+ *
+ * Built with one walking search out of every parking location, bounded by a radius and spread
+ * over threads; every location then keeps the k parking locations that reach it soonest, with
+ * their walking times, sorted by walking time. Eco routing reads the candidates of its
+ * destination from here instead of running a walking search per parking location.
+ *
+ * A list is complete up to a walking time if it has room to spare or its last entry is
+ * further away than that; only complete lists can stand in for the searches. Avoid lists and
+ * changed walking times both invalidate the walking times, so restricted queries must not use
+ * the index.
+ */
+class ParkingIndex {
+public:
+    /**
+     * @brief A parking location and the time it takes to walk from it
+     */
+    struct Entry {
+        int parking; /**< Vertex index of the parking location */
+        float walkingTime; /**< Walking time from the parking location, in minutes */
+    };
+
+    /**
+     * @brief Computes the index for a graph
+     * @param graph The transportation graph
+     * @param k Number of parking locations kept per location
+     * @param radius Longest walking time searched, in minutes
+     * @param threads Number of worker threads, 0 to use every hardware thread
+     * @return The index
+     * @details O(P * E log V / T + V * k) where P is the number of parking locations and T the number of threads
+     */
+    static std::shared_ptr<const ParkingIndex> compute(
+        const Graph<LocationInfo> &graph,
+        int k = 16,
+        double radius = 60,
+        unsigned int threads = 0);
+
+    /**
+     * @brief Computes the index and registers it for Routing
+     * @param graph The transportation graph
+     * @param k Number of parking locations kept per location
+     * @param radius Longest walking time searched, in minutes
+     * @details O(P * E log V / T + V * k)
+     */
+    static void prepare(const Graph<LocationInfo> &graph, int k = 16, double radius = 60);
+
+    /**
+     * @brief Gets the registered index for a graph
+     * @param graph The transportation graph
+     * @return The index, or nullptr if none was prepared for this graph and dataset
+     * @details O(1)
+     */
+    static std::shared_ptr<const ParkingIndex> find(const Graph<LocationInfo> &graph);
+
+    /**
+     * @brief Drops the registered index
+     * @return True if an index was dropped
+     * @details O(1)
+     */
+    static bool clear();
+
+    /**
+     * @brief Registers an index computed earlier, replacing the current one
+     * @param index The index
+     * @details O(1)
+     */
+    static void install(const std::shared_ptr<const ParkingIndex> &index);
+
+    /**
+     * @brief Checks whether the index was computed from a graph and the current dataset
+     * @param graph The graph
+     * @return True if the index can answer queries on the graph
+     * @details O(1)
+     */
+    bool covers(const Graph<LocationInfo> &graph) const;
+
+    /**
+     * @brief Hashes the contents of the index, to check that rebuilds are reproducible
+     * @return FNV-1a hash of the lists
+     * @details O(V + E) where E is the number of stored entries
+     */
+    unsigned long long getChecksum() const;
+
+    /**
+     * @brief Checks whether a location's list holds every parking location within a walking time
+     * @param index Vertex index of the location
+     * @param maxWalkingTime The walking time
+     * @return True if no parking location within that time is missing from the list
+     * @details O(1)
+     */
+    bool isComplete(int index, double maxWalkingTime) const;
+
+    /**
+     * @brief Gets the first entry of a location's list
+     * @param index Vertex index of the location
+     * @return Pointer to the closest parking location, followed by the rest of the list
+     * @details O(1)
+     */
+    const Entry *getNearest(int index) const {
+        return entries.data() + start[index];
+    }
+
+    /**
+     * @brief Gets the length of a location's list
+     * @param index Vertex index of the location
+     * @return Number of parking locations listed, at most k
+     * @details O(1)
+     */
+    int getCount(int index) const {
+        return start[index + 1] - start[index];
+    }
+
+    /**
+     * @brief Gets the number of parking locations kept per location
+     * @return k
+     * @details O(1)
+     */
+    int getK() const {
+        return k;
+    }
+
+    /**
+     * @brief Gets the longest walking time searched
+     * @return The radius, in minutes
+     * @details O(1)
+     */
+    double getRadius() const {
+        return radius;
+    }
+
+private:
+    /** @brief Number of parking locations kept per location */
+    int k;
+
+    /** @brief Longest walking time searched, in minutes */
+    double radius;
+
+    /** @brief Position of every location's list in entries, plus the total at the end */
+    std::vector<int> start;
+
+    /** @brief Lists of every location, each sorted by walking time */
+    std::vector<Entry> entries;
+
+    /** @brief First vertex, identifies the graph the index was computed for */
+    const Vertex<LocationInfo> *graphFirstVertex;
+
+    /** @brief Number of vertices */
+    int graphVertexCount;
+
+    /** @brief DataManager data version the index was computed from */
+    unsigned long dataVersion;
+
+    /** @brief Registered index */
+    static std::shared_ptr<const ParkingIndex> prepared;
+
+    /** @brief Guards the registered index */
+    static std::mutex preparedMutex;
+
+    /**
+     * @brief Creates an empty index
+     * @details O(1)
+     */
+    ParkingIndex();
+};
+
+#endif // PARKINGINDEX_H
@@ -0,0 +1,216 @@
+#include "Preprocessing.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "AllPairsTable.h"
+#include "ArcFlags.h"
+#include "ContractedGraph.h"
+#include "DeltaStepping.h"
+#include "ParkingIndex.h"
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+int Preprocessing::TaskGraph::add(const std::string &name, const Task &task, const std::vector<int> &after) {
+    int id = static_cast<int>(names.size());
+    names.push_back(name);
+    work.push_back(task);
+    dependents.emplace_back();
+    dependencyCount.push_back(static_cast<int>(after.size()));
+    for (int dependency: after) {
+        dependents[dependency].push_back(id);
+    }
+    return id;
+}
+
+Preprocessing::Report Preprocessing::TaskGraph::run(unsigned int threads) const {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    int taskCount = static_cast<int>(names.size());
+
+    Report report;
+    report.threads = threads;
+    report.phases.resize(taskCount);
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<int> waitingFor = dependencyCount;
+    std::vector<int> ready;
+    for (int t = taskCount - 1; t >= 0; t--) {
+        if (waitingFor[t] == 0)
+            ready.push_back(t);
+    }
+    int running = 0;
+    int finished = 0;
+    std::exception_ptr failure;
+
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            changed.wait(lock, [&]() { return !ready.empty() || finished == taskCount || (failure && running == 0); });
+            if (ready.empty()) {
+                return;
+            }
+
+            // Lowest identifier first; tasks running at the same time share the threads
+            int task = ready.back();
+            ready.pop_back();
+            running++;
+            unsigned int share = std::max(1u, threads / static_cast<unsigned int>(running + ready.size()));
+            Phase &phase = report.phases[task];
+            phase.name = names[task];
+            phase.startMillis = elapsed();
+
+            lock.unlock();
+            unsigned long long checksum = 0;
+            std::exception_ptr error;
+            try {
+                checksum = work[task](share);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            lock.lock();
+
+            phase.millis = elapsed() - phase.startMillis;
+            phase.peakKilobytes = peakKilobytes();
+            phase.checksum = checksum;
+            running--;
+            finished++;
+            if (error && !failure) {
+                failure = error;
+            }
+            if (failure) {
+                // Nothing new starts after a failure; the tasks that never ran count as finished
+                finished += static_cast<int>(ready.size());
+                ready.clear();
+            } else {
+                for (int next: dependents[task]) {
+                    if (--waitingFor[next] == 0)
+                        ready.push_back(next);
+                }
+                std::sort(ready.begin(), ready.end(), std::greater<int>());
+            }
+            changed.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned int id = 1; id < threads; id++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &th: pool) {
+        th.join();
+    }
+
+    report.millis = elapsed();
+    report.peakKilobytes = peakKilobytes();
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    return report;
+}
+
+Preprocessing::Report Preprocessing::build(const Graph<LocationInfo> &graph, Indexes &indexes, unsigned int threads) {
+    using EdgeType = Edge<LocationInfo>::EdgeType;
+    const EdgeType modes[3] = {EdgeType::DEFAULT, EdgeType::DRIVING, EdgeType::WALKING};
+    const char *modeNames[3] = {"any mode", "driving", "walking"};
+
+    // Every task writes its own slot, and the slots are only read once every task has finished
+    TaskGraph tasks;
+    for (int m = 0; m < 3; m++) {
+        EdgeType mode = modes[m];
+        std::shared_ptr<const ContractedGraph> *slot = &indexes.contracted[m];
+        tasks.add(std::string("contraction, ") + modeNames[m], [&graph, slot, mode](unsigned int) {
+            *slot = ContractedGraph::build(graph, mode);
+            return (*slot)->getChecksum();
+        });
+    }
+    for (int m = 1; m < 3; m++) {
+        EdgeType mode = modes[m];
+        std::shared_ptr<const ArcFlags> *slot = &indexes.arcFlags[m];
+        tasks.add(std::string("arc flags, ") + modeNames[m], [&graph, slot, mode](unsigned int share) {
+            *slot = ArcFlags::compute(graph, mode, 32, share);
+            return (*slot)->getChecksum();
+        });
+    }
+    std::shared_ptr<const ParkingIndex> *parking = &indexes.parking;
+    tasks.add("parking index", [&graph, parking](unsigned int share) {
+        *parking = ParkingIndex::compute(graph, 16, 60, share);
+        return (*parking)->getChecksum();
+    });
+    for (int m = 1; m < 3 && graph.getNumVertex() <= AllPairsTable::MAX_PREPARED_VERTICES; m++) {
+        EdgeType mode = modes[m];
+        std::shared_ptr<const AllPairsTable> *slot = &indexes.allPairs[m];
+        tasks.add(std::string("all-pairs table, ") + modeNames[m], [&graph, slot, mode](unsigned int share) {
+            *slot = std::make_shared<const AllPairsTable>(AllPairsTable::compute(graph, mode, share));
+            return (*slot)->getChecksum();
+        });
+    }
+    for (int m = 0; m < 3 && graph.getNumVertex() >= DeltaStepping::MIN_PREPARED_VERTICES; m++) {
+        EdgeType mode = modes[m];
+        std::shared_ptr<const DeltaStepping> *slot = &indexes.deltaStepping[m];
+        tasks.add(std::string("delta-stepping, ") + modeNames[m], [&graph, slot, mode](unsigned int) {
+            *slot = DeltaStepping::compile(graph, mode);
+            return (*slot)->getChecksum();
+        });
+    }
+
+    return tasks.run(threads);
+}
+
+Preprocessing::Report Preprocessing::prepare(const Graph<LocationInfo> &graph, unsigned int threads) {
+    Indexes indexes;
+    Report report = build(graph, indexes, threads);
+    for (int m = 0; m < 3; m++) {
+        ContractedGraph::install(indexes.contracted[m]);
+    }
+    for (int m = 1; m < 3; m++) {
+        ArcFlags::install(indexes.arcFlags[m]);
+    }
+    ParkingIndex::install(indexes.parking);
+    for (int m = 1; m < 3; m++) {
+        if (indexes.allPairs[m])
+            AllPairsTable::install(indexes.allPairs[m]);
+    }
+    for (int m = 0; m < 3; m++) {
+        if (indexes.deltaStepping[m])
+            DeltaStepping::install(indexes.deltaStepping[m]);
+    }
+    return report;
+}
+
+void Preprocessing::printReport(const Report &report, std::ostream &out) {
+    char line[160];
+    std::snprintf(line, sizeof(line), "Preprocessing: %.2f ms on %u thread(s), peak memory %.1f MiB",
+                  report.millis, report.threads, report.peakKilobytes / 1024.0);
+    out << line << std::endl;
+    for (const auto &phase: report.phases) {
+        std::snprintf(line, sizeof(line), "  %-24s %9.2f ms  from %8.2f ms  peak %7.1f MiB  checksum %016llx",
+                      phase.name.c_str(), phase.millis, phase.startMillis, phase.peakKilobytes / 1024.0,
+                      phase.checksum);
+        out << line << std::endl;
+    }
+}
+
+long Preprocessing::peakKilobytes() {
+#ifdef __unix__
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return usage.ru_maxrss;
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,159 @@
+#ifndef PREPROCESSING_H
+#define PREPROCESSING_H
+
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "../graph_structure/Graph.h"
+#include "../graph_builder/GraphBuilder.h"
+
+class AllPairsTable;
+class ArcFlags;
+class ContractedGraph;
+class DeltaStepping;
+class ParkingIndex;
+class TravelTimeProfiles;
+
+/**
+ * @class Preprocessing
+ * @brief Builds the acceleration structures of a graph as a task graph run on a pool of threads
+ *
+ * Every structure is a task that only reads the graph and returns what it built; tasks whose
+ * dependencies are done run concurrently, and the ones that parallelise internally get a share
+ * of the threads. Every task fills its own slot of the result, so what Routing sees does not
+ * depend on the thread count or on which task finished first. Each task reports a checksum of
+ * its output, which makes that easy to verify.
+ */
+class Preprocessing {
+public:
+    /**
+     * @brief Timing and memory of one task
+     */
+    struct Phase {
+        std::string name; /**< Name of the task */
+        double startMillis = 0; /**< When the task started, after the start of the run */
+        double millis = 0; /**< How long the task ran */
+        long peakKilobytes = 0; /**< Peak resident memory of the process when the task ended */
+        unsigned long long checksum = 0; /**< Checksum of what the task built, 0 if it builds nothing */
+    };
+
+    /**
+     * @brief Timing and memory of a whole run
+     */
+    struct Report {
+        unsigned int threads = 0; /**< Threads of the pool */
+        double millis = 0; /**< Wall-clock time of the run */
+        long peakKilobytes = 0; /**< Peak resident memory of the process at the end */
+        std::vector<Phase> phases; /**< Every task, in the order they were added */
+    };
+
+    /**
+     * @brief The acceleration structures of one graph
+     */
+    struct Indexes {
+        std::shared_ptr<const ContractedGraph> contracted[3]; /**< Routing cores, by transport mode */
+        std::shared_ptr<const ArcFlags> arcFlags[3]; /**< Arc flags, by transport mode, none for DEFAULT */
+        std::shared_ptr<const ParkingIndex> parking; /**< Nearest parking locations by walking time */
+        std::shared_ptr<const AllPairsTable> allPairs[3]; /**< Travel-time tables, by transport mode, none for DEFAULT or large graphs */
+        std::shared_ptr<const DeltaStepping> deltaStepping[3]; /**< Parallel tree searches, by transport mode, none for small graphs */
+        std::shared_ptr<const TravelTimeProfiles> profiles; /**< Travel-time profiles, nullptr if none were loaded */
+    };
+
+    /**
+     * @brief Work of a task: receives its share of threads and returns a checksum of its output
+     */
+    using Task = std::function<unsigned long long(unsigned int threads)>;
+
+    /**
+     * @class TaskGraph
+     * @brief Tasks with dependencies, run by a fixed number of threads
+     */
+    class TaskGraph {
+    public:
+        /**
+         * @brief Adds a task
+         * @param name Name shown in the report
+         * @param work The work
+         * @param after Tasks that must finish first
+         * @return Identifier of the task, for later dependencies
+         * @details O(D) where D is the number of dependencies
+         */
+        int add(const std::string &name, const Task &work, const std::vector<int> &after = {});
+
+        /**
+         * @brief Runs every task once its dependencies are done
+         *
+         * If a task throws, tasks that have not started are skipped and the first exception is
+         * rethrown once the running ones finish.
+         *
+         * @param threads Threads of the pool, 0 to use every hardware thread
+         * @return The report
+         * @details O(W / T + N * T) where W is the total work, N the number of tasks and T the threads
+         */
+        Report run(unsigned int threads = 0) const;
+
+    private:
+        /** @brief Names of the tasks */
+        std::vector<std::string> names;
+
+        /** @brief Work of the tasks */
+        std::vector<Task> work;
+
+        /** @brief Tasks that wait for each task */
+        std::vector<std::vector<int> > dependents;
+
+        /** @brief Number of dependencies of each task */
+        std::vector<int> dependencyCount;
+    };
+
+    /**
+     * @brief Builds the contraction cores, arc flags, parking index, all-pairs tables and delta-stepping searches of a graph
+     *
+     * The all-pairs tables are only built for graphs of up to AllPairsTable::MAX_PREPARED_VERTICES
+     * vertices, the delta-stepping searches for graphs of at least
+     * DeltaStepping::MIN_PREPARED_VERTICES. Nothing is registered: the caller owns the structures, as GraphSnapshot does. Profiles
+     * are not built here and are left as they were.
+     *
+     * @param graph The transportation graph
+     * @param indexes Receives the structures
+     * @param threads Threads of the pool, 0 to use every hardware thread
+     * @return The report
+     * @details O(V^2 + B * E log V / T + P * E log V / T + V^3 / T) where B is the number of
+     * boundary vertices and P the number of parking locations
+     */
+    static Report build(const Graph<LocationInfo> &graph, Indexes &indexes, unsigned int threads = 0);
+
+    /**
+     * @brief Builds the structures of build for a graph and registers them
+     *
+     * Replaces calling ContractedGraph::prepare, ArcFlags::prepare and ParkingIndex::prepare
+     * one after another; the registered structures are the same, plus the all-pairs tables and
+     * delta-stepping searches.
+     * Meant for graphs that no GraphSnapshot owns.
+     *
+     * @param graph The transportation graph
+     * @param threads Threads of the pool, 0 to use every hardware thread
+     * @return The report
+     * @details See build
+     */
+    static Report prepare(const Graph<LocationInfo> &graph, unsigned int threads = 0);
+
+    /**
+     * @brief Prints a report, one line per task
+     * @param report The report
+     * @param out Stream to print to
+     * @details O(N) where N is the number of tasks
+     */
+    static void printReport(const Report &report, std::ostream &out);
+
+    /**
+     * @brief Gets the peak resident memory of the process
+     * @return Peak in kilobytes, 0 where the platform does not tell
+     * @details O(1)
+     */
+    static long peakKilobytes();
+};
+
+#endif // PREPROCESSING_H
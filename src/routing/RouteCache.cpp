@@ -0,0 +1,281 @@
+#include "RouteCache.h"
+#include <thread>
+#include <utility>
+#include "../parse_data/DataManager.h"
+
+const size_t RouteCache::SHARD_COUNT;
+const size_t RouteCache::SLOT_COUNT;
+const size_t RouteCache::PROBE_WINDOW;
+
+RouteCache::RouteCache() : shards(new Shard[SHARD_COUNT]), budget(64 << 20), dataVersion(0) {
+}
+
+RouteCache *RouteCache::getInstance() {
+    static RouteCache *instance = new RouteCache();
+    return instance;
+}
+
+RouteCache::Key RouteCache::makeKey(const Graph<LocationInfo> &graph,
+                                    Kind kind,
+                                    const std::string &source,
+                                    const std::string &dest,
+                                    Edge<LocationInfo>::EdgeType transportMode,
+                                    const RouteRestrictions::AvoidLists &avoided,
+                                    double maxWalkingTime) {
+    const auto &vertices = graph.getVertexSet();
+    return Key{vertices.empty() ? nullptr : vertices[0], graph.getNumVertex(), kind, transportMode,
+               source, dest, RouteRestrictions::fingerprint(avoided), avoided, maxWalkingTime};
+}
+
+unsigned long long RouteCache::hashKey(const Key &key) {
+    unsigned long long hash = 14695981039346656037ULL;
+    auto mix = [&hash](unsigned long long value) {
+        for (int i = 0; i < 8; i++) {
+            hash ^= (value >> (i * 8)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    };
+    auto mixString = [&hash](const std::string &text) {
+        for (char c: text) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        hash ^= 0xff; // keeps "ab"+"c" apart from "a"+"bc"
+        hash *= 1099511628211ULL;
+    };
+    mix(reinterpret_cast<unsigned long long>(key.graph));
+    mix(static_cast<unsigned long long>(key.vertexCount));
+    mix(static_cast<unsigned long long>(key.kind) * 4 + static_cast<unsigned long long>(key.transportMode));
+    mix(key.restrictions);
+    mix(static_cast<unsigned long long>(key.maxWalkingTime * 1024));
+    mixString(key.source);
+    mixString(key.dest);
+    return hash == 0 ? 1 : hash;
+}
+
+size_t RouteCache::valueBytes(const Value &value) {
+    auto routeBytes = [](const Routing::Route &route) {
+        size_t bytes = route.locations.capacity() * sizeof(LocationInfo) +
+                       route.edges.capacity() * sizeof(Edge<LocationInfo> *) +
+                       route.times.capacity() * sizeof(double);
+        for (const auto &location: route.locations) {
+            bytes += location.name.capacity() + location.code.capacity();
+        }
+        return bytes;
+    };
+
+    size_t bytes = sizeof(Entry) + routeBytes(value.route) + value.ecoRoutes.capacity() * sizeof(Routing::EcoRoute);
+    for (const auto &eco: value.ecoRoutes) {
+        bytes += routeBytes(eco.drivingRoute) + routeBytes(eco.walkingRoute) + eco.errorMessage.capacity();
+    }
+    return bytes;
+}
+
+unsigned long RouteCache::checkDataVersion() {
+    unsigned long current = DataManager::getInstance()->getDataVersion();
+    unsigned long seen = dataVersion.load();
+    // Entries inserted after the swap but before the clear reaches their shard are dropped too, which is harmless
+    if (seen != current && dataVersion.compare_exchange_strong(seen, current)) {
+        clear();
+    }
+    return current;
+}
+
+bool RouteCache::find(const Key &key, Value &value) {
+    if (budget.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+    checkDataVersion();
+
+    unsigned long long hash = hashKey(key);
+    Shard &shard = shards[hash & (SHARD_COUNT - 1)];
+
+    // Register on the counter of the current epoch; retry if a writer moved on meanwhile
+    unsigned long epoch;
+    while (true) {
+        epoch = shard.epoch.load();
+        shard.readers[epoch & 1]++;
+        if (shard.epoch.load() == epoch)
+            break;
+        shard.readers[epoch & 1]--;
+    }
+
+    bool hit = false;
+    size_t home = static_cast<size_t>(hash / SHARD_COUNT);
+    for (size_t probe = 0; probe < PROBE_WINDOW && !hit; probe++) {
+        Slot &slot = shard.slots[(home + probe) & (SLOT_COUNT - 1)];
+        if (slot.hash.load(std::memory_order_acquire) != hash)
+            continue;
+        const Entry *entry = slot.entry.load(std::memory_order_acquire);
+        if (entry != nullptr && entry->hash == hash && entry->key == key) {
+            if (!slot.referenced.load(std::memory_order_relaxed))
+                slot.referenced.store(true, std::memory_order_relaxed);
+            value = entry->value;
+            hit = true;
+        }
+    }
+
+    shard.readers[epoch & 1]--;
+    (hit ? shard.hits : shard.misses).fetch_add(1, std::memory_order_relaxed);
+    return hit;
+}
+
+void RouteCache::insert(const Key &key, Value value) {
+    size_t limit = budget.load(std::memory_order_relaxed) / SHARD_COUNT;
+    if (limit == 0) {
+        return;
+    }
+    unsigned long version = checkDataVersion();
+
+    std::unique_ptr<Entry> created(new Entry{key, std::move(value), hashKey(key), 0});
+    created->bytes = valueBytes(created->value) + key.avoided.nodes.capacity() * sizeof(int) +
+                     key.avoided.segments.capacity() * sizeof(std::pair<int, int>);
+    if (created->bytes > limit) {
+        return;
+    }
+
+    Shard &shard = shards[created->hash & (SHARD_COUNT - 1)];
+    std::vector<const Entry *> retired;
+    {
+        std::lock_guard<std::mutex> lock(shard.writeMutex);
+        // A new dataset since the answer was computed; the clear it causes may already be past this shard
+        if (dataVersion.load() != version) {
+            return;
+        }
+
+        auto unlink = [&shard, &retired](Slot &slot) {
+            const Entry *old = slot.entry.load(std::memory_order_relaxed);
+            slot.hash.store(0, std::memory_order_release);
+            slot.entry.store(nullptr, std::memory_order_release);
+            shard.entries--;
+            shard.memoryBytes -= old->bytes;
+            retired.push_back(old);
+        };
+
+        // The same key if it is there, else an empty slot, else the window's first unreferenced slot
+        size_t home = static_cast<size_t>(created->hash / SHARD_COUNT);
+        Slot *target = nullptr;
+        Slot *empty = nullptr;
+        for (size_t probe = 0; probe < PROBE_WINDOW; probe++) {
+            Slot &slot = shard.slots[(home + probe) & (SLOT_COUNT - 1)];
+            const Entry *entry = slot.entry.load(std::memory_order_relaxed);
+            if (entry == nullptr) {
+                if (empty == nullptr)
+                    empty = &slot;
+            } else if (entry->hash == created->hash && entry->key == key) {
+                target = &slot;
+                break;
+            }
+        }
+        if (target == nullptr)
+            target = empty;
+        for (size_t probe = 0; target == nullptr; probe = (probe + 1) % PROBE_WINDOW) {
+            Slot &slot = shard.slots[(home + probe) & (SLOT_COUNT - 1)];
+            if (!slot.referenced.exchange(false, std::memory_order_relaxed)) {
+                target = &slot;
+                shard.evictions++;
+            }
+        }
+        if (target->entry.load(std::memory_order_relaxed) != nullptr) {
+            unlink(*target);
+        }
+
+        shard.entries++;
+        shard.memoryBytes += created->bytes;
+        target->referenced.store(true, std::memory_order_relaxed);
+        target->entry.store(created.get(), std::memory_order_release);
+        target->hash.store(created->hash, std::memory_order_release);
+        const Entry *published = created.release();
+
+        // CLOCK over the whole shard until it fits its share of the budget
+        while (shard.memoryBytes.load() > limit) {
+            Slot &slot = shard.slots[shard.hand];
+            shard.hand = (shard.hand + 1) & (SLOT_COUNT - 1);
+            const Entry *entry = slot.entry.load(std::memory_order_relaxed);
+            if (entry == nullptr || entry == published)
+                continue;
+            if (!slot.referenced.exchange(false, std::memory_order_relaxed)) {
+                unlink(slot);
+                shard.evictions++;
+            }
+        }
+
+        if (!retired.empty()) {
+            waitForReaders(shard);
+        }
+    }
+    for (auto entry: retired) {
+        delete entry;
+    }
+}
+
+void RouteCache::waitForReaders(Shard &shard) {
+    // Lookups that start from now on register on the other counter and cannot find the unlinked entries
+    unsigned long epoch = shard.epoch.load();
+    shard.epoch.store(epoch + 1);
+    while (shard.readers[epoch & 1].load() != 0) {
+        std::this_thread::yield();
+    }
+}
+
+template<typename Drop>
+size_t RouteCache::dropWhere(Shard &shard, const Drop &drop) {
+    std::vector<const Entry *> retired;
+    {
+        std::lock_guard<std::mutex> lock(shard.writeMutex);
+        for (auto &slot: shard.slots) {
+            const Entry *entry = slot.entry.load(std::memory_order_relaxed);
+            if (entry == nullptr || !drop(*entry))
+                continue;
+            slot.hash.store(0, std::memory_order_release);
+            slot.entry.store(nullptr, std::memory_order_release);
+            shard.entries--;
+            shard.memoryBytes -= entry->bytes;
+            retired.push_back(entry);
+        }
+        if (!retired.empty()) {
+            waitForReaders(shard);
+        }
+    }
+    for (auto entry: retired) {
+        delete entry;
+    }
+    return retired.size();
+}
+
+size_t RouteCache::forget(const Graph<LocationInfo> &graph) {
+    const auto &vertices = graph.getVertexSet();
+    const Vertex<LocationInfo> *first = vertices.empty() ? nullptr : vertices[0];
+    int vertexCount = graph.getNumVertex();
+    size_t dropped = 0;
+    for (size_t s = 0; s < SHARD_COUNT; s++) {
+        dropped += dropWhere(shards[s], [first, vertexCount](const Entry &entry) {
+            return entry.key.graph == first && entry.key.vertexCount == vertexCount;
+        });
+    }
+    return dropped;
+}
+
+void RouteCache::clear() {
+    for (size_t s = 0; s < SHARD_COUNT; s++) {
+        dropWhere(shards[s], [](const Entry &) { return true; });
+    }
+}
+
+void RouteCache::setBudget(size_t bytes) {
+    budget = bytes;
+    clear();
+}
+
+RouteCache::Stats RouteCache::getStats() const {
+    Stats stats;
+    for (size_t s = 0; s < SHARD_COUNT; s++) {
+        const Shard &shard = shards[s];
+        stats.hits += shard.hits.load(std::memory_order_relaxed);
+        stats.misses += shard.misses.load(std::memory_order_relaxed);
+        stats.evictions += shard.evictions.load(std::memory_order_relaxed);
+        stats.entries += shard.entries.load(std::memory_order_relaxed);
+        stats.memoryBytes += shard.memoryBytes.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
@@ -0,0 +1,289 @@
+#ifndef ROUTECACHE_H
+#define ROUTECACHE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../graph_structure/Graph.h"
+#include "../graph_builder/GraphBuilder.h"
+#include "Routing.h"
+#include "RouteRestrictions.h"
+
+/**
+ * @class RouteCache
+ * @brief Concurrent cache of answered route queries, in front of the Routing entry points
+ *
+ * A query is keyed by its graph, kind, endpoints, transport mode, its avoid lists in
+ * RouteRestrictions canonical form (sorted, so the order they were given in does not matter)
+ * and its walking limit. The lists are hashed by their fingerprint and compared in full on a
+ * hit. Repeated queries are answered by one hash lookup instead of a search.
+ *
+ * Keys are spread over shards by hash. Each shard is a small open-addressing table whose
+ * entries are immutable once published: lookups never lock, they announce themselves on one
+ * of two per-shard counters, and a writer that unlinks entries frees them only after the
+ * readers that might still see them have left (a grace period, as in RCU). Writers of a shard
+ * take its lock. Every shard keeps its share of a memory budget by CLOCK eviction.
+ *
+ * The cache clears itself when DataManager loads a new dataset, and GraphSnapshot drops the
+ * routes of a graph it frees. LiveTraffic never changes a graph, it publishes a copy, so routes
+ * of the old graph can never answer a query on the new one.
+ */
+class RouteCache {
+public:
+    /**
+     * @brief Usage counters of the cache
+     */
+    struct Stats {
+        unsigned long hits = 0; /**< Lookups answered from the cache */
+        unsigned long misses = 0; /**< Lookups that had to search */
+        unsigned long evictions = 0; /**< Entries evicted to stay within the budget */
+        size_t entries = 0; /**< Entries currently stored */
+        size_t memoryBytes = 0; /**< Approximate memory used by the stored entries */
+
+        /**
+         * @brief Fraction of lookups answered from the cache
+         * @return Hit rate between 0 and 1
+         * @details O(1)
+         */
+        double hitRate() const {
+            return hits + misses == 0 ? 0 : static_cast<double>(hits) / (hits + misses);
+        }
+    };
+
+    /**
+     * @brief Entry point a query was answered by
+     */
+    enum class Kind {
+        FASTEST, /**< Routing::findFastestRoute */
+        RESTRICTED, /**< Routing::findRouteWithRestrictions */
+        ECO, /**< Routing::findEnvironmentallyFriendlyRoute */
+        APPROXIMATE_ECO /**< Routing::findApproximateEcoRoutes */
+    };
+
+    /**
+     * @brief Canonical form of a query
+     */
+    struct Key {
+        const Vertex<LocationInfo> *graph; /**< First vertex of the graph, which identifies it */
+        int vertexCount; /**< Number of vertices of the graph */
+        Kind kind; /**< Entry point */
+        Edge<LocationInfo>::EdgeType transportMode; /**< Transport mode, DEFAULT for eco queries */
+        std::string source; /**< Source location code */
+        std::string dest; /**< Destination location code */
+        unsigned long long restrictions; /**< RouteRestrictions fingerprint of avoided, compared first */
+        RouteRestrictions::AvoidLists avoided; /**< The avoid lists, in canonical form */
+        double maxWalkingTime; /**< Walking limit of eco queries, 0 otherwise */
+
+        bool operator==(const Key &other) const {
+            return graph == other.graph && vertexCount == other.vertexCount && kind == other.kind &&
+                   transportMode == other.transportMode && restrictions == other.restrictions &&
+                   maxWalkingTime == other.maxWalkingTime && source == other.source && dest == other.dest &&
+                   avoided == other.avoided;
+        }
+    };
+
+    /**
+     * @brief Answer of a query; only the field of the query's kind is filled
+     */
+    struct Value {
+        Routing::Route route; /**< Route of FASTEST and RESTRICTED queries */
+        std::vector<Routing::EcoRoute> ecoRoutes; /**< The route of ECO queries, the routes of APPROXIMATE_ECO ones */
+    };
+
+    /**
+     * @brief Builds the key of a query
+     * @param graph The transportation graph
+     * @param kind Entry point
+     * @param source Source location code
+     * @param dest Destination location code
+     * @param transportMode Transport mode, DEFAULT for eco queries
+     * @param avoided The avoid lists, in canonical form
+     * @param maxWalkingTime Walking limit of eco queries
+     * @return The key
+     * @details O(A) where A is the length of the avoid lists
+     */
+    static Key makeKey(const Graph<LocationInfo> &graph,
+                       Kind kind,
+                       const std::string &source,
+                       const std::string &dest,
+                       Edge<LocationInfo>::EdgeType transportMode,
+                       const RouteRestrictions::AvoidLists &avoided = RouteRestrictions::AvoidLists(),
+                       double maxWalkingTime = 0);
+
+    /**
+     * @brief Gets the singleton instance of the cache
+     * @return Pointer to the cache instance
+     * @details O(1)
+     */
+    static RouteCache *getInstance();
+
+    /**
+     * @brief Looks up a query, without locking
+     * @param key The query
+     * @param value Receives a copy of the answer on a hit
+     * @return True on a hit
+     * @details O(1) plus the copy of the answer
+     */
+    bool find(const Key &key, Value &value);
+
+    /**
+     * @brief Stores the answer of a query, evicting entries of its shard to stay within the budget
+     *
+     * Waits for the lookups that may still read an evicted entry before freeing it.
+     *
+     * @param key The query
+     * @param value The answer
+     * @details O(1) amortised, plus the wait for readers of the shard
+     */
+    void insert(const Key &key, Value value);
+
+    /**
+     * @brief Drops every entry of a graph
+     * @param graph The graph
+     * @return Number of entries dropped
+     * @details O(S) where S is the number of slots
+     */
+    size_t forget(const Graph<LocationInfo> &graph);
+
+    /**
+     * @brief Drops every entry
+     * @details O(S) where S is the number of slots
+     */
+    void clear();
+
+    /**
+     * @brief Sets the memory budget and drops every entry
+     * @param bytes Approximate memory the entries may use; 0 disables the cache
+     * @details O(S) where S is the number of slots
+     */
+    void setBudget(size_t bytes);
+
+    /**
+     * @brief Gets the usage counters
+     * @return A snapshot of the counters
+     * @details O(H) where H is the number of shards
+     */
+    Stats getStats() const;
+
+private:
+    /** @brief Number of shards, a power of two */
+    static const size_t SHARD_COUNT = 64;
+
+    /** @brief Slots per shard, a power of two */
+    static const size_t SLOT_COUNT = 512;
+
+    /** @brief Consecutive slots a key may occupy, starting at its home slot */
+    static const size_t PROBE_WINDOW = 8;
+
+    /**
+     * @brief A stored answer, never changed after it is published
+     */
+    struct Entry {
+        Key key;
+        Value value;
+        unsigned long long hash;
+        size_t bytes;
+    };
+
+    /**
+     * @brief One place in a shard's table
+     */
+    struct Slot {
+        std::atomic<unsigned long long> hash{0}; /**< Hash of the entry, 0 if empty; only a filter */
+        std::atomic<const Entry *> entry{nullptr}; /**< The entry, nullptr if empty */
+        std::atomic<bool> referenced{false}; /**< CLOCK bit, set by lookups */
+    };
+
+    /**
+     * @brief A table with its own writer lock, reader counters and counters
+     */
+    struct Shard {
+        Slot slots[SLOT_COUNT];
+
+        /** @brief Grace-period number; readers register on the counter of its parity */
+        std::atomic<unsigned long> epoch{0};
+
+        /** @brief Lookups in progress, by parity of the epoch they started in */
+        std::atomic<long> readers[2];
+
+        /** @brief Serialises writers */
+        std::mutex writeMutex;
+
+        /** @brief Position of the CLOCK hand, guarded by writeMutex */
+        size_t hand = 0;
+
+        std::atomic<unsigned long> hits{0};
+        std::atomic<unsigned long> misses{0};
+        std::atomic<unsigned long> evictions{0};
+        std::atomic<size_t> entries{0};
+        std::atomic<size_t> memoryBytes{0};
+
+        Shard() {
+            readers[0] = 0;
+            readers[1] = 0;
+        }
+    };
+
+    /** @brief The shards */
+    std::unique_ptr<Shard[]> shards;
+
+    /** @brief Memory budget of the whole cache, 0 when disabled */
+    std::atomic<size_t> budget;
+
+    /** @brief Data version the stored entries were computed from */
+    std::atomic<unsigned long> dataVersion;
+
+    /**
+     * @brief Private constructor (singleton pattern)
+     * @details O(S) where S is the number of slots
+     */
+    RouteCache();
+
+    /**
+     * @brief Clears the cache if DataManager has loaded a new dataset since the last call
+     *
+     * The version is moved on by compare-and-swap, so only one caller clears for each new
+     * dataset; insert checks it again under the shard lock before publishing.
+     *
+     * @return The data version the cache now holds entries of
+     * @details O(1), O(S) when the cache is cleared
+     */
+    unsigned long checkDataVersion();
+
+    /**
+     * @brief Unlinks the entries of a shard that match a predicate and frees them after a grace period
+     * @param shard The shard
+     * @param drop The predicate
+     * @return Number of entries dropped
+     * @details O(S / H) plus the wait for readers of the shard
+     */
+    template<typename Drop>
+    static size_t dropWhere(Shard &shard, const Drop &drop);
+
+    /**
+     * @brief Waits until no lookup that started before the call is still reading the shard
+     * @param shard The shard, whose writer lock the caller holds
+     * @details O(R) where R is the length of the longest lookup in progress
+     */
+    static void waitForReaders(Shard &shard);
+
+    /**
+     * @brief Hashes a key, never to 0
+     * @param key The key
+     * @return The hash
+     * @details O(L) where L is the length of the location codes
+     */
+    static unsigned long long hashKey(const Key &key);
+
+    /**
+     * @brief Approximate memory used by one answer
+     * @param value The answer
+     * @return Size in bytes
+     * @details O(N) where N is the number of locations on its routes
+     */
+    static size_t valueBytes(const Value &value);
+};
+
+#endif // ROUTECACHE_H
@@ -0,0 +1,107 @@
+#include "RouteRestrictions.h"
+#include <algorithm>
+#include <unordered_map>
+
+RouteRestrictions::RouteRestrictions(Edge<LocationInfo>::EdgeType transportMode)
+    : transportMode(transportMode) {
+}
+
+RouteRestrictions RouteRestrictions::compile(
+    const Graph<LocationInfo> &graph,
+    const std::vector<int> &avoidNodes,
+    const std::vector<std::pair<int, int> > &avoidSegments,
+    Edge<LocationInfo>::EdgeType transportMode) {
+    RouteRestrictions restrictions(transportMode);
+    restrictions.avoidLists = canonical(avoidNodes, avoidSegments);
+    restrictions.restrictionFingerprint = hash(restrictions.avoidLists);
+
+    if (restrictions.restrictionFingerprint == 0) {
+        return restrictions;
+    }
+
+    std::unordered_map<int, int> idToIndex;
+    for (auto v: graph.getVertexSet()) {
+        idToIndex[v->getInfo().id] = v->getIndex();
+    }
+
+    if (!avoidNodes.empty()) {
+        restrictions.avoidVertex.assign(graph.getNumVertex(), false);
+        for (int id: avoidNodes) {
+            auto it = idToIndex.find(id);
+            if (it != idToIndex.end()) {
+                restrictions.avoidVertex[it->second] = true;
+            }
+        }
+    }
+
+    if (!avoidSegments.empty()) {
+        restrictions.segmentEnd.assign(graph.getNumVertex(), false);
+        for (const auto &segment: avoidSegments) {
+            auto first = idToIndex.find(segment.first);
+            auto second = idToIndex.find(segment.second);
+            if (first == idToIndex.end() || second == idToIndex.end())
+                continue;
+
+            restrictions.segmentEnd[first->second] = true;
+            restrictions.segmentEnd[second->second] = true;
+            restrictions.avoidSegmentKeys.insert(segmentKey(first->second, second->second));
+        }
+    }
+
+    return restrictions;
+}
+
+unsigned long long RouteRestrictions::fingerprint(
+    const std::vector<int> &avoidNodes,
+    const std::vector<std::pair<int, int> > &avoidSegments) {
+    if (avoidNodes.empty() && avoidSegments.empty()) {
+        return 0;
+    }
+    return hash(canonical(avoidNodes, avoidSegments));
+}
+
+unsigned long long RouteRestrictions::fingerprint(const AvoidLists &lists) {
+    return hash(lists);
+}
+
+RouteRestrictions::AvoidLists RouteRestrictions::canonical(
+    const std::vector<int> &avoidNodes,
+    const std::vector<std::pair<int, int> > &avoidSegments) {
+    AvoidLists lists;
+    lists.nodes = avoidNodes;
+    std::sort(lists.nodes.begin(), lists.nodes.end());
+    lists.nodes.erase(std::unique(lists.nodes.begin(), lists.nodes.end()), lists.nodes.end());
+
+    for (const auto &segment: avoidSegments) {
+        lists.segments.emplace_back(std::min(segment.first, segment.second), std::max(segment.first, segment.second));
+    }
+    std::sort(lists.segments.begin(), lists.segments.end());
+    lists.segments.erase(std::unique(lists.segments.begin(), lists.segments.end()), lists.segments.end());
+    return lists;
+}
+
+unsigned long long RouteRestrictions::hash(const AvoidLists &lists) {
+    if (lists.nodes.empty() && lists.segments.empty()) {
+        return 0;
+    }
+
+    // FNV-1a over the canonical lists; the separator keeps the two lists from aliasing
+    unsigned long long hash = 14695981039346656037ULL;
+    auto mix = [&hash](long long value) {
+        for (int i = 0; i < 8; i++) {
+            hash ^= static_cast<unsigned long long>(value >> (i * 8)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    for (int node: lists.nodes) {
+        mix(node);
+    }
+    mix(-1);
+    for (const auto &segment: lists.segments) {
+        mix(segment.first);
+        mix(segment.second);
+    }
+
+    return hash == 0 ? 1 : hash;
+}
@@ -0,0 +1,195 @@
+#ifndef ROUTERESTRICTIONS_H
+#define ROUTERESTRICTIONS_H
+
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "../graph_structure/Graph.h"
+#include "../graph_builder/GraphBuilder.h"
+
+/**
+ * @class RouteRestrictions
+ * @brief Routing restrictions compiled for constant-time checks during a search
+ *
+ * Avoided locations become a bitset over vertex indices and avoided segments become a hash
+ * set of packed vertex index pairs, guarded by a per-vertex bitset so that most edges never
+ * reach the hash lookup. Checking an edge therefore costs the same no matter how long the
+ * avoid lists are. An avoided location is neither entered nor left, so a search rooted at
+ * an avoided location reaches nothing else.
+ */
+class RouteRestrictions {
+public:
+    /**
+     * @brief Avoid lists in canonical form, so that equal lists compare equal whatever their order
+     */
+    struct AvoidLists {
+        std::vector<int> nodes; /**< IDs of avoided locations, sorted, without duplicates */
+        std::vector<std::pair<int, int> > segments; /**< Avoided segments, lower ID first, sorted, without duplicates */
+
+        bool operator==(const AvoidLists &other) const {
+            return nodes == other.nodes && segments == other.segments;
+        }
+    };
+
+    /**
+     * @brief Creates restrictions that only filter by transport mode
+     * @param transportMode Transport mode to filter for, DEFAULT accepts every mode
+     * @details O(1)
+     */
+    explicit RouteRestrictions(
+        Edge<LocationInfo>::EdgeType transportMode = Edge<LocationInfo>::EdgeType::DEFAULT);
+
+    /**
+     * @brief Compiles avoid lists against a graph
+     * @param graph The graph the restrictions will be used on
+     * @param avoidNodes IDs of locations to avoid
+     * @param avoidSegments Pairs of location IDs whose segment must not be used, in either direction
+     * @param transportMode Transport mode to filter for, DEFAULT accepts every mode
+     * @return The compiled restrictions; unknown IDs are ignored
+     * @details O(V + A + S) where A and S are the sizes of the avoid lists
+     */
+    static RouteRestrictions compile(
+        const Graph<LocationInfo> &graph,
+        const std::vector<int> &avoidNodes,
+        const std::vector<std::pair<int, int> > &avoidSegments,
+        Edge<LocationInfo>::EdgeType transportMode);
+
+    /**
+     * @brief Computes an order-independent fingerprint of a set of avoid lists
+     * @param avoidNodes Nodes to avoid
+     * @param avoidSegments Segments to avoid, in either direction
+     * @return 0 for no restrictions, a hash of the sorted lists otherwise
+     * @details O((A + S) log(A + S)) where A and S are the list sizes
+     */
+    static unsigned long long fingerprint(
+        const std::vector<int> &avoidNodes,
+        const std::vector<std::pair<int, int> > &avoidSegments);
+
+    /**
+     * @brief Computes the fingerprint of avoid lists already in canonical form
+     * @param lists The canonical lists
+     * @return 0 for no restrictions, a hash of the lists otherwise
+     * @details O(A + S) where A and S are the list sizes
+     */
+    static unsigned long long fingerprint(const AvoidLists &lists);
+
+    /**
+     * @brief Puts avoid lists in canonical form
+     * @param avoidNodes Nodes to avoid
+     * @param avoidSegments Segments to avoid, in either direction
+     * @return The canonical lists
+     * @details O((A + S) log(A + S)) where A and S are the list sizes
+     */
+    static AvoidLists canonical(
+        const std::vector<int> &avoidNodes,
+        const std::vector<std::pair<int, int> > &avoidSegments);
+
+    /**
+     * @brief Checks whether a search may use an edge
+     * @param edge The edge to check
+     * @return True if the edge has the right mode and touches no avoided location or segment
+     * @details O(1)
+     */
+    bool allows(const Edge<LocationInfo> *edge) const {
+        if (transportMode != Edge<LocationInfo>::EdgeType::DEFAULT && edge->getType() != transportMode) {
+            return false;
+        }
+        return allowsEndpoints(edge);
+    }
+
+    /**
+     * @brief Checks an edge against the avoid lists only, for callers that check the mode themselves
+     * @param edge The edge to check
+     * @return True if the edge touches no avoided location or segment
+     * @details O(1)
+     */
+    bool allowsEndpoints(const Edge<LocationInfo> *edge) const {
+        int orig = edge->getOrig()->getIndex();
+        int dest = edge->getDest()->getIndex();
+
+        if (!avoidVertex.empty() && (avoidVertex[orig] || avoidVertex[dest])) {
+            return false;
+        }
+
+        return avoidSegmentKeys.empty() || !segmentEnd[orig] || !avoidSegmentKeys.count(segmentKey(orig, dest));
+    }
+
+    /**
+     * @brief Checks whether a location is avoided
+     * @param index Vertex index of the location
+     * @return True if the location must not be used
+     * @details O(1)
+     */
+    bool avoids(int index) const {
+        return !avoidVertex.empty() && avoidVertex[index];
+    }
+
+    /**
+     * @brief Gets the transport mode the restrictions filter for
+     * @return The transport mode
+     * @details O(1)
+     */
+    Edge<LocationInfo>::EdgeType getTransportMode() const {
+        return transportMode;
+    }
+
+    /**
+     * @brief Gets the fingerprint of the avoid lists the restrictions were compiled from
+     * @return 0 if nothing is avoided
+     * @details O(1)
+     */
+    unsigned long long getFingerprint() const {
+        return restrictionFingerprint;
+    }
+
+    /**
+     * @brief Gets the avoid lists the restrictions were compiled from, in canonical form
+     * @return The lists, empty if nothing is avoided
+     * @details O(1)
+     */
+    const AvoidLists &getAvoidLists() const {
+        return avoidLists;
+    }
+
+private:
+    /** @brief Transport mode edges must have */
+    Edge<LocationInfo>::EdgeType transportMode;
+
+    /** @brief Avoided locations by vertex index, empty if none */
+    std::vector<bool> avoidVertex;
+
+    /** @brief Vertices that are an end of some avoided segment */
+    std::vector<bool> segmentEnd;
+
+    /** @brief Avoided segments packed by segmentKey */
+    std::unordered_set<unsigned long long> avoidSegmentKeys;
+
+    /** @brief Fingerprint of the source avoid lists */
+    unsigned long long restrictionFingerprint = 0;
+
+    /** @brief The source avoid lists in canonical form */
+    AvoidLists avoidLists;
+
+    /**
+     * @brief Hashes canonical avoid lists
+     * @param lists The lists
+     * @return 0 if both lists are empty, a non-zero hash otherwise
+     * @details O(A + S)
+     */
+    static unsigned long long hash(const AvoidLists &lists);
+
+    /**
+     * @brief Packs an undirected segment into one key
+     * @param a Vertex index of one end
+     * @param b Vertex index of the other end
+     * @return The same key for (a, b) and (b, a)
+     * @details O(1)
+     */
+    static unsigned long long segmentKey(int a, int b) {
+        unsigned long long low = static_cast<unsigned int>(a < b ? a : b);
+        unsigned long long high = static_cast<unsigned int>(a < b ? b : a);
+        return high << 32 | low;
+    }
+};
+
+#endif // ROUTERESTRICTIONS_H
@@ -7,127 +7,561 @@
 #include "Routing.h"
 
 #include <vector>
+#include <queue>
+#include <thread>
+#include <atomic>
 #include <unordered_set>
 #include <map>
-#include "../graph_structure/MutablePriorityQueue.h"
+#include "SearchTreeCache.h"
+#include "RouteCache.h"
+#include "AllPairsTable.h"
+#include "ArcFlags.h"
+#include "ContractedGraph.h"
+#include "DeltaStepping.h"
+#include "GraphSnapshot.h"
+#include "ParkingIndex.h"
+#include "SearchKernels.h"
+#include "TravelTimeProfiles.h"
+#include "WorkStealing.h"
+
+/**
+ * @brief Gets the routing core of a graph: the one of the snapshot owning it, else the registered one
+ * @param graph The transportation graph
+ * @param transportMode The transport mode
+ * @return The core, or nullptr if there is none
+ * @details O(1), O(S) for a graph of an unpublished snapshot
+ */
+static std::shared_ptr<const ContractedGraph> findCore(
+    const Graph<LocationInfo> &graph,
+    Edge<LocationInfo>::EdgeType transportMode) {
+    GraphSnapshot::Handle snapshot = GraphSnapshot::owning(graph);
+    if (snapshot) {
+        return snapshot->getIndexes().contracted[static_cast<int>(transportMode)];
+    }
+    return ContractedGraph::find(graph, transportMode);
+}
 
-bool Routing::relax(Edge<LocationInfo> *edge) {
-    if (edge->getOrig()->getDist() + edge->getWeight() < edge->getDest()->getDist()) {
-        edge->getDest()->setDist(edge->getOrig()->getDist() + edge->getWeight());
-        edge->getDest()->setPath(edge);
-        return true;
+/**
+ * @brief Gets the arc flags of a graph: the ones of the snapshot owning it, else the registered ones
+ * @param graph The transportation graph
+ * @param transportMode The transport mode
+ * @return The index, or nullptr if there is none
+ * @details O(1), O(S) for a graph of an unpublished snapshot
+ */
+static std::shared_ptr<const ArcFlags> findArcFlags(
+    const Graph<LocationInfo> &graph,
+    Edge<LocationInfo>::EdgeType transportMode) {
+    GraphSnapshot::Handle snapshot = GraphSnapshot::owning(graph);
+    if (snapshot) {
+        return snapshot->getIndexes().arcFlags[static_cast<int>(transportMode)];
     }
-    return false;
+    return ArcFlags::find(graph, transportMode);
+}
+
+/**
+ * @brief Gets the all-pairs table of a graph: the one of the snapshot owning it, else the registered one
+ * @param graph The transportation graph
+ * @param transportMode The transport mode
+ * @return The table, or nullptr if there is none
+ * @details O(1), O(S) for a graph of an unpublished snapshot
+ */
+static std::shared_ptr<const AllPairsTable> findAllPairs(
+    const Graph<LocationInfo> &graph,
+    Edge<LocationInfo>::EdgeType transportMode) {
+    GraphSnapshot::Handle snapshot = GraphSnapshot::owning(graph);
+    if (snapshot) {
+        return snapshot->getIndexes().allPairs[static_cast<int>(transportMode)];
+    }
+    return AllPairsTable::find(graph, transportMode);
+}
+
+/**
+ * @brief Gets the delta-stepping search of a graph: the one of the snapshot owning it, else the registered one
+ * @param graph The transportation graph
+ * @param transportMode The transport mode
+ * @return The search, or nullptr if there is none
+ * @details O(1), O(S) for a graph of an unpublished snapshot
+ */
+static std::shared_ptr<const DeltaStepping> findDeltaStepping(
+    const Graph<LocationInfo> &graph,
+    Edge<LocationInfo>::EdgeType transportMode) {
+    GraphSnapshot::Handle snapshot = GraphSnapshot::owning(graph);
+    if (snapshot) {
+        return snapshot->getIndexes().deltaStepping[static_cast<int>(transportMode)];
+    }
+    return DeltaStepping::find(graph, transportMode);
+}
+
+/**
+ * @brief Gets the parking index of a graph: the one of the snapshot owning it, else the registered one
+ * @param graph The transportation graph
+ * @return The index, or nullptr if there is none
+ * @details O(1), O(S) for a graph of an unpublished snapshot
+ */
+static std::shared_ptr<const ParkingIndex> findParkingIndex(const Graph<LocationInfo> &graph) {
+    GraphSnapshot::Handle snapshot = GraphSnapshot::owning(graph);
+    if (snapshot) {
+        return snapshot->getIndexes().parking;
+    }
+    return ParkingIndex::find(graph);
+}
+
+/**
+ * @brief Gets the travel-time profiles of a graph, which only snapshots load
+ * @param graph The transportation graph
+ * @return The profiles, or nullptr if there are none
+ * @details O(1), O(S) for a graph of an unpublished snapshot
+ */
+static std::shared_ptr<const TravelTimeProfiles> findProfiles(const Graph<LocationInfo> &graph) {
+    GraphSnapshot::Handle snapshot = GraphSnapshot::owning(graph);
+    return snapshot ? snapshot->getIndexes().profiles : nullptr;
 }
 
 void Routing::dijkstra(
     Graph<LocationInfo> &graph,
     const LocationInfo &source,
     EdgeFilter filter) {
+    Vertex<LocationInfo> *s = graph.findVertex(source);
+    if (s == nullptr) {
+        for (auto v: graph.getVertexSet()) {
+            v->setDist(INF);
+            v->setPath(nullptr);
+            v->setVisited(false);
+        }
+        std::cerr << "Source vertex not found!" << std::endl;
+        return;
+    }
+
+    // The search runs on the array-based kernel; the result is copied into the vertices afterwards
+    SearchTree tree = buildSearchTree(graph, s, filter);
     for (auto v: graph.getVertexSet()) {
-        v->setDist(INF);
-        v->setPath(nullptr);
-        v->setVisited(false);
+        v->setDist(tree.dist[v->getIndex()]);
+        v->setPath(tree.parent[v->getIndex()]);
+        v->setVisited(tree.dist[v->getIndex()] != INF);
     }
+}
 
+void Routing::dijkstra(
+    Graph<LocationInfo> &graph,
+    const LocationInfo &source,
+    const LocationInfo &target,
+    Edge<LocationInfo>::EdgeType transportMode) {
     Vertex<LocationInfo> *s = graph.findVertex(source);
+    Vertex<LocationInfo> *t = graph.findVertex(target);
+
+    SearchTree tree;
+    auto arcFlags = findArcFlags(graph, transportMode);
+    if (arcFlags && s != nullptr && t != nullptr) {
+        arcFlags->search(graph, s, t, tree);
+    } else {
+        if (s == nullptr) {
+            std::cerr << "Source vertex not found!" << std::endl;
+        }
+        tree = buildSearchTree(graph, s, RouteRestrictions(transportMode));
+    }
+
+    for (auto v: graph.getVertexSet()) {
+        v->setDist(tree.dist[v->getIndex()]);
+        v->setPath(tree.parent[v->getIndex()]);
+        v->setVisited(tree.dist[v->getIndex()] != INF);
+    }
+}
+
+Routing::SearchTree Routing::buildSearchTree(
+    const Graph<LocationInfo> &graph,
+    const Vertex<LocationInfo> *root,
+    const EdgeFilter &filter,
+    bool backward) {
+    SearchTree tree;
+    if (!filter) {
+        if (backward) {
+            SearchKernels::grow<true>(graph, root, SearchKernels::AnyEdge(), nullptr, 0, tree);
+        } else {
+            SearchKernels::grow<false>(graph, root, SearchKernels::AnyEdge(), nullptr, 0, tree);
+        }
+    } else if (backward) {
+        SearchKernels::grow<true>(graph, root, SearchKernels::ErasedEdge{&filter}, nullptr, 0, tree);
+    } else {
+        SearchKernels::grow<false>(graph, root, SearchKernels::ErasedEdge{&filter}, nullptr, 0, tree);
+    }
+    return tree;
+}
+
+Routing::SearchTree Routing::buildSearchTree(
+    const Graph<LocationInfo> &graph,
+    const Vertex<LocationInfo> *root,
+    const RouteRestrictions &restrictions,
+    bool backward) {
+    SearchTree tree;
+
+    // Large graphs grow unrestricted forward trees on every thread the caller may use
+    auto parallel = root == nullptr || backward || restrictions.getFingerprint() != 0
+                        ? nullptr
+                        : findDeltaStepping(graph, restrictions.getTransportMode());
+    if (parallel) {
+        unsigned int threads = WorkStealing::threadCount(graph.getNumVertex(), DeltaStepping::VERTICES_PER_THREAD);
+        parallel->search(root, tree, threads);
+        return tree;
+    }
+
+    auto contracted = root == nullptr ? nullptr : findCore(graph, restrictions.getTransportMode());
+    if (contracted) {
+        contracted->buildSearchTree(root, restrictions, backward, tree);
+    } else if (backward) {
+        SearchKernels::growRestricted<true>(graph, root, restrictions, nullptr, 0, tree);
+    } else {
+        SearchKernels::growRestricted<false>(graph, root, restrictions, nullptr, 0, tree);
+    }
+    return tree;
+}
+
+Routing::Route Routing::getTreeRoute(const SearchTree &tree, const Vertex<LocationInfo> *vertex) {
+    if (vertex == nullptr || tree.dist[vertex->getIndex()] == INF) {
+        return Route();
+    }
+
+    // Backward trees already store their edges in travel order, forward trees need reversing
+    std::vector<Edge<LocationInfo> *> edges;
+    const Vertex<LocationInfo> *v = vertex;
+    while (tree.parent[v->getIndex()] != nullptr) {
+        Edge<LocationInfo> *e = tree.parent[v->getIndex()];
+        edges.push_back(e);
+        v = tree.backward ? e->getDest() : e->getOrig();
+    }
+
+    if (tree.backward) {
+        return makeRoute(vertex, edges);
+    }
+    std::reverse(edges.begin(), edges.end());
+    return makeRoute(v, edges);
+}
+
+Routing::Route Routing::makeRoute(const Vertex<LocationInfo> *start, const std::vector<Edge<LocationInfo> *> &edges) {
+    Route route;
+    route.edges = edges;
+    route.locations.reserve(edges.size() + 1);
+    route.times.reserve(edges.size() + 1);
+
+    route.locations.push_back(start->getInfo());
+    route.times.push_back(0);
+    for (auto e: edges) {
+        route.locations.push_back(e->getDest()->getInfo());
+        route.times.push_back(route.times.back() + e->getWeight());
+    }
+    return route;
+}
+
+Routing::EdgeFilter Routing::createModeFilter(Edge<LocationInfo>::EdgeType transportMode) {
+    if (transportMode == Edge<LocationInfo>::EdgeType::DEFAULT) {
+        return nullptr;
+    }
+    return [transportMode](Edge<LocationInfo> *e) {
+        return e->getType() == transportMode;
+    };
+}
+
+Routing::Route Routing::findFastestRoute(
+    const Graph<LocationInfo> &graph,
+    const std::string &sourceCode,
+    const std::string &destCode,
+    Edge<LocationInfo>::EdgeType transportMode,
+    double departureTime) {
+    if (departureTime >= 0) {
+        return searchFastestRoute(graph, sourceCode, destCode, transportMode, departureTime);
+    }
+
+    RouteCache *cache = RouteCache::getInstance();
+    RouteCache::Key key = RouteCache::makeKey(graph, RouteCache::Kind::FASTEST, sourceCode, destCode, transportMode);
+    RouteCache::Value cached;
+    if (cache->find(key, cached)) {
+        return cached.route;
+    }
+
+    // Failed queries print why they failed, so only routes are kept
+    Route path = searchFastestRoute(graph, sourceCode, destCode, transportMode, departureTime);
+    if (!path.empty()) {
+        cached.route = path;
+        cache->insert(key, std::move(cached));
+    }
+    return path;
+}
+
+Routing::Route Routing::searchFastestRoute(
+    const Graph<LocationInfo> &graph,
+    const std::string &sourceCode,
+    const std::string &destCode,
+    Edge<LocationInfo>::EdgeType transportMode,
+    double departureTime) {
+    Vertex<LocationInfo> *s = graph.findVertex(LocationInfo("", 0, sourceCode, false));
     if (s == nullptr) {
         std::cerr << "Source vertex not found!" << std::endl;
-        return;
+        return Route();
     }
 
-    s->setDist(0);
+    RouteRestrictions modeOnly(transportMode);
+    Vertex<LocationInfo> *t = graph.findVertex(LocationInfo("", 0, destCode, false));
+    if (t == nullptr || !mayReach(s, t, modeOnly)) {
+        std::cout << "No path found to destination or destination does not exist." << std::endl;
+        return Route();
+    }
 
-    MutablePriorityQueue<Vertex<LocationInfo> > q;
-    q.insert(s);
+    if (departureTime >= 0) {
+        Route path = findTimeDependentRoute(graph, s, t, modeOnly, departureTime);
+        if (path.empty()) {
+            std::cout << "No path found to destination or destination does not exist." << std::endl;
+        }
+        return path;
+    }
 
-    while (!q.empty()) {
-        auto v = q.extractMin();
-        v->setVisited(true);
+    // A table answers without searching; it picks the same route among equal-cost ones as a search
+    auto table = findAllPairs(graph, transportMode);
+    if (table) {
+        Route path = table->getRoute(s, t);
+        if (!path.empty()) {
+            return path;
+        }
+    }
 
-        for (auto e: v->getAdj()) {
-            if (filter && !filter(e)) {
-                continue;
-            }
+    // One lookup: a miss is answered by the arc flags if there are any, or by a tree that is then cached
+    SearchTreeCache *cache = SearchTreeCache::getInstance();
+    auto tree = cache->find(graph, s, modeOnly, false);
+    if (!tree) {
+        auto arcFlags = findArcFlags(graph, transportMode);
+        if (arcFlags) {
+            auto pruned = std::make_shared<SearchTree>();
+            arcFlags->search(graph, s, t, *pruned);
+            tree = pruned;
+        } else {
+            tree = cache->insert(graph, s, modeOnly, buildSearchTree(graph, s, modeOnly, false));
+        }
+    }
 
-            auto dest = e->getDest();
-            if (dest->isVisited())
-                continue;
+    Route path = getTreeRoute(*tree, t);
+    if (path.empty()) {
+        std::cout << "No path found to destination or destination does not exist." << std::endl;
+    }
+    return path;
+}
 
-            auto oldDist = dest->getDist();
-            if (relax(e)) {
-                if (oldDist == INF) {
-                    q.insert(dest);
-                } else {
-                    q.decreaseKey(dest);
-                }
+std::shared_ptr<const Routing::SearchTree> Routing::getCachedTree(
+    const Graph<LocationInfo> &graph,
+    const Vertex<LocationInfo> *root,
+    const RouteRestrictions &restrictions,
+    bool backward) {
+    SearchTreeCache *cache = SearchTreeCache::getInstance();
+
+    auto tree = cache->find(graph, root, restrictions, backward);
+    if (tree) {
+        return tree;
+    }
+
+    return cache->insert(graph, root, restrictions, buildSearchTree(graph, root, restrictions, backward));
+}
+
+bool Routing::findParkingCandidates(
+    const Graph<LocationInfo> &graph,
+    const Vertex<LocationInfo> *dest,
+    const RouteRestrictions &walkingRestrictions,
+    double maxWalkingTime,
+    std::vector<Vertex<LocationInfo> *> &parkingNodes,
+    std::vector<double> &walkingTimes) {
+    parkingNodes.clear();
+    walkingTimes.clear();
+
+    auto index = walkingRestrictions.getFingerprint() == 0 ? findParkingIndex(graph) : nullptr;
+    if (!index || !index->isComplete(dest->getIndex(), maxWalkingTime)) {
+        for (auto v: graph.getVertexSet()) {
+            if (v->getInfo().hasParking) {
+                parkingNodes.push_back(v);
             }
         }
+        return false;
     }
+
+    // Vertex order, like the full scan, so that ties between candidates resolve the same way
+    const ParkingIndex::Entry *first = index->getNearest(dest->getIndex());
+    std::vector<ParkingIndex::Entry> nearest(first, first + index->getCount(dest->getIndex()));
+    std::sort(nearest.begin(), nearest.end(), [](const ParkingIndex::Entry &a, const ParkingIndex::Entry &b) {
+        return a.parking < b.parking;
+    });
+    for (const auto &entry: nearest) {
+        if (entry.walkingTime <= maxWalkingTime) {
+            parkingNodes.push_back(graph.getVertexSet()[entry.parking]);
+            walkingTimes.push_back(entry.walkingTime);
+        }
+    }
+    return true;
 }
 
-std::vector<LocationInfo> Routing::getPath(
+void Routing::measureParkingWalks(
     const Graph<LocationInfo> &graph,
-    const LocationInfo &source,
-    const LocationInfo &dest) {
-    std::vector<LocationInfo> res;
+    const std::vector<Vertex<LocationInfo> *> &parkingNodes,
+    const Vertex<LocationInfo> *dest,
+    const RouteRestrictions &walkingRestrictions,
+    const SearchTree &drivingTree,
+    double maxWalkingTime,
+    bool prune,
+    std::vector<double> &walkingTimes) {
+    walkingTimes.assign(parkingNodes.size(), INF);
+
+    std::vector<bool> targets(graph.getNumVertex(), false);
+    targets[dest->getIndex()] = true;
+
+    unsigned int threads = WorkStealing::threadCount(parkingNodes.size());
+    std::vector<SearchTree> contexts(threads);
+    std::atomic<double> best(INF);
+
+    WorkStealing::run(parkingNodes.size(), threads, [&](size_t i, unsigned int thread) {
+        const Vertex<LocationInfo> *parkingNode = parkingNodes[i];
+        double drivingTime = drivingTree.dist[parkingNode->getIndex()];
+        if (drivingTime == INF || !mayReach(parkingNode, dest, walkingRestrictions)) {
+            return;
+        }
 
-    auto v = graph.findVertex(dest);
-    if (v == nullptr || v->getDist() == INF) {
-        std::cout << "No path found to destination or destination does not exist." << std::endl;
-        return res;
+        // Strict comparisons keep candidates that could still tie the best
+        double limit = maxWalkingTime;
+        if (prune) {
+            double bound = best.load();
+            if (drivingTime > bound) {
+                return;
+            }
+            limit = std::min(limit, bound - drivingTime);
+        }
+
+        SearchTree &tree = contexts[thread];
+        SearchKernels::growRestricted<false>(graph, parkingNode, walkingRestrictions, &targets, 1, tree, limit);
+        double walkingTime = tree.dist[dest->getIndex()];
+        if (walkingTime > limit) {
+            return;
+        }
+        walkingTimes[i] = walkingTime;
+
+        double total = drivingTime + walkingTime;
+        double bound = best.load();
+        while (prune && total < bound && !best.compare_exchange_weak(bound, total)) {
+        }
+    });
+}
+
+bool Routing::mayReach(
+    const Vertex<LocationInfo> *from,
+    const Vertex<LocationInfo> *to,
+    const RouteRestrictions &restrictions) {
+    if (from == to) {
+        return true;
     }
+    if (restrictions.avoids(from->getIndex()) || restrictions.avoids(to->getIndex())) {
+        return false;
+    }
+    return !GraphBuilder::isUnreachable(from->getInfo(), to->getInfo(), restrictions.getTransportMode());
+}
 
-    res.push_back(v->getInfo());
-    while (v->getPath() != nullptr) {
-        v = v->getPath()->getOrig();
-        res.push_back(v->getInfo());
+Routing::Route Routing::findRouteWithRestrictions(
+    const Graph<LocationInfo> &graph,
+    const std::string &sourceCode,
+    const std::string &destCode,
+    const RouteRestrictions &restrictions,
+    double departureTime) {
+    if (departureTime >= 0) {
+        return searchRouteWithRestrictions(graph, sourceCode, destCode, restrictions, departureTime);
     }
 
-    if (res.back().code != source.code) {
-        std::cout << "Path does not start at the specified source." << std::endl;
-        return std::vector<LocationInfo>();
+    RouteCache *cache = RouteCache::getInstance();
+    RouteCache::Key key = RouteCache::makeKey(graph, RouteCache::Kind::RESTRICTED, sourceCode, destCode,
+                                              restrictions.getTransportMode(), restrictions.getAvoidLists());
+    RouteCache::Value cached;
+    if (cache->find(key, cached)) {
+        return cached.route;
     }
 
-    std::reverse(res.begin(), res.end());
-    return res;
+    Route path = searchRouteWithRestrictions(graph, sourceCode, destCode, restrictions, departureTime);
+    if (!path.empty()) {
+        cached.route = path;
+        cache->insert(key, std::move(cached));
+    }
+    return path;
 }
 
-std::vector<LocationInfo> Routing::findFastestRoute(
+Routing::Route Routing::searchRouteWithRestrictions(
     const Graph<LocationInfo> &graph,
     const std::string &sourceCode,
     const std::string &destCode,
-    Edge<LocationInfo>::EdgeType transportMode) {
-    LocationInfo source("", 0, sourceCode, false);
-    LocationInfo dest("", 0, destCode, false);
+    const RouteRestrictions &restrictions,
+    double departureTime) {
+    Vertex<LocationInfo> *s = graph.findVertex(LocationInfo("", 0, sourceCode, false));
+    if (s == nullptr) {
+        std::cerr << "Source vertex not found!" << std::endl;
+        return Route();
+    }
+
+    Vertex<LocationInfo> *t = graph.findVertex(LocationInfo("", 0, destCode, false));
+    if (t == nullptr || !mayReach(s, t, restrictions)) {
+        std::cout << "No path found to destination or destination does not exist." << std::endl;
+        return Route();
+    }
 
-    Graph<LocationInfo> mutableGraph = graph;
+    Route path = departureTime >= 0
+                     ? findTimeDependentRoute(graph, s, t, restrictions, departureTime)
+                     : getTreeRoute(*getCachedTree(graph, s, restrictions), t);
+    if (path.empty()) {
+        std::cout << "No path found to destination or destination does not exist." << std::endl;
+    }
+    return path;
+}
 
-    EdgeFilter filter = nullptr;
-    if (transportMode != Edge<LocationInfo>::EdgeType::DEFAULT) {
-        filter = [transportMode](Edge<LocationInfo> *e) {
-            return e->getType() == transportMode;
-        };
+Routing::Route Routing::findTimeDependentRoute(
+    const Graph<LocationInfo> &graph,
+    const Vertex<LocationInfo> *source,
+    const Vertex<LocationInfo> *target,
+    const RouteRestrictions &restrictions,
+    double departureTime) {
+    auto profiles = findProfiles(graph);
+    if (!profiles) {
+        return getTreeRoute(buildSearchTree(graph, source, restrictions), target);
     }
 
-    dijkstra(mutableGraph, source, filter);
+    SearchTree tree;
+    profiles->search(graph, source, target, restrictions, departureTime, tree);
 
-    return getPath(mutableGraph, source, dest);
+    // Arrival times come from the profiles, not from the static weights makeRoute adds up
+    Route route = getTreeRoute(tree, target);
+    for (size_t i = 0; i < route.edges.size(); i++) {
+        route.times[i + 1] = tree.dist[route.edges[i]->getDest()->getIndex()];
+    }
+    return route;
 }
 
-std::vector<LocationInfo> Routing::findRouteWithFilter(
+Routing::Route Routing::timeRoute(const Graph<LocationInfo> &graph, const Route &route, double departureTime) {
+    auto profiles = findProfiles(graph);
+    if (!profiles) {
+        return route;
+    }
+
+    Route timed = route;
+    for (size_t i = 0; i < timed.edges.size(); i++) {
+        timed.times[i + 1] = timed.times[i] + profiles->travelTime(timed.edges[i], departureTime + timed.times[i]);
+    }
+    return timed;
+}
+
+Routing::Route Routing::findRouteWithFilter(
     const Graph<LocationInfo> &graph,
     const std::string &sourceCode,
     const std::string &destCode,
     EdgeFilter filter) {
-    LocationInfo source("", 0, sourceCode, false);
-    LocationInfo dest("", 0, destCode, false);
-
-    Graph<LocationInfo> mutableGraph = graph;
+    Vertex<LocationInfo> *s = graph.findVertex(LocationInfo("", 0, sourceCode, false));
+    if (s == nullptr) {
+        std::cerr << "Source vertex not found!" << std::endl;
+        return Route();
+    }
 
-    dijkstra(mutableGraph, source, filter);
+    SearchTree tree = buildSearchTree(graph, s, filter);
 
-    return getPath(mutableGraph, source, dest);
+    Route path = getTreeRoute(tree, graph.findVertex(LocationInfo("", 0, destCode, false)));
+    if (path.empty()) {
+        std::cout << "No path found to destination or destination does not exist." << std::endl;
+    }
+    return path;
 }
 
 double Routing::calculateRouteTime(
@@ -175,38 +609,33 @@ double Routing::calculateRouteTime(
     return calculateRouteTime(path, graph, Edge<LocationInfo>::EdgeType::DEFAULT);
 }
 
-void Routing::displayRoute(
-    const std::vector<LocationInfo> &path,
-    const Graph<LocationInfo> &graph) {
-    if (path.empty()) {
+double Routing::calculateRouteTime(const Route &route) {
+    return route.totalTime();
+}
+
+void Routing::displayRoute(const Route &route) {
+    if (route.empty()) {
         std::cout << "No route found." << std::endl;
         return;
     }
 
-    std::cout << "\nRoute from " << path.front().name << " to " << path.back().name << ":" << std::endl;
+    std::cout << "\nRoute from " << route.locations.front().name << " to " << route.locations.back().name << ":"
+            << std::endl;
     std::cout << "--------------------------------" << std::endl;
 
-    for (size_t i = 0; i < path.size(); i++) {
-        std::cout << i + 1 << ". " << path[i].name << " (" << path[i].code << ")";
-
-        if (i < path.size() - 1) {
-            Vertex<LocationInfo> *current = graph.findVertex(path[i]);
+    for (size_t i = 0; i < route.locations.size(); i++) {
+        std::cout << i + 1 << ". " << route.locations[i].name << " (" << route.locations[i].code << ")";
 
-            for (Edge<LocationInfo> *edge: current->getAdj()) {
-                if (edge->getDest()->getInfo().code == path[i + 1].code) {
-                    std::cout << " -> " << edge->getWeight() << " minutes ("
-                            << edge->getTypeString() << ")";
-                    break;
-                }
-            }
+        if (i < route.edges.size()) {
+            std::cout << " -> " << route.edges[i]->getWeight() << " minutes ("
+                    << route.edges[i]->getTypeString() << ")";
         }
 
         std::cout << std::endl;
     }
 
-    double totalTime = calculateRouteTime(path, graph);
     std::cout << "--------------------------------" << std::endl;
-    std::cout << "Total travel time: " << totalTime << " minutes" << std::endl;
+    std::cout << "Total travel time: " << route.totalTime() << " minutes" << std::endl;
 }
 
 std::string Routing::formatRouteForOutput(
@@ -230,13 +659,16 @@ std::string Routing::formatRouteForOutput(
     return ss.str();
 }
 
+std::string Routing::formatRouteForOutput(const Route &route) {
+    return formatRouteForOutput(route.locations, route.totalTime());
+}
+
 void Routing::outputRoutesToFile(
     const std::string &filename,
     int sourceId,
     int destId,
-    const std::vector<LocationInfo> &bestRoute,
-    const std::vector<LocationInfo> &alternativeRoute,
-    const Graph<LocationInfo> &graph) {
+    const Route &bestRoute,
+    const Route &alternativeRoute) {
     std::ofstream outFile(filename);
 
     if (!outFile.is_open()) {
@@ -244,21 +676,10 @@ void Routing::outputRoutesToFile(
         return;
     }
 
-    double bestRouteTime = 0;
-    double alternativeRouteTime = 0;
-
-    if (!bestRoute.empty()) {
-        bestRouteTime = calculateRouteTime(bestRoute, graph);
-    }
-
-    if (!alternativeRoute.empty()) {
-        alternativeRouteTime = calculateRouteTime(alternativeRoute, graph);
-    }
-
     outFile << "Source:" << sourceId << std::endl;
     outFile << "Destination:" << destId << std::endl;
-    outFile << "BestDrivingRoute:" << formatRouteForOutput(bestRoute, bestRouteTime) << std::endl;
-    outFile << "AlternativeDrivingRoute:" << formatRouteForOutput(alternativeRoute, alternativeRouteTime) << std::endl;
+    outFile << "BestDrivingRoute:" << formatRouteForOutput(bestRoute) << std::endl;
+    outFile << "AlternativeDrivingRoute:" << formatRouteForOutput(alternativeRoute) << std::endl;
 
     outFile.flush();
     outFile.close();
@@ -266,58 +687,492 @@ void Routing::outputRoutesToFile(
     std::cout << "Results written to " << filename << " and are ready to view." << std::endl;
 }
 
-Graph<LocationInfo> Routing::createGraphWithoutPath(
+Routing::Route Routing::findAlternativeRoute(
     const Graph<LocationInfo> &originalGraph,
-    const std::vector<LocationInfo> &pathToRemove) {
-    Graph<LocationInfo> newGraph;
+    const Route &fastestPath,
+    const std::string &sourceCode,
+    const std::string &destCode,
+    Edge<LocationInfo>::EdgeType transportMode) {
+    if (fastestPath.locations.size() <= 2) {
+        return Route();
+    }
+
+    // Avoiding the fastest path's segments, in either direction, leaves the same graph a copy without them would
+    std::vector<std::pair<int, int> > pathSegments;
+    for (size_t i = 0; i + 1 < fastestPath.locations.size(); i++) {
+        pathSegments.emplace_back(fastestPath.locations[i].id, fastestPath.locations[i + 1].id);
+    }
+    RouteRestrictions withoutPath = RouteRestrictions::compile(originalGraph, {}, pathSegments, transportMode);
+
+    return findRouteWithRestrictions(originalGraph, sourceCode, destCode, withoutPath);
+}
+
+Routing::DistanceMatrix Routing::distanceMatrix(
+    const Graph<LocationInfo> &graph,
+    const std::vector<std::string> &sourceCodes,
+    const std::vector<std::string> &targetCodes,
+    Edge<LocationInfo>::EdgeType transportMode,
+    const EdgeFilter &filter,
+    unsigned int threads) {
+    DistanceMatrix matrix;
+    matrix.rows = sourceCodes.size();
+    matrix.cols = targetCodes.size();
+    matrix.values.assign(matrix.rows * matrix.cols, INF);
+
+    std::vector<int> targetIndex(matrix.cols, -1);
+    std::vector<bool> isTarget(graph.getNumVertex(), false);
+    int targetCount = 0;
+    for (size_t j = 0; j < matrix.cols; j++) {
+        Vertex<LocationInfo> *t = graph.findVertex(LocationInfo("", 0, targetCodes[j], false));
+        if (t == nullptr)
+            continue;
+        targetIndex[j] = t->getIndex();
+        if (!isTarget[t->getIndex()]) {
+            isTarget[t->getIndex()] = true;
+            targetCount++;
+        }
+    }
+
+    std::vector<Vertex<LocationInfo> *> sources(matrix.rows, nullptr);
+    for (size_t i = 0; i < matrix.rows; i++) {
+        sources[i] = graph.findVertex(LocationInfo("", 0, sourceCodes[i], false));
+    }
 
-    for (auto vertex: originalGraph.getVertexSet()) {
-        newGraph.addVertex(vertex->getInfo());
+    // Without a custom filter the mode-specialised kernel runs; a custom filter is type-erased
+    EdgeFilter combined;
+    if (filter) {
+        EdgeFilter modeFilter = createModeFilter(transportMode);
+        combined = filter;
+        if (modeFilter) {
+            combined = [modeFilter, filter](Edge<LocationInfo> *e) {
+                return modeFilter(e) && filter(e);
+            };
+        }
     }
 
-    for (auto vertex: originalGraph.getVertexSet()) {
-        const LocationInfo &sourceInfo = vertex->getInfo();
+    if (targetCount == 0) {
+        return matrix;
+    }
 
-        for (auto edge: vertex->getAdj()) {
-            const LocationInfo &destInfo = edge->getDest()->getInfo();
+    // Serial inside a WorkStealing::SerialScope, which a SearchBudget also opens: helpers would not see the budget
+    threads = WorkStealing::threadCount(matrix.rows, 1, threads);
 
-            bool isPathEdge = false;
-            for (size_t i = 0; i < pathToRemove.size() - 1; i++) {
-                if ((sourceInfo.code == pathToRemove[i].code && destInfo.code == pathToRemove[i + 1].code) ||
-                    (sourceInfo.code == pathToRemove[i + 1].code && destInfo.code == pathToRemove[i].code)) {
-                    isPathEdge = true;
-                    break;
+    std::atomic<size_t> nextRow(0);
+    auto worker = [&]() {
+        SearchTree tree;
+        for (size_t i = nextRow++; i < matrix.rows; i = nextRow++) {
+            if (sources[i] == nullptr)
+                continue;
+
+            if (combined) {
+                SearchKernels::grow<false>(graph, sources[i], SearchKernels::ErasedEdge{&combined},
+                                           &isTarget, targetCount, tree);
+            } else {
+                SearchKernels::growForMode<false>(graph, sources[i], transportMode, &isTarget, targetCount, tree);
+            }
+
+            double *row = &matrix.values[i * matrix.cols];
+            for (size_t j = 0; j < matrix.cols; j++) {
+                if (targetIndex[j] != -1)
+                    row[j] = tree.dist[targetIndex[j]];
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned int k = 1; k < threads; k++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &th: pool) {
+        th.join();
+    }
+
+    return matrix;
+}
+
+std::vector<int> Routing::orderStops(const std::vector<std::vector<double> > &legs, int stopCount) {
+    std::vector<int> order;
+    if (stopCount == 0) {
+        return order;
+    }
+
+    // legs[0][j] leaves the source, legs[i + 1][j] leaves stop i; column j arrives at stop j, column K at the destination
+    auto tourCost = [&](const std::vector<int> &tour) {
+        double cost = legs[0][tour[0]];
+        for (size_t i = 0; i + 1 < tour.size(); i++) {
+            cost += legs[tour[i] + 1][tour[i + 1]];
+        }
+        return cost + legs[tour.back() + 1][stopCount];
+    };
+
+    if (stopCount <= MAX_EXACT_STOPS) {
+        // Held-Karp: best[mask][j] is the cheapest way to leave the source, visit mask and end at stop j
+        int full = (1 << stopCount) - 1;
+        std::vector<std::vector<double> > best(full + 1, std::vector<double>(stopCount, INF));
+        std::vector<std::vector<int> > previous(full + 1, std::vector<int>(stopCount, -1));
+
+        for (int j = 0; j < stopCount; j++) {
+            best[1 << j][j] = legs[0][j];
+        }
+
+        for (int mask = 1; mask <= full; mask++) {
+            for (int j = 0; j < stopCount; j++) {
+                if (!(mask & (1 << j)) || best[mask][j] == INF)
+                    continue;
+                for (int next = 0; next < stopCount; next++) {
+                    if (mask & (1 << next))
+                        continue;
+                    double cost = best[mask][j] + legs[j + 1][next];
+                    int nextMask = mask | (1 << next);
+                    if (cost < best[nextMask][next]) {
+                        best[nextMask][next] = cost;
+                        previous[nextMask][next] = j;
+                    }
                 }
             }
+        }
+
+        int last = -1;
+        double bestCost = INF;
+        for (int j = 0; j < stopCount; j++) {
+            if (best[full][j] == INF)
+                continue;
+            double cost = best[full][j] + legs[j + 1][stopCount];
+            if (cost < bestCost) {
+                bestCost = cost;
+                last = j;
+            }
+        }
 
-            if (!isPathEdge) {
-                Vertex<LocationInfo> *newSource = newGraph.findVertex(sourceInfo);
-                Vertex<LocationInfo> *newDest = newGraph.findVertex(destInfo);
+        if (last == -1) {
+            return order;
+        }
+
+        for (int mask = full; last != -1;) {
+            order.push_back(last);
+            int prev = previous[mask][last];
+            mask &= ~(1 << last);
+            last = prev;
+        }
+        std::reverse(order.begin(), order.end());
+        return order;
+    }
 
-                if (newSource && newDest) {
-                    Edge<LocationInfo> *newEdge = newSource->addEdge(newDest, edge->getWeight());
-                    newEdge->setType(edge->getType());
+    // Nearest-neighbour tour from the source, then 2-opt until no reversal helps
+    std::vector<bool> used(stopCount, false);
+    for (int row = 0; static_cast<int>(order.size()) < stopCount;) {
+        int next = -1;
+        for (int j = 0; j < stopCount; j++) {
+            if (!used[j] && (next == -1 || legs[row][j] < legs[row][next]))
+                next = j;
+        }
+        used[next] = true;
+        order.push_back(next);
+        row = next + 1;
+    }
+
+    double cost = tourCost(order);
+    bool improved = true;
+    while (improved) {
+        improved = false;
+        for (int i = 0; i < stopCount - 1; i++) {
+            for (int k = i + 1; k < stopCount; k++) {
+                std::reverse(order.begin() + i, order.begin() + k + 1);
+                double candidate = tourCost(order);
+                if (candidate < cost) {
+                    cost = candidate;
+                    improved = true;
+                } else {
+                    std::reverse(order.begin() + i, order.begin() + k + 1);
                 }
             }
         }
     }
 
-    return newGraph;
+    return order;
 }
 
-std::vector<LocationInfo> Routing::findAlternativeRoute(
-    const Graph<LocationInfo> &originalGraph,
-    const std::vector<LocationInfo> &fastestPath,
+Routing::Route Routing::findRouteThroughStops(
+    const Graph<LocationInfo> &graph,
     const std::string &sourceCode,
     const std::string &destCode,
+    const std::vector<std::string> &stopCodes,
+    const RouteRestrictions &restrictions,
+    bool keepOrder) {
+    Route route;
+
+    Vertex<LocationInfo> *s = graph.findVertex(LocationInfo("", 0, sourceCode, false));
+    Vertex<LocationInfo> *t = graph.findVertex(LocationInfo("", 0, destCode, false));
+    if (!s || !t) {
+        return route;
+    }
+
+    int stopCount = stopCodes.size();
+    std::vector<Vertex<LocationInfo> *> stops;
+    for (const auto &code: stopCodes) {
+        Vertex<LocationInfo> *v = graph.findVertex(LocationInfo("", 0, code, false));
+        if (v == nullptr) {
+            return route;
+        }
+        stops.push_back(v);
+    }
+
+    // Every stop has to be reachable from the source and the destination from every stop
+    for (auto stop: stops) {
+        if (!mayReach(s, stop, restrictions) || !mayReach(stop, t, restrictions)) {
+            return route;
+        }
+    }
+    if (!mayReach(s, t, restrictions)) {
+        return route;
+    }
+
+    // trees[0] is rooted at the source and trees[i + 1] at stop i
+    std::vector<std::shared_ptr<const SearchTree> > trees;
+    trees.push_back(getCachedTree(graph, s, restrictions));
+    for (auto stop: stops) {
+        trees.push_back(getCachedTree(graph, stop, restrictions));
+    }
+
+    std::vector<std::vector<double> > legs(stopCount + 1, std::vector<double>(stopCount + 1, INF));
+    for (int i = 0; i <= stopCount; i++) {
+        for (int j = 0; j < stopCount; j++) {
+            if (i != j + 1)
+                legs[i][j] = trees[i]->dist[stops[j]->getIndex()];
+        }
+        legs[i][stopCount] = trees[i]->dist[t->getIndex()];
+    }
+
+    std::vector<int> order;
+    if (keepOrder) {
+        for (int j = 0; j < stopCount; j++) {
+            order.push_back(j);
+        }
+    } else {
+        order = orderStops(legs, stopCount);
+        if (static_cast<int>(order.size()) != stopCount) {
+            return route;
+        }
+    }
+
+    // The legs are stitched by their edges, makeRoute then recomputes the cumulative times
+    std::vector<Edge<LocationInfo> *> edges;
+    int from = 0;
+    order.push_back(stopCount);
+    for (int next: order) {
+        Vertex<LocationInfo> *target = next == stopCount ? t : stops[next];
+        Route leg = getTreeRoute(*trees[from], target);
+        if (leg.empty()) {
+            return route;
+        }
+        edges.insert(edges.end(), leg.edges.begin(), leg.edges.end());
+        from = next + 1;
+    }
+
+    return makeRoute(s, edges);
+}
+
+std::vector<Routing::Route> Routing::findAlternativeRoutes(
+    const Graph<LocationInfo> &graph,
+    const std::string &sourceCode,
+    const std::string &destCode,
+    Edge<LocationInfo>::EdgeType transportMode,
+    int maxAlternatives,
+    double maxStretch,
+    double maxSharing,
+    double minLocalOptimality) {
+    std::vector<Route> alternatives;
+
+    Vertex<LocationInfo> *s = graph.findVertex(LocationInfo("", 0, sourceCode, false));
+    Vertex<LocationInfo> *t = graph.findVertex(LocationInfo("", 0, destCode, false));
+    if (!s || !t || s == t) {
+        return alternatives;
+    }
+
+    RouteRestrictions modeOnly(transportMode);
+    if (!mayReach(s, t, modeOnly)) {
+        return alternatives;
+    }
+
+    SearchTree forward = buildSearchTree(graph, s, modeOnly, false);
+    if (forward.dist[t->getIndex()] == INF) {
+        return alternatives;
+    }
+    SearchTree backward = buildSearchTree(graph, t, modeOnly, true);
+
+    double optimal = forward.dist[t->getIndex()];
+    auto vertices = graph.getVertexSet();
+
+    // A tree edge u -> v lies on a plateau if it is in both trees
+    auto onPlateau = [&](Edge<LocationInfo> *e) {
+        return e != nullptr &&
+               forward.parent[e->getDest()->getIndex()] == e &&
+               backward.parent[e->getOrig()->getIndex()] == e;
+    };
+
+    struct Candidate {
+        int via; // first vertex of the plateau
+        double length;
+        double plateau;
+    };
+    std::vector<Candidate> candidates;
+
+    for (auto v: vertices) {
+        int i = v->getIndex();
+        if (v == s || v == t || forward.dist[i] == INF || backward.dist[i] == INF)
+            continue;
+
+        double length = forward.dist[i] + backward.dist[i];
+        if (length > (1 + maxStretch) * optimal)
+            continue;
+
+        // Every vertex of a plateau yields the same via-route, keep only the plateau's first vertex
+        if (onPlateau(forward.parent[i]))
+            continue;
+
+        double plateau = 0;
+        for (Edge<LocationInfo> *e = backward.parent[i]; onPlateau(e); e = backward.parent[e->getDest()->getIndex()]) {
+            plateau += e->getWeight();
+        }
+
+        if (plateau < minLocalOptimality * optimal)
+            continue;
+
+        candidates.push_back({i, length, plateau});
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        if (a.length - a.plateau != b.length - b.plateau)
+            return a.length - a.plateau < b.length - b.plateau;
+        return a.length < b.length;
+    });
+
+    // Segments are compared regardless of direction, so store them as ordered vertex index pairs
+    auto segmentKey = [](const Edge<LocationInfo> *e) {
+        int a = e->getOrig()->getIndex();
+        int b = e->getDest()->getIndex();
+        return std::make_pair(std::min(a, b), std::max(a, b));
+    };
+
+    std::vector<std::map<std::pair<int, int>, double> > chosenSegments(1);
+    for (Edge<LocationInfo> *e = forward.parent[t->getIndex()]; e != nullptr;
+         e = forward.parent[e->getOrig()->getIndex()]) {
+        chosenSegments[0][segmentKey(e)] = e->getWeight();
+    }
+
+    std::vector<bool> onRoute(vertices.size(), false);
+
+    for (const auto &candidate: candidates) {
+        if (static_cast<int>(alternatives.size()) >= maxAlternatives)
+            break;
+
+        std::vector<Edge<LocationInfo> *> routeEdges;
+        for (Edge<LocationInfo> *e = forward.parent[candidate.via]; e != nullptr;
+             e = forward.parent[e->getOrig()->getIndex()]) {
+            routeEdges.push_back(e);
+        }
+        std::reverse(routeEdges.begin(), routeEdges.end());
+        for (Edge<LocationInfo> *e = backward.parent[candidate.via]; e != nullptr;
+             e = backward.parent[e->getDest()->getIndex()]) {
+            routeEdges.push_back(e);
+        }
+
+        // The concatenation of the two tree paths may revisit a vertex, such routes are not simple
+        std::fill(onRoute.begin(), onRoute.end(), false);
+        onRoute[s->getIndex()] = true;
+        bool simple = true;
+        for (auto e: routeEdges) {
+            int w = e->getDest()->getIndex();
+            if (onRoute[w]) {
+                simple = false;
+                break;
+            }
+            onRoute[w] = true;
+        }
+        if (!simple)
+            continue;
+
+        bool limitedSharing = true;
+        for (const auto &segments: chosenSegments) {
+            double shared = 0;
+            for (auto e: routeEdges) {
+                if (segments.count(segmentKey(e)))
+                    shared += e->getWeight();
+            }
+            if (shared > maxSharing * optimal) {
+                limitedSharing = false;
+                break;
+            }
+        }
+        if (!limitedSharing)
+            continue;
+
+        std::map<std::pair<int, int>, double> segments;
+        for (auto e: routeEdges) {
+            segments[segmentKey(e)] = e->getWeight();
+        }
+
+        chosenSegments.push_back(segments);
+        alternatives.push_back(makeRoute(s, routeEdges));
+    }
+
+    return alternatives;
+}
+
+Routing::Isochrone Routing::findReachable(
+    const Graph<LocationInfo> &graph,
+    const std::string &sourceCode,
+    const std::vector<double> &budgets,
     Edge<LocationInfo>::EdgeType transportMode) {
-    if (fastestPath.size() <= 2) {
-        return std::vector<LocationInfo>();
+    Isochrone isochrone;
+    for (double budget: budgets) {
+        if (budget >= 0)
+            isochrone.budgets.push_back(budget);
+    }
+    std::sort(isochrone.budgets.begin(), isochrone.budgets.end());
+    isochrone.budgets.erase(std::unique(isochrone.budgets.begin(), isochrone.budgets.end()),
+                            isochrone.budgets.end());
+
+    Vertex<LocationInfo> *s = graph.findVertex(LocationInfo("", 0, sourceCode, false));
+    if (s == nullptr || isochrone.budgets.empty()) {
+        return isochrone;
+    }
+    isochrone.rings.resize(isochrone.budgets.size());
+    double limit = isochrone.budgets.back();
+
+    // A full tree from an earlier query answers every budget; otherwise search only up to the largest one
+    std::shared_ptr<const SearchTree> tree =
+        SearchTreeCache::getInstance()->find(graph, s, RouteRestrictions(transportMode), false);
+    if (!tree) {
+        SearchTree bounded;
+        auto parallel = findDeltaStepping(graph, transportMode);
+        if (parallel) {
+            unsigned int threads = WorkStealing::threadCount(graph.getNumVertex(), DeltaStepping::VERTICES_PER_THREAD);
+            parallel->search(s, bounded, threads, limit);
+        } else {
+            SearchKernels::growForMode<false>(graph, s, transportMode, nullptr, 0, bounded, limit);
+        }
+        tree = std::make_shared<const SearchTree>(std::move(bounded));
+    }
+
+    for (auto v: graph.getVertexSet()) {
+        double time = tree->dist[v->getIndex()];
+        if (time > limit)
+            continue;
+
+        size_t ring = std::lower_bound(isochrone.budgets.begin(), isochrone.budgets.end(), time) -
+                      isochrone.budgets.begin();
+        isochrone.rings[ring].push_back({v->getInfo().id, time});
     }
 
-    Graph<LocationInfo> graphWithoutPath = createGraphWithoutPath(originalGraph, fastestPath);
+    for (auto &ring: isochrone.rings) {
+        std::sort(ring.begin(), ring.end(), [](const ReachedLocation &a, const ReachedLocation &b) {
+            return a.time != b.time ? a.time < b.time : a.id < b.id;
+        });
+    }
 
-    return findFastestRoute(graphWithoutPath, sourceCode, destCode, transportMode);
+    return isochrone;
 }
 
 bool Routing::areNodesAdjacent(
@@ -337,36 +1192,31 @@ bool Routing::areNodesAdjacent(
     return false;
 }
 
-Routing::EdgeFilter Routing::createEcoRouteFilter(
+Routing::EcoRoute Routing::findEnvironmentallyFriendlyRoute(
+    const Graph<LocationInfo> &graph,
+    const std::string &sourceCode,
+    const std::string &destCode,
+    double maxWalkingTime,
     const std::vector<int> &avoidNodes,
-    const std::vector<std::pair<int, int> > &avoidSegments,
-    Edge<LocationInfo>::EdgeType transportMode) {
-    return [avoidNodes, avoidSegments, transportMode](Edge<LocationInfo> *edge) {
-        if (transportMode != Edge<LocationInfo>::EdgeType::DEFAULT &&
-            edge->getType() != transportMode) {
-            return false;
-        }
-
-        int origId = edge->getOrig()->getInfo().id;
-        int destId = edge->getDest()->getInfo().id;
-
-        if (std::find(avoidNodes.begin(), avoidNodes.end(), origId) != avoidNodes.end() ||
-            std::find(avoidNodes.begin(), avoidNodes.end(), destId) != avoidNodes.end()) {
-            return false;
-        }
-
-        for (const auto &segment: avoidSegments) {
-            if ((segment.first == origId && segment.second == destId) ||
-                (segment.first == destId && segment.second == origId)) {
-                return false;
-            }
-        }
+    const std::vector<std::pair<int, int> > &avoidSegments) {
+    RouteCache *cache = RouteCache::getInstance();
+    RouteCache::Key key = RouteCache::makeKey(graph, RouteCache::Kind::ECO, sourceCode, destCode,
+                                              Edge<LocationInfo>::EdgeType::DEFAULT,
+                                              RouteRestrictions::canonical(avoidNodes, avoidSegments),
+                                              maxWalkingTime);
+    RouteCache::Value cached;
+    if (cache->find(key, cached)) {
+        return cached.ecoRoutes[0];
+    }
 
-        return true;
-    };
+    EcoRoute route = searchEnvironmentallyFriendlyRoute(
+        graph, sourceCode, destCode, maxWalkingTime, avoidNodes, avoidSegments);
+    cached.ecoRoutes.push_back(route);
+    cache->insert(key, std::move(cached));
+    return route;
 }
 
-Routing::EcoRoute Routing::findEnvironmentallyFriendlyRoute(
+Routing::EcoRoute Routing::searchEnvironmentallyFriendlyRoute(
     const Graph<LocationInfo> &graph,
     const std::string &sourceCode,
     const std::string &destCode,
@@ -391,43 +1241,53 @@ Routing::EcoRoute Routing::findEnvironmentallyFriendlyRoute(
     bestRoute.totalTime = std::numeric_limits<double>::max();
     bestRoute.walkingTime = 0;
 
-    std::vector<LocationInfo> parkingNodes;
-    for (auto v: graph.getVertexSet()) {
-        if (v->getInfo().hasParking) {
-            parkingNodes.push_back(v->getInfo());
-        }
+    RouteRestrictions drivingRestrictions = RouteRestrictions::compile(
+        graph, avoidNodes, avoidSegments, Edge<LocationInfo>::EdgeType::DRIVING);
+    RouteRestrictions walkingRestrictions = RouteRestrictions::compile(
+        graph, avoidNodes, avoidSegments, Edge<LocationInfo>::EdgeType::WALKING);
+
+    std::vector<Vertex<LocationInfo> *> parkingNodes;
+    std::vector<double> indexedWalkingTimes;
+    bool indexed = findParkingCandidates(
+        graph, destVertex, walkingRestrictions, maxWalkingTime, parkingNodes, indexedWalkingTimes);
+
+    auto drivingTree = getCachedTree(graph, sourceVertex, drivingRestrictions);
+    std::vector<double> walkingTimes = indexedWalkingTimes;
+    if (!indexed) {
+        measureParkingWalks(graph, parkingNodes, destVertex, walkingRestrictions, *drivingTree, maxWalkingTime, true,
+                            walkingTimes);
     }
 
-    auto drivingFilter = createEcoRouteFilter(avoidNodes, avoidSegments, Edge<LocationInfo>::EdgeType::DRIVING);
-    auto walkingFilter = createEcoRouteFilter(avoidNodes, avoidSegments, Edge<LocationInfo>::EdgeType::WALKING);
-
-    for (const auto &parkingNode: parkingNodes) {
-        auto drivingRoute = findRouteWithFilter(graph, sourceCode, parkingNode.code, drivingFilter);
-
-        if (drivingRoute.empty()) {
+    const Vertex<LocationInfo> *bestParking = nullptr;
+    for (size_t i = 0; i < parkingNodes.size(); i++) {
+        Vertex<LocationInfo> *parkingNode = parkingNodes[i];
+        if (!mayReach(parkingNode, destVertex, walkingRestrictions)) {
             continue;
         }
 
-        auto walkingRoute = findRouteWithFilter(graph, parkingNode.code, destCode, walkingFilter);
-
-        if (walkingRoute.empty()) {
+        double drivingTime = drivingTree->dist[parkingNode->getIndex()];
+        double walkingTime = walkingTimes[i];
+        if (drivingTime == INF || walkingTime == INF) {
             continue;
         }
 
-        double drivingTime = calculateRouteTime(drivingRoute, graph, Edge<LocationInfo>::EdgeType::DRIVING);
-        double walkingTime = calculateRouteTime(walkingRoute, graph, Edge<LocationInfo>::EdgeType::WALKING);
         double totalTime = drivingTime + walkingTime;
 
         if (walkingTime <= maxWalkingTime && totalTime < bestRoute.totalTime) {
-            bestRoute.drivingRoute = drivingRoute;
-            bestRoute.parkingNode = parkingNode;
-            bestRoute.walkingRoute = walkingRoute;
+            bestRoute.parkingNode = parkingNode->getInfo();
             bestRoute.totalTime = totalTime;
             bestRoute.walkingTime = walkingTime;
             bestRoute.isValid = true;
+            bestParking = parkingNode;
         }
     }
 
+    // Only walking times are known so far, so the routes are built for the winner alone
+    if (bestRoute.isValid) {
+        bestRoute.drivingRoute = getTreeRoute(*drivingTree, bestParking);
+        bestRoute.walkingRoute = getTreeRoute(*getCachedTree(graph, bestParking, walkingRestrictions), destVertex);
+    }
+
     if (!bestRoute.isValid) {
         bestRoute.errorMessage = "No valid route found within walking time constraints";
     }
@@ -435,52 +1295,59 @@ Routing::EcoRoute Routing::findEnvironmentallyFriendlyRoute(
     return bestRoute;
 }
 
-void Routing::outputEcoRouteToFile(
-    const std::string &filename,
-    int sourceId,
-    int destId,
-    const EcoRoute &route) {
-    std::ofstream outFile(filename);
-
-    if (!outFile.is_open()) {
-        std::cerr << "Error opening file " << filename << " for writing." << std::endl;
-        return;
-    }
-
-    outFile << "Source:" << sourceId << std::endl;
-    outFile << "Destination:" << destId << std::endl;
+std::string Routing::formatEcoRouteForOutput(const EcoRoute &route) {
+    std::stringstream out;
 
     if (!route.isValid) {
-        outFile << "DrivingRoute:" << std::endl;
-        outFile << "ParkingNode:" << std::endl;
-        outFile << "WalkingRoute:" << std::endl;
-        outFile << "TotalTime:" << std::endl;
-        outFile << "Message:" << route.errorMessage << std::endl;
+        out << "DrivingRoute:" << std::endl;
+        out << "ParkingNode:" << std::endl;
+        out << "WalkingRoute:" << std::endl;
+        out << "TotalTime:" << std::endl;
+        out << "Message:" << route.errorMessage << std::endl;
     } else {
         std::string drivingRouteStr;
-        for (size_t i = 0; i < route.drivingRoute.size(); i++) {
-            drivingRouteStr += std::to_string(route.drivingRoute[i].id);
-            if (i < route.drivingRoute.size() - 1) {
+        for (size_t i = 0; i < route.drivingRoute.locations.size(); i++) {
+            drivingRouteStr += std::to_string(route.drivingRoute.locations[i].id);
+            if (i < route.drivingRoute.locations.size() - 1) {
                 drivingRouteStr += ",";
             }
         }
         drivingRouteStr += "(" + std::to_string(static_cast<int>(route.totalTime - route.walkingTime)) + ")";
 
         std::string walkingRouteStr;
-        for (size_t i = 0; i < route.walkingRoute.size(); i++) {
-            walkingRouteStr += std::to_string(route.walkingRoute[i].id);
-            if (i < route.walkingRoute.size() - 1) {
+        for (size_t i = 0; i < route.walkingRoute.locations.size(); i++) {
+            walkingRouteStr += std::to_string(route.walkingRoute.locations[i].id);
+            if (i < route.walkingRoute.locations.size() - 1) {
                 walkingRouteStr += ",";
             }
         }
         walkingRouteStr += "(" + std::to_string(static_cast<int>(route.walkingTime)) + ")";
 
-        outFile << "DrivingRoute:" << drivingRouteStr << std::endl;
-        outFile << "ParkingNode:" << route.parkingNode.id << std::endl;
-        outFile << "WalkingRoute:" << walkingRouteStr << std::endl;
-        outFile << "TotalTime:" << static_cast<int>(route.totalTime) << std::endl;
+        out << "DrivingRoute:" << drivingRouteStr << std::endl;
+        out << "ParkingNode:" << route.parkingNode.id << std::endl;
+        out << "WalkingRoute:" << walkingRouteStr << std::endl;
+        out << "TotalTime:" << static_cast<int>(route.totalTime) << std::endl;
     }
 
+    return out.str();
+}
+
+void Routing::outputEcoRouteToFile(
+    const std::string &filename,
+    int sourceId,
+    int destId,
+    const EcoRoute &route) {
+    std::ofstream outFile(filename);
+
+    if (!outFile.is_open()) {
+        std::cerr << "Error opening file " << filename << " for writing." << std::endl;
+        return;
+    }
+
+    outFile << "Source:" << sourceId << std::endl;
+    outFile << "Destination:" << destId << std::endl;
+    outFile << formatEcoRouteForOutput(route);
+
     outFile.flush();
     outFile.close();
 
@@ -614,6 +1481,27 @@ bool Routing::processEcoRouteFromFile(
 }
 
 std::vector<Routing::EcoRoute> Routing::findApproximateEcoRoutes(
+    const Graph<LocationInfo> &graph,
+    const std::string &sourceCode,
+    const std::string &destCode,
+    const std::vector<int> &avoidNodes,
+    const std::vector<std::pair<int, int> > &avoidSegments) {
+    RouteCache *cache = RouteCache::getInstance();
+    RouteCache::Key key = RouteCache::makeKey(graph, RouteCache::Kind::APPROXIMATE_ECO, sourceCode, destCode,
+                                              Edge<LocationInfo>::EdgeType::DEFAULT,
+                                              RouteRestrictions::canonical(avoidNodes, avoidSegments));
+    RouteCache::Value cached;
+    if (cache->find(key, cached)) {
+        return cached.ecoRoutes;
+    }
+
+    cached.ecoRoutes = searchApproximateEcoRoutes(graph, sourceCode, destCode, avoidNodes, avoidSegments);
+    std::vector<EcoRoute> routes = cached.ecoRoutes;
+    cache->insert(key, std::move(cached));
+    return routes;
+}
+
+std::vector<Routing::EcoRoute> Routing::searchApproximateEcoRoutes(
     const Graph<LocationInfo> &graph,
     const std::string &sourceCode,
     const std::string &destCode,
@@ -631,56 +1519,68 @@ std::vector<Routing::EcoRoute> Routing::findApproximateEcoRoutes(
         return approximateRoutes;
     }
 
-    std::vector<LocationInfo> parkingNodes;
-    for (auto v: graph.getVertexSet()) {
-        if (v->getInfo().hasParking) {
-            parkingNodes.push_back(v->getInfo());
-        }
+    RouteRestrictions drivingRestrictions = RouteRestrictions::compile(
+        graph, avoidNodes, avoidSegments, Edge<LocationInfo>::EdgeType::DRIVING);
+    RouteRestrictions walkingRestrictions = RouteRestrictions::compile(
+        graph, avoidNodes, avoidSegments, Edge<LocationInfo>::EdgeType::WALKING);
+
+    std::vector<Vertex<LocationInfo> *> parkingNodes;
+    std::vector<double> indexedWalkingTimes;
+    bool indexed = findParkingCandidates(
+        graph, destVertex, walkingRestrictions, 60, parkingNodes, indexedWalkingTimes);
+
+    auto drivingTree = getCachedTree(graph, sourceVertex, drivingRestrictions);
+    std::vector<double> walkingTimes = indexedWalkingTimes;
+    if (!indexed) {
+        measureParkingWalks(graph, parkingNodes, destVertex, walkingRestrictions, *drivingTree, 60, false,
+                            walkingTimes);
     }
 
-    auto drivingFilter = createEcoRouteFilter(avoidNodes, avoidSegments, Edge<LocationInfo>::EdgeType::DRIVING);
-    auto walkingFilter = createEcoRouteFilter(avoidNodes, avoidSegments, Edge<LocationInfo>::EdgeType::WALKING);
-
     std::vector<EcoRoute> allPossibleRoutes;
+    std::vector<const Vertex<LocationInfo> *> routeParking;
 
-    for (const auto &parkingNode: parkingNodes) {
-        auto drivingRoute = findRouteWithFilter(graph, sourceCode, parkingNode.code, drivingFilter);
-
-        if (drivingRoute.empty()) {
+    for (size_t i = 0; i < parkingNodes.size(); i++) {
+        Vertex<LocationInfo> *parkingNode = parkingNodes[i];
+        if (!mayReach(parkingNode, destVertex, walkingRestrictions)) {
             continue;
         }
 
-        auto walkingRoute = findRouteWithFilter(graph, parkingNode.code, destCode, walkingFilter);
-
-        if (walkingRoute.empty()) {
+        double drivingTime = drivingTree->dist[parkingNode->getIndex()];
+        double walkingTime = walkingTimes[i];
+        if (drivingTime == INF || walkingTime == INF) {
             continue;
         }
 
-        double drivingTime = calculateRouteTime(drivingRoute, graph, Edge<LocationInfo>::EdgeType::DRIVING);
-        double walkingTime = calculateRouteTime(walkingRoute, graph, Edge<LocationInfo>::EdgeType::WALKING);
         double totalTime = drivingTime + walkingTime;
 
         if (walkingTime > 0 && walkingTime < 60) {
             EcoRoute route;
-            route.drivingRoute = drivingRoute;
-            route.parkingNode = parkingNode;
-            route.walkingRoute = walkingRoute;
+            route.parkingNode = parkingNode->getInfo();
             route.totalTime = totalTime;
             route.walkingTime = walkingTime;
             route.isValid = true;
 
             allPossibleRoutes.push_back(route);
+            routeParking.push_back(parkingNode);
         }
     }
 
-    std::sort(allPossibleRoutes.begin(), allPossibleRoutes.end(),
-              [](const EcoRoute &a, const EcoRoute &b) {
-                  return a.totalTime < b.totalTime;
+    std::vector<size_t> order(allPossibleRoutes.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(),
+              [&](size_t a, size_t b) {
+                  return allPossibleRoutes[a].totalTime < allPossibleRoutes[b].totalTime;
               });
 
     int routesToInclude = std::min(2, static_cast<int>(allPossibleRoutes.size()));
     for (int i = 0; i < routesToInclude; i++) {
-        approximateRoutes.push_back(allPossibleRoutes[i]);
+        EcoRoute &route = allPossibleRoutes[order[i]];
+        const Vertex<LocationInfo> *parkingNode = routeParking[order[i]];
+        route.drivingRoute = getTreeRoute(*drivingTree, parkingNode);
+        route.walkingRoute = getTreeRoute(*getCachedTree(graph, parkingNode, walkingRestrictions), destVertex);
+        approximateRoutes.push_back(route);
     }
 
     return approximateRoutes;
@@ -711,18 +1611,18 @@ void Routing::outputMultipleEcoRoutesToFile(
         const auto &route = routes[i];
 
         std::string drivingRouteStr;
-        for (size_t j = 0; j < route.drivingRoute.size(); j++) {
-            drivingRouteStr += std::to_string(route.drivingRoute[j].id);
-            if (j < route.drivingRoute.size() - 1) {
+        for (size_t j = 0; j < route.drivingRoute.locations.size(); j++) {
+            drivingRouteStr += std::to_string(route.drivingRoute.locations[j].id);
+            if (j < route.drivingRoute.locations.size() - 1) {
                 drivingRouteStr += ",";
             }
         }
         drivingRouteStr += "(" + std::to_string(static_cast<int>(route.totalTime - route.walkingTime)) + ")";
 
         std::string walkingRouteStr;
-        for (size_t j = 0; j < route.walkingRoute.size(); j++) {
-            walkingRouteStr += std::to_string(route.walkingRoute[j].id);
-            if (j < route.walkingRoute.size() - 1) {
+        for (size_t j = 0; j < route.walkingRoute.locations.size(); j++) {
+            walkingRouteStr += std::to_string(route.walkingRoute.locations[j].id);
+            if (j < route.walkingRoute.locations.size() - 1) {
                 walkingRouteStr += ",";
             }
         }
@@ -4,8 +4,10 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <memory>
 #include "../graph_structure/Graph.h"
 #include "../graph_builder/GraphBuilder.h"
+#include "RouteRestrictions.h"
 
 /**
  * @class Routing
@@ -21,7 +23,124 @@ public:
     using EdgeFilter = std::function<bool(Edge<LocationInfo> *)>;
 
     /**
-     * @brief Implements Dijkstra's shortest path algorithm
+     * @brief Shortest-path tree produced by a single one-to-all search
+     *
+     * Distances and tree edges are indexed by Vertex::getIndex(), so building a tree
+     * never writes to the graph and the tree stays valid after other searches run.
+     */
+    struct SearchTree {
+        std::vector<double> dist; /**< Distance from (or, for backward trees, to) the root; INF if unreached */
+        std::vector<Edge<LocationInfo> *> parent; /**< Tree edge of each vertex; nullptr for the root */
+        bool backward = false; /**< True if the tree was grown over incoming edges towards the root */
+    };
+
+    /**
+     * @brief Dense travel-time matrix between a list of sources and a list of targets
+     */
+    struct DistanceMatrix {
+        size_t rows = 0; /**< Number of sources */
+        size_t cols = 0; /**< Number of targets */
+        std::vector<double> values; /**< Row-major travel times, INF where a target is unreachable */
+
+        /**
+         * @brief Gets the travel time from a source to a target
+         * @param row Index of the source
+         * @param col Index of the target
+         * @return Travel time in minutes, INF if unreachable
+         * @details O(1)
+         */
+        double at(size_t row, size_t col) const {
+            return values[row * cols + col];
+        }
+    };
+
+    /**
+     * @brief Route that keeps the edges and times of the search it came from
+     *
+     * edges[i] leads from locations[i] to locations[i + 1] and times[i] is the travel time from
+     * the start to locations[i], so the total time, the mode of every hop and the output
+     * format are all read off the route without looking anything up in the graph.
+     */
+    struct Route {
+        std::vector<LocationInfo> locations; /**< Visited locations in order, carrying their ids and codes */
+        std::vector<Edge<LocationInfo> *> edges; /**< Traversed edges, one fewer than locations */
+        std::vector<double> times; /**< Cumulative travel time on arrival at each location */
+
+        /**
+         * @brief Checks whether the route is empty, which means no route was found
+         * @return True if the route has no locations
+         * @details O(1)
+         */
+        bool empty() const {
+            return locations.empty();
+        }
+
+        /**
+         * @brief Gets the travel time of the whole route
+         * @return Time in minutes, 0 for an empty route
+         * @details O(1)
+         */
+        double totalTime() const {
+            return times.empty() ? 0 : times.back();
+        }
+    };
+
+    /**
+     * @brief Builds a complete shortest-path tree rooted at a vertex
+     * @param graph The graph to search
+     * @param root The root vertex of the tree
+     * @param filter Optional filter to exclude certain edges
+     * @param backward If true, follows incoming edges so that distances are measured towards the root
+     * @return The shortest-path tree
+     * @details O(E log V) where E is the number of edges and V is the number of vertices
+     */
+    static SearchTree buildSearchTree(
+        const Graph<LocationInfo> &graph,
+        const Vertex<LocationInfo> *root,
+        const EdgeFilter &filter = nullptr,
+        bool backward = false);
+
+    /**
+     * @brief Builds a complete shortest-path tree that honours compiled restrictions
+     *
+     * An unrestricted forward tree is grown by the DeltaStepping search of the mode when one
+     * was prepared for this graph, which only large graphs get. Otherwise the search runs on the
+     * ContractedGraph core of the restrictions' mode when one was prepared for this graph, and
+     * on the full graph otherwise.
+     *
+     * @param graph The graph to search
+     * @param root The root vertex of the tree
+     * @param restrictions Restrictions compiled for this graph
+     * @param backward If true, follows incoming edges so that distances are measured towards the root
+     * @return The shortest-path tree
+     * @details O(E log V) where E is the number of edges and V is the number of vertices
+     */
+    static SearchTree buildSearchTree(
+        const Graph<LocationInfo> &graph,
+        const Vertex<LocationInfo> *root,
+        const RouteRestrictions &restrictions,
+        bool backward = false);
+
+    /**
+     * @brief Reads a route, with its edges and times, out of a shortest-path tree
+     * @param tree The tree to walk
+     * @param vertex The vertex at the far end of the route
+     * @return Root to vertex for forward trees, vertex to root for backward trees; empty if unreached
+     * @details O(N) where N is the length of the route
+     */
+    static Route getTreeRoute(const SearchTree &tree, const Vertex<LocationInfo> *vertex);
+
+    /**
+     * @brief Builds a route from a chain of edges
+     * @param start The first vertex of the route
+     * @param edges Edges in travel order, each leaving the vertex the previous one entered
+     * @return The route with its cumulative times
+     * @details O(N) where N is the number of edges
+     */
+    static Route makeRoute(const Vertex<LocationInfo> *start, const std::vector<Edge<LocationInfo> *> &edges);
+
+    /**
+     * @brief Implements Dijkstra's shortest path algorithm, storing distances and paths in the vertices
      * @param graph The graph to run the algorithm on
      * @param source The source vertex
      * @param filter Optional filter to exclude certain edges
@@ -32,20 +151,48 @@ public:
         const LocationInfo &source,
         EdgeFilter filter = nullptr);
 
+    /**
+     * @brief Runs Dijkstra's algorithm from a source towards one target, storing distances and paths in the vertices
+     *
+     * When an ArcFlags index was prepared for the graph and mode, edges not flagged for the
+     * target's region are skipped. Only the distance and path of the target are guaranteed.
+     *
+     * @param graph The graph to run the algorithm on
+     * @param source The source vertex
+     * @param target The target vertex
+     * @param transportMode The mode of transport, DEFAULT accepts every mode
+     * @details O(E log V) in the worst case, usually far less with arc flags
+     */
+    static void dijkstra(
+        Graph<LocationInfo> &graph,
+        const LocationInfo &source,
+        const LocationInfo &target,
+        Edge<LocationInfo>::EdgeType transportMode);
+
     /**
      * @brief Finds the fastest route between two locations
+     *
+     * A route already in the RouteCache is returned without a search, and so is one read from
+     * an AllPairsTable prepared for the graph and mode. A tree of the source already in the
+     * SearchTreeCache answers the query directly.
+     * Otherwise an ArcFlags index prepared for the graph and mode runs a pruned search to the
+     * destination, and without one the source's full tree is built and cached. With a
+     * departure time, the query runs over the loaded TravelTimeProfiles instead.
+     *
      * @param graph The transportation graph
      * @param sourceCode Source location code
      * @param destCode Destination location code
      * @param transportMode The mode of transport to use (driving or walking)
-     * @return Vector of locations representing the path
+     * @param departureTime Departure time in minutes after midnight, negative to use static times
+     * @return The route, empty if there is none
      * @details O(E log V) where E is the number of edges and V is the number of vertices
      */
-    static std::vector<LocationInfo> findFastestRoute(
+    static Route findFastestRoute(
         const Graph<LocationInfo> &graph,
         const std::string &sourceCode,
         const std::string &destCode,
-        Edge<LocationInfo>::EdgeType transportMode = Edge<LocationInfo>::EdgeType::DEFAULT);
+        Edge<LocationInfo>::EdgeType transportMode = Edge<LocationInfo>::EdgeType::DEFAULT,
+        double departureTime = -1);
 
     /**
      * @brief Finds an alternative route that avoids the fastest path
@@ -54,31 +201,218 @@ public:
      * @param sourceCode Source location code
      * @param destCode Destination location code
      * @param transportMode The mode of transport to use
-     * @return Vector of locations representing the alternative path
+     * @return The alternative route, empty if there is none
      * @details O(E log V) where E is the number of edges and V is the number of vertices
      */
-    static std::vector<LocationInfo> findAlternativeRoute(
+    static Route findAlternativeRoute(
         const Graph<LocationInfo> &originalGraph,
-        const std::vector<LocationInfo> &fastestPath,
+        const Route &fastestPath,
         const std::string &sourceCode,
         const std::string &destCode,
         Edge<LocationInfo>::EdgeType transportMode = Edge<LocationInfo>::EdgeType::DEFAULT);
 
+    /**
+     * @brief Computes the travel time from every source to every target
+     *
+     * Each row is a one-to-many search that stops as soon as all targets are settled.
+     * Rows are independent and are distributed across worker threads.
+     *
+     * @param graph The transportation graph
+     * @param sourceCodes Source location codes, one per row
+     * @param targetCodes Target location codes, one per column
+     * @param transportMode The mode of transport to use
+     * @param filter Optional additional filter to exclude certain edges
+     * @param threads Number of worker threads, 0 to use the hardware concurrency
+     * @return The dense row-major matrix; rows of unknown sources are all INF
+     * @details O(S * E log V / P) where S is the number of sources and P the number of threads
+     */
+    static DistanceMatrix distanceMatrix(
+        const Graph<LocationInfo> &graph,
+        const std::vector<std::string> &sourceCodes,
+        const std::vector<std::string> &targetCodes,
+        Edge<LocationInfo>::EdgeType transportMode = Edge<LocationInfo>::EdgeType::DEFAULT,
+        const EdgeFilter &filter = nullptr,
+        unsigned int threads = 0);
+
+    /**
+     * @brief Finds the fastest route that passes through a set of mandatory stops
+     *
+     * One search tree is built from the source and from every stop, which yields the full
+     * leg matrix. With keepOrder the stops are visited as given; otherwise the visiting
+     * order is solved exactly with Held-Karp for up to MAX_EXACT_STOPS stops, and with a
+     * nearest-neighbour tour improved by 2-opt beyond that. Legs are stitched from the trees.
+     *
+     * @param graph The transportation graph
+     * @param sourceCode Source location code
+     * @param destCode Destination location code
+     * @param stopCodes Location codes of the intermediate stops
+     * @param restrictions Restrictions compiled for this graph
+     * @param keepOrder If true, stops are visited in the given order
+     * @return The stitched route, empty if some leg is unreachable
+     * @details O((K + 1) * E log V + 2^K * K^2) where K is the number of stops
+     */
+    static Route findRouteThroughStops(
+        const Graph<LocationInfo> &graph,
+        const std::string &sourceCode,
+        const std::string &destCode,
+        const std::vector<std::string> &stopCodes,
+        const RouteRestrictions &restrictions,
+        bool keepOrder = true);
+
+    /** @brief Largest number of stops whose visiting order is solved exactly */
+    static const int MAX_EXACT_STOPS = 12;
+
+    /**
+     * @brief Finds several meaningfully different alternatives to the fastest route
+     *
+     * Uses choice routing: one forward tree from the source and one backward tree from the
+     * destination are built, and every vertex v defines a via-route source -> v -> destination.
+     * Vertices on the same plateau (a stretch where both trees agree) produce the same route,
+     * so each plateau is considered once. A via-route is admissible if it is at most
+     * (1 + maxStretch) times the optimum, shares at most maxSharing of the optimum's length
+     * with every route already chosen, and its plateau covers at least minLocalOptimality of
+     * the optimum, which guarantees that stretch of the route is locally a shortest path.
+     *
+     * @param graph The transportation graph
+     * @param sourceCode Source location code
+     * @param destCode Destination location code
+     * @param transportMode The mode of transport to use
+     * @param maxAlternatives Maximum number of alternatives to return
+     * @param maxStretch Allowed relative detour over the fastest route
+     * @param maxSharing Allowed overlap with already chosen routes, relative to the fastest route
+     * @param minLocalOptimality Minimum plateau length, relative to the fastest route
+     * @return Alternative routes ordered by quality, not including the fastest route itself
+     * @details O(E log V + V * N) where N is the length of a via-route
+     */
+    static std::vector<Route> findAlternativeRoutes(
+        const Graph<LocationInfo> &graph,
+        const std::string &sourceCode,
+        const std::string &destCode,
+        Edge<LocationInfo>::EdgeType transportMode = Edge<LocationInfo>::EdgeType::DEFAULT,
+        int maxAlternatives = 3,
+        double maxStretch = 0.25,
+        double maxSharing = 0.8,
+        double minLocalOptimality = 0.25);
+
+    /**
+     * @brief A location reached within a time budget
+     */
+    struct ReachedLocation {
+        int id; /**< Location ID */
+        double time; /**< Travel time from the origin in minutes */
+    };
+
+    /**
+     * @brief Locations reachable from an origin, split into rings by time budget
+     */
+    struct Isochrone {
+        std::vector<double> budgets; /**< Budgets in ascending order, without duplicates */
+        std::vector<std::vector<ReachedLocation> > rings; /**< rings[k] holds times in (budgets[k - 1], budgets[k]], by time */
+
+        /**
+         * @brief Counts the locations reachable within a budget
+         * @param ring Index of the budget
+         * @return Number of locations in rings 0 to ring
+         * @details O(K) where K is the number of rings
+         */
+        size_t reachableWithin(size_t ring) const {
+            size_t count = 0;
+            for (size_t k = 0; k <= ring && k < rings.size(); k++) {
+                count += rings[k].size();
+            }
+            return count;
+        }
+    };
+
+    /**
+     * @brief Finds every location reachable from an origin within one or more time budgets
+     *
+     * A single search runs up to the largest budget and stops there, so the cost depends on
+     * the size of the largest catchment rather than on the graph; on large graphs it is the
+     * DeltaStepping search of the mode. If the SearchTreeCache already holds the full tree of
+     * the origin for this mode, it is read instead of searching.
+     *
+     * @param graph The transportation graph
+     * @param sourceCode Origin location code
+     * @param budgets Time budgets in minutes, in any order; negative budgets are ignored
+     * @param transportMode The mode of transport to use
+     * @return One ring per distinct budget; empty if the origin does not exist
+     * @details O(E' log V' + V) where E' and V' are the edges and vertices within the largest budget
+     */
+    static Isochrone findReachable(
+        const Graph<LocationInfo> &graph,
+        const std::string &sourceCode,
+        const std::vector<double> &budgets,
+        Edge<LocationInfo>::EdgeType transportMode = Edge<LocationInfo>::EdgeType::DEFAULT);
+
     /**
      * @brief Finds a route with specific filtering constraints
      * @param graph The transportation graph
      * @param sourceCode Source location code
      * @param destCode Destination location code
      * @param filter Function to filter edges
-     * @return Vector of locations representing the path
+     * @return The route, empty if there is none
      * @details O(E log V) where E is the number of edges and V is the number of vertices
      */
-    static std::vector<LocationInfo> findRouteWithFilter(
+    static Route findRouteWithFilter(
         const Graph<LocationInfo> &graph,
         const std::string &sourceCode,
         const std::string &destCode,
         EdgeFilter filter);
 
+    /**
+     * @brief Finds the fastest route that honours compiled restrictions
+     *
+     * Like findFastestRoute, the route is kept in the RouteCache under the restrictions'
+     * fingerprint, and the source's tree in the SearchTreeCache under the restrictions' avoid
+     * lists. Time-dependent queries are not cached.
+     *
+     * @param graph The transportation graph
+     * @param sourceCode Source location code
+     * @param destCode Destination location code
+     * @param restrictions Restrictions compiled for this graph
+     * @param departureTime Departure time in minutes after midnight, negative to use static times
+     * @return The route, empty if there is none
+     * @details O(E log V) on a cache miss, O(N) on a hit where N is the length of the path
+     */
+    static Route findRouteWithRestrictions(
+        const Graph<LocationInfo> &graph,
+        const std::string &sourceCode,
+        const std::string &destCode,
+        const RouteRestrictions &restrictions,
+        double departureTime = -1);
+
+    /**
+     * @brief Finds the fastest route for a departure time, following the loaded TravelTimeProfiles
+     *
+     * The route's times are arrival times, in minutes after the departure. Without profiles
+     * for the graph every edge keeps its static weight.
+     *
+     * @param graph The transportation graph
+     * @param source The source vertex
+     * @param target The target vertex
+     * @param restrictions Restrictions compiled for this graph
+     * @param departureTime Departure time in minutes after midnight
+     * @return The route, empty if there is none
+     * @details O(E (log V + B)) where B is the number of breakpoints of a profile
+     */
+    static Route findTimeDependentRoute(
+        const Graph<LocationInfo> &graph,
+        const Vertex<LocationInfo> *source,
+        const Vertex<LocationInfo> *target,
+        const RouteRestrictions &restrictions,
+        double departureTime);
+
+    /**
+     * @brief Recomputes the times of a route for a departure time, following the loaded TravelTimeProfiles
+     * @param graph The transportation graph the route was found on
+     * @param route The route
+     * @param departureTime Departure time in minutes after midnight
+     * @return The route with arrival times for that departure, unchanged without profiles
+     * @details O(N * (D + B)) where N is the length of the route and D the largest degree
+     */
+    static Route timeRoute(const Graph<LocationInfo> &graph, const Route &route, double departureTime);
+
     /**
      * @brief Calculates the total time for a route using default transport mode
      * @param path Vector of locations representing the path
@@ -104,14 +438,19 @@ public:
         Edge<LocationInfo>::EdgeType transportMode);
 
     /**
-     * @brief Displays a route to the console
-     * @param path Vector of locations representing the path
-     * @param graph The transportation graph
-     * @details O(N) where N is the length of the path
+     * @brief Gets the total time of a route that kept its edges
+     * @param route The route
+     * @return Total time in minutes
+     * @details O(1)
      */
-    static void displayRoute(
-        const std::vector<LocationInfo> &path,
-        const Graph<LocationInfo> &graph);
+    static double calculateRouteTime(const Route &route);
+
+    /**
+     * @brief Displays a route to the console, with the time and mode of every hop
+     * @param route The route to display
+     * @details O(N) where N is the length of the route
+     */
+    static void displayRoute(const Route &route);
 
     /**
      * @brief Outputs routes to a file
@@ -120,16 +459,14 @@ public:
      * @param destId Destination location ID
      * @param bestRoute The best route found
      * @param alternativeRoute An alternative route
-     * @param graph The transportation graph
      * @details O(N) where N is the length of the routes
      */
     static void outputRoutesToFile(
         const std::string &filename,
         int sourceId,
         int destId,
-        const std::vector<LocationInfo> &bestRoute,
-        const std::vector<LocationInfo> &alternativeRoute,
-        const Graph<LocationInfo> &graph);
+        const Route &bestRoute,
+        const Route &alternativeRoute);
 
     /**
      * @brief Formats a route for output
@@ -142,13 +479,21 @@ public:
         const std::vector<LocationInfo> &route,
         double totalTime);
 
+    /**
+     * @brief Formats a route for output with its own total time
+     * @param route The route to format
+     * @return Formatted string representation of the route
+     * @details O(N) where N is the length of the route
+     */
+    static std::string formatRouteForOutput(const Route &route);
+
     /**
      * @brief Structure to store environmentally-friendly route information
      */
     struct EcoRoute {
-        std::vector<LocationInfo> drivingRoute; /**< The driving segment of the route */
+        Route drivingRoute; /**< The driving segment of the route */
         LocationInfo parkingNode; /**< The parking location */
-        std::vector<LocationInfo> walkingRoute; /**< The walking segment of the route */
+        Route walkingRoute; /**< The walking segment of the route */
         double totalTime; /**< Total travel time in minutes */
         double walkingTime; /**< Walking time in minutes */
         bool isValid; /**< Flag indicating if the route is valid */
@@ -157,6 +502,11 @@ public:
 
     /**
      * @brief Finds an environmentally-friendly route combining driving and walking
+     *
+     * With a ParkingIndex prepared for the graph and no avoid lists, only the parking locations
+     * within walking range of the destination are tried, and only the winner's walk is searched.
+     * Answers are kept in the RouteCache.
+     *
      * @param graph The transportation graph
      * @param sourceCode Source location code
      * @param destCode Destination location code
@@ -165,7 +515,7 @@ public:
      * @param avoidSegments Optional list of segments to avoid
      * @return EcoRoute structure with route information
      * @details O(P * E log V) where P is the number of parking nodes, E is the number of edges,
-     *             and V is the number of vertices
+     *             and V is the number of vertices; trees already in the SearchTreeCache are not rebuilt
      */
     static EcoRoute findEnvironmentallyFriendlyRoute(
         const Graph<LocationInfo> &graph,
@@ -177,6 +527,9 @@ public:
 
     /**
      * @brief Finds approximate environmentally-friendly routes when strict constraints can't be met
+     *
+     * Answers are kept in the RouteCache.
+     *
      * @param graph The transportation graph
      * @param sourceCode Source location code
      * @param destCode Destination location code
@@ -193,6 +546,14 @@ public:
         const std::vector<int> &avoidNodes = {},
         const std::vector<std::pair<int, int>> &avoidSegments = {});
 
+    /**
+     * @brief Formats an eco-route as the DrivingRoute, ParkingNode, WalkingRoute and TotalTime lines of the output file
+     * @param route The eco-route to format
+     * @return The lines, with a Message line for invalid routes
+     * @details O(N) where N is the length of the route
+     */
+    static std::string formatEcoRouteForOutput(const EcoRoute &route);
+
     /**
      * @brief Outputs an eco-route to a file
      * @param filename The output file name
@@ -237,50 +598,153 @@ public:
 
 private:
     /**
-     * @brief Relaxes an edge in Dijkstra's algorithm
-     * @param edge The edge to relax
-     * @return True if the edge was relaxed, false otherwise
-     * @details O(1)
+     * @brief Searches the fastest route between two locations, bypassing the RouteCache
+     * @details See findFastestRoute
+     */
+    static Route searchFastestRoute(
+        const Graph<LocationInfo> &graph,
+        const std::string &sourceCode,
+        const std::string &destCode,
+        Edge<LocationInfo>::EdgeType transportMode,
+        double departureTime);
+
+    /**
+     * @brief Searches the fastest route that honours compiled restrictions, bypassing the RouteCache
+     * @details See findRouteWithRestrictions
+     */
+    static Route searchRouteWithRestrictions(
+        const Graph<LocationInfo> &graph,
+        const std::string &sourceCode,
+        const std::string &destCode,
+        const RouteRestrictions &restrictions,
+        double departureTime);
+
+    /**
+     * @brief Searches an environmentally-friendly route, bypassing the RouteCache
+     * @details See findEnvironmentallyFriendlyRoute
+     */
+    static EcoRoute searchEnvironmentallyFriendlyRoute(
+        const Graph<LocationInfo> &graph,
+        const std::string &sourceCode,
+        const std::string &destCode,
+        double maxWalkingTime,
+        const std::vector<int> &avoidNodes,
+        const std::vector<std::pair<int, int> > &avoidSegments);
+
+    /**
+     * @brief Searches approximate environmentally-friendly routes, bypassing the RouteCache
+     * @details See findApproximateEcoRoutes
+     */
+    static std::vector<EcoRoute> searchApproximateEcoRoutes(
+        const Graph<LocationInfo> &graph,
+        const std::string &sourceCode,
+        const std::string &destCode,
+        const std::vector<int> &avoidNodes,
+        const std::vector<std::pair<int, int> > &avoidSegments);
+
+    /**
+     * @brief Orders intermediate stops to minimise the total travel time
+     * @param legs Leg matrix; row 0 is the source, row i the stop i, column i - 1 the stop i, column K the destination
+     * @param stopCount Number of stops K
+     * @return Stop indices (0-based) in visiting order
+     * @details O(2^K * K^2) for K <= MAX_EXACT_STOPS, O(I * K^3) otherwise where I is the number of 2-opt passes
      */
-    static bool relax(Edge<LocationInfo> *edge);
+    static std::vector<int> orderStops(const std::vector<std::vector<double> > &legs, int stopCount);
 
     /**
-     * @brief Reconstructs a path from source to destination
+     * @brief Gets a shortest-path tree from the SearchTreeCache, building and storing it on a miss
+     * @param graph The transportation graph
+     * @param root The root vertex of the tree
+     * @param restrictions Restrictions compiled for this graph
+     * @param backward If true, the tree follows incoming edges towards the root
+     * @return Shared handle to the tree
+     * @details O(1) on a hit, O(E log V) on a miss
+     */
+    static std::shared_ptr<const SearchTree> getCachedTree(
+        const Graph<LocationInfo> &graph,
+        const Vertex<LocationInfo> *root,
+        const RouteRestrictions &restrictions,
+        bool backward = false);
+
+    /**
+     * @brief Lists the parking locations an eco query has to try
+     *
+     * Without avoid lists, and when the ParkingIndex holds every parking location within the
+     * walking limit of the destination, the candidates and their walking times come from the
+     * index. Otherwise every parking location is a candidate and its walk must be searched.
+     *
      * @param graph The transportation graph
-     * @param source The source vertex
      * @param dest The destination vertex
-     * @return Vector of locations representing the path
-     * @details O(N) where N is the length of the path
+     * @param walkingRestrictions Walking restrictions compiled for the graph
+     * @param maxWalkingTime The walking limit
+     * @param parkingNodes Receives the candidates, in vertex order
+     * @param walkingTimes Receives the walking time of every candidate to the destination, if indexed
+     * @return True if the candidates came from the index
+     * @details O(k log k) from the index, O(V) otherwise
      */
-    static std::vector<LocationInfo> getPath(
+    static bool findParkingCandidates(
         const Graph<LocationInfo> &graph,
-        const LocationInfo &source,
-        const LocationInfo &dest);
+        const Vertex<LocationInfo> *dest,
+        const RouteRestrictions &walkingRestrictions,
+        double maxWalkingTime,
+        std::vector<Vertex<LocationInfo> *> &parkingNodes,
+        std::vector<double> &walkingTimes);
+
+    /**
+     * @brief Searches the walks from parking candidates to the destination in parallel
+     *
+     * Candidates are spread over a WorkStealing loop, each thread searching with its own tree
+     * and stopping every walk at the walking limit. When pruning, threads share the best total
+     * found so far through an atomic bound: a candidate whose driving time alone exceeds it is
+     * skipped, and walks stop once they could no longer tie it. Candidates skipped or out of
+     * reach get INF, and none of them could have won, not even on a tie.
+     *
+     * @param graph The transportation graph
+     * @param parkingNodes The candidates
+     * @param dest The destination vertex
+     * @param walkingRestrictions Walking restrictions compiled for the graph
+     * @param drivingTree Driving tree rooted at the source
+     * @param maxWalkingTime The walking limit
+     * @param prune Whether to prune against the best total, for queries that only need the best candidate
+     * @param walkingTimes Receives the walking time of every candidate
+     * @details O(P * W / T) where P is the number of candidates, W the cost of a walk bounded by
+     * the limit and T the number of threads
+     */
+    static void measureParkingWalks(
+        const Graph<LocationInfo> &graph,
+        const std::vector<Vertex<LocationInfo> *> &parkingNodes,
+        const Vertex<LocationInfo> *dest,
+        const RouteRestrictions &walkingRestrictions,
+        const SearchTree &drivingTree,
+        double maxWalkingTime,
+        bool prune,
+        std::vector<double> &walkingTimes);
 
     /**
-     * @brief Creates a graph excluding a specified path
-     * @param originalGraph The original graph
-     * @param pathToRemove The path to remove from the graph
-     * @return A new graph without the specified path
-     * @details O(V + E) where V is the number of vertices and E is the number of edges
+     * @brief Rules out queries that cannot have a route before any search is run
+     *
+     * Two locations in different components of the mode, as labelled by GraphBuilder, are never
+     * connected, and neither is an avoided endpoint. The labels ignore the avoid lists, so a
+     * true result is only a necessary condition for a route.
+     *
+     * @param from The origin vertex
+     * @param to The destination vertex
+     * @param restrictions Restrictions compiled for the graph
+     * @return False if no route can exist
+     * @details O(1)
      */
-    static Graph<LocationInfo> createGraphWithoutPath(
-        const Graph<LocationInfo> &originalGraph,
-        const std::vector<LocationInfo> &pathToRemove);
+    static bool mayReach(
+        const Vertex<LocationInfo> *from,
+        const Vertex<LocationInfo> *to,
+        const RouteRestrictions &restrictions);
 
     /**
-     * @brief Creates a filter for eco-routing based on constraints
-     * @param avoidNodes Nodes to avoid
-     * @param avoidSegments Segments to avoid
+     * @brief Creates a filter that only accepts edges of a given transport mode
      * @param transportMode Transport mode to filter for
-     * @return A filter function
-     * @details O(1) for filter creation, O(A+S) per edge evaluation where A is the number of
-     *             avoid nodes and S is the number of avoid segments
+     * @return A filter function, or nullptr if every mode is accepted
+     * @details O(1)
      */
-    static EdgeFilter createEcoRouteFilter(
-        const std::vector<int> &avoidNodes,
-        const std::vector<std::pair<int, int> > &avoidSegments,
-        Edge<LocationInfo>::EdgeType transportMode);
+    static EdgeFilter createModeFilter(Edge<LocationInfo>::EdgeType transportMode);
 
     /**
      * @brief Checks if two nodes are adjacent in the graph
@@ -0,0 +1,34 @@
+#include "SearchBudget.h"
+
+const unsigned int SearchBudget::CHECK_INTERVAL;
+
+thread_local const SearchBudget::Scope *SearchBudget::current = nullptr;
+
+SearchBudget::Token::Token() : cancelled(std::make_shared<std::atomic<bool> >(false)) {
+}
+
+void SearchBudget::Token::cancel() const {
+    cancelled->store(true, std::memory_order_relaxed);
+}
+
+bool SearchBudget::Token::isCancelled() const {
+    return cancelled->load(std::memory_order_relaxed);
+}
+
+SearchBudget::Scope::Scope(Clock::time_point deadline, const Token &token)
+    : deadline(deadline), token(token), previous(current) {
+    current = this;
+}
+
+SearchBudget::Scope::~Scope() {
+    current = previous;
+}
+
+void SearchBudget::enforce(const Scope &scope) {
+    if (scope.token.isCancelled()) {
+        throw Exhausted(true);
+    }
+    if (Clock::now() > scope.deadline) {
+        throw Exhausted(false);
+    }
+}
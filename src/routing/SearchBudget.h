@@ -0,0 +1,162 @@
+#ifndef SEARCHBUDGET_H
+#define SEARCHBUDGET_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "WorkStealing.h"
+
+/**
+ * @class SearchBudget
+ * @brief Deadline and cancellation for the searches run on one thread
+ *
+ * A query is bounded by binding a budget to its thread with a Scope; every Routing entry point
+ * called inside the scope runs under it. The budget is checked at the start of every search and
+ * every CHECK_INTERVAL vertices the search loops settle: once
+ * the deadline has passed or the token is cancelled, Exhausted is thrown and the query unwinds.
+ * SearchTreeCache and RouteCache only store finished searches, so an abandoned query leaves
+ * nothing behind. Threads without a bound budget pay one thread-local load per check.
+ */
+class SearchBudget {
+public:
+    /** @brief Clock deadlines are measured on */
+    using Clock = std::chrono::steady_clock;
+
+    /** @brief Vertices settled between two checks of a search loop, a power of two */
+    static const unsigned int CHECK_INTERVAL = 256;
+
+    /**
+     * @class Token
+     * @brief Cancellation flag shared by the copies of a token
+     */
+    class Token {
+    public:
+        /**
+         * @brief Creates a token that is not cancelled
+         * @details O(1)
+         */
+        Token();
+
+        /**
+         * @brief Cancels every search bound to a copy of the token
+         * @details O(1)
+         */
+        void cancel() const;
+
+        /**
+         * @brief Tells whether the token was cancelled
+         * @return True once cancel was called on any copy
+         * @details O(1)
+         */
+        bool isCancelled() const;
+
+    private:
+        /** @brief The shared flag */
+        std::shared_ptr<std::atomic<bool> > cancelled;
+    };
+
+    /**
+     * @class Exhausted
+     * @brief Thrown out of a search whose deadline passed or whose token was cancelled
+     */
+    class Exhausted : public std::runtime_error {
+    public:
+        /**
+         * @param cancelled True if the token was cancelled, false if the deadline passed
+         */
+        explicit Exhausted(bool cancelled)
+            : std::runtime_error(cancelled ? "Request cancelled" : "Deadline exceeded"), cancelled(cancelled) {
+        }
+
+        /**
+         * @brief Tells whether the search was cancelled rather than out of time
+         * @return True if the token was cancelled
+         * @details O(1)
+         */
+        bool wasCancelled() const {
+            return cancelled;
+        }
+
+    private:
+        bool cancelled;
+    };
+
+    /**
+     * @class Scope
+     * @brief Bounds the searches of the calling thread for as long as the scope lives
+     *
+     * The thread is also made serial (WorkStealing::SerialScope), so a bounded search never
+     * runs on helper threads, which would not see the budget.
+     */
+    class Scope {
+    public:
+        /**
+         * @brief Binds a budget to the calling thread
+         * @param deadline Time after which searches stop
+         * @param token Token that cancels the searches
+         * @details O(1)
+         */
+        explicit Scope(Clock::time_point deadline, const Token &token = Token());
+
+        /**
+         * @brief Restores the thread's previous budget
+         * @details O(1)
+         */
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        friend class SearchBudget;
+
+        /** @brief Time after which searches stop */
+        Clock::time_point deadline;
+
+        /** @brief Token that cancels the searches */
+        Token token;
+
+        /** @brief Budget the thread had before the scope */
+        const Scope *previous;
+
+        /** @brief Keeps bounded searches on the calling thread */
+        WorkStealing::SerialScope serial;
+    };
+
+    /**
+     * @brief Throws if the calling thread's budget is exhausted
+     * @details O(1)
+     */
+    static void check() {
+        if (current != nullptr) {
+            enforce(*current);
+        }
+    }
+
+    /**
+     * @brief Checks the budget when a search loop has settled a multiple of CHECK_INTERVAL vertices
+     * @param settled Vertices the loop has settled so far
+     * @details O(1)
+     */
+    static void checkEvery(unsigned int settled) {
+        if ((settled & (CHECK_INTERVAL - 1)) == 0) {
+            check();
+        }
+    }
+
+private:
+    /** @brief Budget bound to the calling thread, nullptr if none */
+    static thread_local const Scope *current;
+
+    /**
+     * @brief Throws Exhausted if a budget has run out
+     * @param scope The budget
+     * @details O(1)
+     */
+    static void enforce(const Scope &scope);
+};
+
+#endif // SEARCHBUDGET_H
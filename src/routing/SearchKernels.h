@@ -0,0 +1,427 @@
+#ifndef SEARCHKERNELS_H
+#define SEARCHKERNELS_H
+
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "Routing.h"
+#include "RouteRestrictions.h"
+#include "SearchBudget.h"
+
+/**
+ * @class SearchKernels
+ * @brief Dijkstra kernels specialised at compile time for an edge filter and a search direction
+ *
+ * The kernel is a template over the filter functor, so the filter call is inlined and filters
+ * that accept everything disappear entirely. Transport modes are template arguments of the
+ * ready-made filters, which turns the per-edge mode comparison into a comparison against a
+ * constant. Filters that are only known at run time go through ErasedEdge, the type-erased
+ * path that Routing::EdgeFilter used to take on every search.
+ *
+ * Among equal-cost paths every kernel, here and elsewhere, settles on the same one: the parent
+ * of a vertex is the tight edge whose other end has the lowest index, and the first in that
+ * vertex's edge list if several do (see breaksTie). Travel times are positive, so the choice
+ * never closes a cycle and does not depend on the order in which vertices are settled.
+ */
+class SearchKernels {
+public:
+    /** @brief Shorthand for the transport mode enumeration */
+    using EdgeType = Edge<LocationInfo>::EdgeType;
+
+    /**
+     * @brief Filter that accepts every edge
+     */
+    struct AnyEdge {
+        bool operator()(const Edge<LocationInfo> *) const {
+            return true;
+        }
+    };
+
+    /**
+     * @brief Filter that accepts edges of one transport mode, DEFAULT accepts every mode
+     * @tparam Mode The transport mode edges must have
+     */
+    template<EdgeType Mode>
+    struct ModeEdge {
+        bool operator()(const Edge<LocationInfo> *edge) const {
+            return Mode == EdgeType::DEFAULT || edge->getType() == Mode;
+        }
+    };
+
+    /** @brief Filter for driving-only searches */
+    using DrivingEdge = ModeEdge<EdgeType::DRIVING>;
+
+    /** @brief Filter for walking-only searches */
+    using WalkingEdge = ModeEdge<EdgeType::WALKING>;
+
+    /**
+     * @brief Filter that honours compiled restrictions, with the mode fixed at compile time
+     * @tparam Mode The transport mode the restrictions were compiled for
+     */
+    template<EdgeType Mode>
+    struct RestrictedEdge {
+        const RouteRestrictions *restrictions;
+
+        bool operator()(const Edge<LocationInfo> *edge) const {
+            return ModeEdge<Mode>()(edge) && restrictions->allowsEndpoints(edge);
+        }
+    };
+
+    /**
+     * @brief Adapter that runs a type-erased Routing::EdgeFilter, a null filter accepts every edge
+     */
+    struct ErasedEdge {
+        const Routing::EdgeFilter *filter;
+
+        bool operator()(const Edge<LocationInfo> *edge) const {
+            return !*filter || (*filter)(const_cast<Edge<LocationInfo> *>(edge));
+        }
+    };
+
+    /**
+     * @brief Tells whether an edge reaching a vertex as fast as its parent should replace the parent
+     * @tparam Backward If true, the tree follows incoming edges towards the root
+     * @param edge The edge just relaxed
+     * @param parent The current parent of the vertex, nullptr for a root or seed
+     * @return True if the edge leaves from a lower-index vertex than the parent
+     * @details O(1)
+     */
+    template<bool Backward>
+    static bool breaksTie(const Edge<LocationInfo> *edge, const Edge<LocationInfo> *parent) {
+        return parent != nullptr && (Backward
+                                         ? edge->getDest()->getIndex() < parent->getDest()->getIndex()
+                                         : edge->getOrig()->getIndex() < parent->getOrig()->getIndex());
+    }
+
+    /** @brief A vertex the search starts from and its initial distance */
+    using Seed = std::pair<const Vertex<LocationInfo> *, double>;
+
+    /**
+     * @brief Grows a shortest-path tree, optionally stopping once a set of targets is settled
+     * @tparam Backward If true, follows incoming edges towards the root
+     * @tparam Filter Functor deciding whether an edge may be used
+     * @param graph The graph to search
+     * @param root The root vertex of the tree
+     * @param filter The edge filter
+     * @param targets Optional per-vertex flags marking the targets, nullptr to build the whole tree
+     * @param targetCount Number of distinct flagged targets
+     * @param tree The tree to fill, reset before the search starts
+     * @param limit Distance at which the search stops; every vertex within it is settled
+     * @details O(E log V) where E is the number of edges and V is the number of vertices
+     */
+    template<bool Backward, class Filter>
+    static void grow(
+        const Graph<LocationInfo> &graph,
+        const Vertex<LocationInfo> *root,
+        const Filter &filter,
+        const std::vector<bool> *targets,
+        int targetCount,
+        Routing::SearchTree &tree,
+        double limit = INF) {
+        Seed seed(root, 0);
+        growFrom<Backward>(graph, &seed, root == nullptr ? 0 : 1, filter, targets, targetCount, tree, limit);
+    }
+
+    /**
+     * @brief Grows a shortest-path forest from several seeds with their own initial distances
+     *
+     * Used when the root of a query is not a vertex of the searched graph, such as a location
+     * collapsed into a ContractedGraph chain. Seeds keep a null parent.
+     *
+     * @tparam Backward If true, follows incoming edges towards the seeds
+     * @tparam Filter Functor deciding whether an edge may be used
+     * @param graph The graph to search
+     * @param seeds The seeds
+     * @param seedCount Number of seeds
+     * @param filter The edge filter
+     * @param targets Optional per-vertex flags marking the targets, nullptr to build the whole tree
+     * @param targetCount Number of distinct flagged targets
+     * @param tree The tree to fill, reset before the search starts
+     * @param limit Distance at which the search stops; every vertex within it is settled
+     * @details O(E log V) where E is the number of edges and V is the number of vertices
+     */
+    template<bool Backward, class Filter>
+    static void growFrom(
+        const Graph<LocationInfo> &graph,
+        const Seed *seeds,
+        int seedCount,
+        const Filter &filter,
+        const std::vector<bool> *targets,
+        int targetCount,
+        Routing::SearchTree &tree,
+        double limit = INF) {
+        tree.backward = Backward;
+        tree.dist.assign(graph.getNumVertex(), INF);
+        tree.parent.assign(graph.getNumVertex(), nullptr);
+
+        using QueueEntry = std::pair<double, int>;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > q;
+
+        for (int i = 0; i < seedCount; i++) {
+            int v = seeds[i].first->getIndex();
+            if (seeds[i].second < tree.dist[v]) {
+                tree.dist[v] = seeds[i].second;
+                q.push({seeds[i].second, v});
+            }
+        }
+
+        const auto &vertices = graph.getVertexSet();
+        unsigned int settled = 0;
+        SearchBudget::check();
+
+        while (!q.empty()) {
+            QueueEntry top = q.top();
+            q.pop();
+
+            int v = top.second;
+            if (top.first > tree.dist[v])
+                continue; // stale entry, v was already settled with a smaller distance
+
+            SearchBudget::checkEvery(++settled);
+
+            if (top.first > limit)
+                return; // everything within the limit is settled, entries beyond it stay tentative
+
+            if (targets != nullptr && (*targets)[v] && --targetCount == 0)
+                return; // every requested target is settled, the rest of the tree is not needed
+
+            const auto &edges = Backward ? vertices[v]->getIncoming() : vertices[v]->getAdj();
+            for (auto e: edges) {
+                if (!filter(e)) {
+                    continue;
+                }
+
+                int w = Backward ? e->getOrig()->getIndex() : e->getDest()->getIndex();
+                double newDist = tree.dist[v] + e->getWeight();
+                if (newDist < tree.dist[w]) {
+                    tree.dist[w] = newDist;
+                    tree.parent[w] = e;
+                    q.push({newDist, w});
+                } else if (newDist == tree.dist[w] && breaksTie<Backward>(e, tree.parent[w])) {
+                    tree.parent[w] = e;
+                }
+            }
+        }
+    }
+
+    /** @brief An edge whose weight changed and its weight before the change */
+    using WeightChange = std::pair<Edge<LocationInfo> *, double>;
+
+    /**
+     * @brief Repairs a complete shortest-path tree after some edge weights changed
+     *
+     * Dynamic Dijkstra in the style of Ramalingam and Reps: the subtrees hanging from tree
+     * edges that got slower lose their labels and are re-seeded from their unaffected
+     * neighbours, edges that got faster seed the vertices they now improve, and a Dijkstra
+     * pass from those seeds settles only what changed.
+     *
+     * @tparam Backward If true, the tree follows incoming edges towards the root
+     * @tparam Filter Functor deciding whether an edge may be used, the one the tree was built with
+     * @param graph The graph, with the new weights already set
+     * @param changes The changed edges with their previous weights
+     * @param filter The edge filter
+     * @param tree The tree to repair
+     * @return Number of vertices settled again
+     * @details O(V + A log A) where A is the number of vertices whose distance or parent changes
+     */
+    template<bool Backward, class Filter>
+    static int repair(
+        const Graph<LocationInfo> &graph,
+        const std::vector<WeightChange> &changes,
+        const Filter &filter,
+        Routing::SearchTree &tree) {
+        const auto &vertices = graph.getVertexSet();
+        int n = graph.getNumVertex();
+
+        // head is the vertex whose label an edge sets, tail the one it is relaxed from
+        auto head = [](const Edge<LocationInfo> *e) { return Backward ? e->getOrig() : e->getDest(); };
+        auto tail = [](const Edge<LocationInfo> *e) { return Backward ? e->getDest() : e->getOrig(); };
+
+        std::vector<int> stack;
+        for (const auto &change: changes) {
+            Edge<LocationInfo> *e = change.first;
+            if (e->getWeight() > change.second && tree.parent[head(e)->getIndex()] == e)
+                stack.push_back(head(e)->getIndex());
+        }
+
+        std::vector<bool> affected(n, false);
+        std::vector<int> affectedList;
+        if (!stack.empty()) {
+            // Children of every vertex, packed by parent: children[first[v]] to children[first[v + 1] - 1]
+            std::vector<int> first(n + 1, 0);
+            std::vector<int> children(n);
+            for (int v = 0; v < n; v++) {
+                if (tree.parent[v] != nullptr)
+                    first[tail(tree.parent[v])->getIndex() + 1]++;
+            }
+            for (int v = 0; v < n; v++) {
+                first[v + 1] += first[v];
+            }
+            std::vector<int> next(first.begin(), first.end() - 1);
+            for (int v = 0; v < n; v++) {
+                if (tree.parent[v] != nullptr)
+                    children[next[tail(tree.parent[v])->getIndex()]++] = v;
+            }
+
+            while (!stack.empty()) {
+                int v = stack.back();
+                stack.pop_back();
+                if (affected[v])
+                    continue;
+
+                affected[v] = true;
+                affectedList.push_back(v);
+                for (int c = first[v]; c < first[v + 1]; c++) {
+                    stack.push_back(children[c]);
+                }
+            }
+        }
+
+        using QueueEntry = std::pair<double, int>;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > q;
+
+        for (int v: affectedList) {
+            tree.dist[v] = INF;
+            tree.parent[v] = nullptr;
+        }
+        for (int v: affectedList) {
+            for (auto e: Backward ? vertices[v]->getAdj() : vertices[v]->getIncoming()) {
+                int u = tail(e)->getIndex();
+                if (affected[u] || tree.dist[u] == INF || !filter(e))
+                    continue;
+
+                if (tree.dist[u] + e->getWeight() < tree.dist[v] ||
+                    (tree.dist[u] + e->getWeight() == tree.dist[v] && breaksTie<Backward>(e, tree.parent[v]))) {
+                    tree.dist[v] = tree.dist[u] + e->getWeight();
+                    tree.parent[v] = e;
+                }
+            }
+            if (tree.dist[v] != INF)
+                q.push({tree.dist[v], v});
+        }
+
+        for (const auto &change: changes) {
+            Edge<LocationInfo> *e = change.first;
+            int u = tail(e)->getIndex();
+            int v = head(e)->getIndex();
+            if (e->getWeight() >= change.second || tree.dist[u] == INF || !filter(e))
+                continue;
+
+            // A faster edge that only ties may still become the parent; the distances below stay put
+            if (tree.dist[u] + e->getWeight() < tree.dist[v]) {
+                tree.dist[v] = tree.dist[u] + e->getWeight();
+                tree.parent[v] = e;
+                q.push({tree.dist[v], v});
+            } else if (tree.dist[u] + e->getWeight() == tree.dist[v] && breaksTie<Backward>(e, tree.parent[v])) {
+                tree.parent[v] = e;
+            }
+        }
+
+        int settled = 0;
+        while (!q.empty()) {
+            QueueEntry top = q.top();
+            q.pop();
+
+            int v = top.second;
+            if (top.first > tree.dist[v])
+                continue;
+
+            settled++;
+            for (auto e: Backward ? vertices[v]->getIncoming() : vertices[v]->getAdj()) {
+                if (!filter(e))
+                    continue;
+
+                int w = head(e)->getIndex();
+                double newDist = tree.dist[v] + e->getWeight();
+                if (newDist < tree.dist[w]) {
+                    tree.dist[w] = newDist;
+                    tree.parent[w] = e;
+                    q.push({newDist, w});
+                } else if (newDist == tree.dist[w] && breaksTie<Backward>(e, tree.parent[w])) {
+                    tree.parent[w] = e;
+                }
+            }
+        }
+
+        return settled;
+    }
+
+    /**
+     * @brief Grows a tree with the kernel specialised for a transport mode known only at run time
+     * @tparam Backward If true, follows incoming edges towards the root
+     * @param graph The graph to search
+     * @param root The root vertex of the tree
+     * @param transportMode The transport mode edges must have, DEFAULT accepts every mode
+     * @param targets Optional per-vertex flags marking the targets, nullptr to build the whole tree
+     * @param targetCount Number of distinct flagged targets
+     * @param tree The tree to fill
+     * @param limit Distance at which the search stops
+     * @details O(E log V) where E is the number of edges and V is the number of vertices
+     */
+    template<bool Backward>
+    static void growForMode(
+        const Graph<LocationInfo> &graph,
+        const Vertex<LocationInfo> *root,
+        EdgeType transportMode,
+        const std::vector<bool> *targets,
+        int targetCount,
+        Routing::SearchTree &tree,
+        double limit = INF) {
+        switch (transportMode) {
+            case EdgeType::DRIVING:
+                grow<Backward>(graph, root, DrivingEdge(), targets, targetCount, tree, limit);
+                break;
+            case EdgeType::WALKING:
+                grow<Backward>(graph, root, WalkingEdge(), targets, targetCount, tree, limit);
+                break;
+            default:
+                grow<Backward>(graph, root, AnyEdge(), targets, targetCount, tree, limit);
+                break;
+        }
+    }
+
+    /**
+     * @brief Grows a tree with the kernel specialised for a set of compiled restrictions
+     * @tparam Backward If true, follows incoming edges towards the root
+     * @param graph The graph to search
+     * @param root The root vertex of the tree
+     * @param restrictions Restrictions compiled for this graph
+     * @param targets Optional per-vertex flags marking the targets, nullptr to build the whole tree
+     * @param targetCount Number of distinct flagged targets
+     * @param tree The tree to fill
+     * @param limit Distance at which the search stops
+     * @details O(E log V) where E is the number of edges and V is the number of vertices
+     */
+    template<bool Backward>
+    static void growRestricted(
+        const Graph<LocationInfo> &graph,
+        const Vertex<LocationInfo> *root,
+        const RouteRestrictions &restrictions,
+        const std::vector<bool> *targets,
+        int targetCount,
+        Routing::SearchTree &tree,
+        double limit = INF) {
+        if (restrictions.getFingerprint() == 0) {
+            growForMode<Backward>(graph, root, restrictions.getTransportMode(), targets, targetCount, tree, limit);
+            return;
+        }
+
+        switch (restrictions.getTransportMode()) {
+            case EdgeType::DRIVING:
+                grow<Backward>(graph, root, RestrictedEdge<EdgeType::DRIVING>{&restrictions},
+                               targets, targetCount, tree, limit);
+                break;
+            case EdgeType::WALKING:
+                grow<Backward>(graph, root, RestrictedEdge<EdgeType::WALKING>{&restrictions},
+                               targets, targetCount, tree, limit);
+                break;
+            default:
+                grow<Backward>(graph, root, RestrictedEdge<EdgeType::DEFAULT>{&restrictions},
+                               targets, targetCount, tree, limit);
+                break;
+        }
+    }
+};
+
+#endif // SEARCHKERNELS_H
@@ -0,0 +1,180 @@
+#include "SearchTreeCache.h"
+#include "../parse_data/DataManager.h"
+#include <functional>
+
+SearchTreeCache *SearchTreeCache::instance = nullptr;
+thread_local SearchTreeCache *SearchTreeCache::threadInstance = nullptr;
+
+SearchTreeCache::SearchTreeCache() : capacity(256), dataVersion(0) {
+}
+
+SearchTreeCache *SearchTreeCache::getInstance() {
+    if (threadInstance != nullptr) {
+        return threadInstance;
+    }
+    return getShared();
+}
+
+SearchTreeCache *SearchTreeCache::getShared() {
+    if (instance == nullptr) {
+        instance = new SearchTreeCache();
+    }
+    return instance;
+}
+
+SearchTreeCache::ThreadScope::ThreadScope(size_t capacity)
+    : cache(new SearchTreeCache()), previous(threadInstance) {
+    cache->capacity = capacity;
+    threadInstance = cache.get();
+}
+
+SearchTreeCache::ThreadScope::~ThreadScope() {
+    threadInstance = previous;
+}
+
+void SearchTreeCache::forget(const Graph<LocationInfo> &graph) {
+    if (instance == nullptr) {
+        return;
+    }
+    instance->rewrite([&graph](const Graph<LocationInfo> *owner, const Vertex<LocationInfo> *,
+                               Edge<LocationInfo>::EdgeType, bool, const TreeHandle &tree) {
+        return owner == &graph ? nullptr : tree;
+    });
+}
+
+SearchTreeCache::Key SearchTreeCache::makeKey(
+    const Graph<LocationInfo> &graph,
+    const Vertex<LocationInfo> *root,
+    const RouteRestrictions &restrictions,
+    bool backward) {
+    return Key{&graph, root, restrictions.getTransportMode(), backward, restrictions.getFingerprint(),
+               restrictions.getAvoidLists()};
+}
+
+size_t SearchTreeCache::KeyHash::operator()(const Key &key) const {
+    size_t h = std::hash<const void *>()(key.graph);
+    h = h * 31 + std::hash<const void *>()(key.root);
+    h = h * 31 + static_cast<size_t>(key.transportMode);
+    h = h * 31 + std::hash<unsigned long long>()(key.fingerprint);
+    return h * 2 + (key.backward ? 1 : 0);
+}
+
+void SearchTreeCache::checkDataVersion() {
+    unsigned long current = DataManager::getInstance()->getDataVersion();
+    if (current != dataVersion) {
+        entries.clear();
+        index.clear();
+        stats.entries = 0;
+        stats.memoryBytes = 0;
+        dataVersion = current;
+    }
+}
+
+size_t SearchTreeCache::treeBytes(const Routing::SearchTree &tree) {
+    return sizeof(Routing::SearchTree) +
+           tree.dist.capacity() * sizeof(double) +
+           tree.parent.capacity() * sizeof(Edge<LocationInfo> *);
+}
+
+SearchTreeCache::TreeHandle SearchTreeCache::find(
+    const Graph<LocationInfo> &graph,
+    const Vertex<LocationInfo> *root,
+    const RouteRestrictions &restrictions,
+    bool backward) {
+    Key key = makeKey(graph, root, restrictions, backward);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    checkDataVersion();
+
+    auto it = index.find(key);
+    if (it == index.end()) {
+        stats.misses++;
+        return nullptr;
+    }
+
+    stats.hits++;
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->second;
+}
+
+SearchTreeCache::TreeHandle SearchTreeCache::insert(
+    const Graph<LocationInfo> &graph,
+    const Vertex<LocationInfo> *root,
+    const RouteRestrictions &restrictions,
+    Routing::SearchTree tree) {
+    Key key = makeKey(graph, root, restrictions, tree.backward);
+    TreeHandle handle = std::make_shared<const Routing::SearchTree>(std::move(tree));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    checkDataVersion();
+
+    if (capacity == 0) {
+        return handle;
+    }
+
+    auto it = index.find(key);
+    if (it != index.end()) {
+        // Another search built the same tree concurrently, keep the stored one
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->second;
+    }
+
+    entries.emplace_front(key, handle);
+    index[key] = entries.begin();
+    stats.entries++;
+    stats.memoryBytes += treeBytes(*handle);
+
+    while (entries.size() > capacity) {
+        stats.memoryBytes -= treeBytes(*entries.back().second);
+        stats.entries--;
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+
+    return handle;
+}
+
+void SearchTreeCache::rewrite(const TreeRewrite &rewrite) {
+    std::lock_guard<std::mutex> lock(mutex);
+    checkDataVersion();
+
+    for (auto it = entries.begin(); it != entries.end();) {
+        const Key &key = it->first;
+        TreeHandle replacement = rewrite(key.graph, key.root, key.transportMode, key.fingerprint != 0, it->second);
+        stats.memoryBytes -= treeBytes(*it->second);
+
+        if (replacement) {
+            stats.memoryBytes += treeBytes(*replacement);
+            it->second = replacement;
+            ++it;
+        } else {
+            stats.entries--;
+            index.erase(key);
+            it = entries.erase(it);
+        }
+    }
+}
+
+void SearchTreeCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    index.clear();
+    stats.entries = 0;
+    stats.memoryBytes = 0;
+}
+
+void SearchTreeCache::setCapacity(size_t newCapacity) {
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = newCapacity;
+    while (entries.size() > capacity) {
+        stats.memoryBytes -= treeBytes(*entries.back().second);
+        stats.entries--;
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+SearchTreeCache::Stats SearchTreeCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
@@ -0,0 +1,261 @@
+#ifndef SEARCHTREECACHE_H
+#define SEARCHTREECACHE_H
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Routing.h"
+#include "RouteRestrictions.h"
+
+/**
+ * @class SearchTreeCache
+ * @brief Bounded LRU cache of complete one-to-all shortest-path trees
+ *
+ * Trees are keyed by the graph they were grown on, their root vertex, transport mode, search
+ * direction and the canonical avoid lists they were built with, so a later query from a cached
+ * root is answered by walking the stored parent edges. The RouteRestrictions fingerprint only
+ * picks the hash bucket; two different avoid lists never share a tree, even if their
+ * fingerprints collide. The cache is a singleton and clears itself whenever
+ * DataManager::loadData loads a new dataset.
+ */
+class SearchTreeCache {
+public:
+    /**
+     * @brief Usage counters of the cache
+     */
+    struct Stats {
+        unsigned long hits = 0; /**< Lookups answered from the cache */
+        unsigned long misses = 0; /**< Lookups that had to build a tree */
+        size_t entries = 0; /**< Trees currently stored */
+        size_t memoryBytes = 0; /**< Approximate memory used by the stored trees */
+
+        /**
+         * @brief Fraction of lookups answered from the cache
+         * @return Hit rate between 0 and 1
+         * @details O(1)
+         */
+        double hitRate() const {
+            return hits + misses == 0 ? 0 : static_cast<double>(hits) / (hits + misses);
+        }
+    };
+
+    /**
+     * @class ThreadScope
+     * @brief Gives the calling thread a private cache for as long as the scope lives
+     *
+     * While the scope is alive, getInstance on its thread returns the private cache, so worker
+     * threads neither contend for the shared cache's lock nor evict each other's trees. LiveTraffic
+     * only carries the shared cache's trees over to an updated snapshot, whichever thread publishes
+     * the update; owners of private caches clear them when the snapshot they serve changes.
+     */
+    class ThreadScope {
+    public:
+        /**
+         * @brief Creates a private cache and makes it the calling thread's instance
+         * @param capacity Maximum number of stored trees
+         * @details O(1)
+         */
+        explicit ThreadScope(size_t capacity = 256);
+
+        /**
+         * @brief Restores the thread's previous instance and frees the private cache
+         * @details O(N) where N is the number of stored trees
+         */
+        ~ThreadScope();
+
+        ThreadScope(const ThreadScope &) = delete;
+
+        ThreadScope &operator=(const ThreadScope &) = delete;
+
+    private:
+        /** @brief The private cache */
+        std::unique_ptr<SearchTreeCache> cache;
+
+        /** @brief Instance the thread used before the scope */
+        SearchTreeCache *previous;
+    };
+
+    /** @brief Shared handle to a cached tree, stays valid after the tree is evicted */
+    using TreeHandle = std::shared_ptr<const Routing::SearchTree>;
+
+    /**
+     * @brief Gets the singleton instance of the cache, or the calling thread's private one inside a ThreadScope
+     * @return Pointer to the cache instance
+     * @details O(1)
+     */
+    static SearchTreeCache *getInstance();
+
+    /**
+     * @brief Gets the shared cache, even on a thread inside a ThreadScope
+     * @return Pointer to the shared cache
+     * @details O(1)
+     */
+    static SearchTreeCache *getShared();
+
+    /**
+     * @brief Drops the shared cache's trees grown on a graph that is about to be freed
+     *
+     * Trees are keyed by graph and vertex address, which a later graph could reuse. Private
+     * caches are not touched; their owners clear them when they move to another graph.
+     *
+     * @param graph The graph
+     * @details O(N) where N is the number of stored trees
+     */
+    static void forget(const Graph<LocationInfo> &graph);
+
+    /**
+     * @brief Looks up a tree; a miss is counted once, however the caller then answers the query
+     * @param graph The graph the tree was grown on
+     * @param root The root vertex of the tree
+     * @param restrictions The restrictions the tree was built with, for their mode and avoid lists
+     * @param backward Whether the tree follows incoming edges
+     * @return The cached tree, or nullptr on a miss
+     * @details O(A) on average where A is the length of the avoid lists
+     */
+    TreeHandle find(
+        const Graph<LocationInfo> &graph,
+        const Vertex<LocationInfo> *root,
+        const RouteRestrictions &restrictions,
+        bool backward);
+
+    /**
+     * @brief Stores a tree, evicting the least recently used one if the cache is full
+     * @param graph The graph the tree was grown on
+     * @param root The root vertex of the tree
+     * @param restrictions The restrictions the tree was built with, for their mode and avoid lists
+     * @param tree The tree to store
+     * @return Handle to the stored tree
+     * @details O(A) on average where A is the length of the avoid lists
+     */
+    TreeHandle insert(
+        const Graph<LocationInfo> &graph,
+        const Vertex<LocationInfo> *root,
+        const RouteRestrictions &restrictions,
+        Routing::SearchTree tree);
+
+    /**
+     * @brief Rewrites one stored tree: returns its replacement, the same handle to keep it, or nullptr to drop it
+     */
+    using TreeRewrite = std::function<TreeHandle(
+        const Graph<LocationInfo> *graph,
+        const Vertex<LocationInfo> *root,
+        Edge<LocationInfo>::EdgeType transportMode,
+        bool restricted,
+        const TreeHandle &tree)>;
+
+    /**
+     * @brief Passes every stored tree through a rewrite, keeping the recency order
+     *
+     * Handles given out earlier keep pointing at the old trees, so searches that hold one are
+     * not disturbed.
+     *
+     * @param rewrite The rewrite
+     * @details O(N * R) where N is the number of stored trees and R the cost of one rewrite
+     */
+    void rewrite(const TreeRewrite &rewrite);
+
+    /**
+     * @brief Removes every stored tree
+     * @details O(N) where N is the number of stored trees
+     */
+    void clear();
+
+    /**
+     * @brief Sets the maximum number of stored trees
+     * @param capacity The new capacity; 0 disables the cache
+     * @details O(N) where N is the number of trees evicted
+     */
+    void setCapacity(size_t capacity);
+
+    /**
+     * @brief Gets the usage counters
+     * @return A snapshot of the counters
+     * @details O(1)
+     */
+    Stats getStats() const;
+
+private:
+    /**
+     * @brief Identifies one cached tree
+     */
+    struct Key {
+        const Graph<LocationInfo> *graph;
+        const Vertex<LocationInfo> *root;
+        Edge<LocationInfo>::EdgeType transportMode;
+        bool backward;
+        unsigned long long fingerprint; /**< Hash of avoided, compared first */
+        RouteRestrictions::AvoidLists avoided;
+
+        bool operator==(const Key &other) const {
+            return graph == other.graph && root == other.root && transportMode == other.transportMode &&
+                   backward == other.backward && fingerprint == other.fingerprint && avoided == other.avoided;
+        }
+    };
+
+    /**
+     * @brief Builds the key of a tree
+     * @details O(A) where A is the length of the avoid lists
+     */
+    static Key makeKey(
+        const Graph<LocationInfo> &graph,
+        const Vertex<LocationInfo> *root,
+        const RouteRestrictions &restrictions,
+        bool backward);
+
+    /**
+     * @brief Hash function for cache keys
+     */
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+
+    /** @brief Singleton instance */
+    static SearchTreeCache *instance;
+
+    /** @brief Private instance of the calling thread, nullptr outside a ThreadScope */
+    static thread_local SearchTreeCache *threadInstance;
+
+    /** @brief Stored trees, most recently used first */
+    std::list<std::pair<Key, TreeHandle> > entries;
+
+    /** @brief Index from key to position in the recency list */
+    std::unordered_map<Key, std::list<std::pair<Key, TreeHandle> >::iterator, KeyHash> index;
+
+    /** @brief Maximum number of stored trees */
+    size_t capacity;
+
+    /** @brief Data version the stored trees were built from */
+    unsigned long dataVersion;
+
+    /** @brief Usage counters */
+    Stats stats;
+
+    /** @brief Guards every member, the cache is shared by concurrent searches */
+    mutable std::mutex mutex;
+
+    /**
+     * @brief Private constructor (singleton pattern)
+     * @details O(1)
+     */
+    SearchTreeCache();
+
+    /**
+     * @brief Clears the cache if DataManager has loaded a new dataset since the last call
+     * @details O(1), O(N) when the cache is cleared
+     */
+    void checkDataVersion();
+
+    /**
+     * @brief Approximate memory used by one tree
+     * @param tree The tree to measure
+     * @return Size in bytes
+     * @details O(1)
+     */
+    static size_t treeBytes(const Routing::SearchTree &tree);
+};
+
+#endif // SEARCHTREECACHE_H
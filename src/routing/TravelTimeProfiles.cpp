@@ -0,0 +1,258 @@
+#include "TravelTimeProfiles.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include "SearchBudget.h"
+#include "SearchKernels.h"
+
+const int TravelTimeProfiles::DAY;
+const int TravelTimeProfiles::LINEAR_SCAN;
+
+TravelTimeProfiles::TravelTimeProfiles()
+    : profiledEdgeCount(0) {
+}
+
+std::shared_ptr<const TravelTimeProfiles> TravelTimeProfiles::compile(
+    const Graph<LocationInfo> &graph,
+    const std::vector<ProfileData> &rows,
+    std::vector<std::string> *errors) {
+    std::shared_ptr<TravelTimeProfiles> profiles(new TravelTimeProfiles());
+    const auto &vertices = graph.getVertexSet();
+    int n = graph.getNumVertex();
+
+    profiles->offset.assign(n + 1, 0);
+    for (int v = 0; v < n; v++) {
+        profiles->offset[v + 1] = profiles->offset[v] + static_cast<int>(vertices[v]->getAdj().size());
+    }
+    profiles->profileOf.assign(profiles->offset[n], -1);
+    profiles->profileStart.push_back(0);
+
+    std::unordered_map<std::string, Vertex<LocationInfo> *> byCode;
+    for (auto v: vertices) {
+        byCode[v->getInfo().code] = v;
+    }
+
+    auto report = [errors](const ProfileData &row, const std::string &message) {
+        if (errors != nullptr) {
+            errors->push_back(row.location1 + "-" + row.location2 + " (" + row.mode + "): " + message);
+        }
+    };
+
+    std::map<std::vector<std::pair<int, double> >, int> known;
+    for (const auto &row: rows) {
+        auto from = byCode.find(row.location1);
+        auto to = byCode.find(row.location2);
+        if (from == byCode.end() || to == byCode.end()) {
+            report(row, "unknown location");
+            continue;
+        }
+
+        std::string mode = row.mode;
+        std::transform(mode.begin(), mode.end(), mode.begin(), [](unsigned char ch) {
+            return static_cast<char>(std::tolower(ch));
+        });
+        Edge<LocationInfo>::EdgeType transportMode;
+        if (mode == "driving") {
+            transportMode = Edge<LocationInfo>::EdgeType::DRIVING;
+        } else if (mode == "walking") {
+            transportMode = Edge<LocationInfo>::EdgeType::WALKING;
+        } else {
+            report(row, "unknown transport mode");
+            continue;
+        }
+
+        // Normalise to breakpoints at 00:00 and 24:00, wrapping the last piece of the day around
+        std::vector<std::pair<int, double> > points = row.breakpoints;
+        std::sort(points.begin(), points.end());
+        bool valid = true;
+        for (size_t i = 0; i < points.size(); i++) {
+            if (points[i].second <= 0 || (i > 0 && points[i].first == points[i - 1].first))
+                valid = false;
+        }
+        if (!valid) {
+            report(row, "travel times must be positive, one per minute of the day");
+            continue;
+        }
+
+        const auto &first = points.front();
+        const auto &last = points.back();
+        double atMidnight = first.second;
+        if (first.first > 0 && points.size() > 1) {
+            double span = first.first + DAY - last.first;
+            atMidnight = last.second + (first.second - last.second) * (DAY - last.first) / span;
+        }
+        if (first.first > 0) {
+            points.insert(points.begin(), {0, atMidnight});
+        }
+        points.push_back({DAY, atMidnight});
+
+        for (size_t i = 0; i + 1 < points.size() && valid; i++) {
+            double slope = (points[i + 1].second - points[i].second) / (points[i + 1].first - points[i].first);
+            valid = slope >= -1;
+        }
+        if (!valid) {
+            report(row, "travel time falls faster than time passes, a later departure would arrive earlier");
+            continue;
+        }
+
+        auto it = known.find(points);
+        if (it == known.end()) {
+            int profile = profiles->getProfileCount();
+            for (size_t i = 0; i + 1 < points.size(); i++) {
+                double slope = (points[i + 1].second - points[i].second) / (points[i + 1].first - points[i].first);
+                profiles->pieces.push_back({
+                    static_cast<float>(points[i].first),
+                    static_cast<float>(points[i].second),
+                    static_cast<float>(slope)
+                });
+            }
+            profiles->profileStart.push_back(static_cast<int>(profiles->pieces.size()));
+            it = known.emplace(points, profile).first;
+        }
+
+        // The segment is undirected, like a row of the distances file
+        bool found = false;
+        for (auto ends: {std::make_pair(from->second, to->second), std::make_pair(to->second, from->second)}) {
+            const auto &adj = ends.first->getAdj();
+            for (size_t k = 0; k < adj.size(); k++) {
+                if (adj[k]->getDest() == ends.second && adj[k]->getType() == transportMode) {
+                    profiles->profileOf[profiles->offset[ends.first->getIndex()] + k] = it->second;
+                    found = true;
+                }
+            }
+        }
+        if (!found) {
+            report(row, "no such segment");
+        }
+    }
+
+    profiles->profiledEdgeCount = static_cast<int>(
+        std::count_if(profiles->profileOf.begin(), profiles->profileOf.end(), [](int p) {
+            return p != -1;
+        }));
+    return profiles;
+}
+
+std::shared_ptr<const TravelTimeProfiles> TravelTimeProfiles::load(
+    const Graph<LocationInfo> &graph,
+    const std::string &filePath,
+    std::vector<std::string> *errors) {
+    std::vector<ProfileData> rows = readProfilesCSV(filePath);
+    if (rows.empty()) {
+        if (errors != nullptr) {
+            errors->push_back("No travel-time profiles could be read from " + filePath);
+        }
+        return nullptr;
+    }
+
+    std::vector<std::string> ignored;
+    auto profiles = compile(graph, rows, &ignored);
+    if (errors != nullptr) {
+        for (const auto &error: ignored) {
+            errors->push_back("Ignoring travel-time profile " + error);
+        }
+    }
+    if (profiles->getProfiledEdgeCount() == 0) {
+        return nullptr;
+    }
+    return profiles;
+}
+
+double TravelTimeProfiles::evaluate(int profile, double departureTime) const {
+    double t = std::fmod(departureTime, DAY);
+    if (t < 0) {
+        t += DAY;
+    }
+
+    const Piece *first = pieces.data() + profileStart[profile];
+    const Piece *last = pieces.data() + profileStart[profile + 1];
+    const Piece *piece = first;
+    if (last - first <= LINEAR_SCAN) {
+        while (piece + 1 < last && piece[1].start <= t) {
+            piece++;
+        }
+    } else {
+        piece = std::upper_bound(first + 1, last, t, [](double time, const Piece &p) {
+            return time < p.start;
+        }) - 1;
+    }
+    return piece->time + piece->slope * (t - piece->start);
+}
+
+double TravelTimeProfiles::travelTime(const Edge<LocationInfo> *edge, double departureTime) const {
+    const Vertex<LocationInfo> *orig = edge->getOrig();
+    const auto &adj = orig->getAdj();
+    for (size_t k = 0; k < adj.size(); k++) {
+        if (adj[k] == edge) {
+            int profile = profileOf[offset[orig->getIndex()] + k];
+            return profile == -1 ? edge->getWeight() : evaluate(profile, departureTime);
+        }
+    }
+    return edge->getWeight();
+}
+
+int TravelTimeProfiles::search(
+    const Graph<LocationInfo> &graph,
+    const Vertex<LocationInfo> *source,
+    const Vertex<LocationInfo> *target,
+    const RouteRestrictions &restrictions,
+    double departureTime,
+    Routing::SearchTree &tree) const {
+    tree.backward = false;
+    tree.dist.assign(graph.getNumVertex(), INF);
+    tree.parent.assign(graph.getNumVertex(), nullptr);
+
+    if (source == nullptr) {
+        return 0;
+    }
+
+    const auto &vertices = graph.getVertexSet();
+    int settled = 0;
+
+    // FIFO edges make arrival times behave like static distances, so plain Dijkstra stays exact
+    using QueueEntry = std::pair<double, int>;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > q;
+    tree.dist[source->getIndex()] = 0;
+    q.push({0, source->getIndex()});
+    SearchBudget::check();
+
+    while (!q.empty()) {
+        QueueEntry top = q.top();
+        q.pop();
+
+        int v = top.second;
+        if (top.first > tree.dist[v])
+            continue;
+
+        settled++;
+        SearchBudget::checkEvery(static_cast<unsigned int>(settled));
+        if (target != nullptr && v == target->getIndex())
+            break;
+
+        const auto &adj = vertices[v]->getAdj();
+        const int *edgeProfile = profileOf.data() + offset[v];
+        double now = departureTime + tree.dist[v];
+        for (size_t k = 0; k < adj.size(); k++) {
+            if (!restrictions.allows(adj[k]))
+                continue;
+
+            int w = adj[k]->getDest()->getIndex();
+            double travel = edgeProfile[k] == -1 ? adj[k]->getWeight() : evaluate(edgeProfile[k], now);
+            double newDist = tree.dist[v] + travel;
+            if (newDist < tree.dist[w]) {
+                tree.dist[w] = newDist;
+                tree.parent[w] = adj[k];
+                q.push({newDist, w});
+            } else if (newDist == tree.dist[w] && SearchKernels::breaksTie<false>(adj[k], tree.parent[w])) {
+                tree.parent[w] = adj[k];
+            }
+        }
+    }
+
+    return settled;
+}
@@ -0,0 +1,164 @@
+#ifndef TRAVELTIMEPROFILES_H
+#define TRAVELTIMEPROFILES_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "../graph_structure/Graph.h"
+#include "../graph_builder/GraphBuilder.h"
+#include "../parse_data/ParseData.h"
+#include "Routing.h"
+#include "RouteRestrictions.h"
+
+/**
+ * @class TravelTimeProfiles
+ * @brief Time-of-day travel times of individual segments and the time-dependent Dijkstra that uses them
+ *
+ * A profile is a piecewise-linear function from the departure time, in minutes after midnight,
+ * to the travel time of a segment, repeated every day. Profiles are normalised on load to start
+ * at 00:00 and end at 24:00, so evaluating one is a scan (a binary search for long profiles)
+ * over its breakpoints and a single multiply-add. Identical profiles are stored once, and an
+ * edge only keeps the index of its profile, next to the adjacency lists like ArcFlags; edges
+ * without a profile keep their static weight. Profiles are loaded with the GraphSnapshot whose
+ * graph they were compiled for, and Routing finds them through it.
+ *
+ * Every profile must satisfy the FIFO property, i.e. no segment of it may fall faster than one
+ * minute of travel time per minute of departure time, so that leaving later never means
+ * arriving earlier. That is what keeps Dijkstra over arrival times exact.
+ */
+class TravelTimeProfiles {
+public:
+    /** @brief Length of the period of every profile, in minutes */
+    static const int DAY = 24 * 60;
+
+    /**
+     * @brief Compiles profile rows against a graph
+     *
+     * A row applies to both directions of its segment. Rows naming unknown locations or
+     * segments, or breaking the FIFO property, are reported and ignored; a later row for the
+     * same segment and mode replaces an earlier one.
+     *
+     * @param graph The transportation graph
+     * @param rows The profile rows
+     * @param errors If not null, receives one message per ignored row
+     * @return The compiled profiles
+     * @details O(V + E + R * (B log B + D)) for R rows of B breakpoints and vertex degree D
+     */
+    static std::shared_ptr<const TravelTimeProfiles> compile(
+        const Graph<LocationInfo> &graph,
+        const std::vector<ProfileData> &rows,
+        std::vector<std::string> *errors = nullptr);
+
+    /**
+     * @brief Reads a profile file and compiles it
+     * @param graph The transportation graph
+     * @param filePath Path to the profile CSV file
+     * @param errors If not null, receives one message per ignored row, or one if the file could not be read
+     * @return The profiles, or nullptr if no segment got a profile
+     * @details O(V + E + R * (B log B + D))
+     */
+    static std::shared_ptr<const TravelTimeProfiles> load(
+        const Graph<LocationInfo> &graph,
+        const std::string &filePath,
+        std::vector<std::string> *errors = nullptr);
+
+    /**
+     * @brief Gets the travel time of an edge for a departure time
+     * @param edge The edge, from the graph the profiles were compiled for
+     * @param departureTime Minutes after midnight, any value is taken modulo DAY
+     * @return The travel time, the edge's weight if it has no profile
+     * @details O(D + B) where D is the degree of the edge's origin
+     */
+    double travelTime(const Edge<LocationInfo> *edge, double departureTime) const;
+
+    /**
+     * @brief Runs time-dependent Dijkstra from a source, keeping arrival times as distances
+     * @param graph The graph the profiles were compiled for
+     * @param source The source vertex
+     * @param target Vertex to stop at once settled, nullptr to search the whole graph
+     * @param restrictions Restrictions compiled for the graph
+     * @param departureTime Departure time at the source, in minutes after midnight
+     * @param tree The tree to fill, with minutes elapsed since the departure as distances
+     * @return Number of vertices settled
+     * @details O(E (log V + B))
+     */
+    int search(
+        const Graph<LocationInfo> &graph,
+        const Vertex<LocationInfo> *source,
+        const Vertex<LocationInfo> *target,
+        const RouteRestrictions &restrictions,
+        double departureTime,
+        Routing::SearchTree &tree) const;
+
+    /**
+     * @brief Gets the number of distinct profiles
+     * @return The number of profiles
+     * @details O(1)
+     */
+    int getProfileCount() const {
+        return static_cast<int>(profileStart.size()) - 1;
+    }
+
+    /**
+     * @brief Gets the number of edges that follow a profile
+     * @return The number of edges
+     * @details O(1)
+     */
+    int getProfiledEdgeCount() const {
+        return profiledEdgeCount;
+    }
+
+    /**
+     * @brief Gets the number of breakpoints stored over every distinct profile
+     * @return The number of breakpoints
+     * @details O(1)
+     */
+    int getBreakpointCount() const {
+        return static_cast<int>(pieces.size());
+    }
+
+private:
+    /**
+     * @brief Linear piece of a profile, valid from its start to the start of the next piece
+     */
+    struct Piece {
+        float start; /**< Minute of the day the piece starts at */
+        float time; /**< Travel time at the start */
+        float slope; /**< Change of the travel time per minute, at least -1 */
+    };
+
+    /** @brief Pieces of a profile are scanned linearly up to this many, binary searched beyond */
+    static const int LINEAR_SCAN = 8;
+
+    /** @brief Position of every vertex's first edge in profileOf, plus the total at the end */
+    std::vector<int> offset;
+
+    /** @brief Profile of every edge, by offset of its origin and position in its adjacency list, -1 for none */
+    std::vector<int> profileOf;
+
+    /** @brief Position of every profile's first piece in pieces, plus the total at the end */
+    std::vector<int> profileStart;
+
+    /** @brief Pieces of every profile, the first of each starting at 00:00 */
+    std::vector<Piece> pieces;
+
+    /** @brief Number of edges with a profile */
+    int profiledEdgeCount;
+
+    /**
+     * @brief Creates an empty set of profiles
+     * @details O(1)
+     */
+    TravelTimeProfiles();
+
+    /**
+     * @brief Evaluates a profile
+     * @param profile The profile index
+     * @param departureTime Minutes after midnight, any value is taken modulo DAY
+     * @return The travel time
+     * @details O(B) for short profiles, O(log B) for long ones
+     */
+    double evaluate(int profile, double departureTime) const;
+};
+
+#endif // TRAVELTIMEPROFILES_H
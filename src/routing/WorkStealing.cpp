@@ -0,0 +1,71 @@
+#include "WorkStealing.h"
+#include <algorithm>
+
+thread_local bool WorkStealing::serial = false;
+
+WorkStealing::SerialScope::SerialScope() : previous(serial) {
+    serial = true;
+}
+
+WorkStealing::SerialScope::~SerialScope() {
+    serial = previous;
+}
+
+unsigned int WorkStealing::threadCount(size_t count, size_t grain, unsigned int threads) {
+    if (serial) {
+        return 1;
+    }
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t useful = std::max<size_t>(1, count / std::max<size_t>(1, grain));
+    return static_cast<unsigned int>(std::min<size_t>(threads, useful));
+}
+
+bool WorkStealing::takeFront(Slice &slice, size_t &item) {
+    uint64_t bounds = slice.bounds.load();
+    while (true) {
+        uint64_t begin = bounds >> 32;
+        uint64_t end = bounds & 0xffffffffu;
+        if (begin >= end) {
+            return false;
+        }
+        if (slice.bounds.compare_exchange_weak(bounds, pack(begin + 1, end))) {
+            item = begin;
+            return true;
+        }
+    }
+}
+
+bool WorkStealing::steal(std::vector<Slice> &slices, unsigned int thief) {
+    while (true) {
+        // The fullest slice has the most to give, and its owner is the furthest from done
+        unsigned int victim = thief;
+        uint64_t victimBounds = 0;
+        uint64_t most = 0;
+        for (unsigned int t = 0; t < slices.size(); t++) {
+            if (t == thief)
+                continue;
+            uint64_t bounds = slices[t].bounds.load();
+            uint64_t begin = bounds >> 32;
+            uint64_t end = bounds & 0xffffffffu;
+            if (end > begin && end - begin > most) {
+                most = end - begin;
+                victim = t;
+                victimBounds = bounds;
+            }
+        }
+        if (victim == thief) {
+            return false;
+        }
+
+        uint64_t begin = victimBounds >> 32;
+        uint64_t end = victimBounds & 0xffffffffu;
+        uint64_t half = (end - begin + 1) / 2;
+        if (slices[victim].bounds.compare_exchange_strong(victimBounds, pack(begin, end - half))) {
+            // Only the owner refills its empty slice, and thieves never take from an empty one
+            slices[thief].bounds.store(pack(end - half, end));
+            return true;
+        }
+    }
+}
@@ -0,0 +1,144 @@
+#ifndef WORKSTEALING_H
+#define WORKSTEALING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/**
+ * @class WorkStealing
+ * @brief Runs the iterations of a loop on several threads that steal work from each other
+ *
+ * Every thread starts with a contiguous slice of the iterations and takes them from the front.
+ * A thread whose slice runs out steals the back half of another thread's slice, so threads
+ * stuck on expensive iterations hand their remaining work to idle ones. Slices are packed into
+ * one atomic word each and updated with compare-and-swap, so no thread ever waits on a lock.
+ *
+ * Loops started from a thread inside a SerialScope run on the calling thread alone, which keeps
+ * nested parallel loops from multiplying the threads of an outer pool.
+ */
+class WorkStealing {
+public:
+    /**
+     * @class SerialScope
+     * @brief Makes every loop started on the calling thread run on that thread alone while the scope lives
+     */
+    class SerialScope {
+    public:
+        /**
+         * @brief Marks the calling thread as serial
+         * @details O(1)
+         */
+        SerialScope();
+
+        /**
+         * @brief Restores the thread's previous mode
+         * @details O(1)
+         */
+        ~SerialScope();
+
+        SerialScope(const SerialScope &) = delete;
+
+        SerialScope &operator=(const SerialScope &) = delete;
+
+    private:
+        /** @brief Mode of the thread before the scope */
+        bool previous;
+    };
+
+    /**
+     * @brief Chooses how many threads a loop should use
+     * @param count Number of iterations
+     * @param grain Minimum number of iterations worth a thread of its own
+     * @param threads Requested number of threads, 0 to use every hardware thread
+     * @return Number of threads, at least 1
+     * @details O(1)
+     */
+    static unsigned int threadCount(size_t count, size_t grain = 16, unsigned int threads = 0);
+
+    /**
+     * @brief Runs task(i, thread) for every i in [0, count)
+     * @tparam Task Callable taking the iteration and the index of the thread running it
+     * @param count Number of iterations
+     * @param threads Number of threads, as given by threadCount; the calling thread is thread 0
+     * @param task The loop body; iterations must be independent
+     * @details O(count * C / threads + threads^2) where C is the cost of one iteration
+     */
+    template<class Task>
+    static void run(size_t count, unsigned int threads, const Task &task) {
+        if (serial || threads <= 1 || count <= 1) {
+            for (size_t i = 0; i < count; i++) {
+                task(i, 0u);
+            }
+            return;
+        }
+
+        std::vector<Slice> slices(threads);
+        for (unsigned int t = 0; t < threads; t++) {
+            slices[t].bounds = pack(count * t / threads, count * (t + 1) / threads);
+        }
+
+        auto worker = [&](unsigned int id) {
+            SerialScope nested;
+            size_t item;
+            while (true) {
+                while (takeFront(slices[id], item)) {
+                    task(item, id);
+                }
+                if (!steal(slices, id)) {
+                    return;
+                }
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (unsigned int id = 1; id < threads; id++) {
+            pool.emplace_back(worker, id);
+        }
+        worker(0);
+        for (auto &th: pool) {
+            th.join();
+        }
+    }
+
+private:
+    /**
+     * @brief Iterations [begin, end) left to one thread, begin in the high half of the word
+     */
+    struct alignas(64) Slice {
+        std::atomic<uint64_t> bounds;
+    };
+
+    /** @brief Whether loops started on this thread run serially */
+    static thread_local bool serial;
+
+    /**
+     * @brief Packs a slice into one word
+     * @details O(1)
+     */
+    static uint64_t pack(size_t begin, size_t end) {
+        return static_cast<uint64_t>(begin) << 32 | static_cast<uint64_t>(end);
+    }
+
+    /**
+     * @brief Takes the first iteration of a thread's own slice
+     * @param slice The slice
+     * @param item Receives the iteration
+     * @return False if the slice is empty
+     * @details O(1) amortised
+     */
+    static bool takeFront(Slice &slice, size_t &item);
+
+    /**
+     * @brief Moves the back half of the fullest other slice into an empty slice
+     * @param slices Slices of every thread
+     * @param thief Index of the thread whose slice is empty
+     * @return False if every slice is empty
+     * @details O(T) where T is the number of threads
+     */
+    static bool steal(std::vector<Slice> &slices, unsigned int thief);
+};
+
+#endif // WORKSTEALING_H
@@ -0,0 +1,822 @@
+#include "QueryServer.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include "../routing/SearchTreeCache.h"
+#include "../routing/WorkStealing.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cstdint>
+#include <unordered_map>
+#endif
+
+const int QueryServer::INTERACTIVE;
+const int QueryServer::BULK;
+const std::string QueryServer::UPDATE_KEY = "Update:";
+
+std::shared_ptr<const QueryServer::Context> QueryServer::context;
+std::mutex QueryServer::contextMutex;
+
+class QueryServer::Connection {
+public:
+    /**
+     * @param write Writes one response line, returns false once the client is gone
+     */
+    explicit Connection(std::function<bool(const std::string &)> write) : write(std::move(write)) {
+    }
+
+    /**
+     * @brief Numbers the next request of the client
+     * @return Its position among the client's requests
+     * @details O(1)
+     */
+    unsigned long long reserve() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return reserved++;
+    }
+
+    /**
+     * @brief Hands over the response of a request, writing every response that is now next in line
+     * @param sequence Position of the request
+     * @param response The response
+     * @details O(log P) where P is the number of responses waiting for an earlier one
+     */
+    void complete(unsigned long long sequence, std::string response) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready[sequence] = std::move(response);
+        for (auto it = ready.begin(); it != ready.end() && it->first == written; it = ready.erase(it)) {
+            // A client that is gone still has its requests counted, so waitUntilDone returns
+            if (!broken && !write(it->second)) {
+                broken = true;
+            }
+            written++;
+        }
+        if (written == reserved) {
+            drained.notify_all();
+        }
+    }
+
+    /**
+     * @brief Waits until the response of every numbered request is written
+     */
+    void waitUntilDone() {
+        std::unique_lock<std::mutex> lock(mutex);
+        drained.wait(lock, [this]() { return written == reserved; });
+    }
+
+    /** @brief Cancels the client's queued and running requests when it is gone */
+    SearchBudget::Token token;
+
+private:
+    std::function<bool(const std::string &)> write;
+    std::mutex mutex;
+    std::condition_variable drained;
+    std::map<unsigned long long, std::string> ready;
+    unsigned long long reserved = 0;
+    unsigned long long written = 0;
+    bool broken = false;
+};
+
+/**
+ * @brief Tells whether a line holds nothing but whitespace
+ * @param line The line
+ * @return True if it is blank
+ * @details O(N) where N is the length of the line
+ */
+static bool isBlank(const std::string &line) {
+    return std::all_of(line.begin(), line.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); });
+}
+
+QueryServer::QueryServer(unsigned int threads) : QueryServer(threads, Policy()) {
+}
+
+QueryServer::QueryServer(unsigned int threads, const Policy &policy)
+    : policy(policy), runningBulk(0), stopping(false), listener(-1), stopRequested(false) {
+    // The shared cache is created here, before any worker could race to create it
+    SearchTreeCache::getInstance();
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    bulkWorkers = std::max(1u, threads - 1);
+    for (unsigned int k = 0; k < threads; k++) {
+        workers.emplace_back(&QueryServer::work, this);
+    }
+}
+
+QueryServer::~QueryServer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    room.notify_all();
+    for (auto &worker: workers) {
+        worker.join();
+    }
+}
+
+bool QueryServer::hasRunnable() const {
+    return !queues[INTERACTIVE].empty() || (!queues[BULK].empty() && runningBulk < bulkWorkers);
+}
+
+void QueryServer::work() {
+    SearchTreeCache::ThreadScope scope;
+    // The pool already keeps every core busy, so parallel loops inside a request stay on the worker
+    WorkStealing::SerialScope serial;
+
+    while (true) {
+        Job job;
+        bool bulk;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() {
+                return hasRunnable() || (stopping && queues[INTERACTIVE].empty() && queues[BULK].empty());
+            });
+            if (!hasRunnable()) {
+                return;
+            }
+            bulk = queues[INTERACTIVE].empty();
+            std::deque<Job> &queue = queues[bulk ? BULK : INTERACTIVE];
+            job = std::move(queue.front());
+            queue.pop_front();
+            if (bulk) {
+                runningBulk++;
+            }
+        }
+        room.notify_all();
+
+        job.connection->complete(job.sequence, respond(job));
+
+        if (bulk) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                runningBulk--;
+            }
+            // A bulk request may have been waiting for the slot
+            wake.notify_one();
+        }
+    }
+}
+
+void QueryServer::submit(const std::shared_ptr<Connection> &connection, const std::string &line, bool waitForRoom) {
+    submit(connection, std::vector<std::string>{line}, waitForRoom);
+}
+
+void QueryServer::submit(
+    const std::shared_ptr<Connection> &connection,
+    const std::vector<std::string> &lines,
+    bool waitForRoom) {
+    SearchBudget::Clock::time_point now = SearchBudget::Clock::now();
+    auto after = [now](double milliseconds) {
+        return now + std::chrono::microseconds(static_cast<long long>(milliseconds * 1000));
+    };
+
+    // Answered without a worker: malformed requests and those turned away by a full queue
+    std::vector<std::pair<unsigned long long, std::string> > immediate;
+    size_t queued = 0;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        // Tells whether a queue has room, waiting for it if asked to; what is already queued is handed out first
+        auto hasRoom = [&](int queue, size_t limit) {
+            if (waitForRoom && queues[queue].size() >= limit) {
+                wake.notify_all();
+                room.wait(lock, [&]() { return queues[queue].size() < limit || stopping; });
+            }
+            return queues[queue].size() < limit;
+        };
+
+        for (const auto &line: lines) {
+            unsigned long long sequence = connection->reserve();
+            BatchEngine::Request request;
+            std::string error;
+            if (line.compare(0, UPDATE_KEY.size(), UPDATE_KEY) == 0) {
+                std::vector<LiveTraffic::TravelTimeUpdate> updates;
+                if (!parseUpdates(line.substr(UPDATE_KEY.size()), updates, error)) {
+                    immediate.emplace_back(sequence, "Message:" + error);
+                } else if (!hasRoom(BULK, policy.bulkQueueLimit)) {
+                    immediate.emplace_back(sequence, "Message:Server busy, request rejected");
+                } else {
+                    queues[BULK].push_back(Job{connection, sequence, request, after(policy.bulkTimeLimit), std::move(updates)});
+                    queued++;
+                }
+                continue;
+            }
+            if (!BatchEngine::parseRequest(line, request, error)) {
+                immediate.emplace_back(sequence, "Message:" + error);
+                continue;
+            }
+
+            bool bulk = request.priority == BatchEngine::Priority::AUTOMATIC
+                            ? request.kind == BatchEngine::RequestKind::ECO || !request.includeNodes.empty()
+                            : request.priority == BatchEngine::Priority::BULK;
+            std::deque<Job> &queue = queues[bulk ? BULK : INTERACTIVE];
+            if (!hasRoom(bulk ? BULK : INTERACTIVE, bulk ? policy.bulkQueueLimit : policy.interactiveQueueLimit)) {
+                BatchEngine::Result rejected;
+                rejected.error = "Server busy, request rejected";
+                immediate.emplace_back(sequence, formatResponse(request, rejected));
+                continue;
+            }
+
+            double timeLimit = request.timeLimit > 0
+                                   ? request.timeLimit
+                                   : bulk ? policy.bulkTimeLimit : policy.interactiveTimeLimit;
+            queue.push_back(Job{connection, sequence, request, after(timeLimit), {}});
+            queued++;
+        }
+    }
+
+    if (queued == 1) {
+        wake.notify_one();
+    } else if (queued > 1) {
+        wake.notify_all();
+    }
+    for (auto &response: immediate) {
+        connection->complete(response.first, std::move(response.second));
+    }
+}
+
+bool QueryServer::parseUpdates(
+    const std::string &rows,
+    std::vector<LiveTraffic::TravelTimeUpdate> &updates,
+    std::string &error) {
+    std::stringstream stream(rows);
+    std::string row;
+    while (std::getline(stream, row, ';')) {
+        if (isBlank(row))
+            continue;
+        LiveTraffic::TravelTimeUpdate update;
+        if (!LiveTraffic::parseUpdate(row, update)) {
+            error = "Malformed update " + row + ", expected Location1,Location2,Mode,Time";
+            return false;
+        }
+        updates.push_back(update);
+    }
+    if (updates.empty()) {
+        error = "Update holds no segment";
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const QueryServer::Context> QueryServer::getContext() {
+    GraphSnapshot::Handle snapshot = GraphSnapshot::current();
+    if (!snapshot) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(contextMutex);
+    if (!context || context->snapshot != snapshot) {
+        std::shared_ptr<Context> fresh = std::make_shared<Context>();
+        fresh->snapshot = snapshot;
+        for (auto v: snapshot->getGraph().getVertexSet()) {
+            fresh->codeOf[v->getInfo().id] = v->getInfo().code;
+        }
+        context = fresh;
+    }
+    return context;
+}
+
+std::string QueryServer::respond(const Job &job) const {
+    if (!job.updates.empty()) {
+        if (job.connection->token.isCancelled()) {
+            return "Message:" + std::string(SearchBudget::Exhausted(true).what());
+        }
+        if (SearchBudget::Clock::now() > job.deadline) {
+            return "Message:" + std::string(SearchBudget::Exhausted(false).what());
+        }
+
+        // Publishes a new snapshot; requests already running keep the one they started on
+        LiveTraffic::UpdateReport report = LiveTraffic::publish(job.updates);
+        std::string response = "Updated:" + std::to_string(report.edgesChanged);
+        for (const auto &error: report.errors) {
+            response += ";Message:" + error;
+        }
+        return response;
+    }
+
+    BatchEngine::Result result;
+    std::shared_ptr<const Context> current = getContext();
+    if (!current) {
+        result.error = "No dataset loaded";
+    } else if (job.connection->token.isCancelled()) {
+        result.error = SearchBudget::Exhausted(true).what();
+    } else if (SearchBudget::Clock::now() > job.deadline) {
+        // Spent its whole budget waiting for a worker
+        result.error = SearchBudget::Exhausted(false).what();
+    } else {
+        // Private search trees belong to the snapshot they were grown on, which a reload or an update may free
+        thread_local unsigned long servedSerial = 0;
+        if (servedSerial != current->snapshot->getSerial()) {
+            SearchTreeCache::getInstance()->clear();
+            servedSerial = current->snapshot->getSerial();
+        }
+
+        SearchBudget::Scope budget(job.deadline, job.connection->token);
+        result = BatchEngine::evaluate(current->snapshot->getGraph(), current->codeOf, job.request);
+    }
+    return formatResponse(job.request, result);
+}
+
+std::string QueryServer::formatResponse(const BatchEngine::Request &request, const BatchEngine::Result &result) {
+    std::string response = BatchEngine::formatResult(request, result);
+    while (!response.empty() && response.back() == '\n') {
+        response.pop_back();
+    }
+    std::replace(response.begin(), response.end(), '\n', ';');
+    return response;
+}
+
+void QueryServer::serveStream(std::istream &in, std::ostream &out) {
+    auto connection = std::make_shared<Connection>([&out](const std::string &response) {
+        out << response << '\n';
+        out.flush();
+        return static_cast<bool>(out);
+    });
+
+    // The reader waits while a queue is full, so piped input is never turned away
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!isBlank(line)) {
+            submit(connection, line, true);
+        }
+    }
+    connection->waitUntilDone();
+}
+
+#ifdef __linux__
+
+/**
+ * @brief Responses handed over by the workers, waiting for the event loop to pick them up
+ */
+struct Completions {
+    std::mutex mutex;
+    std::vector<std::pair<unsigned long long, std::string> > responses; /**< Client ID and response, in order per client */
+    int wakeFd = -1; /**< eventfd of the loop, -1 once the loop has ended */
+};
+
+class QueryServer::EventLoop {
+public:
+    EventLoop(QueryServer &server, int listenFd, int pollFd, int wakeFd)
+        : server(server), listenFd(listenFd), pollFd(pollFd), completions(std::make_shared<Completions>()),
+          nextId(FIRST_CLIENT), buffer(READ_SIZE) {
+        completions->wakeFd = wakeFd;
+    }
+
+    /**
+     * @brief Closes every client and stops the workers' responses from waking the loop
+     */
+    ~EventLoop() {
+        for (auto &entry: clients) {
+            close(entry.second.fd);
+        }
+        std::lock_guard<std::mutex> lock(completions->mutex);
+        completions->wakeFd = -1;
+    }
+
+    /**
+     * @brief Accepts and serves clients until stop is requested, then drains them
+     *
+     * Once stop is requested no client is accepted or read from any more. Each client is closed
+     * as soon as the responses to the requests it already sent are written, and clients still
+     * open DRAIN_TIMEOUT later are closed with their outstanding requests cancelled.
+     *
+     * @return False if the loop could not be set up
+     */
+    bool run() {
+        if (!watch(listenFd, LISTENER, EPOLLIN) || !watch(completions->wakeFd, WAKE, EPOLLIN)) {
+            std::cerr << "Could not watch the socket: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+
+        bool accepting = true;
+        std::chrono::steady_clock::time_point drainDeadline;
+        epoll_event events[MAX_EVENTS];
+        while (accepting || !clients.empty()) {
+            if (accepting && server.stopRequested) {
+                epoll_ctl(pollFd, EPOLL_CTL_DEL, listenFd, nullptr);
+                accepting = false;
+                drainDeadline = std::chrono::steady_clock::now() + DRAIN_TIMEOUT;
+                for (auto &entry: clients) {
+                    entry.second.readClosed = true;
+                    entry.second.input.clear();
+                    touched.push_back(entry.first);
+                }
+                settleTouched();
+                continue;
+            }
+
+            int timeout = -1;
+            if (!accepting) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    drainDeadline - std::chrono::steady_clock::now());
+                if (left.count() <= 0) {
+                    while (!clients.empty()) {
+                        drop(clients.begin()->first);
+                    }
+                    break;
+                }
+                timeout = static_cast<int>(left.count());
+            }
+
+            int count = epoll_wait(pollFd, events, MAX_EVENTS, timeout);
+            if (count < 0) {
+                if (errno == EINTR)
+                    continue;
+                std::cerr << "Event loop failed: " << std::strerror(errno) << std::endl;
+                return false;
+            }
+
+            for (int i = 0; i < count; i++) {
+                unsigned long long id = events[i].data.u64;
+                if (id == LISTENER) {
+                    acceptClients();
+                } else if (id == WAKE) {
+                    collectResponses();
+                } else {
+                    auto it = clients.find(id);
+                    if (it == clients.end())
+                        continue;
+                    // A peer that closed both directions can no longer read its responses
+                    bool alive = !(events[i].events & (EPOLLHUP | EPOLLERR));
+                    if (alive && (events[i].events & EPOLLIN))
+                        alive = readRequests(it->second);
+                    if (alive)
+                        touched.push_back(id);
+                    else
+                        drop(id);
+                }
+            }
+
+            settleTouched();
+        }
+        return true;
+    }
+
+private:
+    /** @brief Event ID of the listening socket */
+    static const unsigned long long LISTENER = 0;
+
+    /** @brief Event ID of the eventfd the workers signal */
+    static const unsigned long long WAKE = 1;
+
+    /** @brief First client ID; IDs are never reused, so a late response cannot reach a new client */
+    static const unsigned long long FIRST_CLIENT = 2;
+
+    /** @brief Bytes read from a client per readiness event */
+    static const size_t READ_SIZE = 64 * 1024;
+
+    /** @brief Longest request line accepted */
+    static const size_t MAX_LINE = 64 * 1024;
+
+    /** @brief Requests a client may have in flight or unsent before it is no longer read from, at most */
+    static const size_t MAX_BACKLOG = 1024;
+
+    /** @brief How long clients get, once stop is requested, to receive the responses in flight */
+    static constexpr std::chrono::seconds DRAIN_TIMEOUT{5};
+
+    /** @brief Events handled per epoll_wait */
+    static const int MAX_EVENTS = 64;
+
+    /** @brief Responses gathered into one write */
+    static const int MAX_GATHER = 64;
+
+    /**
+     * @brief A connected client
+     */
+    struct Client {
+        int fd;
+        std::shared_ptr<Connection> connection; /**< Puts the client's responses in order */
+        std::string input; /**< Bytes after the last complete request line */
+        std::deque<std::string> output; /**< Responses not yet fully written */
+        size_t offset = 0; /**< Bytes of output.front(), and its newline, already written */
+        unsigned long long submitted = 0; /**< Requests handed to the workers */
+        unsigned long long received = 0; /**< Responses back from the workers */
+        bool readClosed = false; /**< The client has sent its last request */
+        uint32_t interest = 0; /**< Events currently watched */
+    };
+
+    QueryServer &server;
+    int listenFd;
+    int pollFd;
+    std::shared_ptr<Completions> completions;
+    std::unordered_map<unsigned long long, Client> clients;
+    unsigned long long nextId;
+
+    /** @brief Clients whose state changed during the current round of events */
+    std::vector<unsigned long long> touched;
+
+    /** @brief Read buffer shared by every client */
+    std::vector<char> buffer;
+
+    bool watch(int fd, unsigned long long id, uint32_t events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = id;
+        return epoll_ctl(pollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+    }
+
+    void acceptClients() {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                // EAGAIN once the backlog is empty; anything else is the listener shut down by stop
+                return;
+            }
+
+            unsigned long long id = nextId++;
+            std::shared_ptr<Completions> sink = completions;
+            Client client;
+            client.fd = fd;
+            client.connection = std::make_shared<Connection>([sink, id](const std::string &response) {
+                std::lock_guard<std::mutex> lock(sink->mutex);
+                bool idle = sink->responses.empty();
+                sink->responses.emplace_back(id, response);
+                if (idle && sink->wakeFd >= 0) {
+                    uint64_t one = 1;
+                    ssize_t ignored = write(sink->wakeFd, &one, sizeof(one));
+                    (void) ignored;
+                }
+                return true;
+            });
+            client.interest = EPOLLIN;
+            if (!watch(fd, id, EPOLLIN)) {
+                close(fd);
+                continue;
+            }
+            clients.emplace(id, std::move(client));
+        }
+    }
+
+    void collectResponses() {
+        uint64_t signals;
+        ssize_t ignored = read(completions->wakeFd, &signals, sizeof(signals));
+        (void) ignored;
+
+        std::vector<std::pair<unsigned long long, std::string> > responses;
+        {
+            std::lock_guard<std::mutex> lock(completions->mutex);
+            responses.swap(completions->responses);
+        }
+        for (auto &response: responses) {
+            // Responses of clients that already left are dropped
+            auto it = clients.find(response.first);
+            if (it == clients.end())
+                continue;
+            it->second.output.push_back(std::move(response.second));
+            it->second.received++;
+            touched.push_back(response.first);
+        }
+    }
+
+    /**
+     * @brief Reads what a client sent and submits every complete request line in it
+     * @return False if the client must be dropped
+     */
+    bool readRequests(Client &client) {
+        ssize_t n = recv(client.fd, buffer.data(), buffer.size(), 0);
+        if (n < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+
+        if (n == 0) {
+            client.readClosed = true;
+        } else {
+            client.input.append(buffer.data(), static_cast<size_t>(n));
+        }
+        return submitRequests(client);
+    }
+
+    /**
+     * @brief Gets the number of requests a client may have outstanding
+     * @return The smaller of MAX_BACKLOG and the bulk queue limit
+     */
+    size_t backlogLimit() const {
+        return std::min(MAX_BACKLOG, server.policy.bulkQueueLimit);
+    }
+
+    /**
+     * @brief Gets the number of requests of a client not yet answered or whose response is unsent
+     */
+    static size_t backlog(const Client &client) {
+        return static_cast<size_t>(client.submitted - client.received) + client.output.size();
+    }
+
+    /**
+     * @brief Submits complete request lines of a client while its backlog has room; the rest wait in its input
+     * @return False if the client must be dropped
+     */
+    bool submitRequests(Client &client) {
+        size_t room = backlogLimit() - std::min(backlog(client), backlogLimit());
+        std::vector<std::string> lines;
+        size_t start = 0;
+        size_t end = client.input.find('\n');
+        for (; end != std::string::npos && lines.size() < room; end = client.input.find('\n', start)) {
+            std::string line = client.input.substr(start, end - start);
+            if (!isBlank(line))
+                lines.push_back(std::move(line));
+            start = end + 1;
+        }
+        client.input.erase(0, start);
+
+        if (end == std::string::npos) {
+            // A last request without a newline is still answered
+            if (client.readClosed && lines.size() < room) {
+                if (!isBlank(client.input))
+                    lines.push_back(client.input);
+                client.input.clear();
+            }
+            if (client.input.size() > MAX_LINE)
+                return false;
+        }
+
+        if (!lines.empty()) {
+            client.submitted += lines.size();
+            server.submit(client.connection, lines);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Writes as many ready responses as the socket takes, each followed by a newline
+     * @return False if the client must be dropped
+     */
+    bool writeResponses(Client &client) {
+        static char newline = '\n';
+        while (!client.output.empty()) {
+            iovec vectors[2 * MAX_GATHER];
+            size_t count = 0;
+            size_t skip = client.offset;
+            for (auto it = client.output.begin(); it != client.output.end() && count < 2 * MAX_GATHER; ++it) {
+                if (skip < it->size()) {
+                    vectors[count++] = iovec{const_cast<char *>(it->data()) + skip, it->size() - skip};
+                }
+                vectors[count++] = iovec{&newline, 1};
+                skip = 0;
+            }
+
+            msghdr message{};
+            message.msg_iov = vectors;
+            message.msg_iovlen = count;
+            ssize_t n = sendmsg(client.fd, &message, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+
+            size_t sent = static_cast<size_t>(n);
+            while (sent > 0) {
+                size_t left = client.output.front().size() + 1 - client.offset;
+                if (sent < left) {
+                    client.offset += sent;
+                    break;
+                }
+                sent -= left;
+                client.offset = 0;
+                client.output.pop_front();
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Settles every client touched during the current round of events
+     */
+    void settleTouched() {
+        for (auto id: touched) {
+            auto it = clients.find(id);
+            if (it != clients.end()) {
+                settle(id, it->second);
+            }
+        }
+        touched.clear();
+    }
+
+    /**
+     * @brief Writes what is ready, then closes the client if it is done or updates the events it waits for
+     */
+    void settle(unsigned long long id, Client &client) {
+        if (!writeResponses(client) || !submitRequests(client)) {
+            drop(id);
+            return;
+        }
+        if (client.readClosed && client.received == client.submitted && client.output.empty() &&
+            client.input.empty()) {
+            drop(id);
+            return;
+        }
+
+        // A client that does not read its responses, or whose held requests wait for room, is not read from
+        bool readable = !client.readClosed && backlog(client) < backlogLimit() &&
+                        client.input.find('\n') == std::string::npos;
+        uint32_t interest = (readable ? static_cast<uint32_t>(EPOLLIN) : 0u) |
+                            (client.output.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+        if (interest != client.interest) {
+            epoll_event event{};
+            event.events = interest;
+            event.data.u64 = id;
+            epoll_ctl(pollFd, EPOLL_CTL_MOD, client.fd, &event);
+            client.interest = interest;
+        }
+    }
+
+    void drop(unsigned long long id) {
+        auto it = clients.find(id);
+        it->second.connection->token.cancel();
+        epoll_ctl(pollFd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+        close(it->second.fd);
+        clients.erase(it);
+    }
+};
+
+const unsigned long long QueryServer::EventLoop::LISTENER;
+const unsigned long long QueryServer::EventLoop::WAKE;
+const unsigned long long QueryServer::EventLoop::FIRST_CLIENT;
+const size_t QueryServer::EventLoop::READ_SIZE;
+const size_t QueryServer::EventLoop::MAX_LINE;
+const size_t QueryServer::EventLoop::MAX_BACKLOG;
+constexpr std::chrono::seconds QueryServer::EventLoop::DRAIN_TIMEOUT;
+const int QueryServer::EventLoop::MAX_EVENTS;
+const int QueryServer::EventLoop::MAX_GATHER;
+
+bool QueryServer::serveSocket(const std::string &path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path is too long: " << path << std::endl;
+        return false;
+    }
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    int socketFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socketFd < 0) {
+        std::cerr << "Could not create a socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    unlink(path.c_str());
+    if (bind(socketFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+        listen(socketFd, SOMAXCONN) < 0) {
+        std::cerr << "Could not listen on " << path << ": " << std::strerror(errno) << std::endl;
+        close(socketFd);
+        return false;
+    }
+
+    int pollFd = epoll_create1(EPOLL_CLOEXEC);
+    int wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    bool served = false;
+    if (pollFd < 0 || wakeFd < 0) {
+        std::cerr << "Could not set up the event loop: " << std::strerror(errno) << std::endl;
+    } else {
+        listener = socketFd;
+        {
+            EventLoop loop(*this, socketFd, pollFd, wakeFd);
+            served = loop.run();
+        }
+        listener = -1;
+    }
+
+    if (wakeFd >= 0)
+        close(wakeFd);
+    if (pollFd >= 0)
+        close(pollFd);
+    close(socketFd);
+    unlink(path.c_str());
+    return served;
+}
+
+void QueryServer::stop() {
+    stopRequested = true;
+    int socketFd = listener.load();
+    if (socketFd >= 0) {
+        // Makes the listener readable, which wakes the loop; the descriptor itself is closed by serveSocket
+        shutdown(socketFd, SHUT_RDWR);
+    }
+}
+
+#else
+
+bool QueryServer::serveSocket(const std::string &path) {
+    std::cerr << "Socket serving needs epoll, which this platform lacks; cannot serve " << path << std::endl;
+    return false;
+}
+
+void QueryServer::stop() {
+    stopRequested = true;
+}
+
+#endif
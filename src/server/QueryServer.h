@@ -0,0 +1,287 @@
+#ifndef QUERYSERVER_H
+#define QUERYSERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../routing/BatchEngine.h"
+#include "../routing/GraphSnapshot.h"
+#include "../routing/LiveTraffic.h"
+#include "../routing/SearchBudget.h"
+
+/**
+ * @class QueryServer
+ * @brief Answers route requests, one per line, for as long as the process runs
+ *
+ * A request is a line of input-file keys separated by semicolons, as read by
+ * BatchEngine::parseRequest, and its response is the matching output-file block on one line,
+ * its lines separated by semicolons too. Requests are answered by a fixed pool of workers on
+ * the published GraphSnapshot, so the dataset is loaded once and can be reloaded without
+ * stopping the server. Requests of one client are answered concurrently, but their responses
+ * are written in the order the requests came in.
+ *
+ * Clients talk over a stream, such as standard input and output, or over a Unix-domain socket
+ * where every connection is a client of its own. Socket clients are served by one event-loop
+ * thread built on epoll: it reads whatever requests a client has pipelined, hands them to the
+ * workers in one go, and writes the responses that are ready with one gathering write, so
+ * connections cost no thread of their own and the workers keep the other cores.
+ *
+ * A line starting with Update: instead carries travel-time updates, rows of the distances file
+ * separated by semicolons. They are applied with LiveTraffic::publish as a bulk request, and
+ * answered with the number of edges changed and a message per rejected row. Requests already
+ * running, or queued before the update and not yet started, may still be answered on the
+ * snapshot before it. Workers keep their search trees in private caches, which LiveTraffic does
+ * not repair; each worker clears its own when it first serves the new snapshot.
+ *
+ * Requests are scheduled in two classes. Interactive requests are always taken first, and bulk
+ * requests, eco and multi-stop ones unless a request says otherwise, may only occupy all but
+ * one worker, so cheap requests never wait behind expensive ones. Each class has a bounded
+ * queue: a request arriving at a full queue is turned away at once. Every request runs under a
+ * SearchBudget with a deadline counted from its arrival, and a socket client that disconnects
+ * cancels its outstanding requests.
+ */
+class QueryServer {
+public:
+    /**
+     * @brief Limits of the scheduler
+     */
+    struct Policy {
+        double interactiveTimeLimit; /**< Default time limit of interactive requests, in milliseconds */
+        double bulkTimeLimit; /**< Default time limit of bulk requests, in milliseconds */
+        size_t interactiveQueueLimit; /**< Interactive requests that may wait for a worker */
+        size_t bulkQueueLimit; /**< Bulk requests that may wait for a worker */
+
+        Policy() : interactiveTimeLimit(2000), bulkTimeLimit(30000), interactiveQueueLimit(4096), bulkQueueLimit(256) {
+        }
+    };
+
+    /**
+     * @brief Starts the worker pool with the default policy
+     * @param threads Number of workers, 0 to use every hardware thread
+     * @details O(T) where T is the number of workers
+     */
+    explicit QueryServer(unsigned int threads = 0);
+
+    /**
+     * @brief Starts the worker pool
+     * @param threads Number of workers, 0 to use every hardware thread
+     * @param policy Limits of the scheduler
+     * @details O(T) where T is the number of workers
+     */
+    QueryServer(unsigned int threads, const Policy &policy);
+
+    /**
+     * @brief Stops and joins the workers once every queued request is answered
+     * @details O(T), plus the queued requests
+     */
+    ~QueryServer();
+
+    QueryServer(const QueryServer &) = delete;
+
+    QueryServer &operator=(const QueryServer &) = delete;
+
+    /**
+     * @brief Serves one client over a pair of streams
+     *
+     * Reading stops while the queue of the next request is full, so requests piped in faster
+     * than they are answered wait for room instead of being turned away.
+     *
+     * @param in Stream the requests are read from
+     * @param out Stream the responses are written to, flushed after every response
+     * @details Returns once the input ends and every response is written
+     */
+    void serveStream(std::istream &in, std::ostream &out);
+
+    /**
+     * @brief Serves every client that connects to a Unix-domain socket from the calling thread
+     *
+     * A client with as many requests outstanding as the bulk queue holds, or that stops reading
+     * its responses, is not read from until it catches up, so pipelining alone never fills a
+     * queue. A
+     * client that disconnects has its outstanding responses dropped. After stop, clients are
+     * no longer read from; each is closed once the requests it already sent are answered, and
+     * any left after a few seconds are closed regardless. Only available on Linux.
+     *
+     * @param path Path of the socket; a stale file at the path is replaced
+     * @return False if the socket could not be opened
+     * @details Returns after stop, once every client is closed
+     */
+    bool serveSocket(const std::string &path);
+
+    /**
+     * @brief Makes serveSocket stop accepting clients, drain the connected ones and return
+     * @details O(1)
+     */
+    void stop();
+
+    /**
+     * @brief Gets the number of workers
+     * @return The number of workers
+     * @details O(1)
+     */
+    unsigned int getThreadCount() const {
+        return static_cast<unsigned int>(workers.size());
+    }
+
+private:
+    /**
+     * @class Connection
+     * @brief Puts the responses of one client back in request order
+     */
+    class Connection;
+
+    /**
+     * @class EventLoop
+     * @brief The epoll loop of serveSocket
+     */
+    class EventLoop;
+
+    /** @brief Index of the interactive queue */
+    static const int INTERACTIVE = 0;
+
+    /** @brief Index of the bulk queue */
+    static const int BULK = 1;
+
+    /** @brief Key that starts a line of travel-time updates */
+    static const std::string UPDATE_KEY;
+
+    /**
+     * @brief A request waiting for a worker
+     */
+    struct Job {
+        std::shared_ptr<Connection> connection; /**< Client to answer */
+        unsigned long long sequence; /**< Position of the request among the client's requests */
+        BatchEngine::Request request; /**< The request */
+        SearchBudget::Clock::time_point deadline; /**< Time by which the request must be answered */
+        std::vector<LiveTraffic::TravelTimeUpdate> updates; /**< Travel-time updates to publish instead of the request, if any */
+    };
+
+    /**
+     * @brief A snapshot with the location code of every location ID of its graph
+     */
+    struct Context {
+        GraphSnapshot::Handle snapshot;
+        std::unordered_map<int, std::string> codeOf;
+    };
+
+    /** @brief The worker threads */
+    std::vector<std::thread> workers;
+
+    /** @brief Guards the queue */
+    std::mutex mutex;
+
+    /** @brief Wakes a worker when a request is queued or the server stops */
+    std::condition_variable wake;
+
+    /** @brief Wakes a reader waiting for room when a worker takes a request or the server stops */
+    std::condition_variable room;
+
+    /** @brief Limits of the scheduler */
+    Policy policy;
+
+    /** @brief Requests waiting for a worker, by class, oldest first */
+    std::deque<Job> queues[2];
+
+    /** @brief Workers busy with bulk requests */
+    unsigned int runningBulk;
+
+    /** @brief Workers bulk requests may occupy at once */
+    unsigned int bulkWorkers;
+
+    /** @brief Set when the server is being destroyed */
+    bool stopping;
+
+    /** @brief Listening socket of serveSocket, -1 when not listening */
+    std::atomic<int> listener;
+
+    /** @brief Set by stop */
+    std::atomic<bool> stopRequested;
+
+    /** @brief Context of the last snapshot requests were answered on */
+    static std::shared_ptr<const Context> context;
+
+    /** @brief Guards context */
+    static std::mutex contextMutex;
+
+    /**
+     * @brief Body of every worker: answers queued requests, interactive ones first
+     * @details O(R * Q / T) for R requests
+     */
+    void work();
+
+    /**
+     * @brief Tells whether a waiting worker may take a request; the caller holds the queue lock
+     * @return True if an interactive request waits, or a bulk one and a bulk slot is free
+     * @details O(1)
+     */
+    bool hasRunnable() const;
+
+    /**
+     * @brief Reads the travel-time updates of an Update: line
+     * @param rows What follows the key: Location1,Location2,Mode,Time rows separated by semicolons
+     * @param updates Receives the updates
+     * @param error Receives why the line was rejected
+     * @return False if a row is malformed or there is none
+     * @details O(N) where N is the length of the line
+     */
+    static bool parseUpdates(
+        const std::string &rows,
+        std::vector<LiveTraffic::TravelTimeUpdate> &updates,
+        std::string &error);
+
+    /**
+     * @brief Answers a request on the published snapshot within its budget
+     * @param job The request
+     * @return The response line
+     * @details O(Q) where Q is the cost of the query, bounded by its deadline
+     */
+    std::string respond(const Job &job) const;
+
+    /**
+     * @brief Reads a request of a client and queues it, or answers it at once if it is malformed or its queue is full
+     * @param connection The client
+     * @param line The request
+     * @param waitForRoom If true, a request whose queue is full waits for room instead of being turned away
+     * @details O(N) where N is the length of the line
+     */
+    void submit(const std::shared_ptr<Connection> &connection, const std::string &line, bool waitForRoom = false);
+
+    /**
+     * @brief Reads several requests of a client and queues them at once
+     * @param connection The client
+     * @param lines The requests, in order
+     * @param waitForRoom If true, a request whose queue is full waits for room instead of being turned away
+     * @details O(N) where N is the length of the lines
+     */
+    void submit(
+        const std::shared_ptr<Connection> &connection,
+        const std::vector<std::string> &lines,
+        bool waitForRoom = false);
+
+    /**
+     * @brief Gets the context of the published snapshot, building it when the snapshot changed
+     * @return The context, or nullptr if no snapshot was published
+     * @details O(1), O(V) when the snapshot changed
+     */
+    static std::shared_ptr<const Context> getContext();
+
+    /**
+     * @brief Formats a result on one line
+     * @param request The request
+     * @param result Its result
+     * @return The lines of BatchEngine::formatResult, separated by semicolons
+     * @details O(N) where N is the length of the routes
+     */
+    static std::string formatResponse(const BatchEngine::Request &request, const BatchEngine::Result &result);
+};
+
+#endif // QUERYSERVER_H